@@ -0,0 +1,61 @@
+# Defines compiled into every shader permutation. Permutation i sets the define at position j to
+# bit j of i, matching the ShaderPermutationFlags in src/shader_permutations.h.
+set(SHADER_PERMUTATION_DEFINES RADIUS_CUTOFF DEBUG_MODE HALF_PRECISION RDM_RECONSTRUCT)
+
+# writes a file only if its content changed, so that reconfiguring doesn't recompile every shader
+function(write_if_changed FILE CONTENT)
+	if (EXISTS "${FILE}")
+		file(READ "${FILE}" OLD_CONTENT)
+		if ("${OLD_CONTENT}" STREQUAL "${CONTENT}")
+			return()
+		endif()
+	endif()
+	file(WRITE "${FILE}" "${CONTENT}")
+endfunction()
+
+# Compiles a compute shader once per combination of SHADER_PERMUTATION_DEFINES. Every permutation
+# gets a generated wrapper that sets the defines and includes FILE, the same way NIS_Upscale_Stereo.hlsl
+# wraps NIS_Upscale.hlsl, and is compiled to ${OUT_NAME}_<i>.h with variable ${VAR_NAME}_<i>.
+# ${OUT_NAME}.h then collects them in the ShaderBytecode table ${VAR_NAME}, indexed by permutation.
+# The wrappers are appended to the list OUT_FILES, which must be added to the target's sources.
+# With SHADER_PERMUTATIONS_STUB set, placeholder bytecode is written instead of compiling anything,
+# so that the mapping can be checked on platforms without the shader compiler.
+function(add_compute_shader_permutations FILE OUT_NAME VAR_NAME OUT_FILES)
+	get_filename_component(SOURCE_PATH "${FILE}" ABSOLUTE)
+	set(WRAPPER_DIR "${CMAKE_CURRENT_BINARY_DIR}/shaders")
+	list(LENGTH SHADER_PERMUTATION_DEFINES DEFINE_COUNT)
+	math(EXPR LAST_PERMUTATION "(1 << ${DEFINE_COUNT}) - 1")
+
+	set(TABLE "// generated from ${FILE}, do not edit\n#pragma once\n#include \"shader_permutations.h\"\n\n")
+	set(ENTRIES "")
+	set(WRAPPERS "")
+	foreach(INDEX RANGE ${LAST_PERMUTATION})
+		set(WRAPPER "// generated from ${FILE}, do not edit\n")
+		set(DEFINES "")
+		set(BIT 0)
+		foreach(DEFINE ${SHADER_PERMUTATION_DEFINES})
+			math(EXPR VALUE "(${INDEX} >> ${BIT}) & 1")
+			string(APPEND WRAPPER "#define ${DEFINE} ${VALUE}\n")
+			list(APPEND DEFINES "${DEFINE}=${VALUE}")
+			math(EXPR BIT "${BIT} + 1")
+		endforeach()
+		string(APPEND WRAPPER "#include \"${SOURCE_PATH}\"\n")
+		string(REPLACE ";" " " DEFINES "${DEFINES}")
+
+		set(WRAPPER_FILE "${WRAPPER_DIR}/${OUT_NAME}_${INDEX}.hlsl")
+		write_if_changed("${WRAPPER_FILE}" "${WRAPPER}")
+		if (SHADER_PERMUTATIONS_STUB)
+			write_if_changed("${CMAKE_CURRENT_BINARY_DIR}/${OUT_NAME}_${INDEX}.h" "static const unsigned char ${VAR_NAME}_${INDEX}[] = { ${INDEX} };\n")
+		else()
+			set_compute_shader("${WRAPPER_FILE}" "${OUT_NAME}_${INDEX}.h" "${VAR_NAME}_${INDEX}")
+		endif()
+		list(APPEND WRAPPERS "${WRAPPER_FILE}")
+
+		string(APPEND TABLE "#include \"${OUT_NAME}_${INDEX}.h\"\n")
+		string(APPEND ENTRIES "\t{ ${VAR_NAME}_${INDEX}, sizeof(${VAR_NAME}_${INDEX}), \"${DEFINES}\" },\n")
+	endforeach()
+
+	string(APPEND TABLE "\nstatic const vrperfkit::ShaderBytecode ${VAR_NAME}[] = {\n${ENTRIES}};\n")
+	write_if_changed("${CMAKE_CURRENT_BINARY_DIR}/${OUT_NAME}.h" "${TABLE}")
+	set(${OUT_FILES} ${${OUT_FILES}} ${WRAPPERS} PARENT_SCOPE)
+endfunction()
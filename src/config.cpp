@@ -3,6 +3,8 @@
 #include "logging.h"
 #include "yaml-cpp/yaml.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 namespace fs = std::filesystem;
@@ -92,26 +94,97 @@ namespace vrperfkit {
 		return "Unknown";
 	}
 
+	DynamicControllerType DynamicControllerFromString(std::string s) {
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+		if (s == "pid") {
+			return DynamicControllerType::PID;
+		}
+		if (s == "predictive") {
+			return DynamicControllerType::PREDICTIVE;
+		}
+		LOG_INFO << "Unknown dynamic controller " << s << ", defaulting to pid";
+		return DynamicControllerType::PID;
+	}
+
+	std::string DynamicControllerToString(DynamicControllerType type) {
+		switch (type) {
+		case DynamicControllerType::PID:
+			return "pid";
+		case DynamicControllerType::PREDICTIVE:
+			return "predictive";
+		}
+
+		return "Unknown";
+	}
+
 	std::string PrintToggle(bool toggle) {
 		return toggle ? "enabled" : "disabled";
 	}
 
 	Config g_config;
+	FrameState g_frameState;
+	std::atomic<uint32_t> g_configGeneration { 0 };
 
-	void LoadConfig(const fs::path &configPath) {
-		g_config = Config();
+	namespace {
+		std::shared_ptr<const Config> g_publishedConfig = std::make_shared<Config>();
+		// only touched by the render thread, g_config differs from the default until the first publish
+		bool g_configChanged = true;
+	}
 
-		if (!exists(configPath)) {
-			LOG_ERROR << "Config file not found, falling back to defaults";
+	void PublishConfig() {
+		if (!g_configChanged) {
 			return;
 		}
+		g_configChanged = false;
+		std::atomic_store(&g_publishedConfig, std::shared_ptr<const Config>(std::make_shared<Config>(g_config)));
+		g_configGeneration.fetch_add(1, std::memory_order_release);
+	}
+
+	void MarkConfigChanged() {
+		g_configChanged = true;
+	}
+
+	std::shared_ptr<const Config> CurrentConfig() {
+		return std::atomic_load(&g_publishedConfig);
+	}
+
+	namespace {
+		// catches values that would break rendering rather than just look bad
+		bool ValidateConfig(const Config &config) {
+			bool valid = true;
+			auto check = [&valid](bool condition, const char *message) {
+				if (!condition) {
+					LOG_ERROR << "Invalid configuration: " << message;
+					valid = false;
+				}
+			};
+			check(std::isfinite(config.upscaling.targetFrameTime) && config.upscaling.targetFrameTime > 0
+					&& std::isfinite(config.upscaling.marginFrameTime) && config.upscaling.marginFrameTime > 0, "upscaling targetFPS and marginFPS must be positive");
+			check(config.ffr.innerRadius <= config.ffr.midRadius && config.ffr.midRadius <= config.ffr.outerRadius, "fixedFoveated radii must not decrease from inner to outer");
+			if (config.ffr.dynamic && config.ffr.dynamicChangeRadius) {
+				check(config.ffr.minRadius <= config.ffr.maxRadius, "fixedFoveated minRadius must not exceed innerRadius");
+			}
+			if (config.hiddenMask.dynamic && config.hiddenMask.dynamicChangeRadius) {
+				check(config.hiddenMask.minRadius <= config.hiddenMask.maxRadius, "hiddenMask minRadius must not exceed edgeRadius");
+			}
+			return valid;
+		}
+	}
+
+	bool ParseConfigFile(const fs::path &configPath, ConfigFile &file) {
+		if (!exists(configPath)) {
+			LOG_ERROR << "Config file not found";
+			return false;
+		}
 
+		ConfigFile parsed;
+		Config &config = parsed.config;
 		try {
 			std::ifstream cfgFile (configPath);
 			YAML::Node cfg = YAML::Load(cfgFile);
 
 			YAML::Node upscaleCfg = cfg["upscaling"];
-			UpscaleConfig &upscaling= g_config.upscaling;
+			UpscaleConfig &upscaling= config.upscaling;
 			upscaling.enabled = upscaleCfg["enabled"].as<bool>(upscaling.enabled);
 			upscaling.method = MethodFromString(upscaleCfg["method"].as<std::string>(MethodToString(upscaling.method)));
 			upscaling.renderScale = sqrt(upscaleCfg["renderScale"].as<float>(upscaling.renderScale) / 100.00f);
@@ -122,15 +195,27 @@ namespace vrperfkit {
 			upscaling.sharpness = std::max(0.f, upscaleCfg["sharpness"].as<float>(upscaling.sharpness));
 			upscaling.radius = std::max(0.f, upscaleCfg["radius"].as<float>(upscaling.radius));
 			upscaling.applyMipBias = upscaleCfg["applyMipBias"].as<bool>(upscaling.applyMipBias);
+			upscaling.fusedStereo = upscaleCfg["fusedStereo"].as<bool>(upscaling.fusedStereo);
+			upscaling.halfPrecision = upscaleCfg["halfPrecision"].as<bool>(upscaling.halfPrecision);
+			upscaling.deferredContext = upscaleCfg["deferredContext"].as<bool>(upscaling.deferredContext);
+			upscaling.outputTextures = std::clamp(upscaleCfg["outputTextures"].as<int>(upscaling.outputTextures), 1, 4);
+			upscaling.dynamic = upscaleCfg["dynamic"].as<bool>(upscaling.dynamic);
+			upscaling.dynamicMinScale = sqrt(std::clamp(upscaleCfg["dynamicMinScale"].as<float>(upscaling.dynamicMinScale * upscaling.dynamicMinScale * 100.f), 10.f, 100.f) / 100.f);
+			upscaling.dynamicDecreaseStep = std::clamp(upscaleCfg["dynamicDecreaseStep"].as<float>(upscaling.dynamicDecreaseStep), 0.001f, 1.f);
+			upscaling.dynamicIncreaseStep = std::clamp(upscaleCfg["dynamicIncreaseStep"].as<float>(upscaling.dynamicIncreaseStep), 0.001f, 1.f);
+			upscaling.targetFrameTime = 1.f / upscaleCfg["targetFPS"].as<float>(1.f / upscaling.targetFrameTime);
+			upscaling.marginFrameTime = 1.f / upscaleCfg["marginFPS"].as<float>(1.f / upscaling.marginFrameTime);
+			upscaling.dynamicController = DynamicControllerFromString(upscaleCfg["dynamicController"].as<std::string>(DynamicControllerToString(upscaling.dynamicController)));
+			upscaling.dynamicSmoothing = std::clamp(upscaleCfg["dynamicSmoothing"].as<float>(upscaling.dynamicSmoothing), 0.01f, 1.f);
 
 			YAML::Node dxvkCfg = cfg["dxvk"];
-			DxvkConfig &dxvk = g_config.dxvk;
+			DxvkConfig &dxvk = config.dxvk;
 			dxvk.enabled = dxvkCfg["enabled"].as<bool>(dxvk.enabled);
 			dxvk.dxgiDllPath = dxvkCfg["dxgiDllPath"].as<std::string>(dxvk.dxgiDllPath);
 			dxvk.d3d12DllPath = dxvkCfg["d3d12DllPath"].as<std::string>(dxvk.d3d12DllPath);
 
 			YAML::Node ffrCfg = cfg["fixedFoveated"];
-			FixedFoveatedConfig &ffr = g_config.ffr;
+			FixedFoveatedConfig &ffr = config.ffr;
 			ffr.enabled = ffrCfg["enabled"].as<bool>(ffr.enabled);
 			ffr.apply = ffr.enabled;
 			ffr.method = FFRMethodFromString(ffrCfg["method"].as<std::string>(FFRMethodToString(ffr.method)));
@@ -146,20 +231,22 @@ namespace vrperfkit {
 			ffr.maxRadius = ffr.innerRadius;
 			ffr.overrideSingleEyeOrder = ffrCfg["overrideSingleEyeOrder"].as<std::string>(ffr.overrideSingleEyeOrder);
 			ffr.fastMode = ffrCfg["fastMode"].as<bool>(ffr.fastMode);
-			g_config.ffrFastModeUsesHRMCount = ffrCfg["fastModeUsesHRMCount"].as<bool>(g_config.ffrFastModeUsesHRMCount);
+			config.ffrFastModeUsesHRMCount = ffrCfg["fastModeUsesHRMCount"].as<bool>(config.ffrFastModeUsesHRMCount);
 			if (!ffr.fastMode) {
-				g_config.ffrFastModeUsesHRMCount = false;
+				config.ffrFastModeUsesHRMCount = false;
 			}
 			ffr.dynamic = ffrCfg["dynamic"].as<bool>(ffr.dynamic);
 			ffr.targetFrameTime = 1.f / ffrCfg["targetFPS"].as<float>(ffr.targetFrameTime);
 			ffr.marginFrameTime = 1.f / ffrCfg["marginFPS"].as<float>(ffr.marginFrameTime);
 			ffr.dynamicChangeRadius= ffrCfg["dynamicChangeRadius"].as<bool>(ffr.dynamicChangeRadius);
+			ffr.dynamicController = DynamicControllerFromString(ffrCfg["dynamicController"].as<std::string>(DynamicControllerToString(ffr.dynamicController)));
+			ffr.dynamicSmoothing = std::clamp(ffrCfg["dynamicSmoothing"].as<float>(ffr.dynamicSmoothing), 0.01f, 1.f);
 			ffr.minRadius = ffrCfg["minRadius"].as<float>(ffr.minRadius);
 			ffr.increaseRadiusStep = ffrCfg["increaseRadiusStep"].as<float>(ffr.increaseRadiusStep);
 			ffr.decreaseRadiusStep = ffrCfg["decreaseRadiusStep"].as<float>(ffr.decreaseRadiusStep);
 
 			YAML::Node hiddenMaskCfg = cfg["hiddenMask"];
-			HiddenRadialMask &hiddenMask= g_config.hiddenMask;
+			HiddenRadialMask &hiddenMask= config.hiddenMask;
 			hiddenMask.enabled = hiddenMaskCfg["enabled"].as<bool>(hiddenMask.enabled);
 			hiddenMask.edgeRadius = std::max(0.f, hiddenMaskCfg["edgeRadius"].as<float>(hiddenMask.edgeRadius));
 			hiddenMask.maxRadius = hiddenMask.edgeRadius;
@@ -171,126 +258,268 @@ namespace vrperfkit {
 			hiddenMask.targetFrameTime = 1.f / hiddenMaskCfg["targetFPS"].as<float>(hiddenMask.targetFrameTime);
 			hiddenMask.marginFrameTime = 1.f / hiddenMaskCfg["marginFPS"].as<float>(hiddenMask.marginFrameTime);
 			hiddenMask.dynamicChangeRadius = hiddenMaskCfg["dynamicChangeRadius"].as<bool>(hiddenMask.dynamicChangeRadius);
+			hiddenMask.dynamicController = DynamicControllerFromString(hiddenMaskCfg["dynamicController"].as<std::string>(DynamicControllerToString(hiddenMask.dynamicController)));
+			hiddenMask.dynamicSmoothing = std::clamp(hiddenMaskCfg["dynamicSmoothing"].as<float>(hiddenMask.dynamicSmoothing), 0.01f, 1.f);
 			hiddenMask.minRadius = hiddenMaskCfg["minRadius"].as<float>(hiddenMask.minRadius);
 			hiddenMask.increaseRadiusStep = hiddenMaskCfg["increaseRadiusStep"].as<float>(hiddenMask.increaseRadiusStep);
 			hiddenMask.decreaseRadiusStep = hiddenMaskCfg["decreaseRadiusStep"].as<float>(hiddenMask.decreaseRadiusStep);
 
-			g_config.debugMode = cfg["debugMode"].as<bool>(g_config.debugMode);
+			config.debugMode = cfg["debugMode"].as<bool>(config.debugMode);
+			config.traceEvents = cfg["traceEvents"].as<bool>(config.traceEvents);
 
-			g_config.dllLoadPath = cfg["dllLoadPath"].as<std::string>(g_config.dllLoadPath);
+			config.dllLoadPath = cfg["dllLoadPath"].as<std::string>(config.dllLoadPath);
 
-			g_config.gameMode = GameModeFromString(cfg["gameMode"].as<std::string>(GameModeToString(g_config.gameMode)));
-			g_config.dynamicFramesCheck = cfg["dynamicFramesCheck"].as<int>(g_config.dynamicFramesCheck);
-			if (g_config.dynamicFramesCheck < 1) {
-				g_config.dynamicFramesCheck = 1;
+			config.gameMode = GameModeFromString(cfg["gameMode"].as<std::string>(GameModeToString(config.gameMode)));
+			config.dynamicFramesCheck = cfg["dynamicFramesCheck"].as<int>(config.dynamicFramesCheck);
+			if (config.dynamicFramesCheck < 1) {
+				config.dynamicFramesCheck = 1;
+			}
+
+			YAML::Node hotkeysCfg = cfg["hotkeys"];
+			parsed.hotkeys.enabled = hotkeysCfg["enabled"].as<bool>(parsed.hotkeys.enabled);
+			if (hotkeysCfg.IsMap()) {
+				for (auto entry : hotkeysCfg) {
+					std::string name = entry.first.as<std::string>();
+					if (name == "enabled") {
+						continue;
+					}
+					std::vector<std::string> &keys = parsed.hotkeys.keys[name];
+					if (entry.second.IsSequence()) {
+						for (auto key : entry.second) {
+							keys.push_back(key.as<std::string>(""));
+						}
+					}
+					else {
+						keys.push_back(entry.second.as<std::string>(""));
+					}
+				}
 			}
 
-			if (g_config.ffr.enabled) {
-				if (g_config.ffr.method == FixedFoveatedMethod::RDM) {
-					g_config.ffr.fastMode = false;
-					g_config.ffrFastModeUsesHRMCount = false;
-					g_config.hiddenMask.enabled = false;
+			if (config.ffr.enabled) {
+				if (config.ffr.method == FixedFoveatedMethod::RDM) {
+					config.ffr.fastMode = false;
+					config.ffrFastModeUsesHRMCount = false;
+					config.hiddenMask.enabled = false;
 					
-					if (!g_config.upscaling.enabled) {
-						g_config.upscaling.enabled = true;
-						g_config.upscaling.radius = g_config.ffr.edgeRadius;
-						g_config.upscaling.method = UpscaleMethod::CAS;
-						g_config.upscaling.renderScale = 1.0f;
-						g_config.upscaling.sharpness = 0.7f;
-						g_config.upscaling.applyMipBias = false;
+					if (!config.upscaling.enabled) {
+						config.upscaling.enabled = true;
+						config.upscaling.radius = config.ffr.edgeRadius;
+						config.upscaling.method = UpscaleMethod::CAS;
+						config.upscaling.renderScale = 1.0f;
+						config.upscaling.sharpness = 0.7f;
+						config.upscaling.applyMipBias = false;
 					}
 
-				} else if (g_config.ffr.method == FixedFoveatedMethod::VRS && !g_config.hiddenMask.enabled && g_config.ffrFastModeUsesHRMCount) {
-					g_config.hiddenMask.enabled = true;
-					g_config.hiddenMask.dynamic = false;
-					g_config.hiddenMask.edgeRadius = 1.15f;
-					g_config.hiddenMask.ignoreFirstTargetRenders = 0;
-					g_config.hiddenMask.ignoreLastTargetRenders = 0;
-					g_config.hiddenMask.preciseResolution = true;
+				} else if (config.ffr.method == FixedFoveatedMethod::VRS && !config.hiddenMask.enabled && config.ffrFastModeUsesHRMCount) {
+					config.hiddenMask.enabled = true;
+					config.hiddenMask.dynamic = false;
+					config.hiddenMask.edgeRadius = 1.15f;
+					config.hiddenMask.ignoreFirstTargetRenders = 0;
+					config.hiddenMask.ignoreLastTargetRenders = 0;
+					config.hiddenMask.preciseResolution = true;
 				}
 			}
+
+			// dynamic adjustments of a disabled feature would never run
+			if (!config.upscaling.enabled) {
+				config.upscaling.dynamic = false;
+			}
+			if (!config.ffr.enabled) {
+				config.ffr.dynamic = false;
+				config.ffr.fastMode = false;
+			}
+			if (!config.hiddenMask.enabled) {
+				config.hiddenMask.dynamic = false;
+			}
 		}
 		catch (const YAML::Exception &e) {
 			LOG_ERROR << "Failed to load configuration file: " << e.msg;
+			return false;
+		}
+
+		if (!ValidateConfig(config)) {
+			return false;
 		}
+		file = parsed;
+		return true;
 	}
 
-	void PrintCurrentConfig() {
-		LOG_INFO << "Current configuration:";
-		LOG_INFO << "  Upscaling is " << PrintToggle(g_config.upscaling.enabled);
-		if (g_config.upscaling.enabled) {
-			LOG_INFO << "    * Method:        " << MethodToString(g_config.upscaling.method);
-			LOG_INFO << "    * Render scale:  " << std::setprecision(6) << g_config.upscaling.renderScale * g_config.upscaling.renderScale * 100 << "%";
-			LOG_INFO << "    * Render factor: " << std::setprecision(6) << g_config.upscaling.renderScale;
-			LOG_INFO << "    * Sharpness:     " << std::setprecision(6) << g_config.upscaling.sharpness;
-			LOG_INFO << "    * Radius:        " << std::setprecision(6) << g_config.upscaling.radius;
-			LOG_INFO << "    * MIP bias:      " << PrintToggle(g_config.upscaling.applyMipBias);
+	void ApplyReloadedConfig(const Config &reloaded) {
+		MarkConfigChanged();
+		Config &config = g_config;
+		bool radiiChanged = config.ffr.innerRadius != reloaded.ffr.innerRadius || config.ffr.midRadius != reloaded.ffr.midRadius
+			|| config.ffr.outerRadius != reloaded.ffr.outerRadius;
+
+#define TAKE(field) config.field = reloaded.field
+		TAKE(upscaling.renderScale);
+		TAKE(upscaling.sharpness);
+		TAKE(upscaling.radius);
+		TAKE(upscaling.applyMipBias);
+		TAKE(upscaling.fusedStereo);
+		TAKE(upscaling.halfPrecision);
+		TAKE(upscaling.deferredContext);
+		TAKE(upscaling.method);
+		TAKE(ffr.innerRadius);
+		TAKE(ffr.midRadius);
+		TAKE(ffr.outerRadius);
+		TAKE(ffr.edgeRadius);
+		TAKE(ffr.favorHorizontal);
+		TAKE(ffr.overrideSingleEyeOrder);
+		TAKE(ffr.preciseResolution);
+		TAKE(ffr.ignoreFirstTargetRenders);
+		TAKE(ffr.ignoreLastTargetRenders);
+		TAKE(ffr.renderOnlyTarget);
+		TAKE(hiddenMask.edgeRadius);
+		TAKE(hiddenMask.preciseResolution);
+		TAKE(hiddenMask.ignoreFirstTargetRenders);
+		TAKE(hiddenMask.ignoreLastTargetRenders);
+		TAKE(hiddenMask.renderOnlyTarget);
+		TAKE(debugMode);
+		TAKE(dynamicFramesCheck);
+#undef TAKE
+
+		std::vector<const char*> ignored;
+#define IGNORE_CHANGE(field) if (!(config.field == reloaded.field)) ignored.push_back(#field)
+		IGNORE_CHANGE(upscaling.enabled);
+		IGNORE_CHANGE(upscaling.outputTextures);
+		IGNORE_CHANGE(upscaling.dynamic);
+		IGNORE_CHANGE(upscaling.dynamicMinScale);
+		IGNORE_CHANGE(upscaling.dynamicDecreaseStep);
+		IGNORE_CHANGE(upscaling.dynamicIncreaseStep);
+		IGNORE_CHANGE(upscaling.targetFrameTime);
+		IGNORE_CHANGE(upscaling.marginFrameTime);
+		IGNORE_CHANGE(upscaling.dynamicController);
+		IGNORE_CHANGE(upscaling.dynamicSmoothing);
+		IGNORE_CHANGE(dxvk.enabled);
+		IGNORE_CHANGE(dxvk.dxgiDllPath);
+		IGNORE_CHANGE(dxvk.d3d12DllPath);
+		IGNORE_CHANGE(gameMode);
+		IGNORE_CHANGE(ffrFastModeUsesHRMCount);
+		IGNORE_CHANGE(ffr.enabled);
+		IGNORE_CHANGE(ffr.method);
+		IGNORE_CHANGE(ffr.fastMode);
+		IGNORE_CHANGE(ffr.dynamic);
+		IGNORE_CHANGE(ffr.dynamicChangeRadius);
+		IGNORE_CHANGE(ffr.dynamicController);
+		IGNORE_CHANGE(ffr.dynamicSmoothing);
+		IGNORE_CHANGE(ffr.targetFrameTime);
+		IGNORE_CHANGE(ffr.marginFrameTime);
+		IGNORE_CHANGE(ffr.minRadius);
+		IGNORE_CHANGE(ffr.decreaseRadiusStep);
+		IGNORE_CHANGE(ffr.increaseRadiusStep);
+		IGNORE_CHANGE(hiddenMask.enabled);
+		IGNORE_CHANGE(hiddenMask.dynamic);
+		IGNORE_CHANGE(hiddenMask.dynamicChangeRadius);
+		IGNORE_CHANGE(hiddenMask.dynamicController);
+		IGNORE_CHANGE(hiddenMask.dynamicSmoothing);
+		IGNORE_CHANGE(hiddenMask.targetFrameTime);
+		IGNORE_CHANGE(hiddenMask.marginFrameTime);
+		IGNORE_CHANGE(hiddenMask.minRadius);
+		IGNORE_CHANGE(hiddenMask.decreaseRadiusStep);
+		IGNORE_CHANGE(hiddenMask.increaseRadiusStep);
+		IGNORE_CHANGE(traceEvents);
+		IGNORE_CHANGE(dllLoadPath);
+#undef IGNORE_CHANGE
+
+		if (radiiChanged) {
+			g_frameState.ffrRadiusChanged[0] = true;
+			g_frameState.ffrRadiusChanged[1] = true;
+		}
+		for (const char *field : ignored) {
+			LOG_INFO << "Changing " << field << " requires restarting the game";
+		}
+	}
+
+	void PrintConfig(const Config &config) {
+		LOG_INFO << "Configuration:";
+		LOG_INFO << "  Upscaling is " << PrintToggle(config.upscaling.enabled);
+		if (config.upscaling.enabled) {
+			LOG_INFO << "    * Method:        " << MethodToString(config.upscaling.method);
+			LOG_INFO << "    * Render scale:  " << std::setprecision(6) << config.upscaling.renderScale * config.upscaling.renderScale * 100 << "%";
+			LOG_INFO << "    * Render factor: " << std::setprecision(6) << config.upscaling.renderScale;
+			LOG_INFO << "    * Sharpness:     " << std::setprecision(6) << config.upscaling.sharpness;
+			LOG_INFO << "    * Radius:        " << std::setprecision(6) << config.upscaling.radius;
+			LOG_INFO << "    * MIP bias:      " << PrintToggle(config.upscaling.applyMipBias);
+			LOG_INFO << "    * Fused stereo:  " << PrintToggle(config.upscaling.fusedStereo);
+			LOG_INFO << "    * Half prec.:    " << PrintToggle(config.upscaling.halfPrecision);
+			LOG_INFO << "    * Output tex:    " << config.upscaling.outputTextures;
+			LOG_INFO << "    * Deferred ctx:  " << PrintToggle(config.upscaling.deferredContext);
+			LOG_INFO << "    * Dynamic:       " << PrintToggle(config.upscaling.dynamic);
+			if (config.upscaling.dynamic) {
+				LOG_INFO << "      * Min scale:   " << std::setprecision(6) << config.upscaling.dynamicMinScale * config.upscaling.dynamicMinScale * 100 << "%";
+				LOG_INFO << "      * Dec step:    " << std::setprecision(6) << config.upscaling.dynamicDecreaseStep;
+				LOG_INFO << "      * Inc step:    " << std::setprecision(6) << config.upscaling.dynamicIncreaseStep;
+				LOG_INFO << "      * Target FPS:  " << std::setprecision(6) << (1.f / config.upscaling.targetFrameTime);
+				LOG_INFO << "      * Margin FPS:  " << std::setprecision(6) << (1.f / config.upscaling.marginFrameTime);
+				LOG_INFO << "      * Controller:  " << DynamicControllerToString(config.upscaling.dynamicController);
+				LOG_INFO << "      * Smoothing:   " << std::setprecision(6) << config.upscaling.dynamicSmoothing;
+			}
 		}
-		LOG_INFO << "  Game Mode:         " << GameModeToString(g_config.gameMode);
-		if ((g_config.ffr.enabled && g_config.ffr.dynamic) || (g_config.hiddenMask.enabled && g_config.hiddenMask.dynamic)) {
-			LOG_INFO << "  Dynamic Frames Check:  " << std::setprecision(6) << g_config.dynamicFramesCheck;
+		LOG_INFO << "  Game Mode:         " << GameModeToString(config.gameMode);
+		if ((config.ffr.enabled && config.ffr.dynamic) || (config.hiddenMask.enabled && config.hiddenMask.dynamic) || config.upscaling.dynamic) {
+			LOG_INFO << "  Dynamic Frames Check:  " << std::setprecision(6) << config.dynamicFramesCheck;
 		}
-		LOG_INFO << "  Fixed foveated rendering is " << PrintToggle(g_config.ffr.enabled);
-		if (g_config.ffr.enabled) {
-			LOG_INFO << "    * Method:        " << FFRMethodToString(g_config.ffr.method);
-			LOG_INFO << "    * Inner radius:  " << std::setprecision(6) << g_config.ffr.innerRadius;
-			LOG_INFO << "    * Mid radius:    " << std::setprecision(6) << g_config.ffr.midRadius;
-			LOG_INFO << "    * Outer radius:  " << std::setprecision(6) << g_config.ffr.outerRadius;
-			if (g_config.ffr.method == FixedFoveatedMethod::RDM) {
-				LOG_INFO << "    * Edge radius:   " << std::setprecision(6) << g_config.ffr.edgeRadius;
+		LOG_INFO << "  Fixed foveated rendering is " << PrintToggle(config.ffr.enabled);
+		if (config.ffr.enabled) {
+			LOG_INFO << "    * Method:        " << FFRMethodToString(config.ffr.method);
+			LOG_INFO << "    * Inner radius:  " << std::setprecision(6) << config.ffr.innerRadius;
+			LOG_INFO << "    * Mid radius:    " << std::setprecision(6) << config.ffr.midRadius;
+			LOG_INFO << "    * Outer radius:  " << std::setprecision(6) << config.ffr.outerRadius;
+			if (config.ffr.method == FixedFoveatedMethod::RDM) {
+				LOG_INFO << "    * Edge radius:   " << std::setprecision(6) << config.ffr.edgeRadius;
 			}
-			LOG_INFO << "    * Precise res:   " << PrintToggle(g_config.ffr.preciseResolution);
-			LOG_INFO << "    * No first rend: " << std::setprecision(6) << g_config.ffr.ignoreFirstTargetRenders;
-			LOG_INFO << "    * No last rend:  " << std::setprecision(6) << g_config.ffr.ignoreLastTargetRenders;
-			LOG_INFO << "    * Render only:   " << std::setprecision(6) << g_config.ffr.renderOnlyTarget;
-			LOG_INFO << "    * Fast mode:     " << PrintToggle(g_config.ffr.fastMode);
-			if (g_config.ffr.fastMode) {
-				LOG_INFO << "      * HRM counter: " << PrintToggle(g_config.ffrFastModeUsesHRMCount);
-			} else if (!g_config.ffr.overrideSingleEyeOrder.empty()) {
-				LOG_INFO << "    * Eye order:     " << g_config.ffr.overrideSingleEyeOrder;
+			LOG_INFO << "    * Precise res:   " << PrintToggle(config.ffr.preciseResolution);
+			LOG_INFO << "    * No first rend: " << std::setprecision(6) << config.ffr.ignoreFirstTargetRenders;
+			LOG_INFO << "    * No last rend:  " << std::setprecision(6) << config.ffr.ignoreLastTargetRenders;
+			LOG_INFO << "    * Render only:   " << std::setprecision(6) << config.ffr.renderOnlyTarget;
+			LOG_INFO << "    * Fast mode:     " << PrintToggle(config.ffr.fastMode);
+			if (config.ffr.fastMode) {
+				LOG_INFO << "      * HRM counter: " << PrintToggle(config.ffrFastModeUsesHRMCount);
+			} else if (!config.ffr.overrideSingleEyeOrder.empty()) {
+				LOG_INFO << "    * Eye order:     " << config.ffr.overrideSingleEyeOrder;
 			}
-			LOG_INFO << "    * Dynamic:       " << PrintToggle(g_config.ffr.dynamic);
-			if (g_config.ffr.dynamic) {
-				LOG_INFO << "      * Target FPS:  " << std::setprecision(6) << (1.f / g_config.ffr.targetFrameTime);
-				LOG_INFO << "      * Target FT:   " << std::setprecision(6) << (g_config.ffr.targetFrameTime * 1000.f) << "ms";
-				LOG_INFO << "      * Margin FPS:  " << std::setprecision(6) << (1.f / g_config.ffr.marginFrameTime);
-				LOG_INFO << "      * Margin FT:   " << std::setprecision(6) << (g_config.ffr.marginFrameTime * 1000.f) << "ms";
-				LOG_INFO << "      * Change radius is " << PrintToggle(g_config.ffr.dynamicChangeRadius);
-				if (g_config.ffr.dynamicChangeRadius) {
-					LOG_INFO << "      * Min radius: " << std::setprecision(6) << g_config.ffr.minRadius;
-					LOG_INFO << "      * Inc radius: " << std::setprecision(6) << g_config.ffr.increaseRadiusStep;
-					LOG_INFO << "      * Dec radius: " << std::setprecision(6) << g_config.ffr.decreaseRadiusStep;
+			LOG_INFO << "    * Dynamic:       " << PrintToggle(config.ffr.dynamic);
+			if (config.ffr.dynamic) {
+				LOG_INFO << "      * Target FPS:  " << std::setprecision(6) << (1.f / config.ffr.targetFrameTime);
+				LOG_INFO << "      * Target FT:   " << std::setprecision(6) << (config.ffr.targetFrameTime * 1000.f) << "ms";
+				LOG_INFO << "      * Margin FPS:  " << std::setprecision(6) << (1.f / config.ffr.marginFrameTime);
+				LOG_INFO << "      * Margin FT:   " << std::setprecision(6) << (config.ffr.marginFrameTime * 1000.f) << "ms";
+				LOG_INFO << "      * Controller:  " << DynamicControllerToString(config.ffr.dynamicController);
+				LOG_INFO << "      * Smoothing:   " << std::setprecision(6) << config.ffr.dynamicSmoothing;
+				LOG_INFO << "      * Change radius is " << PrintToggle(config.ffr.dynamicChangeRadius);
+				if (config.ffr.dynamicChangeRadius) {
+					LOG_INFO << "      * Min radius: " << std::setprecision(6) << config.ffr.minRadius;
+					LOG_INFO << "      * Inc radius: " << std::setprecision(6) << config.ffr.increaseRadiusStep;
+					LOG_INFO << "      * Dec radius: " << std::setprecision(6) << config.ffr.decreaseRadiusStep;
 				}
 			}
-		} else {
-			g_config.ffr.dynamic = false;
-			g_config.ffr.fastMode = false;
 		}
 
-		LOG_INFO << "  Hidden radial mask is " << PrintToggle(g_config.hiddenMask.enabled);
-		if (g_config.hiddenMask.enabled) {
-			LOG_INFO << "    * Edge radius:   " << std::setprecision(6) << g_config.hiddenMask.edgeRadius;
-			LOG_INFO << "    * Precise res:   " << PrintToggle(g_config.hiddenMask.preciseResolution);
-			LOG_INFO << "    * No first rend: " << std::setprecision(6) << g_config.hiddenMask.ignoreFirstTargetRenders;
-			LOG_INFO << "    * No last rend:  " << std::setprecision(6) << g_config.hiddenMask.ignoreLastTargetRenders;
-			LOG_INFO << "    * Render only:   " << std::setprecision(6) << g_config.hiddenMask.renderOnlyTarget;
-			LOG_INFO << "    * Dynamic:       " << PrintToggle(g_config.hiddenMask.dynamic);
-			if (g_config.hiddenMask.dynamic) {
-				LOG_INFO << "      * Target FPS:  " << std::setprecision(6) << (1.f / g_config.hiddenMask.targetFrameTime);
-				LOG_INFO << "      * Target FT:   " << std::setprecision(6) << (g_config.hiddenMask.targetFrameTime * 1000.f) << "ms";
-				LOG_INFO << "      * Margin FPS:  " << std::setprecision(6) << (1.f / g_config.hiddenMask.marginFrameTime);
-				LOG_INFO << "      * Margin FT:   " << std::setprecision(6) << (g_config.hiddenMask.marginFrameTime * 1000.f) << "ms";
-				LOG_INFO << "      * Change radius is " << PrintToggle(g_config.hiddenMask.dynamicChangeRadius);
-				if (g_config.hiddenMask.dynamicChangeRadius) {
-					LOG_INFO << "       - Min radius: " << std::setprecision(6) << g_config.hiddenMask.minRadius;
-					LOG_INFO << "       - Inc radius: " << std::setprecision(6) << g_config.hiddenMask.increaseRadiusStep;
-					LOG_INFO << "       - Dec radius: " << std::setprecision(6) << g_config.hiddenMask.decreaseRadiusStep;
+		LOG_INFO << "  Hidden radial mask is " << PrintToggle(config.hiddenMask.enabled);
+		if (config.hiddenMask.enabled) {
+			LOG_INFO << "    * Edge radius:   " << std::setprecision(6) << config.hiddenMask.edgeRadius;
+			LOG_INFO << "    * Precise res:   " << PrintToggle(config.hiddenMask.preciseResolution);
+			LOG_INFO << "    * No first rend: " << std::setprecision(6) << config.hiddenMask.ignoreFirstTargetRenders;
+			LOG_INFO << "    * No last rend:  " << std::setprecision(6) << config.hiddenMask.ignoreLastTargetRenders;
+			LOG_INFO << "    * Render only:   " << std::setprecision(6) << config.hiddenMask.renderOnlyTarget;
+			LOG_INFO << "    * Dynamic:       " << PrintToggle(config.hiddenMask.dynamic);
+			if (config.hiddenMask.dynamic) {
+				LOG_INFO << "      * Target FPS:  " << std::setprecision(6) << (1.f / config.hiddenMask.targetFrameTime);
+				LOG_INFO << "      * Target FT:   " << std::setprecision(6) << (config.hiddenMask.targetFrameTime * 1000.f) << "ms";
+				LOG_INFO << "      * Margin FPS:  " << std::setprecision(6) << (1.f / config.hiddenMask.marginFrameTime);
+				LOG_INFO << "      * Margin FT:   " << std::setprecision(6) << (config.hiddenMask.marginFrameTime * 1000.f) << "ms";
+				LOG_INFO << "      * Controller:  " << DynamicControllerToString(config.hiddenMask.dynamicController);
+				LOG_INFO << "      * Smoothing:   " << std::setprecision(6) << config.hiddenMask.dynamicSmoothing;
+				LOG_INFO << "      * Change radius is " << PrintToggle(config.hiddenMask.dynamicChangeRadius);
+				if (config.hiddenMask.dynamicChangeRadius) {
+					LOG_INFO << "       - Min radius: " << std::setprecision(6) << config.hiddenMask.minRadius;
+					LOG_INFO << "       - Inc radius: " << std::setprecision(6) << config.hiddenMask.increaseRadiusStep;
+					LOG_INFO << "       - Dec radius: " << std::setprecision(6) << config.hiddenMask.decreaseRadiusStep;
 				}
 			}
-		} else {
-			g_config.hiddenMask.dynamic = false;
 		}
-		LOG_INFO << "  Debug mode is " << PrintToggle(g_config.debugMode);
+		LOG_INFO << "  Debug mode is " << PrintToggle(config.debugMode);
+		LOG_INFO << "  Event tracing is " << PrintToggle(config.traceEvents);
 		FlushLog();
 	}
 }
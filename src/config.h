@@ -1,7 +1,12 @@
 #pragma once
 #include "types.h"
 
+#include <atomic>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace vrperfkit {
 	struct UpscaleConfig {
@@ -11,6 +16,23 @@ namespace vrperfkit {
 		float sharpness = 0.30f;
 		float radius = 0.95f;
 		bool applyMipBias = true;
+		bool fusedStereo = false;
+		bool halfPrecision = false;
+		// number of output textures cycled through, so that we don't write to the one the compositor is still reading
+		int outputTextures = 3;
+		bool deferredContext = false;
+		bool dynamic = false;
+		float dynamicMinScale = 0.70711f;
+		// largest change of the scale factor per controller update
+		float dynamicDecreaseStep = 0.05f;
+		float dynamicIncreaseStep = 0.02f;
+		float targetFrameTime = 0.0111f;
+		float marginFrameTime = 0.0105f;
+		DynamicControllerType dynamicController = DynamicControllerType::PID;
+		float dynamicSmoothing = 0.3f;
+
+		// not actually a config option, but the current dynamic resolution factor on top of renderScale
+		float dynamicScale = 1.f;
 	};
 
 	struct DxvkConfig {
@@ -35,6 +57,8 @@ namespace vrperfkit {
 		bool fastMode = false;
 		bool dynamic = false;
 		bool dynamicChangeRadius = false;
+		DynamicControllerType dynamicController = DynamicControllerType::PID;
+		float dynamicSmoothing = 0.3f;
 		float targetFrameTime = 0.0167f;
 		float marginFrameTime = 0.f;
 		float minRadius = 0.30f;
@@ -45,7 +69,6 @@ namespace vrperfkit {
 		int ignoreFirstTargetRenders = 0;
 		int ignoreLastTargetRenders = 0;
 		int renderOnlyTarget = 0;
-		bool radiusChanged[2] = { true, true };
 	};
 
 	struct HiddenRadialMask {
@@ -53,6 +76,8 @@ namespace vrperfkit {
 		float edgeRadius = 1.15f;
 		bool dynamic = false;
 		bool dynamicChangeRadius = false;
+		DynamicControllerType dynamicController = DynamicControllerType::PID;
+		float dynamicSmoothing = 0.3f;
 		float targetFrameTime = 0.0167f;
 		float marginFrameTime = 0.f;
 		float minRadius = 0.8f;
@@ -69,20 +94,77 @@ namespace vrperfkit {
 		UpscaleConfig upscaling;
 		DxvkConfig dxvk;
 		GameMode gameMode = GameMode::AUTO;
-		bool renderingSecondEye = false;
 		bool ffrFastModeUsesHRMCount = false;
-		bool ffrApplyFastMode = true;
-		int ffrRenderTargetCount = 0;
-		int ffrRenderTargetCountMax = 0;
 		FixedFoveatedConfig ffr;
 		HiddenRadialMask hiddenMask;
 		bool debugMode = false;
+		// records hook events to OpenVRPerfKit.trace for tools/trace_replay
+		bool traceEvents = false;
 		std::string dllLoadPath = "";
 		int dynamicFramesCheck = 1;
 	};
 
+	// Bookkeeping of the frame the game is rendering, only touched from the render thread.
+	struct FrameState {
+		bool renderingSecondEye = false;
+		bool ffrApplyFastMode = true;
+		int ffrRenderTargetCount = 0;
+		int ffrRenderTargetCountMax = 0;
+		// tells VRS to recreate the shading rate patterns of each eye
+		bool ffrRadiusChanged[2] = { true, true };
+	};
+
+	// g_config is only written from the render thread between frames or while handling a frame's submit
+	// (hotkeys, dynamic controllers, falling back after errors), and every writer marks it changed.
+	// Everything that runs while a frame is rendered reads the snapshot published at the last frame
+	// boundary instead, so that a change never applies to only part of a frame.
 	extern Config g_config;
+	extern FrameState g_frameState;
+
+	// the names of the keys bound to each hotkey, as written in the config file
+	struct HotkeyBindings {
+		bool enabled = false;
+		std::map<std::string, std::vector<std::string>> keys;
+	};
+
+	// everything OpenVRPerfKit.yml holds, parsed in one go
+	struct ConfigFile {
+		Config config;
+		HotkeyBindings hotkeys;
+	};
+
+	extern std::atomic<uint32_t> g_configGeneration;
+
+	// makes the current state of g_config visible to ConfigSnapshot, call once per frame after all changes;
+	// does nothing unless MarkConfigChanged was called since it last published
+	void PublishConfig();
+	// call after writing to g_config, or PublishConfig won't pick the change up
+	void MarkConfigChanged();
+	std::shared_ptr<const Config> CurrentConfig();
+
+	// Keeps the snapshot a listener works with and picks up a newly published one on the next access,
+	// which costs a single atomic load as long as nothing changed.
+	class ConfigSnapshot {
+	public:
+		const Config &Get() {
+			uint32_t current = g_configGeneration.load(std::memory_order_acquire);
+			if (config == nullptr || current != generation) {
+				config = CurrentConfig();
+				generation = current;
+			}
+			return *config;
+		}
+		const Config *operator->() { return &Get(); }
+
+	private:
+		std::shared_ptr<const Config> config;
+		uint32_t generation = 0;
+	};
 
-	void LoadConfig(const std::filesystem::path &configPath);
-	void PrintCurrentConfig();
+	// returns false if the file is missing or invalid, in which case file is left untouched
+	bool ParseConfigFile(const std::filesystem::path &configPath, ConfigFile &file);
+	// Takes the settings that can change while the game is running from a reloaded config into g_config.
+	// Anything resources, hooks or dynamic controllers were set up with keeps its current value.
+	void ApplyReloadedConfig(const Config &reloaded);
+	void PrintConfig(const Config &config);
 }
@@ -0,0 +1,149 @@
+#include "config_watcher.h"
+#include "config.h"
+#include "hotkeys.h"
+#include "logging.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+#include "win_header_sane.h"
+
+namespace fs = std::filesystem;
+
+namespace vrperfkit {
+	namespace {
+		const DWORD CONFIG_POLL_INTERVAL_MS = 500;
+
+		HANDLE g_watcherThread = nullptr;
+		// manual reset, tells the watcher to stop
+		HANDLE g_watcherStopEvent = nullptr;
+		// set before the watcher starts and not touched afterwards
+		fs::path g_watchedPath;
+
+		std::mutex g_reloadMutex;
+		// the latest valid config the watcher parsed that the render thread hasn't applied yet
+		std::unique_ptr<Config> g_pendingReload;
+		// lets the render thread skip the lock while nothing is pending
+		std::atomic_bool g_reloadPending = false;
+
+		struct FileStamp {
+			fs::file_time_type writeTime;
+			uintmax_t size = 0;
+
+			bool operator==(const FileStamp &other) const { return writeTime == other.writeTime && size == other.size; }
+			bool operator!=(const FileStamp &other) const { return !(*this == other); }
+		};
+
+		bool GetFileStamp(const fs::path &path, FileStamp &stamp) {
+			std::error_code error;
+			stamp.writeTime = fs::last_write_time(path, error);
+			if (error) {
+				return false;
+			}
+			stamp.size = fs::file_size(path, error);
+			return !error;
+		}
+
+		void WatchConfig(const fs::path &configPath) {
+			FileStamp loaded;
+			GetFileStamp(configPath, loaded);
+			FileStamp seen = loaded;
+
+			while (WaitForSingleObject(g_watcherStopEvent, CONFIG_POLL_INTERVAL_MS) == WAIT_TIMEOUT) {
+				FileStamp current;
+				if (!GetFileStamp(configPath, current) || current == loaded) {
+					continue;
+				}
+				// editors may save in several steps, so wait for the file to stay the same for a moment
+				if (current != seen) {
+					seen = current;
+					continue;
+				}
+				loaded = current;
+
+				LOG_INFO << "Config file changed, reloading";
+				ConfigFile file;
+				if (!ParseConfigFile(configPath, file)) {
+					LOG_ERROR << "Keeping the current configuration";
+					continue;
+				}
+				// the render thread only takes the config, everything else is done here
+				PrintConfig(file.config);
+				LoadHotkeys(file.hotkeys);
+				PrintHotkeys();
+
+				std::lock_guard lock (g_reloadMutex);
+				g_pendingReload = std::make_unique<Config>(file.config);
+				g_reloadPending = true;
+			}
+		}
+
+		// holds a reference to our module like the hotkey thread, see HotkeyThread
+		DWORD WINAPI WatcherThread(LPVOID module) {
+			WatchConfig(g_watchedPath);
+			FreeLibraryAndExitThread((HMODULE)module, 0);
+		}
+	}
+
+	void StartConfigWatcher(const fs::path &configPath) {
+		if (g_watcherThread != nullptr) {
+			return;
+		}
+		HMODULE module;
+		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)&WatcherThread, &module)) {
+			LOG_ERROR << "Failed to reference our module for the config watcher: " << GetLastError();
+			return;
+		}
+		g_watchedPath = configPath;
+		g_watcherStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (g_watcherStopEvent != nullptr) {
+			g_watcherThread = CreateThread(nullptr, 0, &WatcherThread, module, 0, nullptr);
+		}
+		if (g_watcherThread == nullptr) {
+			LOG_ERROR << "Failed to start the config watcher: " << GetLastError();
+			if (g_watcherStopEvent != nullptr) {
+				CloseHandle(g_watcherStopEvent);
+				g_watcherStopEvent = nullptr;
+			}
+			FreeLibrary(module);
+		}
+	}
+
+	void StopConfigWatcher(bool processExiting) {
+		if (g_watcherThread == nullptr) {
+			return;
+		}
+		// nothing to wait for and the event stays open unless the process is exiting, see StopHotkeyThread
+		if (processExiting) {
+			CloseHandle(g_watcherStopEvent);
+			g_watcherStopEvent = nullptr;
+		}
+		else {
+			SetEvent(g_watcherStopEvent);
+		}
+		CloseHandle(g_watcherThread);
+		g_watcherThread = nullptr;
+	}
+
+	bool ApplyConfigReload() {
+		if (!g_reloadPending) {
+			return false;
+		}
+
+		std::unique_ptr<Config> config;
+		{
+			std::lock_guard lock (g_reloadMutex);
+			config = std::move(g_pendingReload);
+			g_reloadPending = false;
+		}
+		if (config == nullptr) {
+			return false;
+		}
+
+		ApplyReloadedConfig(*config);
+		LOG_INFO << "Applied reloaded configuration";
+		return true;
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <filesystem>
+
+namespace vrperfkit {
+	// Watches the config file on a thread of its own and parses it whenever it is saved, so that settings
+	// can be tuned without restarting the game. The watcher logs valid configs and loads their hotkeys,
+	// the settings are applied by the render thread. The thread holds a reference to our module,
+	// so the DLL stays loaded while it runs.
+	void StartConfigWatcher(const std::filesystem::path &configPath);
+	// processExiting: see ShutdownVrPerfkit, the thread is already gone then
+	void StopConfigWatcher(bool processExiting);
+	// takes the latest reloaded config into g_config, call between frames before PublishConfig;
+	// returns whether there was one, so that the caller can update what depends on the changed settings
+	bool ApplyConfigReload();
+}
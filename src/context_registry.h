@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace vrperfkit {
+	// Maps graphics contexts to the object that handles their hooked calls. Meant for lookups on hot
+	// hook paths, where going through the API's private data would take a lock on every call.
+	// Lookups are lock-free and answered from a per-thread cache of the last context seen, which is
+	// invalidated whenever anything is registered or unregistered. Registering and unregistering may
+	// happen concurrently with lookups, but the caller must ensure that nothing still uses a value
+	// after unregistering it, just as with private data.
+	template<typename Value, size_t Capacity = 16>
+	class ContextRegistry {
+	public:
+		// returns false if the registry is full
+		bool Register(const void *context, Value *value) {
+			for (Slot &slot : slots) {
+				const void *expected = nullptr;
+				if (slot.context.load(std::memory_order_relaxed) == nullptr && slot.context.compare_exchange_strong(expected, &reservedMarker, std::memory_order_acquire)) {
+					slot.value.store(value, std::memory_order_relaxed);
+					slot.context.store(context, std::memory_order_release);
+					generation.fetch_add(1, std::memory_order_release);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void Unregister(const void *context) {
+			for (Slot &slot : slots) {
+				if (slot.context.load(std::memory_order_acquire) == context) {
+					slot.value.store(nullptr, std::memory_order_relaxed);
+					slot.context.store(nullptr, std::memory_order_release);
+				}
+			}
+			generation.fetch_add(1, std::memory_order_release);
+		}
+
+		Value *Lookup(const void *context) const {
+			uint32_t currentGeneration = generation.load(std::memory_order_acquire);
+			CacheEntry &entry = cache;
+			if (entry.context == context && entry.registry == this && entry.generation == currentGeneration) {
+				return entry.value;
+			}
+
+			Value *value = nullptr;
+			for (const Slot &slot : slots) {
+				if (slot.context.load(std::memory_order_acquire) == context) {
+					value = slot.value.load(std::memory_order_relaxed);
+					break;
+				}
+			}
+
+			// also remembers contexts without a value, e.g. deferred contexts sharing the hooked vtable
+			entry.registry = this;
+			entry.context = context;
+			entry.value = value;
+			entry.generation = currentGeneration;
+			return value;
+		}
+
+	private:
+		// marks a slot as taken while its value is being filled in
+		static inline const char reservedMarker = 0;
+
+		struct Slot {
+			std::atomic<const void*> context { nullptr };
+			std::atomic<Value*> value { nullptr };
+		};
+
+		struct CacheEntry {
+			const ContextRegistry *registry = nullptr;
+			const void *context = nullptr;
+			Value *value = nullptr;
+			uint32_t generation = 0;
+		};
+
+		Slot slots[Capacity];
+		std::atomic<uint32_t> generation { 1 };
+		static inline thread_local CacheEntry cache;
+	};
+}
@@ -1,5 +1,6 @@
 #include "d3d12_cas_upscaler.h"
 #include "d3d12_helper.h"
+#include "d3d12_shader_cache.h"
 #include "logging.h"
 #include "shader_cas_upscale.h"
 #include "shader_cas_sharpen.h"
@@ -28,18 +29,25 @@ namespace vrperfkit {
 		LOG_INFO << "Creating D3D12 resources for CAS upscaling...";
 		device->GetImmediateContext(context.GetAddressOf());
 
-		CheckResult("creating CAS upscale shader", device->CreateComputeShader(g_CASUpscaleShader, sizeof(g_CASUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating CAS sharpen shader", device->CreateComputeShader(g_CASSharpenShader, sizeof(g_CASSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+		upscaleShader = g_shaderCache.GetComputeShader(device, g_CASUpscaleShader, sizeof(g_CASUpscaleShader));
+		sharpenShader = g_shaderCache.GetComputeShader(device, g_CASSharpenShader, sizeof(g_CASSharpenShader));
 
 		constantsBuffer = CreateConstantsBuffer(device, sizeof(ShaderConstants));
 		sampler = CreateLinearSampler(device);
 	}
 
+	void D3D12CasUpscaler::RegisterShaders() {
+		g_shaderCache.Register(ShaderStage::COMPUTE, g_CASUpscaleShader, sizeof(g_CASUpscaleShader));
+		g_shaderCache.Register(ShaderStage::COMPUTE, g_CASSharpenShader, sizeof(g_CASSharpenShader));
+	}
+
 	void D3D12CasUpscaler::Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) {
 		D3D12_TEXTURE2D_DESC td, otd;
 		input.inputTexture->GetDesc(&td);
 		input.outputTexture->GetDesc(&otd);
 
+		D3D12GpuProfileScope profileScope(profiler, input.inputViewport != outputViewport ? GpuSection::UPSCALE : GpuSection::SHARPEN);
+
 		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
 		ID3D12ShaderResourceView *srvs[1] = {input.inputView};
 		context->CSSetShaderResources(0, 1, srvs);
@@ -48,7 +56,7 @@ namespace vrperfkit {
 		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
 
 		ShaderConstants constants;
-		CasSetup(constants.const0, constants.const1, g_config.upscaling.sharpness, 
+		CasSetup(constants.const0, constants.const1, input.config->upscaling.sharpness, 
 				input.inputViewport.width, input.inputViewport.height,
 				outputViewport.width, outputViewport.height);
 		constants.inputOffset[0] = input.inputViewport.x;
@@ -59,11 +67,11 @@ namespace vrperfkit {
 		constants.inputTextureSize[1] = td.Height;
 		constants.outputTextureSize[0] = otd.Width;
 		constants.outputTextureSize[1] = otd.Height;
-		float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+		float radius = 0.5f * input.config->upscaling.radius * outputViewport.height;
 		constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
 		constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
 		constants.squaredRadius = radius * radius;
-		constants.debugMode = g_config.debugMode;
+		constants.debugMode = input.config->debugMode;
 		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &constants, 0, 0);
 		context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
 
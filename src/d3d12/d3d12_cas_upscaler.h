@@ -10,10 +10,11 @@ namespace vrperfkit {
 	class D3D12CasUpscaler : public D3D12Upscaler {
 	public:
 		D3D12CasUpscaler(ID3D12Device *device);
+		// makes the shaders known to g_shaderCache for prewarming
+		static void RegisterShaders();
 		void Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) override;
 
 	private:
-		ComPtr<ID3D12DeviceContext> context;
 		ComPtr<ID3D12ComputeShader> upscaleShader;
 		ComPtr<ID3D12ComputeShader> sharpenShader;
 		ComPtr<ID3D12Resource> constantsBuffer;
@@ -1,6 +1,7 @@
 #include "d3d12_fsr_upscaler.h"
 
 #include "d3d12_helper.h"
+#include "d3d12_shader_cache.h"
 #include "logging.h"
 #include "shader_fsr_easu.h"
 #include "shader_fsr_rcas.h"
@@ -30,30 +31,40 @@ namespace vrperfkit {
 
 	D3D12FsrUpscaler::D3D12FsrUpscaler(ID3D12Device *device, uint32_t outputWidth, uint32_t outputHeight, DXGI_FORMAT format) {
 		LOG_INFO << "Creating D3D12 resources for FSR upscaling...";
-		CheckResult("creating FSR upscale shader", device->CreateComputeShader(g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating FSR sharpen shader", device->CreateComputeShader(g_FSRSharpenShader, sizeof(g_FSRSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+		upscaleShader = g_shaderCache.GetComputeShader(device, g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader));
+		sharpenShader = g_shaderCache.GetComputeShader(device, g_FSRSharpenShader, sizeof(g_FSRSharpenShader));
 
 		constantsBuffer = CreateConstantsBuffer(device, max(sizeof(UpscaleShaderConstants), sizeof(SharpenShaderConstants)));
-		upscaledTexture = CreatePostProcessTexture(device, outputWidth, outputHeight, format);
-		upscaledView = CreateShaderResourceView(device, upscaledTexture.Get());
-		upscaledUav = CreateUnorderedAccessView(device, upscaledTexture.Get());
+		upscaled.resize(g_config.upscaling.outputTextures);
+		for (Intermediate &intermediate : upscaled) {
+			intermediate.texture = CreatePostProcessTexture(device, outputWidth, outputHeight, format);
+			intermediate.view = CreateShaderResourceView(device, intermediate.texture.Get());
+			intermediate.uav = CreateUnorderedAccessView(device, intermediate.texture.Get());
+		}
 		sampler = CreateLinearSampler(device);
 
 		device->GetImmediateContext(context.GetAddressOf());
 	}
 
+	void D3D12FsrUpscaler::RegisterShaders() {
+		g_shaderCache.Register(ShaderStage::COMPUTE, g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader));
+		g_shaderCache.Register(ShaderStage::COMPUTE, g_FSRSharpenShader, sizeof(g_FSRSharpenShader));
+	}
+
 	void D3D12FsrUpscaler::Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) {
 		D3D12_TEXTURE2D_DESC td;
 		input.inputTexture->GetDesc(&td);
+		const Intermediate &intermediate = upscaled[input.outputSlot % upscaled.size()];
 
 		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
 		ID3D12ShaderResourceView *srvs[1] = {input.inputView};
 		UINT uavCount = -1;
-		ID3D12UnorderedAccessView *uavs[] = {upscaledUav.Get()};
-		float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+		ID3D12UnorderedAccessView *uavs[] = {intermediate.uav.Get()};
+		float radius = 0.5f * input.config->upscaling.radius * outputViewport.height;
 
 		if (input.inputViewport != outputViewport) {
 			// upscaling pass
+			D3D12GpuProfileScope profileScope(profiler, GpuSection::UPSCALE);
 			UpscaleShaderConstants upscaleConstants;
 			FsrEasuConOffset(upscaleConstants.const0, upscaleConstants.const1, upscaleConstants.const2, upscaleConstants.const3,
 				input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
@@ -71,18 +82,19 @@ namespace vrperfkit {
 			context->CSSetShaderResources(0, 1, srvs);
 			context->CSSetShader(upscaleShader.Get(), nullptr, 0);
 			context->Dispatch((outputViewport.width + 15) >> 4, (outputViewport.height + 15) >> 4, 1);
-			srvs[0] = upscaledView.Get();
+			srvs[0] = intermediate.view.Get();
 		}
 
 		// sharpening pass
+		D3D12GpuProfileScope profileScope(profiler, GpuSection::SHARPEN);
 		SharpenShaderConstants sharpenConstants;
-		FsrRcasCon(sharpenConstants.const0, 2.f - 2 * g_config.upscaling.sharpness);
+		FsrRcasCon(sharpenConstants.const0, 2.f - 2 * input.config->upscaling.sharpness);
 		sharpenConstants.const0[2] = outputViewport.x;
 		sharpenConstants.const0[3] = outputViewport.y;
 		sharpenConstants.squaredRadius = radius * radius;
 		sharpenConstants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
 		sharpenConstants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
-		sharpenConstants.debugMode = g_config.debugMode ? 1 : 0;
+		sharpenConstants.debugMode = input.config->debugMode ? 1 : 0;
 		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &sharpenConstants, 0, 0);
 
 		uavs[0] = input.outputUav;
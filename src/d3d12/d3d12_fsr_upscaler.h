@@ -3,6 +3,7 @@
 
 #include <d3d12.h>
 #include <wrl/client.h>
+#include <vector>
 
 using Microsoft::WRL::ComPtr;
 
@@ -10,16 +11,21 @@ namespace vrperfkit {
 	class D3D12FsrUpscaler : public D3D12Upscaler {
 	public:
 		D3D12FsrUpscaler(ID3D12Device *device, uint32_t outputWidth, uint32_t outputHeight, DXGI_FORMAT format);
+		// makes the shaders known to g_shaderCache for prewarming
+		static void RegisterShaders();
 		void Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) override;
 
 	private:
-		ComPtr<ID3D12DeviceContext> context;
 		ComPtr<ID3D12ComputeShader> upscaleShader;
 		ComPtr<ID3D12ComputeShader> sharpenShader;
 		ComPtr<ID3D12Resource> constantsBuffer;
-		ComPtr<ID3D12Resource> upscaledTexture;
-		ComPtr<ID3D12ShaderResourceView> upscaledView;
-		ComPtr<ID3D12UnorderedAccessView> upscaledUav;
+		// one per output texture, so that a frame's upscale pass doesn't wait on the previous frame's sharpen pass
+		struct Intermediate {
+			ComPtr<ID3D12Resource> texture;
+			ComPtr<ID3D12ShaderResourceView> view;
+			ComPtr<ID3D12UnorderedAccessView> uav;
+		};
+		std::vector<Intermediate> upscaled;
 		ComPtr<ID3D12SamplerState> sampler;
 	};
 }
@@ -0,0 +1,243 @@
+#include "d3d12_gpu_profiler.h"
+
+#include "config.h"
+#include "logging.h"
+
+namespace vrperfkit {
+	namespace {
+		const char *SectionName(GpuSection section) {
+			switch (section) {
+			case GpuSection::GAME_RENDER:
+				return "game render";
+			case GpuSection::MASK:
+				return "mask";
+			case GpuSection::UPSCALE:
+				return "upscale";
+			case GpuSection::SHARPEN:
+				return "sharpen";
+			}
+			return "unknown";
+		}
+	}
+
+	float GpuFrameTimings::Total() const {
+		float total = 0;
+		for (float time : section) {
+			total += time;
+		}
+		return total;
+	}
+
+	D3D12GpuProfiler::D3D12GpuProfiler(ID3D12Device *device, ID3D12DeviceContext *context) : context(context), sectionContext(context) {
+		D3D12_QUERY_DESC qd;
+		qd.MiscFlags = 0;
+		for (auto &frame : frames) {
+			qd.Query = D3D12_QUERY_TIMESTAMP_DISJOINT;
+			CheckResult("creating disjoint query", device->CreateQuery(&qd, frame.queryDisjoint.GetAddressOf()));
+			qd.Query = D3D12_QUERY_TIMESTAMP;
+			for (auto &scope : frame.scopes) {
+				CheckResult("creating timestamp query", device->CreateQuery(&qd, scope.queryStart.GetAddressOf()));
+				CheckResult("creating timestamp query", device->CreateQuery(&qd, scope.queryEnd.GetAddressOf()));
+				scope.open = false;
+			}
+		}
+	}
+
+	void D3D12GpuProfiler::BeginFrame() {
+		if (frameActive) {
+			return;
+		}
+
+		FrameQueries &frame = frames[currentFrame];
+		if (frame.pending) {
+			// the GPU has not delivered this slot's results in time; drop it rather than wait for it
+			LOG_DEBUG << "GPU profiler: dropping unresolved frame timings";
+			frame.pending = false;
+			stereoValid = false;
+		}
+
+		context->Begin(frame.queryDisjoint.Get());
+		frame.usedScopes = 0;
+		frameActive = true;
+	}
+
+	void D3D12GpuProfiler::EndFrame(bool completesStereoFrame) {
+		if (!frameActive) {
+			return;
+		}
+
+		FrameQueries &frame = frames[currentFrame];
+		for (int i = 0; i < frame.usedScopes; ++i) {
+			if (frame.scopes[i].open) {
+				context->End(frame.scopes[i].queryEnd.Get());
+				frame.scopes[i].open = false;
+			}
+		}
+		context->End(frame.queryDisjoint.Get());
+		frame.completesStereoFrame = completesStereoFrame;
+		frame.pending = true;
+
+		currentFrame = (currentFrame + 1) % RING_SIZE;
+		frameActive = false;
+
+		ResolveFinishedFrames();
+	}
+
+	void D3D12GpuProfiler::BeginSection(GpuSection section) {
+		if (!frameActive) {
+			return;
+		}
+
+		FrameQueries &frame = frames[currentFrame];
+		if (frame.usedScopes >= MAX_SCOPES) {
+			return;
+		}
+
+		Scope &scope = frame.scopes[frame.usedScopes++];
+		scope.section = section;
+		scope.open = true;
+		sectionContext->End(scope.queryStart.Get());
+	}
+
+	void D3D12GpuProfiler::EndSection(GpuSection section) {
+		if (!frameActive) {
+			return;
+		}
+
+		FrameQueries &frame = frames[currentFrame];
+		for (int i = frame.usedScopes - 1; i >= 0; --i) {
+			Scope &scope = frame.scopes[i];
+			if (scope.open && scope.section == section) {
+				sectionContext->End(scope.queryEnd.Get());
+				scope.open = false;
+				return;
+			}
+		}
+	}
+
+	bool D3D12GpuProfiler::FetchFrameTime(float &seconds) {
+		if (!hasNewFrameTime) {
+			return false;
+		}
+
+		seconds = latestFrameTime;
+		hasNewFrameTime = false;
+		return true;
+	}
+
+	void D3D12GpuProfiler::ResolveFinishedFrames() {
+		// walk from the oldest to the newest slot that is at least READBACK_LATENCY frames old,
+		// stopping at the first one whose results are not yet available to keep frames in order
+		for (int age = RING_SIZE - 1; age >= READBACK_LATENCY; --age) {
+			FrameQueries &frame = frames[(currentFrame - 1 - age + 2 * RING_SIZE) % RING_SIZE];
+			if (!frame.pending) {
+				continue;
+			}
+
+			GpuFrameTimings timings;
+			bool valid = true;
+			if (!ReadFrame(frame, timings, valid)) {
+				break;
+			}
+			frame.pending = false;
+			stereoValid = stereoValid && valid;
+
+			for (int i = 0; i < (int)GpuSection::COUNT; ++i) {
+				stereoTimings.section[i] += timings.section[i];
+			}
+
+			if (frame.completesStereoFrame) {
+				if (stereoValid) {
+					latestFrameTime = stereoTimings.Total();
+					hasNewFrameTime = true;
+					Report(stereoTimings);
+				}
+				stereoTimings = GpuFrameTimings();
+				stereoValid = true;
+				stereoTimelineCount = 0;
+			}
+		}
+	}
+
+	bool D3D12GpuProfiler::ReadFrame(FrameQueries &frame, GpuFrameTimings &timings, bool &valid) {
+		D3D12_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (context->GetData(frame.queryDisjoint.Get(), &disjoint, sizeof(disjoint), D3D12_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			return false;
+		}
+
+		if (disjoint.Disjoint) {
+			// timestamps are unreliable for this frame, e.g. due to a clock change
+			valid = false;
+			return true;
+		}
+
+		int timelineStart = stereoTimelineCount;
+		for (int i = 0; i < frame.usedScopes; ++i) {
+			UINT64 begin, end;
+			if (context->GetData(frame.scopes[i].queryStart.Get(), &begin, sizeof(UINT64), D3D12_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+					|| context->GetData(frame.scopes[i].queryEnd.Get(), &end, sizeof(UINT64), D3D12_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+				// read again in full next time
+				stereoTimelineCount = timelineStart;
+				return false;
+			}
+			if (end > begin) {
+				timings.section[(int)frame.scopes[i].section] += (end - begin) / float(disjoint.Frequency);
+				if (stereoTimelineCount < 2 * MAX_SCOPES) {
+					stereoTimeline[stereoTimelineCount++] = { frame.scopes[i].section, begin, end };
+				}
+			}
+		}
+		timestampFrequency = disjoint.Frequency;
+
+		// masks are drawn while the game is rendering, so don't count them twice
+		float &gameRender = timings.section[(int)GpuSection::GAME_RENDER];
+		gameRender -= timings.section[(int)GpuSection::MASK];
+		if (gameRender < 0) {
+			gameRender = 0;
+		}
+		return true;
+	}
+
+	void D3D12GpuProfiler::Report(const GpuFrameTimings &timings) {
+		if (!g_config.debugMode) {
+			countedFrames = 0;
+			summedTimings = GpuFrameTimings();
+			return;
+		}
+
+		for (int i = 0; i < (int)GpuSection::COUNT; ++i) {
+			summedTimings.section[i] += timings.section[i];
+		}
+		++countedFrames;
+
+		if (countedFrames >= REPORT_INTERVAL) {
+			LOG_DEBUG << "Average GPU frame time over " << countedFrames << " frames: " << 1000.f / countedFrames * summedTimings.Total() << " ms";
+			for (int i = 0; i < (int)GpuSection::COUNT; ++i) {
+				LOG_DEBUG << "  * " << SectionName((GpuSection)i) << ": " << 1000.f / countedFrames * summedTimings.section[i] << " ms";
+			}
+			ReportTimeline();
+			countedFrames = 0;
+			summedTimings = GpuFrameTimings();
+		}
+	}
+
+	void D3D12GpuProfiler::ReportTimeline() {
+		if (stereoTimelineCount == 0) {
+			return;
+		}
+
+		// relative to the earliest section; gaps between sections are the game's work or idle time
+		UINT64 origin = stereoTimeline[0].begin;
+		for (int i = 1; i < stereoTimelineCount; ++i) {
+			if (stereoTimeline[i].begin < origin) {
+				origin = stereoTimeline[i].begin;
+			}
+		}
+		float toMs = 1000.f / timestampFrequency;
+		LOG_DEBUG << "GPU timeline of the latest frame:";
+		for (int i = 0; i < stereoTimelineCount; ++i) {
+			const TimelineEntry &entry = stereoTimeline[i];
+			LOG_DEBUG << "  * " << SectionName(entry.section) << ": " << (entry.begin - origin) * toMs << " - " << (entry.end - origin) * toMs << " ms";
+		}
+	}
+}
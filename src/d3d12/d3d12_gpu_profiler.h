@@ -0,0 +1,109 @@
+#pragma once
+#include "d3d12_helper.h"
+
+namespace vrperfkit {
+	enum class GpuSection {
+		GAME_RENDER,
+		MASK,
+		UPSCALE,
+		SHARPEN,
+		COUNT,
+	};
+
+	struct GpuFrameTimings {
+		float section[(int)GpuSection::COUNT] = {};
+
+		float Total() const;
+	};
+
+	// Measures the GPU time spent on each eye with timestamp queries. Queries are kept in a ring
+	// and only read back several frames later without flushing, so the CPU never waits on the GPU.
+	// A "frame" here spans from the end of the previous eye's post-processing to the end of the
+	// current one. The game's own rendering for that eye is captured as well, from the first render
+	// target or depth clear it sets after the previous submit.
+	class D3D12GpuProfiler {
+	public:
+		D3D12GpuProfiler(ID3D12Device *device, ID3D12DeviceContext *context);
+
+		void BeginFrame();
+		void EndFrame(bool completesStereoFrame);
+		bool IsFrameActive() const { return frameActive; }
+
+		void BeginSection(GpuSection section);
+		void EndSection(GpuSection section);
+		// sections are timed on this context, which may be a deferred one whose work is executed later
+		void SetSectionContext(ID3D12DeviceContext *context) { sectionContext = context; }
+
+		// returns true once per completed stereo frame that has been read back from the GPU
+		bool FetchFrameTime(float &seconds);
+
+	private:
+		static const int RING_SIZE = 8;
+		static const int READBACK_LATENCY = 4;
+		static const int MAX_SCOPES = 8;
+		static const int REPORT_INTERVAL = 500;
+
+		struct Scope {
+			GpuSection section;
+			ComPtr<ID3D12Query> queryStart;
+			ComPtr<ID3D12Query> queryEnd;
+			bool open;
+		};
+
+		struct FrameQueries {
+			ComPtr<ID3D12Query> queryDisjoint;
+			Scope scopes[MAX_SCOPES];
+			int usedScopes = 0;
+			bool completesStereoFrame = false;
+			bool pending = false;
+		};
+
+		ComPtr<ID3D12DeviceContext> context;
+		ID3D12DeviceContext *sectionContext;
+		FrameQueries frames[RING_SIZE];
+		int currentFrame = 0;
+		bool frameActive = false;
+
+		GpuFrameTimings stereoTimings;
+		bool stereoValid = true;
+		float latestFrameTime = 0;
+		bool hasNewFrameTime = false;
+
+		// when each section of the current stereo frame ran, to show in the report where the time goes
+		struct TimelineEntry {
+			GpuSection section;
+			UINT64 begin;
+			UINT64 end;
+		};
+		TimelineEntry stereoTimeline[2 * MAX_SCOPES];
+		int stereoTimelineCount = 0;
+		UINT64 timestampFrequency = 1;
+
+		GpuFrameTimings summedTimings;
+		int countedFrames = 0;
+
+		void ResolveFinishedFrames();
+		bool ReadFrame(FrameQueries &frame, GpuFrameTimings &timings, bool &valid);
+		void Report(const GpuFrameTimings &timings);
+		void ReportTimeline();
+	};
+
+	class D3D12GpuProfileScope {
+	public:
+		D3D12GpuProfileScope(D3D12GpuProfiler *profiler, GpuSection section) : profiler(profiler), section(section) {
+			if (profiler != nullptr) {
+				profiler->BeginSection(section);
+			}
+		}
+
+		~D3D12GpuProfileScope() {
+			if (profiler != nullptr) {
+				profiler->EndSection(section);
+			}
+		}
+
+	private:
+		D3D12GpuProfiler *profiler;
+		GpuSection section;
+	};
+}
@@ -42,6 +42,31 @@ namespace vrperfkit {
 		return buffer;
 	}
 
+	ComPtr<ID3D12Resource> CreateStructuredBuffer(ID3D12Device *device, uint32_t elementSize, uint32_t count) {
+		D3D12_BUFFER_DESC bd;
+		bd.Usage = D3D12_USAGE_DEFAULT;
+		bd.BindFlags = D3D12_BIND_SHADER_RESOURCE;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = D3D12_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bd.StructureByteStride = elementSize;
+		bd.ByteWidth = elementSize * count;
+		ComPtr<ID3D12Resource> buffer;
+		CheckResult("creating structured buffer", device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf()));
+		return buffer;
+	}
+
+	ComPtr<ID3D12ShaderResourceView> CreateStructuredBufferView(ID3D12Device *device, ID3D12Resource *buffer, uint32_t count) {
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvd;
+		srvd.Format = DXGI_FORMAT_UNKNOWN;
+		srvd.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvd.Buffer.FirstElement = 0;
+		srvd.Buffer.NumElements = count;
+
+		ComPtr<ID3D12ShaderResourceView> srv;
+		CheckResult("creating structured buffer view", device->CreateShaderResourceView(buffer, &srvd, srv.GetAddressOf()));
+		return srv;
+	}
+
 	ComPtr<ID3D12SamplerState> CreateLinearSampler(ID3D12Device *device) {
 		D3D12_SAMPLER_DESC sd;
 		sd.Filter = D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
@@ -101,6 +126,14 @@ namespace vrperfkit {
 		}
 	}
 
+	bool SupportsHalfPrecisionCompute(ID3D12Device *device) {
+		D3D12_FEATURE_DATA_SHADER_MIN_PRECISION_SUPPORT support = {};
+		if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MIN_PRECISION_SUPPORT, &support, sizeof(support)))) {
+			return false;
+		}
+		return (support.AllOtherShaderStagesMinPrecision & D3D12_SHADER_MIN_PRECISION_16_BIT) != 0;
+	}
+
 	void StoreD3D12State(ID3D12DeviceContext *context, D3D12State &state) {
 		context->VSGetShader(state.vertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
 		context->PSGetShader(state.pixelShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
@@ -116,7 +149,7 @@ namespace vrperfkit {
 		context->RSGetViewports( &state.numViewports, state.viewports );
 		context->VSGetConstantBuffers( 0, 1, state.vsConstantBuffer.GetAddressOf() );
 		context->PSGetConstantBuffers( 0, 1, state.psConstantBuffer.GetAddressOf() );
-		context->CSGetConstantBuffers(0, 1, state.csConstantBuffer.GetAddressOf());
+		context->CSGetConstantBuffers(0, 2, state.csConstantBuffers);
 		context->CSGetShaderResources(0, D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, state.csShaderResources);
 		context->CSGetUnorderedAccessViews(0, D3D12_1_UAV_SLOT_COUNT, state.csUavs);
 	}
@@ -144,7 +177,11 @@ namespace vrperfkit {
 		context->RSSetViewports( state.numViewports, state.viewports );
 		context->VSSetConstantBuffers( 0, 1, state.vsConstantBuffer.GetAddressOf() );
 		context->PSSetConstantBuffers( 0, 1, state.psConstantBuffer.GetAddressOf() );
-		context->CSSetConstantBuffers(0, 1, state.csConstantBuffer.GetAddressOf());
+		context->CSSetConstantBuffers(0, 2, state.csConstantBuffers);
+		for (int i = 0; i < 2; ++i) {
+			if (state.csConstantBuffers[i])
+				state.csConstantBuffers[i]->Release();
+		}
 		context->CSSetShaderResources(0, D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, state.csShaderResources);
 		for (int i = 0; i < D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; ++i) {
 			if (state.csShaderResources[i])
@@ -205,6 +242,39 @@ namespace vrperfkit {
 		return uav;
 	}
 
+	ComPtr<ID3D12ShaderResourceView> CreateShaderResourceArrayView(ID3D12Device *device, ID3D12Resource *texture) {
+		D3D12_TEXTURE2D_DESC td;
+		texture->GetDesc(&td);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvd;
+		srvd.Format = TranslateTypelessFormats(td.Format);
+		srvd.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvd.Texture2DArray.ArraySize = td.ArraySize;
+		srvd.Texture2DArray.FirstArraySlice = 0;
+		srvd.Texture2DArray.MipLevels = td.MipLevels;
+		srvd.Texture2DArray.MostDetailedMip = 0;
+
+		ComPtr<ID3D12ShaderResourceView> srv;
+		CheckResult("creating shader resource array view", device->CreateShaderResourceView(texture, &srvd, srv.GetAddressOf()));
+		return srv;
+	}
+
+	ComPtr<ID3D12UnorderedAccessView> CreateUnorderedAccessArrayView(ID3D12Device *device, ID3D12Resource *texture) {
+		D3D12_TEXTURE2D_DESC td;
+		texture->GetDesc(&td);
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavd;
+		uavd.Format = TranslateTypelessFormats(td.Format);
+		uavd.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
+		uavd.Texture2DArray.ArraySize = td.ArraySize;
+		uavd.Texture2DArray.FirstArraySlice = 0;
+		uavd.Texture2DArray.MipSlice = 0;
+
+		ComPtr<ID3D12UnorderedAccessView> uav;
+		CheckResult("creating unordered access array view", device->CreateUnorderedAccessView(texture, &uavd, uav.GetAddressOf()));
+		return uav;
+	}
+
 	ComPtr<ID3D12Resource> CreateResolveTexture(ID3D12Device *device, ID3D12Resource *texture, DXGI_FORMAT format) {
 		D3D12_TEXTURE2D_DESC td;
 		texture->GetDesc(&td);
@@ -10,15 +10,23 @@ namespace vrperfkit {
 
 	ComPtr<D3D12_SHADER_RESOURCE_VIEW_DESC> CreateShaderResourceView(ID3D12Device *device, ID3D12Resource *texture, int arrayIndex = 0); 
 	ComPtr<D3D12_UNORDERED_ACCESS_VIEW_DESC> CreateUnorderedAccessView(ID3D12Device *device, ID3D12Resource *texture, int arrayIndex = 0);
+	// views of all array slices, which also works for textures that aren't arrays
+	ComPtr<ID3D12ShaderResourceView> CreateShaderResourceArrayView(ID3D12Device *device, ID3D12Resource *texture);
+	ComPtr<ID3D12UnorderedAccessView> CreateUnorderedAccessArrayView(ID3D12Device *device, ID3D12Resource *texture);
 	ComPtr<ID3D12Resource> CreateResolveTexture(ID3D12Device *device, ID3D12Resource *texture, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN);
 	ComPtr<ID3D12Resource> CreatePostProcessTexture(ID3D12Device *device, uint32_t width, uint32_t height, DXGI_FORMAT format);
 	ComPtr<ID3D12Resource> CreateConstantsBuffer(ID3D12Device *device, uint32_t size);
+	ComPtr<ID3D12Resource> CreateStructuredBuffer(ID3D12Device *device, uint32_t elementSize, uint32_t count);
+	ComPtr<ID3D12ShaderResourceView> CreateStructuredBufferView(ID3D12Device *device, ID3D12Resource *buffer, uint32_t count);
 	ComPtr<D3D12_STATIC_SAMPLER_DESC> CreateLinearSampler(ID3D12Device *device);
 
 	DXGI_FORMAT TranslateTypelessFormats(DXGI_FORMAT format);
 	DXGI_FORMAT MakeSrgbFormatsTypeless(DXGI_FORMAT format);
 	bool IsSrgbFormat(DXGI_FORMAT format);
 
+	// whether min16float in compute shaders actually runs at 16 bit rather than being promoted to 32 bit
+	bool SupportsHalfPrecisionCompute(ID3D12Device *device);
+
 	struct D3D12State {
 		ComPtr<vertex_shader> vertexShader;
 		ComPtr<ID3D12PixelShader> pixelShader;
@@ -40,7 +48,8 @@ namespace vrperfkit {
 		UINT numViewports = 0;
 		ComPtr<ID3D12Resource> vsConstantBuffer;
 		ComPtr<ID3D12Resource> psConstantBuffer;
-		ComPtr<ID3D12Resource> csConstantBuffer;
+		// b1 holds the RDM constants of upscalers reconstructing a masked input
+		ID3D12Resource *csConstantBuffers[2];
 		ID3D12ShaderResourceView *csShaderResources[D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
 		ID3D12UnorderedAccessView *csUavs[D3D12_1_UAV_SLOT_COUNT];
 	};
@@ -2,6 +2,10 @@
 #include "hooks.h"
 
 #include "config.h"
+#include "context_registry.h"
+#include "logging.h"
+#include "render_heuristics.h"
+#include "trace_recorder.h"
 
 namespace vrperfkit {
 	namespace {
@@ -24,12 +28,37 @@ namespace vrperfkit {
 			bool state;
 		};
 
-		template<typename T>
-		D3D12Injector *GetInjector(T *object) {
-			D3D12Injector *injector = nullptr;
-			UINT size = sizeof(injector);
-			object->GetPrivateData(__uuidof(D3D12Injector), &size, &injector);
-			return injector;
+		// the hooked context calls are far too frequent to look up the injector through GetPrivateData,
+		// which takes a lock inside the runtime every time
+		ContextRegistry<D3D12Injector> injectors;
+
+		D3D12Injector *GetInjector(ID3D12DeviceContext *context) {
+			return injectors.Lookup(context);
+		}
+
+		D3D12StateTracker *GetStateTracker(ID3D12DeviceContext *context) {
+			// deferred contexts share the hooked vtable, but only the immediate context has an injector
+			D3D12Injector *injector = GetInjector(context);
+			D3D12StateTracker *tracker = injector != nullptr ? injector->GetStateTracker() : nullptr;
+			if (tracker == nullptr || tracker->IsOverriding()) {
+				return nullptr;
+			}
+			return tracker;
+		}
+
+		void TraceRenderTargets(UINT numViews, ID3D12RenderTargetView * const *renderTargetViews) {
+			D3D12_TEXTURE2D_DESC td = {};
+			if (numViews > 0 && renderTargetViews != nullptr && renderTargetViews[0] != nullptr) {
+				D3D12_RENDER_TARGET_VIEW_DESC rtd;
+				renderTargetViews[0]->GetDesc(&rtd);
+				if (rtd.ViewDimension == D3D12_RTV_DIMENSION_TEXTURE2D || rtd.ViewDimension == D3D12_RTV_DIMENSION_TEXTURE2DARRAY
+						|| rtd.ViewDimension == D3D12_RTV_DIMENSION_TEXTURE2DMS || rtd.ViewDimension == D3D12_RTV_DIMENSION_TEXTURE2DMSARRAY) {
+					ComPtr<ID3D12Resource> resource;
+					renderTargetViews[0]->GetResource(resource.GetAddressOf());
+					((ID3D12Resource*)resource.Get())->GetDesc(&td);
+				}
+			}
+			g_trace.Record(TraceEventType::RENDER_TARGETS, GuessRenderingEye(false), td.Width, td.Height, td.ArraySize, td.SampleDesc.Count, td.Format, (uint8_t)numViews);
 		}
 
 		void D3D12ContextHook_PSSetSamplers(ID3D12DeviceContext *self, UINT StartSlot, UINT NumSamplers, ID3D12SamplerState * const *ppSamplers) {
@@ -45,6 +74,23 @@ namespace vrperfkit {
 			hooks::CallOriginal(D3D12ContextHook_PSSetSamplers)(self, StartSlot, NumSamplers, ppSamplers);
 		}
 
+		void D3D12ContextHook_RSSetViewports(ID3D12DeviceContext *self, UINT NumViewports, const D3D12_VIEWPORT *pViewports) {
+			HookGuard hookGuard;
+
+			D3D12Injector *injector = GetInjector(self);
+			if (injector != nullptr && !hookGuard.AlreadyInsideHook()) {
+				if (injector->PreRSSetViewports(NumViewports, pViewports)) {
+					return;
+				}
+			}
+
+			hooks::CallOriginal(D3D12ContextHook_RSSetViewports)(self, NumViewports, pViewports);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnRSSetViewports(NumViewports, pViewports);
+			}
+		}
+
 		void D3D12ContextHook_OMSetRenderTargets(
 				ID3D12DeviceContext *self,
 				UINT NumViews, ID3D12RenderTargetView * const *ppRenderTargetViews,
@@ -53,7 +99,14 @@ namespace vrperfkit {
 
 			hooks::CallOriginal(D3D12ContextHook_OMSetRenderTargets)(self, NumViews, ppRenderTargetViews, pDepthStencilView);
 
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnOMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+			}
+
 			if (D3D12Injector *injector = GetInjector(self)) {
+				if (g_trace.IsActive()) {
+					TraceRenderTargets(NumViews, ppRenderTargetViews);
+				}
 				injector->PostOMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 			}
 		}
@@ -71,11 +124,117 @@ namespace vrperfkit {
 
 			hooks::CallOriginal(D3D12ContextHook_OMSetRenderTargetsAndUnorderedAccessViews)(self, NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
 
+			D3D12StateTracker *tracker = GetStateTracker(self);
+			if (tracker != nullptr && NumRTVs != D3D12_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL) {
+				tracker->OnOMSetRenderTargets(NumRTVs, ppRenderTargetViews, pDepthStencilView);
+			}
+
 			if (D3D12Injector *injector = GetInjector(self)) {
+				if (g_trace.IsActive()) {
+					TraceRenderTargets(NumRTVs, ppRenderTargetViews);
+				}
 				injector->PostOMSetRenderTargets(NumRTVs, ppRenderTargetViews, pDepthStencilView);
 			}
 		}
 
+		void D3D12ContextHook_CSSetShaderResources(ID3D12DeviceContext *self, UINT StartSlot, UINT NumViews, ID3D12ShaderResourceView * const *ppShaderResourceViews) {
+			hooks::CallOriginal(D3D12ContextHook_CSSetShaderResources)(self, StartSlot, NumViews, ppShaderResourceViews);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnCSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+			}
+		}
+
+		void D3D12ContextHook_CSSetUnorderedAccessViews(ID3D12DeviceContext *self, UINT StartSlot, UINT NumUAVs, ID3D12UnorderedAccessView * const *ppUnorderedAccessViews, const UINT *pUAVInitialCounts) {
+			hooks::CallOriginal(D3D12ContextHook_CSSetUnorderedAccessViews)(self, StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnCSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews);
+			}
+		}
+
+		void D3D12ContextHook_CSSetShader(ID3D12DeviceContext *self, ID3D12ComputeShader *pComputeShader, ID3D12ClassInstance * const *ppClassInstances, UINT NumClassInstances) {
+			hooks::CallOriginal(D3D12ContextHook_CSSetShader)(self, pComputeShader, ppClassInstances, NumClassInstances);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnCSSetShader(pComputeShader);
+			}
+		}
+
+		void D3D12ContextHook_CSSetSamplers(ID3D12DeviceContext *self, UINT StartSlot, UINT NumSamplers, ID3D12SamplerState * const *ppSamplers) {
+			hooks::CallOriginal(D3D12ContextHook_CSSetSamplers)(self, StartSlot, NumSamplers, ppSamplers);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnCSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+			}
+		}
+
+		void D3D12ContextHook_VSSetShader(ID3D12DeviceContext *self, ID3D12VertexShader *pVertexShader, ID3D12ClassInstance * const *ppClassInstances, UINT NumClassInstances) {
+			hooks::CallOriginal(D3D12ContextHook_VSSetShader)(self, pVertexShader, ppClassInstances, NumClassInstances);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnVSSetShader(pVertexShader);
+			}
+		}
+
+		void D3D12ContextHook_PSSetShader(ID3D12DeviceContext *self, ID3D12PixelShader *pPixelShader, ID3D12ClassInstance * const *ppClassInstances, UINT NumClassInstances) {
+			hooks::CallOriginal(D3D12ContextHook_PSSetShader)(self, pPixelShader, ppClassInstances, NumClassInstances);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnPSSetShader(pPixelShader);
+			}
+		}
+
+		void D3D12ContextHook_IASetInputLayout(ID3D12DeviceContext *self, ID3D12InputLayout *pInputLayout) {
+			hooks::CallOriginal(D3D12ContextHook_IASetInputLayout)(self, pInputLayout);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnIASetInputLayout(pInputLayout);
+			}
+		}
+
+		void D3D12ContextHook_IASetPrimitiveTopology(ID3D12DeviceContext *self, D3D12_PRIMITIVE_TOPOLOGY Topology) {
+			hooks::CallOriginal(D3D12ContextHook_IASetPrimitiveTopology)(self, Topology);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnIASetPrimitiveTopology(Topology);
+			}
+		}
+
+		void D3D12ContextHook_OMSetDepthStencilState(ID3D12DeviceContext *self, ID3D12DepthStencilState *pDepthStencilState, UINT StencilRef) {
+			hooks::CallOriginal(D3D12ContextHook_OMSetDepthStencilState)(self, pDepthStencilState, StencilRef);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnOMSetDepthStencilState(pDepthStencilState, StencilRef);
+			}
+		}
+
+		void D3D12ContextHook_RSSetState(ID3D12DeviceContext *self, ID3D12RasterizerState *pRasterizerState) {
+			hooks::CallOriginal(D3D12ContextHook_RSSetState)(self, pRasterizerState);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->OnRSSetState(pRasterizerState);
+			}
+		}
+
+		void D3D12ContextHook_ClearState(ID3D12DeviceContext *self) {
+			hooks::CallOriginal(D3D12ContextHook_ClearState)(self);
+
+			if (D3D12StateTracker *tracker = GetStateTracker(self)) {
+				tracker->Reset();
+			}
+		}
+
+		void D3D12ContextHook_ExecuteCommandList(ID3D12DeviceContext *self, ID3D12CommandList *pCommandList, BOOL RestoreContextState) {
+			hooks::CallOriginal(D3D12ContextHook_ExecuteCommandList)(self, pCommandList, RestoreContextState);
+
+			// without restoring, the context is left in its default state
+			D3D12StateTracker *tracker = GetStateTracker(self);
+			if (tracker != nullptr && !RestoreContextState) {
+				tracker->Reset();
+			}
+		}
+
 		void D3D12ContextHook_ClearDepthStencilView(
 				ID3D12DeviceContext *self,
 				ID3D12DepthStencilView *pDepthStencilView,
@@ -87,6 +246,13 @@ namespace vrperfkit {
 			hooks::CallOriginal(D3D12ContextHook_ClearDepthStencilView)(self, pDepthStencilView, ClearFlags, Depth, Stencil);
 
 			if (D3D12Injector *injector = GetInjector(self)) {
+				if (g_trace.IsActive() && pDepthStencilView != nullptr) {
+					ComPtr<ID3D12Resource> resource;
+					pDepthStencilView->GetResource(resource.GetAddressOf());
+					D3D12_TEXTURE2D_DESC td;
+					((ID3D12Resource*)resource.Get())->GetDesc(&td);
+					g_trace.Record(TraceEventType::DEPTH_CLEAR, GuessRenderingEye(false), td.Width, td.Height, td.ArraySize, td.SampleDesc.Count, td.Format, (uint8_t)ClearFlags);
+				}
 				injector->ClearDepthStencilView(pDepthStencilView, ClearFlags, Depth, Stencil);
 			}
 		}
@@ -100,33 +266,108 @@ namespace vrperfkit {
 		UINT size = sizeof(instance);
 		device->SetPrivateData(__uuidof(D3D12Injector), size, &instance);
 		context->SetPrivateData(__uuidof(D3D12Injector), size, &instance);
+		if (!injectors.Register(context.Get(), this)) {
+			// the hooks couldn't find us anyway, so leave the context alone
+			LOG_ERROR << "Too many D3D12 devices, not injecting into this one";
+			return;
+		}
+
+		bool upscaling = g_config.upscaling.enabled;
+		bool vrs = g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::VRS;
+		bool masking = g_config.hiddenMask.enabled || (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::RDM);
+		bool dynamicResolution = upscaling && g_config.upscaling.dynamic;
+		bool tracing = g_trace.IsActive();
 
 		// Upscaling and FFR
-		if (g_config.upscaling.enabled || (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::VRS)) {
+		if (upscaling || vrs) {
 			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::PSSetSamplers", context.Get(), 10, (void*)&D3D12ContextHook_PSSetSamplers);
+			samplersHooked = true;
+		}
+
+		// also needed to track the render targets we overwrite with upscaling and HRM
+		if (upscaling || vrs || masking || tracing) {
 			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::OMSetRenderTargets", context.Get(), 33, (void*)&D3D12ContextHook_OMSetRenderTargets);
 			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews", context.Get(), 34, (void*)&D3D12ContextHook_OMSetRenderTargetsAndUnorderedAccessViews);
+			renderTargetsHooked = true;
+		}
+
+		// Dynamic resolution, and the viewports we overwrite with HRM
+		if (dynamicResolution || masking) {
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::RSSetViewports", context.Get(), 44, (void*)&D3D12ContextHook_RSSetViewports);
+			viewportsHooked = true;
 		}
 
 		// HRM
-		if (g_config.hiddenMask.enabled || (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::RDM)) {
+		if (masking || tracing) {
 			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::ClearDepthStencilView", context.Get(), 53, (void*)&D3D12ContextHook_ClearDepthStencilView);
+			clearDepthStencilViewHooked = true;
+		}
+
+		// Shadow state, so that post-processing only has to restore what it overwrote
+		uint32_t trackedGroups = 0;
+		if (upscaling) {
+			trackedGroups |= STATE_COMPUTE | STATE_OUTPUT_MERGER;
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::CSSetShaderResources", context.Get(), 67, (void*)&D3D12ContextHook_CSSetShaderResources);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::CSSetUnorderedAccessViews", context.Get(), 68, (void*)&D3D12ContextHook_CSSetUnorderedAccessViews);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::CSSetShader", context.Get(), 69, (void*)&D3D12ContextHook_CSSetShader);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::CSSetSamplers", context.Get(), 70, (void*)&D3D12ContextHook_CSSetSamplers);
+		}
+		if (masking) {
+			trackedGroups |= STATE_GRAPHICS_SHADERS | STATE_INPUT_ASSEMBLER | STATE_RASTERIZER | STATE_DEPTH_STENCIL | STATE_OUTPUT_MERGER;
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::PSSetShader", context.Get(), 9, (void*)&D3D12ContextHook_PSSetShader);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::VSSetShader", context.Get(), 11, (void*)&D3D12ContextHook_VSSetShader);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::IASetInputLayout", context.Get(), 17, (void*)&D3D12ContextHook_IASetInputLayout);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::IASetPrimitiveTopology", context.Get(), 24, (void*)&D3D12ContextHook_IASetPrimitiveTopology);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::OMSetDepthStencilState", context.Get(), 36, (void*)&D3D12ContextHook_OMSetDepthStencilState);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::RSSetState", context.Get(), 43, (void*)&D3D12ContextHook_RSSetState);
+		}
+		if (trackedGroups != 0) {
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::ExecuteCommandList", context.Get(), 58, (void*)&D3D12ContextHook_ExecuteCommandList);
+			hooks::InstallVirtualFunctionHook("ID3D12DeviceContext::ClearState", context.Get(), 110, (void*)&D3D12ContextHook_ClearState);
+			stateTracker.reset(new D3D12StateTracker(context.Get(), trackedGroups));
 		}
 	}
 
 	D3D12Injector::~D3D12Injector() {
-		// Upscaling && FFR
-		if (g_config.upscaling.enabled || (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::VRS)) {
+		if (samplersHooked) {
 			hooks::RemoveHook((void*)&D3D12ContextHook_PSSetSamplers);
+		}
+
+		if (renderTargetsHooked) {
 			hooks::RemoveHook((void*)&D3D12ContextHook_OMSetRenderTargets);
 			hooks::RemoveHook((void*)&D3D12ContextHook_OMSetRenderTargetsAndUnorderedAccessViews);
 		}
+
+		if (viewportsHooked) {
+			hooks::RemoveHook((void*)&D3D12ContextHook_RSSetViewports);
+		}
 		
 		// HRM
-		if (g_config.hiddenMask.enabled || (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::RDM)) {
+		if (clearDepthStencilViewHooked) {
 			hooks::RemoveHook((void*)&D3D12ContextHook_ClearDepthStencilView);
 		}
 
+		if (stateTracker) {
+			uint32_t trackedGroups = stateTracker->TrackedGroups();
+			if (trackedGroups & STATE_COMPUTE) {
+				hooks::RemoveHook((void*)&D3D12ContextHook_CSSetShaderResources);
+				hooks::RemoveHook((void*)&D3D12ContextHook_CSSetUnorderedAccessViews);
+				hooks::RemoveHook((void*)&D3D12ContextHook_CSSetShader);
+				hooks::RemoveHook((void*)&D3D12ContextHook_CSSetSamplers);
+			}
+			if (trackedGroups & STATE_GRAPHICS_SHADERS) {
+				hooks::RemoveHook((void*)&D3D12ContextHook_PSSetShader);
+				hooks::RemoveHook((void*)&D3D12ContextHook_VSSetShader);
+				hooks::RemoveHook((void*)&D3D12ContextHook_IASetInputLayout);
+				hooks::RemoveHook((void*)&D3D12ContextHook_IASetPrimitiveTopology);
+				hooks::RemoveHook((void*)&D3D12ContextHook_OMSetDepthStencilState);
+				hooks::RemoveHook((void*)&D3D12ContextHook_RSSetState);
+			}
+			hooks::RemoveHook((void*)&D3D12ContextHook_ExecuteCommandList);
+			hooks::RemoveHook((void*)&D3D12ContextHook_ClearState);
+		}
+
+		injectors.Unregister(context.Get());
 		device->SetPrivateData(__uuidof(D3D12Injector), 0, nullptr);
 		context->SetPrivateData(__uuidof(D3D12Injector), 0, nullptr);
 	}
@@ -154,6 +395,16 @@ namespace vrperfkit {
 		return false;
 	}
 
+	bool D3D12Injector::PreRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *pViewports) {
+		for (D3D12Listener *listener : listeners) {
+			if (listener->PreRSSetViewports(numViewports, pViewports)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	void D3D12Injector::PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) {
 		for (D3D12Listener *listener : listeners) {
 			listener->PostOMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
@@ -1,12 +1,15 @@
 #pragma once
 #include "d3d12_helper.h"
+#include "d3d12_state_tracker.h"
 
+#include <memory>
 #include <vector>
 
 namespace vrperfkit {
 	class D3D12Listener {
 	public:
 		virtual bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState *const *ppSamplers) { return false; }
+		virtual bool PreRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *pViewports) { return false; }
 		virtual void PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) {}
 		
 		virtual HRESULT ClearDepthStencilView(ID3D12DepthStencilView *pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil) { return 0; }
@@ -24,13 +27,22 @@ namespace vrperfkit {
 		void RemoveListener(D3D12Listener *listener);
 
 		bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState *const *ppSamplers);
+		bool PreRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *pViewports);
 		void PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView);
 
 		HRESULT ClearDepthStencilView(ID3D12DepthStencilView *pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil);
 
+		// null if none of our passes can restore state from the tracker
+		D3D12StateTracker *GetStateTracker() const { return stateTracker.get(); }
+
 	private:
 		ComPtr<ID3D12Device> device;
 		ComPtr<ID3D12DeviceContext> context;
+		bool samplersHooked = false;
+		bool renderTargetsHooked = false;
+		bool viewportsHooked = false;
+		bool clearDepthStencilViewHooked = false;
+		std::unique_ptr<D3D12StateTracker> stateTracker;
 
 		std::vector<D3D12Listener*> listeners;
 	};
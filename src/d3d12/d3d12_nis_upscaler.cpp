@@ -1,8 +1,13 @@
 #include "d3d12_nis_upscaler.h"
 #include "d3d12_helper.h"
+#include "d3d12_shader_cache.h"
 #include "logging.h"
 #include "shader_nis_upscale.h"
 #include "shader_nis_sharpen.h"
+#include "shader_nis_upscale_stereo.h"
+#include "shader_nis_sharpen_stereo.h"
+#include "shader_nis_copy.h"
+#include "shader_nis_copy_stereo.h"
 #include "config.h"
 
 #include "nis/NIS_Config.h"
@@ -10,12 +15,15 @@
 namespace vrperfkit {
 	D3D12NisUpscaler::D3D12NisUpscaler(ID3D12Device *device) {
 		LOG_INFO << "Creating D3D12 resources for NIS upscaling...";
+		this->device = device;
 		device->GetImmediateContext(context.GetAddressOf());
-
-		CheckResult("creating NIS upscale shader", device->CreateComputeShader(g_NISUpscaleShader, sizeof(g_NISUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		CheckResult("creating NIS sharpen shader", device->CreateComputeShader(g_NISSharpenShader, sizeof(g_NISSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+		halfPrecisionSupported = SupportsHalfPrecisionCompute(device);
+		if (g_config.upscaling.halfPrecision && !halfPrecisionSupported) {
+			LOG_INFO << "GPU has no 16 bit compute support, NIS upscaling runs at full precision";
+		}
 
 		constantsBuffer = CreateConstantsBuffer(device, sizeof(NISConfig));
+		stereoConstantsBuffer = CreateConstantsBuffer(device, 2 * sizeof(NISConfig));
 		sampler = CreateLinearSampler(device);
 
 		D3D12_TEXTURE2D_DESC td;
@@ -42,11 +50,21 @@ namespace vrperfkit {
 		usmCoeffView = CreateShaderResourceView(device, usmCoeffTexture.Get());
 	}
 
+	void D3D12NisUpscaler::RegisterShaders() {
+		for (const ShaderBytecode *permutations : { g_NISUpscaleShader, g_NISSharpenShader, g_NISUpscaleStereoShader, g_NISSharpenStereoShader, g_NISCopyShader, g_NISCopyStereoShader }) {
+			for (uint32_t i = 0; i < SHADER_PERMUTATION_COUNT; ++i) {
+				g_shaderCache.Register(ShaderStage::COMPUTE, permutations[i].data, permutations[i].size);
+			}
+		}
+	}
+
 	void D3D12NisUpscaler::Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) {
 		D3D12_TEXTURE2D_DESC td, otd;
 		input.inputTexture->GetDesc(&td);
 		input.outputTexture->GetDesc(&otd);
 
+		D3D12GpuProfileScope profileScope(profiler, input.inputViewport != outputViewport ? GpuSection::UPSCALE : GpuSection::SHARPEN);
+
 		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
 		ID3D12ShaderResourceView *srvs[1] = {input.inputView};
 		context->CSSetShaderResources(0, 1, srvs);
@@ -55,29 +73,192 @@ namespace vrperfkit {
 		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
 
 		NISConfig constants;
-		NVScalerUpdateConfig(constants, g_config.upscaling.sharpness, input.inputViewport.x, input.inputViewport.y,
+		NVScalerUpdateConfig(constants, input.config->upscaling.sharpness, input.inputViewport.x, input.inputViewport.y,
 				input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
 				outputViewport.x, outputViewport.y, outputViewport.width, outputViewport.height,
 				otd.Width, otd.Height);
-		float radius = 0.5f * g_config.upscaling.radius * outputViewport.height;
+		float radius = 0.5f * input.config->upscaling.radius * outputViewport.height;
 		constants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
 		constants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
 		constants.squaredRadius = radius * radius;
-		constants.debugMode = g_config.debugMode;
+		constants.debugMode = input.config->debugMode;
 		context->UpdateSubresource(constantsBuffer.Get(), 0, nullptr, &constants, 0, 0);
+		bool halfPrecision = input.config->upscaling.halfPrecision && halfPrecisionSupported;
+		uint32_t permutation = SelectShaderPermutation(input.config->debugMode, halfPrecision, outputViewport.width, outputViewport.height,
+				constants.projCentre[0], constants.projCentre[1], constants.squaredRadius);
 		context->CSSetConstantBuffers(0, 1, constantsBuffer.GetAddressOf());
+		if (input.rdmConstants != nullptr) {
+			permutation |= SHADER_RDM_RECONSTRUCT;
+			context->CSSetConstantBuffers(1, 1, &input.rdmConstants);
+		}
 
-		if (input.inputViewport != outputViewport) {
+		bool upscaling = input.inputViewport != outputViewport;
+		ID3D12ComputeShader *shader;
+		uint32_t blockHeight;
+		if (upscaling) {
 			// full upscaling pass
 			ID3D12ShaderResourceView *coeffViews[2] = {scalerCoeffView.Get(), usmCoeffView.Get()};
 			context->CSSetShaderResources(1, 2, coeffViews);
-			context->CSSetShader(upscaleShader.Get(), nullptr, 0);
-
-			context->Dispatch((UINT)std::ceil(outputViewport.width / 32.f), (UINT)std::ceil(outputViewport.height / 24.f), 1);
+			shader = GetShader(upscaleShaders, g_NISUpscaleShader, permutation, "upscale");
+			blockHeight = 24;
 		} else {
 			// just sharpening
-			context->CSSetShader(sharpenShader.Get(), nullptr, 0);
-			context->Dispatch((UINT)std::ceil(outputViewport.width / 32.f), (UINT)std::ceil(outputViewport.height / 32.f), 1);
+			shader = GetShader(sharpenShaders, g_NISSharpenShader, permutation, "sharpen");
+			blockHeight = 32;
+		}
+
+		if (permutation & SHADER_RADIUS_CUTOFF) {
+			TileClassifierEye eye;
+			eye.viewportWidth = outputViewport.width;
+			eye.viewportHeight = outputViewport.height;
+			eye.projCentreX = constants.projCentre[0];
+			eye.projCentreY = constants.projCentre[1];
+			eye.squaredRadius = constants.squaredRadius;
+			ID3D12ComputeShader *copyShader = GetShader(copyShaders, g_NISCopyShader, permutation, "copy");
+			DispatchFoveated(foveatedTiles[input.eye], &eye, 1, blockHeight, shader, copyShader);
+		} else {
+			context->CSSetShader(shader, nullptr, 0);
+			context->Dispatch((UINT)std::ceil(outputViewport.width / 32.f), (UINT)std::ceil(outputViewport.height / (float)blockHeight), 1);
+		}
+	}
+
+	bool D3D12NisUpscaler::UpscaleStereo(const D3D12PostProcessInput inputs[2], const Viewport outputViewports[2]) {
+		// the views handed to us only cover a single eye, so view the whole resources behind them instead
+		ComPtr<ID3D12Resource> inputTexture, outputTexture;
+		inputs[0].inputView->GetResource(inputTexture.GetAddressOf());
+		inputs[0].outputUav->GetResource(outputTexture.GetAddressOf());
+		D3D12_TEXTURE2D_DESC td, otd;
+		inputTexture->GetDesc(&td);
+		outputTexture->GetDesc(&otd);
+
+		auto &inputView = stereoInputViews[inputTexture.Get()];
+		if (inputView == nullptr) {
+			LOG_INFO << "Creating NIS stereo input view for texture " << inputTexture.Get();
+			inputView = CreateShaderResourceArrayView(device.Get(), inputTexture.Get());
+		}
+		auto &outputUav = stereoOutputUavs[outputTexture.Get()];
+		if (outputUav == nullptr) {
+			LOG_INFO << "Creating NIS stereo output view for texture " << outputTexture.Get();
+			outputUav = CreateUnorderedAccessArrayView(device.Get(), outputTexture.Get());
+		}
+
+		bool upscaling = inputs[0].inputViewport != outputViewports[0];
+		D3D12GpuProfileScope profileScope(profiler, upscaling ? GpuSection::UPSCALE : GpuSection::SHARPEN);
+
+		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
+		ID3D12ShaderResourceView *srvs[1] = {inputView.Get()};
+		context->CSSetShaderResources(0, 1, srvs);
+		UINT uavCount = -1;
+		ID3D12UnorderedAccessView *uavs[] = {outputUav.Get()};
+		context->CSSetUnorderedAccessViews(0, 1, uavs, &uavCount);
+
+		// the shaders pick the constants by the index in the dispatch's Z dimension or in the tile, in the
+		// order of the inputs rather than by eye, and read the eye's array slice from them
+		NISConfig constants[2];
+		TileClassifierEye tileEyes[2];
+		uint32_t maxWidth = 0, maxHeight = 0;
+		// both eyes run the same shader, so it has to cover what either of them needs
+		uint32_t permutation = 0;
+		bool halfPrecision = inputs[0].config->upscaling.halfPrecision && halfPrecisionSupported;
+		for (int i = 0; i < 2; ++i) {
+			const D3D12PostProcessInput &input = inputs[i];
+			const Viewport &outputViewport = outputViewports[i];
+			NISConfig &eyeConstants = constants[i];
+			NVScalerUpdateConfig(eyeConstants, input.config->upscaling.sharpness, input.inputViewport.x, input.inputViewport.y,
+					input.inputViewport.width, input.inputViewport.height, td.Width, td.Height,
+					outputViewport.x, outputViewport.y, outputViewport.width, outputViewport.height,
+					otd.Width, otd.Height);
+			float radius = 0.5f * input.config->upscaling.radius * outputViewport.height;
+			eyeConstants.projCentre[0] = outputViewport.width * input.projectionCenter.x;
+			eyeConstants.projCentre[1] = outputViewport.height * input.projectionCenter.y;
+			eyeConstants.squaredRadius = radius * radius;
+			eyeConstants.debugMode = input.config->debugMode;
+			permutation |= SelectShaderPermutation(input.config->debugMode, halfPrecision, outputViewport.width, outputViewport.height,
+					eyeConstants.projCentre[0], eyeConstants.projCentre[1], eyeConstants.squaredRadius);
+			// array slices to read from and write to
+			eyeConstants.reserved0 = input.mode == TextureMode::ARRAY ? input.eye : 0;
+			eyeConstants.reserved1 = input.mode == TextureMode::ARRAY ? input.eye : 0;
+			tileEyes[i].viewportWidth = outputViewport.width;
+			tileEyes[i].viewportHeight = outputViewport.height;
+			tileEyes[i].projCentreX = eyeConstants.projCentre[0];
+			tileEyes[i].projCentreY = eyeConstants.projCentre[1];
+			tileEyes[i].squaredRadius = eyeConstants.squaredRadius;
+			if (outputViewport.width > maxWidth) {
+				maxWidth = outputViewport.width;
+			}
+			if (outputViewport.height > maxHeight) {
+				maxHeight = outputViewport.height;
+			}
+		}
+		context->UpdateSubresource(stereoConstantsBuffer.Get(), 0, nullptr, constants, 0, 0);
+		context->CSSetConstantBuffers(0, 1, stereoConstantsBuffer.GetAddressOf());
+
+		ID3D12ComputeShader *shader;
+		uint32_t blockHeight;
+		if (upscaling) {
+			ID3D12ShaderResourceView *coeffViews[2] = {scalerCoeffView.Get(), usmCoeffView.Get()};
+			context->CSSetShaderResources(1, 2, coeffViews);
+			shader = GetShader(upscaleStereoShaders, g_NISUpscaleStereoShader, permutation, "stereo upscale");
+			blockHeight = 24;
+		} else {
+			shader = GetShader(sharpenStereoShaders, g_NISSharpenStereoShader, permutation, "stereo sharpen");
+			blockHeight = 32;
+		}
+
+		if (permutation & SHADER_RADIUS_CUTOFF) {
+			ID3D12ComputeShader *copyShader = GetShader(copyStereoShaders, g_NISCopyStereoShader, permutation, "stereo copy");
+			DispatchFoveated(foveatedTiles[2], tileEyes, 2, blockHeight, shader, copyShader);
+		} else {
+			context->CSSetShader(shader, nullptr, 0);
+			context->Dispatch((UINT)std::ceil(maxWidth / 32.f), (UINT)std::ceil(maxHeight / (float)blockHeight), 2);
+		}
+
+		return true;
+	}
+
+	ID3D12ComputeShader *D3D12NisUpscaler::GetShader(ComPtr<ID3D12ComputeShader> *shaders, const ShaderBytecode *permutations, uint32_t permutation, const char *name) {
+		ComPtr<ID3D12ComputeShader> &shader = shaders[permutation];
+		if (shader == nullptr) {
+			const ShaderBytecode &bytecode = permutations[permutation];
+			LOG_INFO << "Creating NIS " << name << " shader with " << bytecode.defines;
+			shader = g_shaderCache.GetComputeShader(device.Get(), bytecode.data, bytecode.size);
+		}
+		return shader.Get();
+	}
+
+	void D3D12NisUpscaler::DispatchFoveated(FoveatedTiles &tiles, const TileClassifierEye *eyes, int eyeCount, uint32_t blockHeight, ID3D12ComputeShader *filterShader, ID3D12ComputeShader *copyShader) {
+		if (tiles.classifier.Classify(32, blockHeight, eyes, eyeCount)) {
+			UploadTileList(tiles.filterList, tiles.classifier.FilterList());
+			UploadTileList(tiles.copyList, tiles.classifier.CopyList());
+		}
+
+		uint32_t groupsX, groupsY;
+		if (TileClassifier::DispatchSize(tiles.classifier.FilterList(), groupsX, groupsY)) {
+			context->CSSetShaderResources(3, 1, tiles.filterList.view.GetAddressOf());
+			context->CSSetShader(filterShader, nullptr, 0);
+			context->Dispatch(groupsX, groupsY, 1);
+		}
+		if (TileClassifier::DispatchSize(tiles.classifier.CopyList(), groupsX, groupsY)) {
+			context->CSSetShaderResources(3, 1, tiles.copyList.view.GetAddressOf());
+			context->CSSetShader(copyShader, nullptr, 0);
+			context->Dispatch(groupsX, groupsY, 1);
+		}
+	}
+
+	void D3D12NisUpscaler::UploadTileList(TileListBuffer &buffer, const std::vector<uint32_t> &list) {
+		if (list.size() <= 1) {
+			// nothing to dispatch
+			return;
+		}
+		uint32_t count = (uint32_t)list.size();
+		if (count > buffer.capacity) {
+			// leave some room, so that a growing radius doesn't recreate the buffer every frame
+			buffer.capacity = count + count / 4;
+			LOG_INFO << "Creating NIS tile list buffer for " << buffer.capacity << " tiles";
+			buffer.buffer = CreateStructuredBuffer(device.Get(), sizeof(uint32_t), buffer.capacity);
+			buffer.view = CreateStructuredBufferView(device.Get(), buffer.buffer.Get(), buffer.capacity);
 		}
+		D3D12_BOX box = { 0, 0, 0, count * (UINT)sizeof(uint32_t), 1, 1 };
+		context->UpdateSubresource(buffer.buffer.Get(), 0, &box, list.data(), 0, 0);
 	}
 }
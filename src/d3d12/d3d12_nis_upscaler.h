@@ -1,8 +1,11 @@
 #pragma once
 #include "d3d12_post_processor.h"
+#include "shader_permutations.h"
+#include "tile_classifier.h"
 
 #include <d3d12.h>
 #include <wrl/client.h>
+#include <unordered_map>
 
 using Microsoft::WRL::ComPtr;
 
@@ -10,17 +13,50 @@ namespace vrperfkit {
 	class D3D12NisUpscaler : public D3D12Upscaler {
 	public:
 		D3D12NisUpscaler(ID3D12Device *device);
+		// makes the shaders known to g_shaderCache for prewarming
+		static void RegisterShaders();
 		void Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) override;
+		bool UpscaleStereo(const D3D12PostProcessInput inputs[2], const Viewport outputViewports[2]) override;
+		bool SupportsRdmReconstruction() const override { return true; }
 
 	private:
-		ComPtr<ID3D12DeviceContext> context;
-		ComPtr<ID3D12ComputeShader> upscaleShader;
-		ComPtr<ID3D12ComputeShader> sharpenShader;
+		ComPtr<ID3D12Device> device;
+		// created on first use, indexed by permutation
+		ComPtr<ID3D12ComputeShader> upscaleShaders[SHADER_PERMUTATION_COUNT];
+		ComPtr<ID3D12ComputeShader> sharpenShaders[SHADER_PERMUTATION_COUNT];
+		ComPtr<ID3D12ComputeShader> upscaleStereoShaders[SHADER_PERMUTATION_COUNT];
+		ComPtr<ID3D12ComputeShader> sharpenStereoShaders[SHADER_PERMUTATION_COUNT];
+		ComPtr<ID3D12ComputeShader> copyShaders[SHADER_PERMUTATION_COUNT];
+		ComPtr<ID3D12ComputeShader> copyStereoShaders[SHADER_PERMUTATION_COUNT];
+		// whether the HALF_PRECISION permutations, which store luma, filter coefficients and edge weights
+		// at 16 bit, run at 16 bit on this GPU; they are only used with upscaling.halfPrecision
+		bool halfPrecisionSupported = false;
 		ComPtr<ID3D12Resource> constantsBuffer;
+		ComPtr<ID3D12Resource> stereoConstantsBuffer;
+		std::unordered_map<ID3D12Resource*, ComPtr<ID3D12ShaderResourceView>> stereoInputViews;
+		std::unordered_map<ID3D12Resource*, ComPtr<ID3D12UnorderedAccessView>> stereoOutputUavs;
 		ComPtr<ID3D12SamplerState> sampler;
 		ComPtr<ID3D12Resource> scalerCoeffTexture;
 		ComPtr<ID3D12ShaderResourceView> scalerCoeffView;
 		ComPtr<ID3D12Resource> usmCoeffTexture;
 		ComPtr<ID3D12ShaderResourceView> usmCoeffView;
+
+		struct TileListBuffer {
+			ComPtr<ID3D12Resource> buffer;
+			ComPtr<ID3D12ShaderResourceView> view;
+			uint32_t capacity = 0;
+		};
+		// with RADIUS_CUTOFF, the filter only runs on the blocks within the radius and the rest is copied
+		struct FoveatedTiles {
+			TileClassifier classifier;
+			TileListBuffer filterList;
+			TileListBuffer copyList;
+		};
+		// indexed by eye for single eye passes, the last one is for stereo passes
+		FoveatedTiles foveatedTiles[3];
+
+		ID3D12ComputeShader *GetShader(ComPtr<ID3D12ComputeShader> *shaders, const ShaderBytecode *permutations, uint32_t permutation, const char *name);
+		void DispatchFoveated(FoveatedTiles &tiles, const TileClassifierEye *eyes, int eyeCount, uint32_t blockHeight, ID3D12ComputeShader *filterShader, ID3D12ComputeShader *copyShader);
+		void UploadTileList(TileListBuffer &buffer, const std::vector<uint32_t> &list);
 	};
 }
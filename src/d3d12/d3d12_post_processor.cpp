@@ -4,43 +4,95 @@
 #include "d3d12_cas_upscaler.h"
 #include "d3d12_fsr_upscaler.h"
 #include "d3d12_nis_upscaler.h"
+#include "d3d12_shader_cache.h"
 #include "hooks.h"
 #include "logging.h"
+#include "resolution_scaling.h"
+#include "trace_recorder.h"
 #include "shader_hrm_fullscreen_tri.h"
 #include "shader_hrm_mask.h"
-/*
 #include "shader_rdm_mask.h"
-#include "shader_rdm_reconstruction.h"*/
+#include "shader_rdm_reconstruction.h"
 
 #include <sstream>
 
 namespace vrperfkit {
 	D3D12PostProcessor::D3D12PostProcessor(ComPtr<ID3D12Device> device) : device(device) {
-		enableDynamic = g_config.hiddenMask.dynamic || g_config.ffr.dynamic;
+		// so that switching to an upscaler used in a previous session doesn't stall on shader creation
+		g_shaderCache.Register(ShaderStage::VERTEX, g_HRM_FullscreenTriShader, sizeof(g_HRM_FullscreenTriShader));
+		g_shaderCache.Register(ShaderStage::PIXEL, g_HRM_MaskShader, sizeof(g_HRM_MaskShader));
+		g_shaderCache.Register(ShaderStage::PIXEL, g_RDM_MaskShader, sizeof(g_RDM_MaskShader));
+		g_shaderCache.Register(ShaderStage::COMPUTE, g_RDM_ReconstructionShader, sizeof(g_RDM_ReconstructionShader));
+		D3D12FsrUpscaler::RegisterShaders();
+		D3D12NisUpscaler::RegisterShaders();
+		D3D12CasUpscaler::RegisterShaders();
+		g_shaderCache.Prewarm(device.Get());
+
+		enableDynamic = g_config.hiddenMask.dynamic || g_config.ffr.dynamic || g_config.upscaling.dynamic;
 
 		is_rdm = (g_config.ffr.enabled && g_config.ffr.method == FixedFoveatedMethod::RDM);
 		if (is_rdm) {
 			hiddenMaskApply = g_config.ffr.enabled;
+			if (!g_config.upscaling.enabled) {
+				// the masked image is only reconstructed on its way into the upscaler
+				LOG_ERROR << "RDM requires upscaling or sharpening to be enabled, the image will stay masked";
+			}
+		}
+		else {
+			hiddenMaskApply = g_config.hiddenMask.enabled;
+		}
+		ConfigureMasking();
+
+		CreateDynamicControllers();
+
+		device->GetImmediateContext(context.GetAddressOf());
+
+		try {
+			profiler.reset(new D3D12GpuProfiler(device.Get(), context.Get()));
+		}
+		catch (const std::exception &e) {
+			LOG_ERROR << "Failed to create GPU profiler, dynamic adjustments will be unavailable: " << e.what();
+			enableDynamic = false;
+		}
+
+		LOG_INFO << "Init PostProcessor";
+	}
+
+	void D3D12PostProcessor::OnConfigReloaded(bool outputsChanged) {
+		ConfigureMasking();
+		if (outputsChanged) {
+			// upscalers keep intermediates and views for the previous output textures
+			upscaler.reset();
+			fusedStereoEye = FusedStereoEye();
+		}
+	}
+
+	void D3D12PostProcessor::ConfigureMasking() {
+		if (is_rdm) {
 			preciseResolution = g_config.ffr.preciseResolution;
-			ignoreFirstTargetRenders = g_config.ffr.ignoreFirstTargetRenders;
-			ignoreLastTargetRenders = g_config.ffr.ignoreLastTargetRenders;
-			renderOnlyTarget = g_config.ffr.renderOnlyTarget;
+			depthClears.Configure({ g_config.ffr.ignoreFirstTargetRenders, g_config.ffr.ignoreLastTargetRenders, g_config.ffr.renderOnlyTarget });
 			edgeRadius = g_config.ffr.edgeRadius;
 		}
 		else {
-			hiddenMaskApply = g_config.hiddenMask.enabled;
 			preciseResolution = g_config.hiddenMask.preciseResolution;
-			ignoreFirstTargetRenders = g_config.hiddenMask.ignoreFirstTargetRenders;
-			ignoreLastTargetRenders = g_config.hiddenMask.ignoreLastTargetRenders;
-			renderOnlyTarget = g_config.hiddenMask.renderOnlyTarget;
+			depthClears.Configure({ g_config.hiddenMask.ignoreFirstTargetRenders, g_config.hiddenMask.ignoreLastTargetRenders, g_config.hiddenMask.renderOnlyTarget });
 			edgeRadius = g_config.hiddenMask.edgeRadius;
 		}
+	}
 
-		device->GetImmediateContext(context.GetAddressOf());
-		LOG_INFO << "Init PostProcessor";
+	void D3D12PostProcessor::BeginGameRender() {
+		if (gameRenderPending) {
+			gameRenderPending = false;
+			profiler->BeginSection(GpuSection::GAME_RENDER);
+		}
+	}
+
+	void D3D12PostProcessor::PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) {
+		BeginGameRender();
 	}
 
 	HRESULT D3D12PostProcessor::ClearDepthStencilView(ID3D12DepthStencilView *pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil) {
+		BeginGameRender();
 		if (pDepthStencilView == nullptr) {
 			return 0;
 		}
@@ -54,14 +106,7 @@ namespace vrperfkit {
 		D3D12_TEXTURE2D_DESC texDesc;
 		((ID3D12Resource *)resource.Get())->GetDesc(&texDesc);
 
-		if (preciseResolution) {
-			if (texDesc.Width != textureWidth || texDesc.Height != textureHeight) {
-				return 0;
-			}
-		}
-		else if (texDesc.Width < textureWidth || texDesc.Height < textureHeight || texDesc.Width == texDesc.Height) {
-			// smaller than submitted texture size, so not the correct render target
-			// if equals, this is probably the shadow map or something similar
+		if (!IsEyeDepthBuffer(texDesc.Width, texDesc.Height, textureWidth, textureHeight, preciseResolution)) {
 			return 0;
 		}
 
@@ -178,8 +223,8 @@ namespace vrperfkit {
 			PrepareCopyResources(std.Format);
 		}
 
-		// DXGI_FORMAT textureFormat = DetermineOutputFormat(std.Format);
-		// PrepareRdmResources(textureFormat);
+		DXGI_FORMAT textureFormat = DetermineOutputFormat(std.Format);
+		PrepareRdmResources(textureFormat);
 
 		hrmInitialized = true;
 	}
@@ -207,37 +252,40 @@ namespace vrperfkit {
 		CheckResult("Creating copy SRV", device->CreateShaderResourceView(copiedTexture.Get(), &srv, copiedTextureView.GetAddressOf()));
 	}
 
-	/*void D3D12PostProcessor::PrepareRdmResources(DXGI_FORMAT format) {
-		CheckResult("Creating HRM/RDM fullscreen tri vertex shader", device->CreateVertexShader( g_HRM_FullscreenTriShader, sizeof( g_HRM_FullscreenTriShader ),
-	nullptr, hrmFullTriVertexShader.GetAddressOf() )); if (is_rdm) { CheckResult("Creating RDM masking shader", device->CreatePixelShader( g_RDM_MaskShader,
-	sizeof( g_RDM_MaskShader ), nullptr, rdmMaskingShader.GetAddressOf() )); CheckResult("Creating RDM reconstruction shader", device->CreateComputeShader(
-	g_RDM_ReconstructionShader, sizeof( g_RDM_ReconstructionShader ), nullptr, rdmReconstructShader.GetAddressOf() ));
+	void D3D12PostProcessor::PrepareRdmResources(DXGI_FORMAT format) {
+		hrmFullTriVertexShader = g_shaderCache.GetVertexShader(device.Get(), g_HRM_FullscreenTriShader, sizeof(g_HRM_FullscreenTriShader));
+		if (is_rdm) {
+			rdmMaskingShader = g_shaderCache.GetPixelShader(device.Get(), g_RDM_MaskShader, sizeof(g_RDM_MaskShader));
+			rdmReconstructShader = g_shaderCache.GetComputeShader(device.Get(), g_RDM_ReconstructionShader, sizeof(g_RDM_ReconstructionShader));
 
+			// only read through our own view, so it doesn't need to match the game's format
 			D3D12_TEXTURE2D_DESC td;
 			td.Width = textureWidth;
 			td.Height = textureHeight;
 			td.MipLevels = 1;
 			td.CPUAccessFlags = 0;
 			td.Usage = D3D12_USAGE_DEFAULT;
-			td.BindFlags = D3D12_BIND_UNORDERED_ACCESS|D3D12_BIND_SHADER_RESOURCE;
+			td.BindFlags = D3D12_BIND_UNORDERED_ACCESS | D3D12_BIND_SHADER_RESOURCE;
 			td.Format = format;
 			td.MiscFlags = 0;
 			td.SampleDesc.Count = 1;
 			td.SampleDesc.Quality = 0;
 			td.ArraySize = 1;
-			CheckResult("Creating RDM reconstructed texture", device->CreateTexture2D( &td, nullptr, rdmReconstructedTexture.GetAddressOf() ));
+			CheckResult("Creating RDM reconstructed texture", device->CreateTexture2D(&td, nullptr, rdmReconstructedTexture.GetAddressOf()));
 			D3D12_UNORDERED_ACCESS_VIEW_DESC uav;
 			uav.Format = td.Format;
 			uav.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 			uav.Texture2D.MipSlice = 0;
-			CheckResult("Creating RDM reconstructed UAV", device->CreateUnorderedAccessView( rdmReconstructedTexture.Get(), &uav,
-	rdmReconstructedUav.GetAddressOf() )); D3D12_SHADER_RESOURCE_VIEW_DESC svd; svd.Format = TranslateTypelessFormats(format); svd.ViewDimension =
-	D3D12_SRV_DIMENSION_TEXTURE2D; svd.Texture2D.MostDetailedMip = 0; svd.Texture2D.MipLevels = 1; CheckResult("Creating RDM reconstructed view",
-	device->CreateShaderResourceView( rdmReconstructedTexture.Get(), &svd, rdmReconstructedView.GetAddressOf() ));
-
-		} else {
-			CheckResult("Creating HRM masking shader", device->CreatePixelShader( g_HRM_MaskShader, sizeof( g_HRM_MaskShader ), nullptr,
-	hrmMaskingShader.GetAddressOf() ));
+			CheckResult("Creating RDM reconstructed UAV", device->CreateUnorderedAccessView(rdmReconstructedTexture.Get(), &uav, rdmReconstructedUav.GetAddressOf()));
+			D3D12_SHADER_RESOURCE_VIEW_DESC svd;
+			svd.Format = TranslateTypelessFormats(format);
+			svd.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			svd.Texture2D.MostDetailedMip = 0;
+			svd.Texture2D.MipLevels = 1;
+			CheckResult("Creating RDM reconstructed view", device->CreateShaderResourceView(rdmReconstructedTexture.Get(), &svd, rdmReconstructedView.GetAddressOf()));
+		}
+		else {
+			hrmMaskingShader = g_shaderCache.GetPixelShader(device.Get(), g_HRM_MaskShader, sizeof(g_HRM_MaskShader));
 		}
 
 		D3D12_DEPTH_STENCIL_DESC dsd;
@@ -277,15 +325,15 @@ namespace vrperfkit {
 		bd.MiscFlags = 0;
 		bd.StructureByteStride = 0;
 		bd.ByteWidth = sizeof(RdmMaskingConstants);
-		CheckResult("Creating HRM masking constants buffer", device->CreateBuffer( &bd, nullptr, hrmMaskingConstantsBuffer[0].GetAddressOf() ));
-		CheckResult("Creating HRM masking constants buffer", device->CreateBuffer( &bd, nullptr, hrmMaskingConstantsBuffer[1].GetAddressOf() ));
+		CheckResult("Creating HRM masking constants buffer", device->CreateBuffer(&bd, nullptr, hrmMaskingConstantsBuffer[0].GetAddressOf()));
+		CheckResult("Creating HRM masking constants buffer", device->CreateBuffer(&bd, nullptr, hrmMaskingConstantsBuffer[1].GetAddressOf()));
 
 		if (is_rdm) {
 			bd.ByteWidth = sizeof(RdmReconstructConstants);
-			CheckResult("Creating RDM reconstruct constants buffer", device->CreateBuffer( &bd, nullptr, rdmReconstructConstantsBuffer[0].GetAddressOf() ));
-			CheckResult("Creating RDM reconstruct constants buffer", device->CreateBuffer( &bd, nullptr, rdmReconstructConstantsBuffer[1].GetAddressOf() ));
+			CheckResult("Creating RDM reconstruct constants buffer", device->CreateBuffer(&bd, nullptr, rdmReconstructConstantsBuffer[0].GetAddressOf()));
+			CheckResult("Creating RDM reconstruct constants buffer", device->CreateBuffer(&bd, nullptr, rdmReconstructConstantsBuffer[1].GetAddressOf()));
 		}
-	}*/
+	}
 
 	bool D3D12PostProcessor::HasBlacklistedTextureName(ID3D12Resource *tex) {
 		// Used to ignore certain depth textures that we know are not relevant for us
@@ -345,97 +393,40 @@ namespace vrperfkit {
 		return depthStencilViews[depthStencilTex].view[eye].Get();
 	}
 
+	vr::EVREye D3D12PostProcessor::GuessRenderingEye(bool separateEyeTextures) const {
+		return (vr::EVREye)vrperfkit::GuessRenderingEye(separateEyeTextures);
+	}
+
 	void D3D12PostProcessor::ApplyRadialDensityMask(ID3D12Resource *depthStencilTex, float depth, uint8_t stencil) {
 		if (HasBlacklistedTextureName(depthStencilTex)) {
 			return;
 		}
 
-		++depthClearCount;
-
-		if (!hiddenMaskApply) {
+		if (!depthClears.OnDepthClear(hiddenMaskApply)) {
 			return;
 		}
 
-		vr::EVREye currentEye = vr::Eye_Left;
-
-		if ((renderOnlyTarget > 0 && renderOnlyTarget != depthClearCount) ||
-			(renderOnlyTarget < 0 && depthClearCountMax + 1 + renderOnlyTarget != depthClearCount)) {
-			if (g_config.ffrFastModeUsesHRMCount) {
-				g_config.ffrApplyFastMode = false;
-			}
-			return;
-		}
-
-		if (depthClearCount <= ignoreFirstTargetRenders || (ignoreLastTargetRenders > 0 && depthClearCount > depthClearCountMax - ignoreLastTargetRenders)) {
-			if (g_config.ffrFastModeUsesHRMCount) {
-				g_config.ffrApplyFastMode = false;
-			}
-			return;
-		}
-
-		if (g_config.ffrFastModeUsesHRMCount) {
-			g_config.ffrApplyFastMode = true;
-		}
-
-		if (g_config.gameMode == GameMode::LEFT_EYE_FIRST) {
-			if (g_config.renderingSecondEye) {
-				currentEye = vr::Eye_Right;
-			}
-		}
-		else if (g_config.gameMode == GameMode::RIGHT_EYE_FIRST) {
-			if (!g_config.renderingSecondEye) {
-				currentEye = vr::Eye_Right;
-			}
-		}
-
 		D3D12_TEXTURE2D_DESC td;
 		depthStencilTex->GetDesc(&td);
 
-		bool sideBySide = g_config.gameMode == GameMode::GENERIC_SINGLE || td.Width >= 2 * textureWidth;
+		bool sideBySide = config->gameMode == GameMode::GENERIC_SINGLE || td.Width >= 2 * textureWidth;
 		bool arrayTex = td.ArraySize == 2;
+		vr::EVREye currentEye = GuessRenderingEye(!sideBySide && !arrayTex);
 
-		if (!sideBySide && !arrayTex && g_config.renderingSecondEye) {
-			currentEye = vr::Eye_Right;
-		}
-
-		// LOG_INFO << "Frame: " << depthClearCount << " Eye: " << g_config.renderingSecondEye;
+		// LOG_INFO << "Frame: " << depthClears.Count() << " Eye: " << g_frameState.renderingSecondEye;
 
 		uint32_t renderWidth = td.Width * (sideBySide ? 0.5 : 1);
 		uint32_t renderHeight = td.Height;
+		// the mask has to match the part of the eye the game renders to with dynamic resolution
+		uint32_t maskWidth = renderWidth;
+		uint32_t maskHeight = renderHeight;
+		AdjustDynamicResolution(config->upscaling, maskWidth, maskHeight);
 
-		// Store D3D12 State before drawing mask
-		ComPtr<ID3D12VertexShader> prevVS;
-		context->VSGetShader(prevVS.GetAddressOf(), nullptr, nullptr);
-		ComPtr<ID3D12PixelShader> prevPS;
-		context->PSGetShader(prevPS.GetAddressOf(), nullptr, nullptr);
-		ComPtr<ID3D12InputLayout> inputLayout;
-		context->IAGetInputLayout(inputLayout.GetAddressOf());
-		D3D12_PRIMITIVE_TOPOLOGY topology;
-		context->IAGetPrimitiveTopology(&topology);
-		ID3D12Resource *vertexBuffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
-		UINT strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
-		UINT offsets[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
-		context->IAGetVertexBuffers(0, D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, vertexBuffers, strides, offsets);
-		ComPtr<ID3D12Resource> indexBuffer;
-		DXGI_FORMAT format;
-		UINT offset;
-		context->IAGetIndexBuffer(indexBuffer.GetAddressOf(), &format, &offset);
-		ID3D12RenderTargetView *renderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
-		ComPtr<ID3D12DepthStencilView> depthStencil;
-		context->OMGetRenderTargets(D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT, renderTargets, depthStencil.GetAddressOf());
-		ComPtr<ID3D12RasterizerState> rasterizerState;
-		context->RSGetState(rasterizerState.GetAddressOf());
-		ComPtr<ID3D12DepthStencilState> depthStencilState;
-		UINT stencilRef;
-		context->OMGetDepthStencilState(depthStencilState.GetAddressOf(), &stencilRef);
-		D3D12_VIEWPORT viewports[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
-		UINT numViewports = 0;
-		context->RSGetViewports(&numViewports, nullptr);
-		context->RSGetViewports(&numViewports, viewports);
-		ComPtr<ID3D12Resource> vsConstantBuffer;
-		context->VSGetConstantBuffers(0, 1, vsConstantBuffer.GetAddressOf());
-		ComPtr<ID3D12Resource> psConstantBuffer;
-		context->PSGetConstantBuffers(0, 1, psConstantBuffer.GetAddressOf());
+		D3D12GpuProfileScope profileScope(profiler.get(), GpuSection::MASK);
+
+		// the game's bindings are put back once this goes out of scope
+		D3D12StateOverride stateOverride(stateTracker, context.Get(),
+			STATE_GRAPHICS_SHADERS | STATE_INPUT_ASSEMBLER | STATE_OUTPUT_MERGER | STATE_RASTERIZER | STATE_DEPTH_STENCIL);
 
 		context->VSSetShader(hrmFullTriVertexShader.Get(), nullptr, 0);
 		if (is_rdm) {
@@ -446,8 +437,6 @@ namespace vrperfkit {
 		}
 		context->IASetInputLayout(nullptr);
 		context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		context->IASetVertexBuffers(0, 0, nullptr, nullptr, nullptr);
-		context->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
 		context->OMSetRenderTargets(0, nullptr, GetDepthStencilView(depthStencilTex, currentEye));
 		context->RSSetState(hrmRasterizerState.Get());
 		context->OMSetDepthStencilState(hrmDepthStencilState.Get(), ~stencil);
@@ -455,13 +444,13 @@ namespace vrperfkit {
 		RdmMaskingConstants constants;
 		constants.depthOut = 1.f - depth;
 		if (is_rdm) {
-			constants.radius[0] = g_config.ffr.innerRadius;
-			constants.radius[1] = g_config.ffr.midRadius;
-			constants.radius[2] = g_config.ffr.outerRadius;
+			constants.radius[0] = config->ffr.innerRadius;
+			constants.radius[1] = config->ffr.midRadius;
+			constants.radius[2] = config->ffr.outerRadius;
 		}
 		constants.edgeRadius = edgeRadius;
-		constants.invClusterResolution[0] = 8.f / renderWidth;
-		constants.invClusterResolution[1] = 8.f / renderHeight;
+		constants.invClusterResolution[0] = 8.f / maskWidth;
+		constants.invClusterResolution[1] = 8.f / maskHeight;
 		constants.projectionCenter[0] = projX[currentEye];
 		constants.projectionCenter[1] = projY[currentEye];
 		// New Unity engine with array textures renders heads down and then flips the texture before submitting.
@@ -480,8 +469,8 @@ namespace vrperfkit {
 		vp.TopLeftY = 0;
 		vp.MinDepth = 0;
 		vp.MaxDepth = 1;
-		vp.Width = renderWidth;
-		vp.Height = renderHeight;
+		vp.Width = maskWidth;
+		vp.Height = maskHeight;
 		context->RSSetViewports(1, &vp);
 
 		context->Draw(3, 0);
@@ -502,29 +491,6 @@ namespace vrperfkit {
 
 			context->Draw(3, 0);
 		}
-
-		// Restore D3D12 State
-		context->VSSetShader(prevVS.Get(), nullptr, 0);
-		context->PSSetShader(prevPS.Get(), nullptr, 0);
-		context->IASetInputLayout(inputLayout.Get());
-		context->IASetPrimitiveTopology(topology);
-		context->IASetVertexBuffers(0, D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, vertexBuffers, strides, offsets);
-		for (int i = 0; i < D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT; ++i) {
-			if (vertexBuffers[i])
-				vertexBuffers[i]->Release();
-		}
-		context->IASetIndexBuffer(indexBuffer.Get(), format, offset);
-		context->OMSetRenderTargets(D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT, renderTargets, depthStencil.Get());
-		for (int i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
-			if (renderTargets[i]) {
-				renderTargets[i]->Release();
-			}
-		}
-		context->RSSetState(rasterizerState.Get());
-		context->OMSetDepthStencilState(depthStencilState.Get(), stencilRef);
-		context->RSSetViewports(numViewports, viewports);
-		context->VSSetConstantBuffers(0, 1, vsConstantBuffer.GetAddressOf());
-		context->PSSetConstantBuffers(0, 1, psConstantBuffer.GetAddressOf());
 	}
 
 	void D3D12PostProcessor::ReconstructRdmRender(const D3D12PostProcessInput &input) {
@@ -532,6 +498,21 @@ namespace vrperfkit {
 		ID3D12Resource *emptyBind[] = {nullptr};
 		context->CSSetConstantBuffers(0, 1, emptyBind);
 
+		ID3D12Resource *constantsBuffer = UpdateRdmConstants(input);
+		UINT uavCount = -1;
+		context->CSSetUnorderedAccessViews(0, 1, rdmReconstructedUav.GetAddressOf(), &uavCount);
+		context->CSSetConstantBuffers(0, 1, &constantsBuffer);
+		ID3D12ShaderResourceView *srvs[1] = {input.inputView};
+		context->CSSetShaderResources(0, 1, srvs);
+		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
+		context->Dispatch((input.inputViewport.width + 7) / 8, (input.inputViewport.height + 7) / 8, 1);
+		// the upscaler reads it next
+		ID3D12UnorderedAccessView *emptyUav[] = {nullptr};
+		context->CSSetUnorderedAccessViews(0, 1, emptyUav, &uavCount);
+	}
+
+	ID3D12Resource *D3D12PostProcessor::UpdateRdmConstants(const D3D12PostProcessInput &input) {
+		ComPtr<ID3D12Resource> &buffer = rdmReconstructConstantsBuffer[input.eye];
 		RdmReconstructConstants constants;
 		constants.offset[0] = input.inputViewport.x;
 		constants.offset[1] = input.inputViewport.y;
@@ -541,35 +522,46 @@ namespace vrperfkit {
 		constants.invResolution[1] = 1.f / textureHeight;
 		constants.invClusterResolution[0] = 8.f / input.inputViewport.width;
 		constants.invClusterResolution[1] = 8.f / input.inputViewport.height;
-		constants.radius[0] = g_config.ffr.innerRadius;
-		constants.radius[1] = g_config.ffr.midRadius;
-		constants.radius[2] = g_config.ffr.outerRadius;
+		constants.radius[0] = config->ffr.innerRadius;
+		constants.radius[1] = config->ffr.midRadius;
+		constants.radius[2] = config->ffr.outerRadius;
 		constants.edgeRadius = edgeRadius;
-		if (g_config.gameMode == GameMode::GENERIC_SINGLE && input.eye == vr::Eye_Right) {
+		if (config->gameMode == GameMode::GENERIC_SINGLE && input.eye == vr::Eye_Right) {
 			constants.projectionCenter[0] += 1.f;
 		}
 		D3D12_MAPPED_SUBRESOURCE mapped{nullptr, 0, 0};
-		context->Map(rdmReconstructConstantsBuffer[input.eye].Get(), 0, D3D12_MAP_WRITE_DISCARD, 0, &mapped);
+		CheckResult("Mapping RDM reconstruct constants", context->Map(buffer.Get(), 0, D3D12_MAP_WRITE_DISCARD, 0, &mapped));
 		memcpy(mapped.pData, &constants, sizeof(constants));
-		context->Unmap(rdmReconstructConstantsBuffer[input.eye].Get(), 0);
-		UINT uavCount = -1;
-		context->CSSetUnorderedAccessViews(0, 1, rdmReconstructedUav.GetAddressOf(), &uavCount);
-		context->CSSetConstantBuffers(0, 1, rdmReconstructConstantsBuffer[input.eye].GetAddressOf());
-		ID3D12ShaderResourceView *srvs[1] = {input.inputView};
-		context->CSSetShaderResources(0, 1, srvs);
-		context->CSSetSamplers(0, 1, sampler.GetAddressOf());
-		context->Dispatch((input.inputViewport.width + 7) / 8, (input.inputViewport.height + 7) / 8, 1);
+		context->Unmap(buffer.Get(), 0);
+		return buffer.Get();
 	}
 
-	bool D3D12PostProcessor::Apply(const D3D12PostProcessInput &input, Viewport &outputViewport) {
+	bool D3D12PostProcessor::Apply(const D3D12PostProcessInput &submittedInput, Viewport &outputViewport) {
 		bool didPostprocessing = false;
-		/*
-				if (g_config.debugMode) {
-					StartProfiling();
-				}
-		*/
 
-		if (g_config.hiddenMask.enabled || is_rdm) {
+		if (g_trace.IsActive()) {
+			D3D12_TEXTURE2D_DESC td;
+			submittedInput.inputTexture->GetDesc(&td);
+			g_trace.Record(TraceEventType::SUBMIT, submittedInput.eye, td.Width, td.Height, td.ArraySize, td.SampleDesc.Count, td.Format, (uint8_t)submittedInput.mode);
+		}
+
+		// with dynamic resolution, the game only rendered to the upper left part of the submitted region
+		D3D12PostProcessInput input = submittedInput;
+		input.config = &config.Get();
+		fullViewportWidth = submittedInput.inputViewport.width;
+		fullViewportHeight = submittedInput.inputViewport.height;
+		AdjustDynamicResolution(config->upscaling, input.inputViewport.width, input.inputViewport.height);
+
+		bool profiling = IsProfilingEnabled();
+		if (profiling) {
+			if (!profiler->IsFrameActive()) {
+				profiler->BeginFrame();
+			}
+			profiler->EndSection(GpuSection::GAME_RENDER);
+			gameRenderPending = false;
+		}
+
+		if (config->hiddenMask.enabled || is_rdm) {
 			if (!hrmInitialized) {
 				try {
 					PrepareResources(input.inputTexture);
@@ -581,111 +573,268 @@ namespace vrperfkit {
 			}
 		}
 
-		if (g_config.upscaling.enabled) {
+		if (config->upscaling.enabled && ConsumeFusedStereoEye(input)) {
+			// already upscaled together with the other eye
+			outputViewport = GetOutputViewport(input);
+			didPostprocessing = true;
+		}
+		else if (config->upscaling.enabled) {
 			try {
-				D3D12State previousState;
-				StoreD3D12State(context.Get(), previousState);
+				D3D12StateOverride stateOverride(stateTracker, context.Get(), STATE_COMPUTE | STATE_OUTPUT_MERGER);
 
 				// Disable any RTs in case our input texture is still bound; otherwise using it as a view will fail
 				context->OMSetRenderTargets(0, nullptr, nullptr);
 
 				PrepareUpscaler(input.outputTexture);
-				D3D12_TEXTURE2D_DESC td;
-				input.outputTexture->GetDesc(&td);
-				outputViewport.x = outputViewport.y = 0;
-				outputViewport.width = td.Width;
-				outputViewport.height = td.Height;
-				if (input.mode == TextureMode::COMBINED) {
-					outputViewport.width /= 2;
-					if (input.eye == RIGHT_EYE) {
-						outputViewport.x += outputViewport.width;
-					}
+				bool deferred = config->upscaling.deferredContext && PrepareRecordingContext();
+				ID3D12DeviceContext *upscaleContext = deferred ? recordingContext.Get() : context.Get();
+				upscaler->SetContext(upscaleContext);
+				upscaler->SetProfiler(profiling ? profiler.get() : nullptr);
+				if (profiling) {
+					profiler->SetSectionContext(upscaleContext);
 				}
+				outputViewport = GetOutputViewport(input);
 
 				if (is_rdm) {
-					ReconstructRdmRender(input);
-					context->CopyResource(input.inputTexture, rdmReconstructedTexture.Get());
+					if (upscaler->SupportsRdmReconstruction()) {
+						// saves a full resolution pass and copy
+						input.rdmConstants = UpdateRdmConstants(input);
+					}
+					else {
+						// keeps the input's viewport, so the upscaler can read it in place of the game's texture
+						ReconstructRdmRender(input);
+						input.inputTexture = rdmReconstructedTexture.Get();
+						input.inputView = rdmReconstructedView.Get();
+					}
 				}
 
-				upscaler->Upscale(input, outputViewport);
-
-				float newLodBias = -log2f(outputViewport.width / (float)input.inputViewport.width);
-				if (newLodBias != mipLodBias) {
-					LOG_DEBUG << "MIP LOD Bias changed from " << mipLodBias << " to " << newLodBias << ", recreating samplers";
-					passThroughSamplers.clear();
-					mappedSamplers.clear();
-					mipLodBias = newLodBias;
+				if (!UpscaleStereo(submittedInput, input, outputViewport)) {
+					upscaler->Upscale(input, outputViewport);
+				}
+				if (deferred) {
+					ExecuteRecordedUpscaling();
 				}
 
-				RestoreD3D12State(context.Get(), previousState);
+				// based on the full resolution so that dynamic resolution changes don't keep recreating the samplers
+				// replacements for previous biases stay cached, so switching back to them is free
+				int newLodBiasKey = samplerCache.QuantizeBias(-log2f(outputViewport.width / (float)submittedInput.inputViewport.width));
+				if (newLodBiasKey != mipLodBiasKey) {
+					LOG_DEBUG << "MIP LOD Bias changed from " << samplerCache.BiasFromKey(mipLodBiasKey) << " to " << samplerCache.BiasFromKey(newLodBiasKey);
+					mipLodBiasKey = newLodBiasKey;
+				}
 
 				didPostprocessing = true;
 			}
 			catch (const std::exception &e) {
 				LOG_ERROR << "Upscaling failed: " << e.what();
 				g_config.upscaling.enabled = false;
+				MarkConfigChanged();
+				if (recordingContext != nullptr) {
+					// drop whatever was recorded so far
+					ComPtr<ID3D12CommandList> discarded;
+					recordingContext->FinishCommandList(FALSE, discarded.GetAddressOf());
+				}
+			}
+
+			if (profiler != nullptr) {
+				profiler->SetSectionContext(context.Get());
 			}
 		}
 
-		g_config.renderingSecondEye = !g_config.renderingSecondEye;
-		g_config.ffrRenderTargetCountMax = g_config.ffrRenderTargetCount;
-		g_config.ffrRenderTargetCount = 0;
-		depthClearCountMax = depthClearCount;
-		depthClearCount = 0;
+		EndSubmittedEye();
+		depthClears.EndEye();
 
-		if (enableDynamic && (g_config.renderingSecondEye || g_config.gameMode == GameMode::GENERIC_SINGLE)) {
-			EndDynamicProfiling();
+		// both eyes of a frame are rendered with the same dynamic resolution,
+		// so only move on once the last eye is in; single mode games submit both eyes as well
+		bool completesStereoFrame = submittedInput.eye == RIGHT_EYE;
+		if (completesStereoFrame && stateTracker != nullptr) {
+			stateTracker->EndFrame();
+		}
+
+		if (profiling) {
+			profiler->EndFrame(completesStereoFrame);
+			// The next frame starts right away so that it covers the game's rendering of the next eye,
+			// but the game's section only once it sends work, so the GPU idling while the game waits for
+			// its poses or vsync isn't counted as its rendering time.
+			profiler->BeginFrame();
+			gameRenderPending = true;
+			if (enableDynamic && completesStereoFrame) {
+				EndDynamicProfiling();
+			}
 		}
-		/*
-				if (g_config.debugMode) {
-					EndProfiling();
-				}
-		*/
 		return didPostprocessing;
 	}
 
+	Viewport D3D12PostProcessor::GetOutputViewport(const D3D12PostProcessInput &input) const {
+		D3D12_TEXTURE2D_DESC td;
+		input.outputTexture->GetDesc(&td);
+		Viewport outputViewport;
+		outputViewport.x = outputViewport.y = 0;
+		outputViewport.width = td.Width;
+		outputViewport.height = td.Height;
+		if (input.mode == TextureMode::COMBINED) {
+			outputViewport.width /= 2;
+			if (input.eye == RIGHT_EYE) {
+				outputViewport.x += outputViewport.width;
+			}
+		}
+		return outputViewport;
+	}
+
+	bool D3D12PostProcessor::UpscaleStereo(const D3D12PostProcessInput &submittedInput, const D3D12PostProcessInput &input, const Viewport &outputViewport) {
+		if (!config->upscaling.fusedStereo || fusedStereoFailed || is_rdm) {
+			return false;
+		}
+		if (input.mode != TextureMode::COMBINED && input.mode != TextureMode::ARRAY) {
+			return false;
+		}
+
+		D3D12_TEXTURE2D_DESC itd, otd;
+		input.inputTexture->GetDesc(&itd);
+		input.outputTexture->GetDesc(&otd);
+		// without an output array, both eyes would be written to the same place
+		if (input.mode == TextureMode::ARRAY && (itd.ArraySize < 2 || otd.ArraySize < 2)) {
+			return false;
+		}
+
+		// the other eye isn't submitted yet, so assume it mirrors this one
+		D3D12PostProcessInput inputs[2] = { input, input };
+		D3D12PostProcessInput &other = inputs[1];
+		other.eye = 1 - input.eye;
+		other.projectionCenter = input.otherEyeProjectionCenter;
+		other.otherEyeProjectionCenter = input.projectionCenter;
+		other.inputViewport = submittedInput.inputViewport;
+		if (input.mode == TextureMode::COMBINED) {
+			other.inputViewport.x = itd.Width - submittedInput.inputViewport.x - submittedInput.inputViewport.width;
+		}
+		AdjustDynamicResolution(config->upscaling, other.inputViewport.width, other.inputViewport.height);
+		Viewport outputViewports[2] = { outputViewport, GetOutputViewport(other) };
+
+		if (!upscaler->UpscaleStereo(inputs, outputViewports)) {
+			return false;
+		}
+
+		fusedStereoEye.pending = true;
+		fusedStereoEye.eye = other.eye;
+		fusedStereoEye.inputTexture = other.inputTexture;
+		fusedStereoEye.outputTexture = other.outputTexture;
+		fusedStereoEye.inputViewport = other.inputViewport;
+		return true;
+	}
+
+	bool D3D12PostProcessor::ConsumeFusedStereoEye(const D3D12PostProcessInput &input) {
+		if (!fusedStereoEye.pending) {
+			return false;
+		}
+
+		fusedStereoEye.pending = false;
+		if (input.eye == fusedStereoEye.eye && input.inputTexture == fusedStereoEye.inputTexture
+				&& input.outputTexture == fusedStereoEye.outputTexture && input.inputViewport == fusedStereoEye.inputViewport) {
+			return true;
+		}
+
+		// the eyes don't come in the way we guessed, so don't waste any more work on it
+		LOG_INFO << "Second eye does not match the first, disabling fused stereo upscaling";
+		fusedStereoFailed = true;
+		return false;
+	}
+
 	bool D3D12PostProcessor::PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState *const *ppSamplers) {
-		if (!g_config.upscaling.applyMipBias) {
-			passThroughSamplers.clear();
-			mappedSamplers.clear();
+		if (!config->upscaling.applyMipBias) {
+			if (samplerCache.Size() > 0) {
+				samplerCache.Clear();
+			}
+			return false;
+		}
+		if (mipLodBiasKey == 0) {
 			return false;
 		}
 
+		// only copied once a sampler actually needs to be replaced
 		ID3D12SamplerState *samplers[D3D12_COMMONSHADER_SAMPLER_SLOT_COUNT];
-		memcpy(samplers, ppSamplers, numSamplers * sizeof(ID3D12SamplerState *));
+		bool replaced = false;
+		int created = 0;
 		for (UINT i = 0; i < numSamplers; ++i) {
-			ID3D12SamplerState *orig = samplers[i];
-			if (orig == nullptr || passThroughSamplers.find(orig) != passThroughSamplers.end()) {
+			ID3D12SamplerState *orig = ppSamplers[i];
+			if (orig == nullptr) {
 				continue;
 			}
 
-			if (mappedSamplers.find(orig) == mappedSamplers.end()) {
+			ID3D12SamplerState *replacement = samplerCache.Find(orig, mipLodBiasKey);
+			if (replacement == nullptr) {
 				D3D12_SAMPLER_DESC sd;
 				orig->GetDesc(&sd);
 				if (sd.MipLODBias != 0 || sd.MaxAnisotropy == 1) {
 					// Do not mess with samplers that already have a bias or are not doing anisotropic filtering.
 					// should hopefully reduce the chance of causing rendering errors.
-					passThroughSamplers.insert(orig);
+					// This also covers our own replacements, e.g. when the game's state is restored.
+					samplerCache.Insert(orig, mipLodBiasKey, orig);
 					continue;
 				}
-				sd.MipLODBias = mipLodBias;
-				LOG_INFO << "Creating replacement sampler for " << orig << " with MIP LOD bias " << sd.MipLODBias;
-				device->CreateSamplerState(&sd, mappedSamplers[orig].GetAddressOf());
-				passThroughSamplers.insert(mappedSamplers[orig].Get());
+				sd.MipLODBias = samplerCache.BiasFromKey(mipLodBiasKey);
+				ComPtr<ID3D12SamplerState> sampler;
+				if (FAILED(device->CreateSamplerState(&sd, sampler.GetAddressOf()))) {
+					samplerCache.Insert(orig, mipLodBiasKey, orig);
+					continue;
+				}
+				replacement = sampler.Get();
+				samplerCache.Insert(orig, mipLodBiasKey, replacement, sampler);
+				++created;
+			}
+
+			if (replacement != orig) {
+				if (!replaced) {
+					memcpy(samplers, ppSamplers, numSamplers * sizeof(ID3D12SamplerState *));
+					replaced = true;
+				}
+				samplers[i] = replacement;
 			}
+		}
 
-			samplers[i] = mappedSamplers[orig].Get();
+		if (created > 0) {
+			LOG_INFO << "Created " << created << " replacement samplers with MIP LOD bias " << samplerCache.BiasFromKey(mipLodBiasKey)
+				<< ", " << samplerCache.Size() << " cached, " << samplerCache.Evictions() << " evicted";
 		}
 
+		if (!replaced) {
+			return false;
+		}
 		context->PSSetSamplers(startSlot, numSamplers, samplers);
 		return true;
 	}
 
+	bool D3D12PostProcessor::PreRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *pViewports) {
+		if (!config->upscaling.enabled || config->upscaling.dynamicScale >= 1.f || numViewports == 0 || fullViewportWidth == 0) {
+			return false;
+		}
+
+		D3D12_VIEWPORT viewports[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+		if (numViewports > D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE) {
+			numViewports = D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+		}
+		bool changed = false;
+		for (UINT i = 0; i < numViewports; ++i) {
+			viewports[i] = pViewports[i];
+			// only touch viewports covering a whole eye, anything else is likely a shadow map or similar
+			if (viewports[i].Width == fullViewportWidth && viewports[i].Height == fullViewportHeight) {
+				AdjustDynamicResolution(config->upscaling, viewports[i].Width, viewports[i].Height);
+				changed = true;
+			}
+		}
+
+		if (!changed) {
+			return false;
+		}
+
+		context->RSSetViewports(numViewports, viewports);
+		return true;
+	}
+
 	void D3D12PostProcessor::PrepareUpscaler(ID3D12Resource *outputTexture) {
-		if (upscaler == nullptr || upscaleMethod != g_config.upscaling.method) {
+		if (upscaler == nullptr || upscaleMethod != config->upscaling.method) {
 			D3D12_TEXTURE2D_DESC td;
 			outputTexture->GetDesc(&td);
-			upscaleMethod = g_config.upscaling.method;
+			upscaleMethod = config->upscaling.method;
 			switch (upscaleMethod) {
 			case UpscaleMethod::FSR:
 				upscaler.reset(new D3D12FsrUpscaler(device.Get(), td.Width, td.Height, td.Format));
@@ -698,93 +847,142 @@ namespace vrperfkit {
 				break;
 			}
 
-			passThroughSamplers.clear();
-			mappedSamplers.clear();
+			samplerCache.Clear();
 		}
 	}
 
-	void D3D12PostProcessor::StartDynamicProfiling() {
-		++dynamicSleepCount;
-		if (dynamicSleepCount < g_config.dynamicFramesCheck) {
-			return;
+	bool D3D12PostProcessor::PrepareRecordingContext() {
+		if (recordingContext != nullptr) {
+			return true;
 		}
 
-		is_DynamicProfiling = true;
+		LOG_INFO << "Creating deferred context to record upscaling on";
+		if (FAILED(device->CreateDeferredContext(0, recordingContext.GetAddressOf()))) {
+			LOG_ERROR << "Failed to create deferred context, upscaling on the immediate context instead";
+			g_config.upscaling.deferredContext = false;
+			MarkConfigChanged();
+			return false;
+		}
+		return true;
+	}
 
-		dynamicSleepCount = 0;
+	void D3D12PostProcessor::ExecuteRecordedUpscaling() {
+		// The command list starts out from and leaves behind a clean state, so the game's bindings are
+		// untouched. It runs on the immediate context like everything else, so the GPU still executes
+		// the upscaling after the game's preceding work rather than alongside it.
+		ComPtr<ID3D12CommandList> commandList;
+		CheckResult("recording upscaling command list", recordingContext->FinishCommandList(FALSE, commandList.GetAddressOf()));
+		context->ExecuteCommandList(commandList.Get(), TRUE);
+	}
 
-		GetSystemTimePreciseAsFileTime(&ft);
-		dynamicTimeUs = ft.dwLowDateTime;
+	bool D3D12PostProcessor::IsProfilingEnabled() {
+		return profiler != nullptr && (enableDynamic || config->debugMode);
 	}
 
-	void D3D12PostProcessor::EndDynamicProfiling() {
-		if (is_DynamicProfiling) {
-			GetSystemTimePreciseAsFileTime(&ft);
-			const unsigned int end = ft.dwLowDateTime;
+	void D3D12PostProcessor::CreateDynamicControllers() {
+		if (g_config.ffr.dynamic) {
+			DynamicControllerSettings settings;
+			settings.targetFrameTime = g_config.ffr.targetFrameTime;
+			settings.marginFrameTime = g_config.ffr.marginFrameTime;
+			settings.minValue = g_config.ffr.minRadius;
+			settings.maxValue = g_config.ffr.maxRadius;
+			settings.maxDecreaseStep = g_config.ffr.decreaseRadiusStep;
+			settings.maxIncreaseStep = g_config.ffr.increaseRadiusStep;
+			settings.smoothing = g_config.ffr.dynamicSmoothing;
+			ffrController = CreateDynamicController(g_config.ffr.dynamicController, settings);
+		}
+
+		if (g_config.hiddenMask.dynamic) {
+			DynamicControllerSettings settings;
+			settings.targetFrameTime = g_config.hiddenMask.targetFrameTime;
+			settings.marginFrameTime = g_config.hiddenMask.marginFrameTime;
+			settings.minValue = g_config.hiddenMask.minRadius;
+			settings.maxValue = g_config.hiddenMask.maxRadius;
+			settings.maxDecreaseStep = g_config.hiddenMask.decreaseRadiusStep;
+			settings.maxIncreaseStep = g_config.hiddenMask.increaseRadiusStep;
+			settings.smoothing = g_config.hiddenMask.dynamicSmoothing;
+			hrmController = CreateDynamicController(g_config.hiddenMask.dynamicController, settings);
+		}
+
+		if (g_config.upscaling.enabled && g_config.upscaling.dynamic) {
+			DynamicControllerSettings settings;
+			settings.targetFrameTime = g_config.upscaling.targetFrameTime;
+			settings.marginFrameTime = g_config.upscaling.marginFrameTime;
+			settings.minValue = g_config.upscaling.dynamicMinScale;
+			settings.maxValue = 1.f;
+			settings.maxDecreaseStep = g_config.upscaling.dynamicDecreaseStep;
+			settings.maxIncreaseStep = g_config.upscaling.dynamicIncreaseStep;
+			settings.smoothing = g_config.upscaling.dynamicSmoothing;
+			resolutionController = CreateDynamicController(g_config.upscaling.dynamicController, settings);
+		}
+	}
 
-			float frameTime = (end - dynamicTimeUs) / 10000000.f; // (1000 * 1000 * 10) FrameTime in seconds
+	void D3D12PostProcessor::EndDynamicProfiling() {
+		// GPU timings arrive a few frames late; always consume them so a decision is never based on stale data
+		float frameTime;
+		if (!profiler->FetchFrameTime(frameTime)) {
+			return;
+		}
 
-			// LOG_INFO << "frameTime: " << std::setprecision(8) << frameTime;
+		++dynamicSleepCount;
+		if (dynamicSleepCount < g_config.dynamicFramesCheck) {
+			return;
+		}
+		dynamicSleepCount = 0;
 
-			// HRM
-			if (g_config.hiddenMask.dynamic) {
-				if (frameTime > g_config.hiddenMask.targetFrameTime) {
-					if (g_config.hiddenMask.dynamicChangeRadius) {
-						if ((edgeRadius - g_config.hiddenMask.decreaseRadiusStep) >= g_config.hiddenMask.minRadius) {
-							edgeRadius -= g_config.hiddenMask.decreaseRadiusStep;
-						}
-					}
-					else {
-						hiddenMaskApply = true;
-					}
+		// HRM
+		if (hrmController != nullptr) {
+			if (g_config.hiddenMask.dynamicChangeRadius) {
+				edgeRadius = hrmController->Update(frameTime, edgeRadius);
+			}
+			else {
+				FrameTimeBand band = hrmController->Observe(frameTime);
+				if (band == FrameTimeBand::ABOVE_TARGET) {
+					hiddenMaskApply = true;
 				}
-				else if (frameTime < g_config.hiddenMask.marginFrameTime) {
-					if (g_config.hiddenMask.dynamicChangeRadius) {
-						if ((edgeRadius + g_config.hiddenMask.increaseRadiusStep) <= g_config.hiddenMask.maxRadius) {
-							edgeRadius += g_config.hiddenMask.increaseRadiusStep;
-						}
-					}
-					else {
-						hiddenMaskApply = false;
-					}
+				else if (band == FrameTimeBand::BELOW_MARGIN) {
+					hiddenMaskApply = false;
 				}
 			}
+		}
 
-			// FFR
-			if (g_config.ffr.dynamic) {
-				if (frameTime > g_config.ffr.targetFrameTime) {
-					if (g_config.ffr.dynamicChangeRadius) {
-						if ((g_config.ffr.innerRadius - g_config.ffr.decreaseRadiusStep) >= g_config.ffr.minRadius) {
-							g_config.ffr.innerRadius -= g_config.ffr.decreaseRadiusStep;
-							g_config.ffr.midRadius -= g_config.ffr.decreaseRadiusStep;
-							g_config.ffr.outerRadius -= g_config.ffr.decreaseRadiusStep;
-							g_config.ffr.radiusChanged[0] = true;
-							g_config.ffr.radiusChanged[1] = true;
-						}
-					}
-					else {
-						g_config.ffr.apply = true;
-					}
+		// Dynamic resolution
+		if (resolutionController != nullptr) {
+			float scale = resolutionController->Update(frameTime, g_config.upscaling.dynamicScale);
+			if (scale != g_config.upscaling.dynamicScale) {
+				g_config.upscaling.dynamicScale = scale;
+				MarkConfigChanged();
+			}
+		}
+
+		// FFR
+		if (ffrController != nullptr) {
+			if (g_config.ffr.dynamicChangeRadius) {
+				float innerRadius = ffrController->Update(frameTime, g_config.ffr.innerRadius);
+				float delta = innerRadius - g_config.ffr.innerRadius;
+				if (delta != 0) {
+					g_config.ffr.innerRadius = innerRadius;
+					g_config.ffr.midRadius += delta;
+					g_config.ffr.outerRadius += delta;
+					MarkConfigChanged();
+					g_frameState.ffrRadiusChanged[0] = true;
+					g_frameState.ffrRadiusChanged[1] = true;
 				}
-				else if (frameTime < g_config.ffr.marginFrameTime) {
-					if (g_config.ffr.dynamicChangeRadius) {
-						if ((g_config.ffr.innerRadius + g_config.ffr.increaseRadiusStep) <= g_config.ffr.maxRadius) {
-							g_config.ffr.innerRadius += g_config.ffr.increaseRadiusStep;
-							g_config.ffr.midRadius += g_config.ffr.increaseRadiusStep;
-							g_config.ffr.outerRadius += g_config.ffr.increaseRadiusStep;
-							g_config.ffr.radiusChanged[0] = true;
-							g_config.ffr.radiusChanged[1] = true;
-						}
-					}
-					else {
-						g_config.ffr.apply = false;
-					}
+			}
+			else {
+				FrameTimeBand band = ffrController->Observe(frameTime);
+				bool apply = g_config.ffr.apply;
+				if (band == FrameTimeBand::ABOVE_TARGET) {
+					apply = true;
+				}
+				else if (band == FrameTimeBand::BELOW_MARGIN) {
+					apply = false;
+				}
+				if (apply != g_config.ffr.apply) {
+					g_config.ffr.apply = apply;
+					MarkConfigChanged();
 				}
 			}
-
-			is_DynamicProfiling = false;
 		}
-
-		StartDynamicProfiling();
 	}
 } // namespace vrperfkit
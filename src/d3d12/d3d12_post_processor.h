@@ -1,11 +1,15 @@
 #pragma once
+#include "config.h"
 #include "types.h"
+#include "dynamic_controller.h"
+#include "render_heuristics.h"
+#include "sampler_cache.h"
 #include "d3d12_helper.h"
+#include "d3d12_gpu_profiler.h"
 #include "d3d12_injector.h"
+#include "d3d12_state_tracker.h"
 
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
 
 #include "openvr.h"
 
@@ -16,15 +20,36 @@ namespace vrperfkit {
 		ID3D12ShaderResourceView *inputView;
 		ID3D12ShaderResourceView *outputView;
 		ID3D12UnorderedAccessView *outputUav;
+		// which of the cycled output textures this frame goes to, for upscalers keeping per-frame intermediates
+		int outputSlot = 0;
 		Viewport inputViewport;
 		int eye;
 		TextureMode mode;
 		Point<float> projectionCenter;
+		// needed to upscale both eyes at once for combined and array textures
+		Point<float> otherEyeProjectionCenter = { 0.5f, 0.5f };
+		// set if the input is still masked by RDM, for upscalers reconstructing it as they read it
+		ID3D12Resource *rdmConstants = nullptr;
+		// the snapshot the frame is rendered with, set by the post processor
+		const Config *config = nullptr;
 	};
 
 	class D3D12Upscaler {
 	public:
 		virtual void Upscale(const D3D12PostProcessInput &input, const Viewport &outputViewport) = 0;
+		// Upscales both eyes of a combined or array texture with a single dispatch. Returns false
+		// if the upscaler can't do that, in which case each eye is upscaled separately.
+		virtual bool UpscaleStereo(const D3D12PostProcessInput inputs[2], const Viewport outputViewports[2]) { return false; }
+		// whether the upscaler can read an RDM masked input directly, see D3D12PostProcessInput::rdmConstants
+		virtual bool SupportsRdmReconstruction() const { return false; }
+
+		void SetProfiler(D3D12GpuProfiler *profiler) { this->profiler = profiler; }
+		// the context dispatches are recorded on, the immediate context unless upscaling.deferredContext is on
+		void SetContext(ID3D12DeviceContext *context) { this->context = context; }
+
+	protected:
+		ComPtr<ID3D12DeviceContext> context;
+		D3D12GpuProfiler *profiler = nullptr;
 	};
 
 	class D3D12PostProcessor : public D3D12Listener {
@@ -33,44 +58,71 @@ namespace vrperfkit {
 
 		HRESULT ClearDepthStencilView(ID3D12DepthStencilView *pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil);
 
-		bool Apply(const D3D12PostProcessInput &input, Viewport &outputViewport);
+		bool Apply(const D3D12PostProcessInput &submittedInput, Viewport &outputViewport);
 
 		bool PrePSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState * const *ppSamplers) override;
+		bool PreRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *pViewports) override;
+		void PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) override;
 
 		void D3D12PostProcessor::SetProjCenters(float LX, float LY, float RX, float RY);
+		void SetStateTracker(D3D12StateTracker *tracker) { stateTracker = tracker; }
+		// picks up the masking settings of a reloaded config; outputsChanged if the output textures were recreated
+		void OnConfigReloaded(bool outputsChanged);
 
 	private:
 		ComPtr<ID3D12Device> device;
 		ComPtr<ID3D12DeviceContext> context;
+		D3D12StateTracker *stateTracker = nullptr;
+		// what the game's current frame is rendered with, g_config itself is only written to
+		ConfigSnapshot config;
 		std::unique_ptr<D3D12Upscaler> upscaler;
 		UpscaleMethod upscaleMethod;
 
 		void PrepareUpscaler(ID3D12Resource *outputTexture);
 
-		std::unordered_set<ID3D12SamplerState*> passThroughSamplers;
-		std::unordered_map<ID3D12SamplerState*, ComPtr<ID3D12SamplerState>> mappedSamplers;
-		float mipLodBias = 0.0f;
-
-
-		struct DynamicProfileQuery {
-			ComPtr<ID3D12Query> queryDisjoint;
-			ComPtr<ID3D12Query> queryStart;
-			ComPtr<ID3D12Query> queryEnd;
+		// with upscaling.deferredContext, upscaling is recorded here and then executed on the immediate
+		// context as one command list, in order with the game's work
+		ComPtr<ID3D12DeviceContext> recordingContext;
+		bool PrepareRecordingContext();
+		void ExecuteRecordedUpscaling();
+		Viewport GetOutputViewport(const D3D12PostProcessInput &input) const;
+
+		// the eye that was already upscaled along with the other one, so its own submit can skip it
+		struct FusedStereoEye {
+			bool pending = false;
+			int eye = 0;
+			ID3D12Resource *inputTexture = nullptr;
+			ID3D12Resource *outputTexture = nullptr;
+			Viewport inputViewport;
 		};
-		FILETIME ft;
-		unsigned int dynamicTimeUs = 0;
+		FusedStereoEye fusedStereoEye;
+		bool fusedStereoFailed = false;
+		bool UpscaleStereo(const D3D12PostProcessInput &submittedInput, const D3D12PostProcessInput &input, const Viewport &outputViewport);
+		bool ConsumeFusedStereoEye(const D3D12PostProcessInput &input);
+
+		SamplerReplacementCache<ID3D12SamplerState, ComPtr<ID3D12SamplerState>> samplerCache;
+		int mipLodBiasKey = 0;
+
+		std::unique_ptr<D3D12GpuProfiler> profiler;
+		std::unique_ptr<DynamicController> ffrController;
+		std::unique_ptr<DynamicController> hrmController;
+		std::unique_ptr<DynamicController> resolutionController;
+		// size of the eye viewports as submitted, i.e. before applying dynamic resolution
+		uint32_t fullViewportWidth = 0;
+		uint32_t fullViewportHeight = 0;
 		int dynamicSleepCount = 0;
-		bool is_DynamicProfiling = false;
 		bool enableDynamic = false;
 		bool hiddenMaskApply = false;
 		bool is_rdm = false;
 		bool preciseResolution = false;
-		int ignoreFirstTargetRenders = 0;
-		int ignoreLastTargetRenders = 0;
-		int renderOnlyTarget = 0;
 
-		void CreateDynamicProfileQueries();
-		void StartDynamicProfiling();
+		// the game's section of the profiler opens with its first tracked work after a submit
+		bool gameRenderPending = false;
+		void BeginGameRender();
+
+		bool IsProfilingEnabled();
+		void ConfigureMasking();
+		void CreateDynamicControllers();
 		void EndDynamicProfiling();
 
 		ComPtr<ID3D12Resource> copiedTexture;
@@ -94,8 +146,7 @@ namespace vrperfkit {
 		ComPtr<ID3D12RasterizerState> hrmRasterizerState;
 		float projX[2];
 		float projY[2];
-		int depthClearCount = 0;
-		int depthClearCountMax = 0;
+		DepthClearCounter depthClears;
 		float edgeRadius = 1.15f;
 		
 		struct DepthStencilViews {
@@ -104,11 +155,13 @@ namespace vrperfkit {
 		std::unordered_map<ID3D12Resource*, DepthStencilViews> depthStencilViews;
 
 		bool D3D12PostProcessor::HasBlacklistedTextureName(ID3D12Resource *tex);
+		vr::EVREye D3D12PostProcessor::GuessRenderingEye(bool separateEyeTextures) const;
 		ID3D12DepthStencilView * D3D12PostProcessor::GetDepthStencilView(ID3D12Resource *depthStencilTex, vr::EVREye eye);
 		void D3D12PostProcessor::PrepareResources(ID3D12Resource *inputTexture);
 		void D3D12PostProcessor::PrepareCopyResources(DXGI_FORMAT format);
 		void D3D12PostProcessor::PrepareRdmResources(DXGI_FORMAT format);
 		void D3D12PostProcessor::ApplyRadialDensityMask(ID3D12Resource *depthStencilTex, float depth, uint8_t stencil);
 		void D3D12PostProcessor::ReconstructRdmRender(const D3D12PostProcessInput &input);
+		ID3D12Resource *D3D12PostProcessor::UpdateRdmConstants(const D3D12PostProcessInput &input);
 	};
 }
@@ -0,0 +1,240 @@
+#include "d3d12_shader_cache.h"
+#include "d3d12_helper.h"
+#include "logging.h"
+
+#include <dxgi.h>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+namespace vrperfkit {
+	D3D12ShaderCache g_shaderCache;
+
+	struct D3D12ShaderCache::DeviceShaders {
+		std::mutex mutex;
+		ComPtr<ID3D12Device> device;
+		ShaderCacheManifest manifest;
+		std::unordered_map<uint64_t, ComPtr<ID3D12DeviceChild>> created;
+		// the manifest has entries that aren't saved yet
+		bool manifestDirty = false;
+		// tells the prewarm thread to stop once the device is replaced
+		bool abandoned = false;
+	};
+
+	namespace {
+		ShaderCacheKey GetShaderCacheKey(ID3D12Device *device) {
+			ShaderCacheKey key;
+			ComPtr<IDXGIDevice> dxgiDevice;
+			ComPtr<IDXGIAdapter> adapter;
+			if (FAILED(device->QueryInterface(dxgiDevice.GetAddressOf())) || FAILED(dxgiDevice->GetAdapter(adapter.GetAddressOf()))) {
+				return key;
+			}
+			DXGI_ADAPTER_DESC desc;
+			if (SUCCEEDED(adapter->GetDesc(&desc))) {
+				key.vendorId = desc.VendorId;
+				key.deviceId = desc.DeviceId;
+			}
+			LARGE_INTEGER driverVersion;
+			if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion))) {
+				key.driverVersion = driverVersion.QuadPart;
+			}
+			return key;
+		}
+
+		HRESULT CreateShader(ID3D12Device *device, ShaderStage stage, const void *data, size_t size, ComPtr<ID3D12DeviceChild> &shader) {
+			HRESULT result = E_INVALIDARG;
+			switch (stage) {
+			case ShaderStage::VERTEX: {
+				ComPtr<ID3D12VertexShader> vs;
+				result = device->CreateVertexShader(data, size, nullptr, vs.GetAddressOf());
+				shader = vs;
+				break;
+			}
+			case ShaderStage::PIXEL: {
+				ComPtr<ID3D12PixelShader> ps;
+				result = device->CreatePixelShader(data, size, nullptr, ps.GetAddressOf());
+				shader = ps;
+				break;
+			}
+			case ShaderStage::COMPUTE: {
+				ComPtr<ID3D12ComputeShader> cs;
+				result = device->CreateComputeShader(data, size, nullptr, cs.GetAddressOf());
+				shader = cs;
+				break;
+			}
+			}
+			return result;
+		}
+
+		// when the process is exiting, the lock may be held by a thread that is already gone
+		bool Acquire(std::unique_lock<std::mutex> &lock, bool processExiting) {
+			if (processExiting) {
+				return lock.try_lock();
+			}
+			lock.lock();
+			return true;
+		}
+	}
+
+	void D3D12ShaderCache::SetManifestPath(const std::filesystem::path &path) {
+		std::lock_guard lock (mutex);
+		manifestPath = path;
+	}
+
+	void D3D12ShaderCache::Register(ShaderStage stage, const void *data, size_t size) {
+		std::lock_guard lock (mutex);
+		bool known = std::any_of(registered.begin(), registered.end(), [data](const Registered &r) { return r.data == data; });
+		if (!known) {
+			registered.push_back({ stage, data, size, HashShaderBytecode(data, size) });
+		}
+	}
+
+	void D3D12ShaderCache::Prewarm(ID3D12Device *device) {
+		std::shared_ptr<DeviceShaders> target = ForDevice(device);
+
+		std::vector<Registered> pending;
+		{
+			std::lock_guard lock (mutex);
+			std::lock_guard shadersLock (target->mutex);
+			for (const Registered &r : registered) {
+				if (target->manifest.Contains(r.hash) && target->created.find(r.hash) == target->created.end()) {
+					pending.push_back(r);
+				}
+			}
+		}
+		if (pending.empty()) {
+			return;
+		}
+
+		LOG_INFO << "Creating " << pending.size() << " shaders used in previous sessions in the background";
+		std::thread([this, target, pending]() {
+			for (const Registered &r : pending) {
+				{
+					std::lock_guard lock (target->mutex);
+					if (target->abandoned) {
+						return;
+					}
+					if (target->created.find(r.hash) != target->created.end()) {
+						continue;
+					}
+				}
+				ComPtr<ID3D12DeviceChild> shader;
+				if (FAILED(CreateShader(target->device.Get(), r.stage, r.data, r.size, shader))) {
+					LOG_ERROR << "Failed to create shader " << std::hex << r.hash << std::dec << " in the background";
+					continue;
+				}
+				std::lock_guard lock (target->mutex);
+				target->created.emplace(r.hash, shader);
+			}
+			LOG_DEBUG << "Background shader creation finished";
+			// the render thread may have added shaders in the meantime
+			SaveManifest();
+		}).detach();
+	}
+
+	ComPtr<ID3D12VertexShader> D3D12ShaderCache::GetVertexShader(ID3D12Device *device, const void *data, size_t size) {
+		ComPtr<ID3D12VertexShader> shader;
+		CheckResult("querying cached vertex shader", Get(device, ShaderStage::VERTEX, data, size).As(&shader));
+		return shader;
+	}
+
+	ComPtr<ID3D12PixelShader> D3D12ShaderCache::GetPixelShader(ID3D12Device *device, const void *data, size_t size) {
+		ComPtr<ID3D12PixelShader> shader;
+		CheckResult("querying cached pixel shader", Get(device, ShaderStage::PIXEL, data, size).As(&shader));
+		return shader;
+	}
+
+	ComPtr<ID3D12ComputeShader> D3D12ShaderCache::GetComputeShader(ID3D12Device *device, const void *data, size_t size) {
+		ComPtr<ID3D12ComputeShader> shader;
+		CheckResult("querying cached compute shader", Get(device, ShaderStage::COMPUTE, data, size).As(&shader));
+		return shader;
+	}
+
+	void D3D12ShaderCache::SaveManifest(bool processExiting) {
+		// the prewarm thread and shutdown may both want to save
+		std::unique_lock saveLock (saveMutex, std::defer_lock);
+		if (!Acquire(saveLock, processExiting)) {
+			return;
+		}
+		std::unique_lock lock (mutex, std::defer_lock);
+		if (!Acquire(lock, processExiting)) {
+			return;
+		}
+		std::shared_ptr<DeviceShaders> target = shaders;
+		std::filesystem::path path = manifestPath;
+		lock.unlock();
+		if (target == nullptr || path.empty()) {
+			return;
+		}
+
+		ShaderCacheManifest manifest;
+		{
+			std::unique_lock shadersLock (target->mutex, std::defer_lock);
+			if (!Acquire(shadersLock, processExiting)) {
+				return;
+			}
+			if (!target->manifestDirty) {
+				return;
+			}
+			manifest = target->manifest;
+			target->manifestDirty = false;
+		}
+
+		if (manifest.Save(path)) {
+			LOG_DEBUG << "Saved shader manifest with " << manifest.Entries().size() << " shaders";
+		}
+		else {
+			LOG_ERROR << "Failed to save shader manifest to " << path.string();
+		}
+	}
+
+	std::shared_ptr<D3D12ShaderCache::DeviceShaders> D3D12ShaderCache::ForDevice(ID3D12Device *device) {
+		std::lock_guard lock (mutex);
+		if (shaders != nullptr && shaders->device.Get() == device) {
+			return shaders;
+		}
+
+		std::shared_ptr<DeviceShaders> previous = shaders;
+		shaders = std::make_shared<DeviceShaders>();
+		shaders->device = device;
+		shaders->manifest = ShaderCacheManifest(GetShaderCacheKey(device));
+		if (!manifestPath.empty() && shaders->manifest.Load(manifestPath)) {
+			LOG_INFO << "Shader manifest lists " << shaders->manifest.Entries().size() << " shaders";
+		}
+
+		if (previous != nullptr) {
+			std::lock_guard shadersLock (previous->mutex);
+			previous->abandoned = true;
+			// carry over what the previous device added but didn't save, if it's the same GPU
+			if (previous->manifestDirty && previous->manifest.Key() == shaders->manifest.Key()) {
+				for (const ShaderCacheEntry &entry : previous->manifest.Entries()) {
+					shaders->manifestDirty |= shaders->manifest.Add(entry.hash, entry.stage);
+				}
+			}
+		}
+		return shaders;
+	}
+
+	ComPtr<ID3D12DeviceChild> D3D12ShaderCache::Get(ID3D12Device *device, ShaderStage stage, const void *data, size_t size) {
+		std::shared_ptr<DeviceShaders> target = ForDevice(device);
+		uint64_t hash = HashShaderBytecode(data, size);
+		{
+			std::lock_guard lock (target->mutex);
+			auto it = target->created.find(hash);
+			if (it != target->created.end()) {
+				return it->second;
+			}
+		}
+
+		ComPtr<ID3D12DeviceChild> shader;
+		CheckResult("creating shader", CreateShader(device, stage, data, size, shader));
+
+		std::lock_guard lock (target->mutex);
+		// the prewarm thread may have gotten there first
+		shader = target->created.emplace(hash, shader).first->second;
+		if (target->manifest.Add(hash, stage)) {
+			target->manifestDirty = true;
+		}
+		return shader;
+	}
+}
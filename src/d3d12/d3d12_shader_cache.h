@@ -0,0 +1,56 @@
+#pragma once
+#include "shader_cache.h"
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+using Microsoft::WRL::ComPtr;
+
+namespace vrperfkit {
+	// Shares the shaders of all passes between upscaler and post processor instances, so that switching
+	// back to an upscaler reuses the shaders created for it before. The shaders used in previous sessions
+	// are listed in a manifest next to the config and created on a background thread at startup, so that
+	// their first use, e.g. after switching the upscaler by hotkey, doesn't stall the render thread.
+	// Shaders first created on the render thread only mark the manifest dirty, it is written once the
+	// prewarm thread is done and at shutdown.
+	class D3D12ShaderCache {
+	public:
+		void SetManifestPath(const std::filesystem::path &path);
+
+		// makes bytecode that is part of the binary known for prewarming, call before Prewarm
+		void Register(ShaderStage stage, const void *data, size_t size);
+		// starts creating the registered shaders that the manifest for the device's GPU lists in the background
+		void Prewarm(ID3D12Device *device);
+
+		ComPtr<ID3D12VertexShader> GetVertexShader(ID3D12Device *device, const void *data, size_t size);
+		ComPtr<ID3D12PixelShader> GetPixelShader(ID3D12Device *device, const void *data, size_t size);
+		ComPtr<ID3D12ComputeShader> GetComputeShader(ID3D12Device *device, const void *data, size_t size);
+
+		// writes the manifest if shaders were added since it was last saved, keep it off the render thread
+		void SaveManifest(bool processExiting = false);
+
+	private:
+		struct DeviceShaders;
+
+		std::mutex mutex;
+		std::mutex saveMutex;
+		std::filesystem::path manifestPath;
+		struct Registered {
+			ShaderStage stage;
+			const void *data;
+			size_t size;
+			uint64_t hash;
+		};
+		std::vector<Registered> registered;
+		// shared with the prewarm thread, replaced when the device changes
+		std::shared_ptr<DeviceShaders> shaders;
+
+		std::shared_ptr<DeviceShaders> ForDevice(ID3D12Device *device);
+		ComPtr<ID3D12DeviceChild> Get(ID3D12Device *device, ShaderStage stage, const void *data, size_t size);
+	};
+
+	extern D3D12ShaderCache g_shaderCache;
+}
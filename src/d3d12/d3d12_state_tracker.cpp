@@ -0,0 +1,249 @@
+#include "d3d12_state_tracker.h"
+#include "logging.h"
+
+namespace vrperfkit {
+	D3D12StateTracker::D3D12StateTracker(ID3D12DeviceContext *context, uint32_t trackedGroups) : context(context), trackedGroups(trackedGroups) {
+		Sync();
+	}
+
+	void D3D12StateTracker::Sync() {
+		// we are usually created in the middle of a frame, so pick up whatever the game has bound right now
+		ID3D12ShaderResourceView *srvs[CS_SRV_SLOTS];
+		ID3D12RenderTargetView *rtvs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+
+		context->CSGetShader(computeShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+		context->CSGetShaderResources(0, CS_SRV_SLOTS, srvs);
+		for (UINT i = 0; i < CS_SRV_SLOTS; ++i) {
+			csShaderResources[i].Attach(srvs[i]);
+		}
+		context->CSGetUnorderedAccessViews(0, 1, csUav.ReleaseAndGetAddressOf());
+		context->CSGetSamplers(0, 1, csSampler.ReleaseAndGetAddressOf());
+		context->VSGetShader(vertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+		context->PSGetShader(pixelShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+		context->IAGetInputLayout(inputLayout.ReleaseAndGetAddressOf());
+		context->IAGetPrimitiveTopology(&topology);
+		context->OMGetRenderTargets(D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs, depthStencil.ReleaseAndGetAddressOf());
+		numRenderTargets = 0;
+		for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+			renderTargets[i].Attach(rtvs[i]);
+			if (rtvs[i] != nullptr) {
+				numRenderTargets = i + 1;
+			}
+		}
+		context->OMGetDepthStencilState(depthStencilState.ReleaseAndGetAddressOf(), &stencilRef);
+		context->RSGetState(rasterizerState.ReleaseAndGetAddressOf());
+		numViewports = D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+		context->RSGetViewports(&numViewports, viewports);
+	}
+
+	void D3D12StateTracker::Reset() {
+		computeShader.Reset();
+		for (auto &srv : csShaderResources) {
+			srv.Reset();
+		}
+		csUav.Reset();
+		csSampler.Reset();
+		vertexShader.Reset();
+		pixelShader.Reset();
+		inputLayout.Reset();
+		topology = D3D12_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		for (auto &rtv : renderTargets) {
+			rtv.Reset();
+		}
+		numRenderTargets = 0;
+		depthStencil.Reset();
+		depthStencilState.Reset();
+		stencilRef = 0;
+		rasterizerState.Reset();
+		numViewports = 0;
+	}
+
+	void D3D12StateTracker::BeginOverride(uint32_t groups) {
+		overriding = true;
+		overriddenGroups = groups;
+
+		if (groups & STATE_COMPUTE) {
+			ID3D12Resource *buffers[CS_CONSTANT_BUFFER_SLOTS];
+			context->CSGetConstantBuffers(0, CS_CONSTANT_BUFFER_SLOTS, buffers);
+			for (UINT i = 0; i < CS_CONSTANT_BUFFER_SLOTS; ++i) {
+				csConstantBuffers[i].Attach(buffers[i]);
+			}
+			++contextCalls;
+		}
+		if (groups & STATE_GRAPHICS_SHADERS) {
+			context->VSGetConstantBuffers(0, 1, vsConstantBuffer.ReleaseAndGetAddressOf());
+			context->PSGetConstantBuffers(0, 1, psConstantBuffer.ReleaseAndGetAddressOf());
+			contextCalls += 2;
+		}
+		fullContextCalls += FULL_SAVE_RESTORE_CALLS;
+	}
+
+	void D3D12StateTracker::EndOverride() {
+		// the setters below still pass through our hooks, which must not record them while overriding
+		uint32_t groups = overriddenGroups;
+
+		if (groups & STATE_COMPUTE) {
+			ID3D12ShaderResourceView *srvs[CS_SRV_SLOTS];
+			for (UINT i = 0; i < CS_SRV_SLOTS; ++i) {
+				srvs[i] = csShaderResources[i].Get();
+			}
+			ID3D12Resource *buffers[CS_CONSTANT_BUFFER_SLOTS];
+			for (UINT i = 0; i < CS_CONSTANT_BUFFER_SLOTS; ++i) {
+				buffers[i] = csConstantBuffers[i].Get();
+			}
+			UINT keepCounter = -1;
+			context->CSSetShader(computeShader.Get(), nullptr, 0);
+			context->CSSetConstantBuffers(0, CS_CONSTANT_BUFFER_SLOTS, buffers);
+			context->CSSetShaderResources(0, CS_SRV_SLOTS, srvs);
+			context->CSSetUnorderedAccessViews(0, 1, csUav.GetAddressOf(), &keepCounter);
+			context->CSSetSamplers(0, 1, csSampler.GetAddressOf());
+			contextCalls += 5;
+			for (auto &buffer : csConstantBuffers) {
+				buffer.Reset();
+			}
+		}
+		if (groups & STATE_GRAPHICS_SHADERS) {
+			context->VSSetShader(vertexShader.Get(), nullptr, 0);
+			context->PSSetShader(pixelShader.Get(), nullptr, 0);
+			context->VSSetConstantBuffers(0, 1, vsConstantBuffer.GetAddressOf());
+			context->PSSetConstantBuffers(0, 1, psConstantBuffer.GetAddressOf());
+			contextCalls += 4;
+			vsConstantBuffer.Reset();
+			psConstantBuffer.Reset();
+		}
+		if (groups & STATE_INPUT_ASSEMBLER) {
+			context->IASetInputLayout(inputLayout.Get());
+			context->IASetPrimitiveTopology(topology);
+			contextCalls += 2;
+		}
+		if (groups & STATE_RASTERIZER) {
+			context->RSSetState(rasterizerState.Get());
+			context->RSSetViewports(numViewports, viewports);
+			contextCalls += 2;
+		}
+		if (groups & STATE_DEPTH_STENCIL) {
+			context->OMSetDepthStencilState(depthStencilState.Get(), stencilRef);
+			++contextCalls;
+		}
+		// last, so that the game's render targets win over any of them we restored as shader inputs above
+		if (groups & STATE_OUTPUT_MERGER) {
+			ID3D12RenderTargetView *rtvs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			for (UINT i = 0; i < numRenderTargets; ++i) {
+				rtvs[i] = renderTargets[i].Get();
+			}
+			context->OMSetRenderTargets(numRenderTargets, rtvs, depthStencil.Get());
+			++contextCalls;
+		}
+
+		overriddenGroups = 0;
+		overriding = false;
+	}
+
+	void D3D12StateTracker::OnCSSetShader(ID3D12ComputeShader *shader) {
+		computeShader = shader;
+	}
+
+	void D3D12StateTracker::OnCSSetShaderResources(UINT startSlot, UINT numViews, ID3D12ShaderResourceView *const *views) {
+		for (UINT i = 0; i < numViews && startSlot + i < CS_SRV_SLOTS; ++i) {
+			csShaderResources[startSlot + i] = views != nullptr ? views[i] : nullptr;
+		}
+	}
+
+	void D3D12StateTracker::OnCSSetUnorderedAccessViews(UINT startSlot, UINT numUavs, ID3D12UnorderedAccessView *const *uavs) {
+		if (startSlot == 0 && numUavs > 0) {
+			csUav = uavs != nullptr ? uavs[0] : nullptr;
+		}
+	}
+
+	void D3D12StateTracker::OnCSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState *const *samplers) {
+		if (startSlot == 0 && numSamplers > 0) {
+			csSampler = samplers != nullptr ? samplers[0] : nullptr;
+		}
+	}
+
+	void D3D12StateTracker::OnVSSetShader(ID3D12VertexShader *shader) {
+		vertexShader = shader;
+	}
+
+	void D3D12StateTracker::OnPSSetShader(ID3D12PixelShader *shader) {
+		pixelShader = shader;
+	}
+
+	void D3D12StateTracker::OnIASetInputLayout(ID3D12InputLayout *inputLayout) {
+		this->inputLayout = inputLayout;
+	}
+
+	void D3D12StateTracker::OnIASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) {
+		this->topology = topology;
+	}
+
+	void D3D12StateTracker::OnOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) {
+		if (numViews > D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT) {
+			numViews = D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT;
+		}
+		for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+			renderTargets[i] = i < numViews && renderTargetViews != nullptr ? renderTargetViews[i] : nullptr;
+		}
+		numRenderTargets = numViews;
+		depthStencil = depthStencilView;
+	}
+
+	void D3D12StateTracker::OnOMSetDepthStencilState(ID3D12DepthStencilState *depthStencilState, UINT stencilRef) {
+		this->depthStencilState = depthStencilState;
+		this->stencilRef = stencilRef;
+	}
+
+	void D3D12StateTracker::OnRSSetState(ID3D12RasterizerState *rasterizerState) {
+		this->rasterizerState = rasterizerState;
+	}
+
+	void D3D12StateTracker::OnRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *viewports) {
+		if (numViewports > D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE) {
+			numViewports = D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+		}
+		for (UINT i = 0; i < numViewports; ++i) {
+			this->viewports[i] = viewports[i];
+		}
+		this->numViewports = numViewports;
+	}
+
+	void D3D12StateTracker::CountFullSaveRestore() {
+		contextCalls += FULL_SAVE_RESTORE_CALLS;
+		fullContextCalls += FULL_SAVE_RESTORE_CALLS;
+	}
+
+	void D3D12StateTracker::EndFrame() {
+		if (++frameCount < REPORT_INTERVAL) {
+			return;
+		}
+
+		LOG_DEBUG << "State save/restore: " << float(contextCalls) / frameCount << " context calls per frame, "
+			<< float(fullContextCalls) / frameCount << " with full save/restore";
+		contextCalls = 0;
+		fullContextCalls = 0;
+		frameCount = 0;
+	}
+
+	D3D12StateOverride::D3D12StateOverride(D3D12StateTracker *tracker, ID3D12DeviceContext *context, uint32_t groups)
+			: tracker(tracker), context(context) {
+		if (tracker != nullptr && !tracker->IsOverriding() && (groups & ~tracker->TrackedGroups()) == 0) {
+			tracker->BeginOverride(groups);
+		}
+		else {
+			fullState.reset(new D3D12State);
+			StoreD3D12State(context, *fullState);
+			if (tracker != nullptr) {
+				tracker->CountFullSaveRestore();
+			}
+		}
+	}
+
+	D3D12StateOverride::~D3D12StateOverride() {
+		if (fullState) {
+			RestoreD3D12State(context, *fullState);
+		}
+		else {
+			tracker->EndOverride();
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "d3d12_helper.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace vrperfkit {
+	// the parts of the pipeline state our post-processing passes overwrite
+	enum D3D12StateGroup : uint32_t {
+		STATE_COMPUTE = 1 << 0,         // CS shader, constant buffers 0 and 1 and the first few SRV, UAV and sampler slots
+		STATE_OUTPUT_MERGER = 1 << 1,   // render targets and depth stencil view
+		STATE_GRAPHICS_SHADERS = 1 << 2,// VS and PS with their constant buffer 0
+		STATE_INPUT_ASSEMBLER = 1 << 3, // input layout and topology
+		STATE_RASTERIZER = 1 << 4,      // rasterizer state and viewports
+		STATE_DEPTH_STENCIL = 1 << 5,   // depth stencil state and stencil ref
+	};
+
+	// Keeps a shadow copy of the game's bindings for the state groups above, fed by the setter hooks
+	// in D3D12Injector. That way we don't have to query the whole pipeline state from the context
+	// every time we post-process and can restore only the slots our own passes changed.
+	class D3D12StateTracker {
+	public:
+		// the input, the NIS coefficients and the tile lists of the foveated passes
+		static const UINT CS_SRV_SLOTS = 4;
+		// our own constants, and the RDM constants of upscalers reconstructing a masked input
+		static const UINT CS_CONSTANT_BUFFER_SLOTS = 2;
+
+		D3D12StateTracker(ID3D12DeviceContext *context, uint32_t trackedGroups);
+
+		uint32_t TrackedGroups() const { return trackedGroups; }
+		bool IsOverriding() const { return overriding; }
+
+		void BeginOverride(uint32_t groups);
+		void EndOverride();
+
+		// after ClearState or executing a command list without restoring the context state
+		void Reset();
+
+		void OnCSSetShader(ID3D12ComputeShader *shader);
+		void OnCSSetShaderResources(UINT startSlot, UINT numViews, ID3D12ShaderResourceView *const *views);
+		void OnCSSetUnorderedAccessViews(UINT startSlot, UINT numUavs, ID3D12UnorderedAccessView *const *uavs);
+		void OnCSSetSamplers(UINT startSlot, UINT numSamplers, ID3D12SamplerState *const *samplers);
+		void OnVSSetShader(ID3D12VertexShader *shader);
+		void OnPSSetShader(ID3D12PixelShader *shader);
+		void OnIASetInputLayout(ID3D12InputLayout *inputLayout);
+		void OnIASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+		void OnOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView *const *renderTargetViews, ID3D12DepthStencilView *depthStencilView);
+		void OnOMSetDepthStencilState(ID3D12DepthStencilState *depthStencilState, UINT stencilRef);
+		void OnRSSetState(ID3D12RasterizerState *rasterizerState);
+		void OnRSSetViewports(UINT numViewports, const D3D12_VIEWPORT *viewports);
+
+		// counts the context calls spent on saving and restoring state, for the periodic statistics
+		void CountFullSaveRestore();
+		void EndFrame();
+
+	private:
+		static const int REPORT_INTERVAL = 1000;
+		// StoreD3D12State issues 17 and RestoreD3D12State 16 context calls
+		static const uint32_t FULL_SAVE_RESTORE_CALLS = 33;
+
+		ComPtr<ID3D12DeviceContext> context;
+		uint32_t trackedGroups;
+		uint32_t overriddenGroups = 0;
+		bool overriding = false;
+
+		ComPtr<ID3D12ComputeShader> computeShader;
+		ComPtr<ID3D12ShaderResourceView> csShaderResources[CS_SRV_SLOTS];
+		ComPtr<ID3D12UnorderedAccessView> csUav;
+		ComPtr<ID3D12SamplerState> csSampler;
+		ComPtr<ID3D12VertexShader> vertexShader;
+		ComPtr<ID3D12PixelShader> pixelShader;
+		ComPtr<ID3D12InputLayout> inputLayout;
+		D3D12_PRIMITIVE_TOPOLOGY topology = D3D12_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		ComPtr<ID3D12RenderTargetView> renderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		UINT numRenderTargets = 0;
+		ComPtr<ID3D12DepthStencilView> depthStencil;
+		ComPtr<ID3D12DepthStencilState> depthStencilState;
+		UINT stencilRef = 0;
+		ComPtr<ID3D12RasterizerState> rasterizerState;
+		D3D12_VIEWPORT viewports[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+		UINT numViewports = 0;
+
+		// constant buffers may also be bound with an offset through the *SetConstantBuffers1 variants,
+		// which we don't hook, so they are read from the context when an override begins
+		ComPtr<ID3D12Resource> vsConstantBuffer;
+		ComPtr<ID3D12Resource> psConstantBuffer;
+		ComPtr<ID3D12Resource> csConstantBuffers[CS_CONSTANT_BUFFER_SLOTS];
+
+		uint64_t contextCalls = 0;
+		uint64_t fullContextCalls = 0;
+		int frameCount = 0;
+
+		void Sync();
+	};
+
+	// Overrides parts of the pipeline state for the lifetime of the scope and puts the game's
+	// bindings back afterwards. Falls back to saving and restoring the full state if the groups
+	// aren't tracked.
+	class D3D12StateOverride {
+	public:
+		D3D12StateOverride(D3D12StateTracker *tracker, ID3D12DeviceContext *context, uint32_t groups);
+		~D3D12StateOverride();
+
+	private:
+		D3D12StateTracker *tracker;
+		ID3D12DeviceContext *context;
+		std::unique_ptr<D3D12State> fullState;
+	};
+}
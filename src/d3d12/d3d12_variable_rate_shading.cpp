@@ -1,63 +1,22 @@
 #include "d3d12_variable_rate_shading.h"
 #include "config.h"
 #include "logging.h"
+#include "trace_recorder.h"
+#include "vrs_pattern.h"
 
 namespace vrperfkit {
-	uint8_t DistanceToVRSLevel(float distance) {
-		if (distance < g_config.ffr.innerRadius) {
-			return 0;
+	namespace {
+		// while the radius is changed dynamically, patterns for radii rounded to this step are kept around
+		const float PATTERN_RADIUS_STEP = 0.005f;
+		const size_t PATTERN_CACHE_SIZE = 32;
+
+		VrsPatternRadii ConfiguredRadii(const FixedFoveatedConfig &ffr) {
+			VrsPatternRadii radii;
+			radii.inner = ffr.innerRadius;
+			radii.mid = ffr.midRadius;
+			radii.outer = ffr.outerRadius;
+			return radii;
 		}
-		if (distance < g_config.ffr.midRadius) {
-			return 1;
-		}
-		if (distance < g_config.ffr.outerRadius) {
-			return 2;
-		}
-		return 3;
-	}
-
-	bool ResolutionMatches(int actualSize, int targetSize) {
-		if (g_config.ffr.preciseResolution) {
-			return actualSize == targetSize;
-		}
-		return actualSize >= targetSize && actualSize <= targetSize + 2;
-	}
-
-	std::vector<uint8_t> CreateCombinedFixedFoveatedVRSPattern( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
-		std::vector<uint8_t> data (width * height);
-		int halfWidth = width / 2;
-
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < halfWidth; ++x) {
-				float fx = float(x) / halfWidth;
-				float fy = float(y) / height;
-				float distance = 2 * sqrtf((fx - leftProjX) * (fx - leftProjX) + (fy - leftProjY) * (fy - leftProjY));
-				data[y * width + x] = DistanceToVRSLevel(distance);
-			}
-			for (int x = halfWidth; x < width; ++x) {
-				float fx = float(x - halfWidth) / halfWidth;
-				float fy = float(y) / height;
-				float distance = 2 * sqrtf((fx - rightProjX) * (fx - rightProjX) + (fy - rightProjY) * (fy - rightProjY));
-				data[y * width + x] = DistanceToVRSLevel(distance);
-			}
-		}
-
-		return data;
-	}
-
-	std::vector<uint8_t> CreateSingleEyeFixedFoveatedVRSPattern( int width, int height, float projX, float projY ) {
-		std::vector<uint8_t> data (width * height);
-
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				float fx = float(x) / width;
-				float fy = float(y) / height;
-				float distance = 2 * sqrtf((fx - projX) * (fx - projX) + (fy - projY) * (fy - projY));
-				data[y * width + x] = DistanceToVRSLevel(distance);
-			}
-		}
-
-		return data;
 	}
 
 	D3D12VariableRateShading::D3D12VariableRateShading(ComPtr<ID3D12Device> device) {
@@ -87,18 +46,20 @@ namespace vrperfkit {
 
 		this->device = device;
 		device->GetImmediateContext(context.GetAddressOf());
+		if (g_config.ffr.dynamic && g_config.ffr.dynamicChangeRadius) {
+			for (int i = 0; i < 2; ++i) {
+				singleEyePattern[i].EnableCache(PATTERN_RADIUS_STEP, PATTERN_CACHE_SIZE);
+				arrayPattern[i].EnableCache(PATTERN_RADIUS_STEP, PATTERN_CACHE_SIZE);
+			}
+			combinedPattern.EnableCache(PATTERN_RADIUS_STEP, PATTERN_CACHE_SIZE);
+		}
 		active = true;
-		ignoreFirstTargetRenders = g_config.ffr.ignoreFirstTargetRenders;
-		ignoreLastTargetRenders = g_config.ffr.ignoreLastTargetRenders;
-		renderOnlyTarget = g_config.ffr.renderOnlyTarget;
 		LOG_INFO << "Successfully initialized NVAPI; Variable Rate Shading is available.";
 	}
 
 	void D3D12VariableRateShading::UpdateTargetInformation(int targetWidth, int targetHeight, TextureMode mode, float leftProjX, float leftProjY, float rightProjX, float rightProjY) {
 		if (nvapiLoaded) {
-			this->targetWidth = targetWidth;
-			this->targetHeight = targetHeight;
-			this->targetMode = mode;
+			classifier.SetEyeTarget(targetWidth, targetHeight, mode);
 			proj[0][0] = leftProjX;
 			proj[0][1] = leftProjY;
 			proj[1][0] = rightProjX;
@@ -106,39 +67,26 @@ namespace vrperfkit {
 		}
 	}
 
+	void D3D12VariableRateShading::OnConfigReloaded() {
+		// new radii are picked up through g_frameState, as with the dynamic controller
+		classifier.Configure(g_config.ffr);
+	}
+
 	void D3D12VariableRateShading::EndFrame() {
-		if (!g_config.ffr.fastMode && currentSingleEyeRT > 0) {
-			if (currentSingleEyeRT != singleEyeOrder.size()) {
-				LOG_DEBUG << "Found " << currentSingleEyeRT << " single eye render targets in current frame";
-				// guess left eye being rendered first, followed by right eye
-				singleEyeOrder.clear();
-				for (int i = 0; i < currentSingleEyeRT / 2; ++i) {
-					singleEyeOrder.push_back('L');
-				}
-				for (int i = 0; i < currentSingleEyeRT / 2; ++i) {
-					singleEyeOrder.push_back('R');
-				}
-				for (int i = singleEyeOrder.size(); i < currentSingleEyeRT; ++i) {
-					singleEyeOrder.push_back('S');
-				}
-				LOG_DEBUG << "Guessing order of render targets as " << singleEyeOrder;
-				if (!g_config.ffr.overrideSingleEyeOrder.empty()) {
-					if (g_config.ffr.overrideSingleEyeOrder.size() == singleEyeOrder.size()) {
-						singleEyeOrder = g_config.ffr.overrideSingleEyeOrder;
-						LOG_DEBUG << "Overriding order with " << singleEyeOrder;
-					}
-					else {
-						LOG_DEBUG << "Not using configured override since it does not match number of render targets: " << g_config.ffr.overrideSingleEyeOrder;
-					}
-				}
+		g_trace.Record(TraceEventType::FRAME_END);
+
+		if (classifier.EndFrame(config.Get())) {
+			LOG_DEBUG << "Found " << classifier.SingleEyeTargetCount() << " single eye render targets in current frame";
+			LOG_DEBUG << "Using order of render targets " << classifier.SingleEyeOrder();
+			if (!config->ffr.overrideSingleEyeOrder.empty() && config->ffr.overrideSingleEyeOrder != classifier.SingleEyeOrder()) {
+				LOG_DEBUG << "Not using configured override since it does not match number of render targets: " << config->ffr.overrideSingleEyeOrder;
 			}
-			currentSingleEyeRT = 0;
 		}
 	}
 
 	void D3D12VariableRateShading::PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView * const *renderTargetViews,
 			ID3D12DepthStencilView *depthStencilView) {
-		if (!active || numViews == 0 || renderTargetViews == nullptr || renderTargetViews[0] == nullptr || !g_config.ffr.apply || !g_config.ffrApplyFastMode) {
+		if (!active || numViews == 0 || renderTargetViews == nullptr || renderTargetViews[0] == nullptr) {
 			DisableVRS();
 			return;
 		}
@@ -156,81 +104,26 @@ namespace vrperfkit {
 		D3D12_TEXTURE2D_DESC td;
 		tex->GetDesc( &td );
 
-		if (td.Width == td.Height) {
-			// probably a shadow map or similar extra resources
-			DisableVRS();
-			return;
-		}
-
-		if (!g_config.ffrFastModeUsesHRMCount) {
-			++g_config.ffrRenderTargetCount;
-
-			if ((renderOnlyTarget > 0 && renderOnlyTarget != g_config.ffrRenderTargetCount) || (renderOnlyTarget < 0 && g_config.ffrRenderTargetCountMax + 1 + renderOnlyTarget != g_config.ffrRenderTargetCount)) {
-				DisableVRS();
-				return;
-			}
-
-			if (g_config.ffrRenderTargetCount < ignoreFirstTargetRenders || (ignoreLastTargetRenders > 0 && g_config.ffrRenderTargetCount > g_config.ffrRenderTargetCountMax - ignoreLastTargetRenders)) {
-				DisableVRS();
-				return;
-			}
-		}
-
-		if (g_config.ffr.fastMode) {
-			if (ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-				if (g_config.gameMode == GameMode::RIGHT_EYE_FIRST) {
-					if (g_config.renderingSecondEye) {
-						ApplySingleEyeVRS(0, td.Width, td.Height);	// Left eye
-					} else {
-						ApplySingleEyeVRS(1, td.Width, td.Height);	// RIght eye
-					}
-				} else {
-					if (g_config.renderingSecondEye) {
-						ApplySingleEyeVRS(1, td.Width, td.Height);	// Right eye
-					} else {
-						ApplySingleEyeVRS(0, td.Width, td.Height);	// Left eye
-					}
-				}
-			} else {
-				DisableVRS();
-				return;
-			}
-
-		} else if (targetMode == TextureMode::SINGLE && ResolutionMatches(td.Width, 2 * targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-			ApplyCombinedVRS(td.Width, td.Height);
-
-		} else if (targetMode == TextureMode::COMBINED && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
+		switch (classifier.Classify(config.Get(), td.Width, td.Height, td.ArraySize)) {
+		case VrsTarget::LEFT_EYE:
+			ApplySingleEyeVRS(0, td.Width, td.Height);
+			break;
+		case VrsTarget::RIGHT_EYE:
+			ApplySingleEyeVRS(1, td.Width, td.Height);
+			break;
+		case VrsTarget::COMBINED:
 			ApplyCombinedVRS(td.Width, td.Height);
-
-		} else if (targetMode != TextureMode::COMBINED && td.ArraySize == 2 && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
+			break;
+		case VrsTarget::ARRAY:
 			ApplyArrayVRS(td.Width, td.Height);
-
-		} else if (targetMode == TextureMode::SINGLE && td.ArraySize == 1 && ResolutionMatches(td.Width, targetWidth) && ResolutionMatches(td.Height, targetHeight)) {
-			if (currentSingleEyeRT < singleEyeOrder.size()) {
-				char eye = singleEyeOrder[currentSingleEyeRT];
-				switch (eye) {
-				case 'L':
-				case 'l':
-					ApplySingleEyeVRS(0, td.Width, td.Height);
-					break;
-				case 'R':
-				case 'r':
-					ApplySingleEyeVRS(1, td.Width, td.Height);
-					break;
-				default:
-					DisableVRS();
-					return;
-				}
-			} else {
-				LOG_DEBUG << "VRS: Single eye target, don't know which eye";
-				DisableVRS();
-				return;
-			}
-			++currentSingleEyeRT;
-
-		} else {
+			break;
+		case VrsTarget::UNKNOWN_EYE:
+			LOG_DEBUG << "VRS: Single eye target, don't know which eye";
 			DisableVRS();
-			return;
+			break;
+		default:
+			DisableVRS();
+			break;
 		}
 	}
 
@@ -239,7 +132,7 @@ namespace vrperfkit {
 			return;
 
 		SetupCombinedVRS(width, height, proj[0][0], proj[0][1], proj[1][0], proj[1][1] );
-		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), combinedVRSView.Get() );
+		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), combinedVRS.view.Get() );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rate resource view: " << status;
 			Shutdown();
@@ -254,7 +147,7 @@ namespace vrperfkit {
 			return;
 
 		SetupArrayVRS( width, height, proj[0][0], proj[0][1], proj[1][0], proj[1][1] );
-		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), arrayVRSView.Get() );
+		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), arrayVRS.view.Get() );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rate resource view: " << status;
 			Shutdown();
@@ -269,7 +162,7 @@ namespace vrperfkit {
 			return;
 
 		SetupSingleEyeVRS( eye, width, height, proj[eye][0], proj[eye][1] );
-		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), singleEyeVRSView[eye].Get() );
+		NvAPI_Status status = NvAPI_D3D12_RSSetShadingRateResourceView( context.Get(), singleEyeVRS[eye].view.Get() );
 		if (status != NVAPI_OK) {
 			LOG_ERROR << "Error while setting shading rate resource view: " << status;
 			Shutdown();
@@ -308,13 +201,10 @@ namespace vrperfkit {
 		nvapiLoaded = false;
 		active = false;
 		for (int i = 0; i < 2; ++i) {
-			singleEyeVRSTex[i].Reset();
-			singleEyeVRSView[i].Reset();
+			singleEyeVRS[i] = ShadingRateTexture();
 		}
-		combinedVRSTex.Reset();
-		combinedVRSView.Reset();
-		arrayVRSTex.Reset();
-		arrayVRSView.Reset();
+		combinedVRS = ShadingRateTexture();
+		arrayVRS = ShadingRateTexture();
 		device.Reset();
 		context.Reset();
 	}
@@ -325,7 +215,7 @@ namespace vrperfkit {
 			vsrd[i].enableVariablePixelShadingRate = true;
 			memset(vsrd[i].shadingRateTable, 5, sizeof(vsrd[i].shadingRateTable));
 			vsrd[i].shadingRateTable[0] = NV_PIXEL_X1_PER_RASTER_PIXEL;
-			vsrd[i].shadingRateTable[1] = g_config.ffr.favorHorizontal ? NV_PIXEL_X1_PER_2X1_RASTER_PIXELS : NV_PIXEL_X1_PER_1X2_RASTER_PIXELS;
+			vsrd[i].shadingRateTable[1] = config->ffr.favorHorizontal ? NV_PIXEL_X1_PER_2X1_RASTER_PIXELS : NV_PIXEL_X1_PER_1X2_RASTER_PIXELS;
 			vsrd[i].shadingRateTable[2] = NV_PIXEL_X1_PER_2X2_RASTER_PIXELS;
 			vsrd[i].shadingRateTable[3] = NV_PIXEL_X1_PER_4X4_RASTER_PIXELS;
 		}
@@ -347,57 +237,20 @@ namespace vrperfkit {
 
 		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
 		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
-		
-		if (!g_config.ffr.radiusChanged[eye] && singleEyeVRSTex[eye] && vrsWidth == singleWidth[eye] && vrsHeight == singleHeight[eye]) {
-			return;
-		}
-
-		g_config.ffr.radiusChanged[eye] = false;
-
-		singleEyeVRSTex[eye].Reset();
-		singleEyeVRSView[eye].Reset();
 
-		singleWidth[eye] = vrsWidth;
-		singleHeight[eye] = vrsHeight;
-
-		//LOG_INFO << "Creating VRS pattern texture for eye " << eye << " of size " << vrsWidth << "x" << vrsHeight;
-
-		D3D12_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 1;
-		td.Format = DXGI_FORMAT_R8_UINT;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D12_USAGE_DEFAULT;
-		td.BindFlags = D3D12_BIND_SHADER_RESOURCE;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags= 0;
-		td.MipLevels = 1;
-		auto data = CreateSingleEyeFixedFoveatedVRSPattern(vrsWidth, vrsHeight, projX, projY);
-		D3D12_SUBRESOURCE_DATA srd;
-		srd.pSysMem = data.data();
-		srd.SysMemPitch = vrsWidth;
-		srd.SysMemSlicePitch = 0;
-		HRESULT result = device->CreateTexture2D( &td, &srd, singleEyeVRSTex[eye].GetAddressOf() );
-		if (FAILED(result)) {
-			Shutdown();
-			LOG_ERROR << "Failed to create VRS pattern texture for eye " << eye << ": " << std::hex << result << std::dec;
+		bool created = false;
+		std::string name = "eye " + std::to_string(eye);
+		if (!PrepareShadingRateTexture(singleEyeVRS[eye], vrsWidth, vrsHeight, 1, name.c_str(), created)) {
 			return;
 		}
-
-		//LOG_INFO << "Creating shading rate resource view for eye " << eye;
-		NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
-		vd.version = NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
-		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
-		vd.Texture2D.MipSlice = 0;
-		NvAPI_Status status = NvAPI_D3D12_CreateShadingRateResourceView( device.Get(), singleEyeVRSTex[eye].Get(), &vd, singleEyeVRSView[eye].GetAddressOf() );
-		if (status != NVAPI_OK) {
-			Shutdown();
-			LOG_ERROR << "Failed to create VRS pattern view for eye " << eye << ": " << status;
+		if (!created && !g_frameState.ffrRadiusChanged[eye]) {
 			return;
 		}
+
+		g_frameState.ffrRadiusChanged[eye] = false;
+
+		const uint8_t *data = singleEyePattern[eye].SingleEye(vrsWidth, vrsHeight, projX, projY, ConfiguredRadii(config->ffr)).data();
+		UploadPattern(singleEyeVRS[eye], &data, 1);
 	}
 
 	void D3D12VariableRateShading::SetupCombinedVRS( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
@@ -411,56 +264,19 @@ namespace vrperfkit {
 		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
 		if (vrsHeight & 1)
 			++vrsHeight;
-		if (!g_config.ffr.radiusChanged[0] && combinedVRSTex && vrsWidth == combinedWidth && vrsHeight == combinedHeight) {
-			return;
-		}
-
-		g_config.ffr.radiusChanged[0] = false;
-
-		combinedVRSTex.Reset();
-		combinedVRSView.Reset();
-
-		combinedWidth = vrsWidth;
-		combinedHeight = vrsHeight;
 
-		//LOG_INFO << "Creating combined VRS pattern texture of size " << vrsWidth << "x" << vrsHeight << " for input texture size " << width << "x" << height;
-
-		D3D12_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 1;
-		td.Format = DXGI_FORMAT_R8_UINT;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D12_USAGE_DEFAULT;
-		td.BindFlags = D3D12_BIND_SHADER_RESOURCE;
-		td.CPUAccessFlags = 0;
-		td.MiscFlags= 0;
-		td.MipLevels = 1;
-		auto data = CreateCombinedFixedFoveatedVRSPattern(vrsWidth, vrsHeight, leftProjX, leftProjY, rightProjX, rightProjY);
-		D3D12_SUBRESOURCE_DATA srd;
-		srd.pSysMem = data.data();
-		srd.SysMemPitch = vrsWidth;
-		srd.SysMemSlicePitch = 0;
-		HRESULT result = device->CreateTexture2D( &td, &srd, combinedVRSTex.GetAddressOf() );
-		if (FAILED(result)) {
-			Shutdown();
-			LOG_ERROR << "Failed to create combined VRS pattern texture: " << std::hex << result << std::dec;
+		bool created = false;
+		if (!PrepareShadingRateTexture(combinedVRS, vrsWidth, vrsHeight, 1, "combined", created)) {
 			return;
 		}
-
-		//LOG_INFO << "Creating combined shading rate resource view";
-		NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
-		vd.version = NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
-		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
-		vd.Texture2D.MipSlice = 0;
-		NvAPI_Status status = NvAPI_D3D12_CreateShadingRateResourceView( device.Get(), combinedVRSTex.Get(), &vd, combinedVRSView.GetAddressOf() );
-		if (status != NVAPI_OK) {
-			Shutdown();
-			LOG_ERROR << "Failed to create combined VRS pattern view: " << status;
+		if (!created && !g_frameState.ffrRadiusChanged[0]) {
 			return;
 		}
+
+		g_frameState.ffrRadiusChanged[0] = false;
+
+		const uint8_t *data = combinedPattern.Combined(vrsWidth, vrsHeight, leftProjX, leftProjY, rightProjX, rightProjY, ConfiguredRadii(config->ffr)).data();
+		UploadPattern(combinedVRS, &data, 1);
 	}
 
 	void D3D12VariableRateShading::SetupArrayVRS( int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY ) {
@@ -470,24 +286,45 @@ namespace vrperfkit {
 
 		int vrsWidth = width / NV_VARIABLE_PIXEL_SHADING_TILE_WIDTH;
 		int vrsHeight = height / NV_VARIABLE_PIXEL_SHADING_TILE_HEIGHT;
-		if (!g_config.ffr.radiusChanged[0] && arrayVRSTex && vrsWidth == arrayWidth && vrsHeight == arrayHeight) {
+
+		bool created = false;
+		if (!PrepareShadingRateTexture(arrayVRS, vrsWidth, vrsHeight, 2, "array", created)) {
+			return;
+		}
+		if (!created && !g_frameState.ffrRadiusChanged[0]) {
 			return;
 		}
 
-		g_config.ffr.radiusChanged[0] = false;
+		g_frameState.ffrRadiusChanged[0] = false;
 
-		arrayVRSTex.Reset();
-		arrayVRSView.Reset();
+		// array rendering is most likely a new Unity engine game, which for some reason renders upside down.
+		// so we invert the y projection center coordinate to match the upside down render.
+		const uint8_t *data[2] = {
+			arrayPattern[0].SingleEye( vrsWidth, vrsHeight, leftProjX, 1.f - leftProjY, ConfiguredRadii(config->ffr) ).data(),
+			arrayPattern[1].SingleEye( vrsWidth, vrsHeight, rightProjX, 1.f - rightProjY, ConfiguredRadii(config->ffr) ).data(),
+		};
+		UploadPattern(arrayVRS, data, 2);
+	}
 
-		arrayWidth = vrsWidth;
-		arrayHeight = vrsHeight;
+	bool D3D12VariableRateShading::PrepareShadingRateTexture( ShadingRateTexture &vrs, int width, int height, UINT arraySize, const char *name, bool &created ) {
+		if (vrs.texture && vrs.width == width && vrs.height == height) {
+			return true;
+		}
+
+		vrs.texture.Reset();
+		vrs.view.Reset();
+		vrs.staging[0].Reset();
+		vrs.staging[1].Reset();
+		vrs.width = width;
+		vrs.height = height;
+		created = true;
 
-		//LOG_INFO << "Creating array VRS pattern texture of size " << vrsWidth << "x" << vrsHeight;
+		LOG_DEBUG << "Creating " << name << " VRS pattern texture of size " << width << "x" << height;
 
 		D3D12_TEXTURE2D_DESC td = {};
-		td.Width = vrsWidth;
-		td.Height = vrsHeight;
-		td.ArraySize = 2;
+		td.Width = width;
+		td.Height = height;
+		td.ArraySize = arraySize;
 		td.Format = DXGI_FORMAT_R8_UINT;
 		td.SampleDesc.Count = 1;
 		td.SampleDesc.Quality = 0;
@@ -496,34 +333,88 @@ namespace vrperfkit {
 		td.CPUAccessFlags = 0;
 		td.MiscFlags= 0;
 		td.MipLevels = 1;
-		HRESULT result = device->CreateTexture2D( &td, nullptr, arrayVRSTex.GetAddressOf() );
+		HRESULT result = device->CreateTexture2D( &td, nullptr, vrs.texture.GetAddressOf() );
 		if (FAILED(result)) {
 			Shutdown();
-			LOG_ERROR << "Failed to create array VRS pattern texture: " << std::hex << result << std::dec;
-			return;
+			LOG_ERROR << "Failed to create " << name << " VRS pattern texture: " << std::hex << result << std::dec;
+			return false;
 		}
 
-		// array rendering is most likely a new Unity engine game, which for some reason renders upside down.
-		// so we invert the y projection center coordinate to match the upside down render.
-		auto data = CreateSingleEyeFixedFoveatedVRSPattern( vrsWidth, vrsHeight, leftProjX, 1.f - leftProjY );
-		context->UpdateSubresource( arrayVRSTex.Get(), D3D12CalcSubresource( 0, 0, 1 ), nullptr, data.data(), vrsWidth, 0 );
-		data = CreateSingleEyeFixedFoveatedVRSPattern( vrsWidth, vrsHeight, rightProjX, 1.f - rightProjY );
-		context->UpdateSubresource( arrayVRSTex.Get(), D3D12CalcSubresource( 0, 1, 1 ), nullptr, data.data(), vrsWidth, 0 );
+		td.Usage = D3D12_USAGE_STAGING;
+		td.BindFlags = 0;
+		td.CPUAccessFlags = D3D12_CPU_ACCESS_WRITE;
+		for (int i = 0; i < 2; ++i) {
+			result = device->CreateTexture2D( &td, nullptr, vrs.staging[i].GetAddressOf() );
+			if (FAILED(result)) {
+				Shutdown();
+				LOG_ERROR << "Failed to create " << name << " VRS staging texture: " << std::hex << result << std::dec;
+				return false;
+			}
+		}
+		vrs.nextStaging = 0;
 
-		//LOG_INFO << "Creating array shading rate resource view";
 		NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC vd = {};
 		vd.version = NV_D3D12_SHADING_RATE_RESOURCE_VIEW_DESC_VER;
 		vd.Format = td.Format;
-		vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2DARRAY;
-		vd.Texture2DArray.MipSlice = 0;
-		vd.Texture2DArray.ArraySize = 2;
-		vd.Texture2DArray.FirstArraySlice = 0;
-		NvAPI_Status status = NvAPI_D3D12_CreateShadingRateResourceView( device.Get(), arrayVRSTex.Get(), &vd, arrayVRSView.GetAddressOf() );
+		if (arraySize > 1) {
+			vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2DARRAY;
+			vd.Texture2DArray.MipSlice = 0;
+			vd.Texture2DArray.ArraySize = arraySize;
+			vd.Texture2DArray.FirstArraySlice = 0;
+		}
+		else {
+			vd.ViewDimension = NV_SRRV_DIMENSION_TEXTURE2D;
+			vd.Texture2D.MipSlice = 0;
+		}
+		NvAPI_Status status = NvAPI_D3D12_CreateShadingRateResourceView( device.Get(), vrs.texture.Get(), &vd, vrs.view.GetAddressOf() );
 		if (status != NVAPI_OK) {
 			Shutdown();
-			LOG_ERROR << "Failed to create array VRS pattern view: " << status;
-			return;
+			LOG_ERROR << "Failed to create " << name << " VRS pattern view: " << status;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool D3D12VariableRateShading::UploadPattern( ShadingRateTexture &vrs, const uint8_t * const *slices, UINT arraySize ) {
+		// use whichever staging texture the GPU is done with; if it is still busy with both,
+		// fall back to letting the driver manage the upload
+		for (int attempt = 0; attempt < 2; ++attempt) {
+			ID3D12Resource *staging = vrs.staging[vrs.nextStaging].Get();
+			vrs.nextStaging = 1 - vrs.nextStaging;
+
+			D3D12_MAPPED_SUBRESOURCE mapped{nullptr, 0, 0};
+			HRESULT result = context->Map( staging, D3D12CalcSubresource( 0, 0, 1 ), D3D12_MAP_WRITE, D3D12_MAP_FLAG_DO_NOT_WAIT, &mapped );
+			if (result == DXGI_ERROR_WAS_STILL_DRAWING) {
+				continue;
+			}
+			if (FAILED(result)) {
+				LOG_ERROR << "Failed to map VRS staging texture: " << std::hex << result << std::dec;
+				break;
+			}
+
+			for (UINT slice = 0; slice < arraySize; ++slice) {
+				if (slice > 0) {
+					result = context->Map( staging, D3D12CalcSubresource( 0, slice, 1 ), D3D12_MAP_WRITE, 0, &mapped );
+					if (FAILED(result)) {
+						LOG_ERROR << "Failed to map VRS staging texture: " << std::hex << result << std::dec;
+						return false;
+					}
+				}
+				for (int y = 0; y < vrs.height; ++y) {
+					memcpy( (uint8_t*)mapped.pData + y * mapped.RowPitch, slices[slice] + y * vrs.width, vrs.width );
+				}
+				context->Unmap( staging, D3D12CalcSubresource( 0, slice, 1 ) );
+			}
+
+			context->CopyResource( vrs.texture.Get(), staging );
+			return true;
+		}
+
+		for (UINT slice = 0; slice < arraySize; ++slice) {
+			context->UpdateSubresource( vrs.texture.Get(), D3D12CalcSubresource( 0, slice, 1 ), nullptr, slices[slice], vrs.width, 0 );
 		}
+		return true;
 	}
 
 }
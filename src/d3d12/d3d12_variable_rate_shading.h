@@ -3,8 +3,11 @@
 #include "d3d12_injector.h"
 #include <d3d12.h>
 #include <wrl/client.h>
+#include "config.h"
 #include "nvapi.h"
+#include "render_heuristics.h"
 #include "types.h"
+#include "vrs_pattern.h"
 
 namespace vrperfkit {
 	using Microsoft::WRL::ComPtr;
@@ -16,6 +19,7 @@ namespace vrperfkit {
 
 		void UpdateTargetInformation(int targetWidth, int targetHeight, TextureMode mode, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
 		void EndFrame();
+		void OnConfigReloaded();
 
 		void PostOMSetRenderTargets(UINT numViews, ID3D12RenderTargetView * const *renderTargetViews, ID3D12DepthStencilView *depthStencilView) override;
 
@@ -23,31 +27,29 @@ namespace vrperfkit {
 		bool nvapiLoaded = false;
 		bool active = false;
 
-		int ignoreFirstTargetRenders = 0;
-		int ignoreLastTargetRenders = 0;
-		int renderOnlyTarget = 0;
-
-		int targetWidth = 1000000;
-		int targetHeight = 1000000;
-		TextureMode targetMode = TextureMode::SINGLE;
+		ConfigSnapshot config;
+		VrsTargetClassifier classifier;
 		float proj[2][2] = { 0, 0, 0, 0 };
 
 		ComPtr<ID3D12Device> device;
 		ComPtr<ID3D12DeviceContext> context;
-		int singleWidth[2] = { 0, 0 };
-		int singleHeight[2] = { 0, 0 };
-		ComPtr<ID3D12Resource> singleEyeVRSTex[2];
-		ComPtr<ID3D12NvShadingRateResourceView> singleEyeVRSView[2];
-		std::string singleEyeOrder;
-		int currentSingleEyeRT = 0;
-		int combinedWidth = 0;
-		int combinedHeight = 0;
-		ComPtr<ID3D12Resource> combinedVRSTex;
-		ComPtr<ID3D12NvShadingRateResourceView> combinedVRSView;
-		int arrayWidth = 0;
-		int arrayHeight = 0;
-		ComPtr<ID3D12Resource> arrayVRSTex;
-		ComPtr<ID3D12NvShadingRateResourceView> arrayVRSView;
+		// Shading rate textures are only created when their size changes. New patterns are written to one of
+		// two staging textures in turn and copied over on the GPU, so that the upload doesn't have to wait
+		// for the GPU to finish with the previous one.
+		struct ShadingRateTexture {
+			int width = 0;
+			int height = 0;
+			ComPtr<ID3D12Resource> texture;
+			ComPtr<ID3D12NvShadingRateResourceView> view;
+			ComPtr<ID3D12Resource> staging[2];
+			int nextStaging = 0;
+		};
+		ShadingRateTexture singleEyeVRS[2];
+		ShadingRateTexture combinedVRS;
+		ShadingRateTexture arrayVRS;
+		VrsPatternGenerator singleEyePattern[2];
+		VrsPatternGenerator combinedPattern;
+		VrsPatternGenerator arrayPattern[2];
 
 		void Shutdown();
 
@@ -61,5 +63,9 @@ namespace vrperfkit {
 		void SetupSingleEyeVRS(int eye, int width, int height, float projX, float projY);
 		void SetupCombinedVRS(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
 		void SetupArrayVRS(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY);
+
+		// returns whether the texture is ready to be used; sets created if it has to be filled from scratch
+		bool PrepareShadingRateTexture(ShadingRateTexture &vrs, int width, int height, UINT arraySize, const char *name, bool &created);
+		bool UploadPattern(ShadingRateTexture &vrs, const uint8_t * const *slices, UINT arraySize);
 	};
 }
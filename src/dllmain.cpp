@@ -1,4 +1,5 @@
 #include "config.h"
+#include "config_watcher.h"
 #include "logging.h"
 #include "win_header_sane.h"
 #include "hooks.h"
@@ -6,6 +7,8 @@
 #include "oculus/oculus_hooks.h"
 #include "oculus/oculus_manager.h"
 #include "openvr/openvr_hooks.h"
+#include "trace_recorder.h"
+#include "d3d12/d3d12_shader_cache.h"
 #include <mutex>
 
 namespace fs = std::filesystem;
@@ -26,6 +29,9 @@ namespace vrperfkit {
 }
 
 namespace {
+	// about 2 MB, which holds several hundred frames for most games
+	const uint32_t TRACE_CAPACITY = 65536;
+
 	std::mutex g_hookInstallMutex;
 
 	void InstallVrHooks() {
@@ -91,10 +97,22 @@ namespace {
 		LOG_INFO << "      OpenVR PerfKit v4        ";
 		LOG_INFO << "===============================\n";
 
-		vrperfkit::LoadConfig(vrperfkit::g_basePath / "OpenVRPerfKit.yml");
-		vrperfkit::LoadHotkeys(vrperfkit::g_basePath / "OpenVRPerfKit.yml");
-		vrperfkit::PrintCurrentConfig();
+		fs::path configPath = vrperfkit::g_basePath / "OpenVRPerfKit.yml";
+		vrperfkit::ConfigFile configFile;
+		if (!vrperfkit::ParseConfigFile(configPath, configFile)) {
+			LOG_ERROR << "Falling back to the default configuration";
+		}
+		vrperfkit::g_config = configFile.config;
+		vrperfkit::LoadHotkeys(configFile.hotkeys);
+		vrperfkit::PrintConfig(vrperfkit::g_config);
+		vrperfkit::PublishConfig();
 		vrperfkit::PrintHotkeys();
+		vrperfkit::StartHotkeyThread();
+		vrperfkit::StartConfigWatcher(configPath);
+		vrperfkit::g_shaderCache.SetManifestPath(vrperfkit::g_basePath / "OpenVRPerfKit.shaders");
+		if (vrperfkit::g_config.traceEvents) {
+			vrperfkit::g_trace.Open(vrperfkit::g_basePath / "OpenVRPerfKit.trace", TRACE_CAPACITY);
+		}
 
 		if (LoadLibraryA("dxgi_ori.dll")) {
 			LOG_INFO << "External DLL loaded: dxgi_ori.dll";
@@ -109,22 +127,28 @@ namespace {
 		InstallVrHooks();
 	}
 
-	void ShutdownVrPerfkit() {
+	// processExiting: the process is terminating rather than unloading us, and Windows has already
+	// killed all other threads
+	void ShutdownVrPerfkit(bool processExiting) {
 		LOG_INFO << "Shutting down\n";
+		vrperfkit::StopHotkeyThread(processExiting);
+		vrperfkit::StopConfigWatcher(processExiting);
 		vrperfkit::g_oculus.Shutdown();
+		vrperfkit::g_shaderCache.SaveManifest(processExiting);
 		vrperfkit::hooks::Shutdown();
-		vrperfkit::FlushLog();
+		vrperfkit::g_trace.Close();
+		vrperfkit::CloseLogFile(processExiting);
 	}
 }
 
-BOOL WINAPI DllMain(HMODULE module, DWORD reason, LPVOID) {
+BOOL WINAPI DllMain(HMODULE module, DWORD reason, LPVOID reserved) {
 	switch (reason) {
 	case DLL_PROCESS_ATTACH:
 		InitVrPerfkit(module);
 		break;
 
 	case DLL_PROCESS_DETACH:
-		ShutdownVrPerfkit();
+		ShutdownVrPerfkit(reserved != nullptr);
 		break;
 	}
 
@@ -0,0 +1,143 @@
+#include "dynamic_controller.h"
+
+#include <algorithm>
+
+namespace vrperfkit {
+	namespace {
+		// below this variance of the observed values the cost model can't estimate a slope
+		const float MIN_VALUE_VARIANCE = 1e-6f;
+		// slopes below this are treated as noise; the value doesn't measurably influence the frame time
+		const float MIN_COST_SLOPE = 1e-5f;
+		const float MAX_INTEGRAL = 1.f;
+	}
+
+	DynamicController::DynamicController(const DynamicControllerSettings &settings) : settings(settings) {
+		if (this->settings.marginFrameTime > this->settings.targetFrameTime) {
+			this->settings.marginFrameTime = this->settings.targetFrameTime;
+		}
+		this->settings.smoothing = std::clamp(this->settings.smoothing, 0.01f, 1.f);
+		this->settings.maxDecreaseStep = std::max(0.f, this->settings.maxDecreaseStep);
+		this->settings.maxIncreaseStep = std::max(0.f, this->settings.maxIncreaseStep);
+	}
+
+	FrameTimeBand DynamicController::Observe(float frameTime) {
+		if (!hasSamples) {
+			smoothedFrameTime = previousSmoothedFrameTime = frameTime;
+			hasSamples = true;
+		}
+		else {
+			previousSmoothedFrameTime = smoothedFrameTime;
+			smoothedFrameTime += settings.smoothing * (frameTime - smoothedFrameTime);
+		}
+
+		if (smoothedFrameTime > settings.targetFrameTime) {
+			return FrameTimeBand::ABOVE_TARGET;
+		}
+		if (smoothedFrameTime < settings.marginFrameTime) {
+			return FrameTimeBand::BELOW_MARGIN;
+		}
+		return FrameTimeBand::WITHIN_BAND;
+	}
+
+	float DynamicController::Update(float frameTime, float currentValue) {
+		Observe(frameTime);
+
+		float step = ComputeStep(currentValue);
+		step = std::clamp(step, -settings.maxDecreaseStep, settings.maxIncreaseStep);
+		return std::clamp(currentValue + step, settings.minValue, settings.maxValue);
+	}
+
+	void DynamicController::Reset() {
+		smoothedFrameTime = previousSmoothedFrameTime = 0;
+		hasSamples = false;
+	}
+
+	float DynamicController::Setpoint(float frameTime) const {
+		if (frameTime > settings.targetFrameTime) {
+			return settings.targetFrameTime;
+		}
+		if (frameTime < settings.marginFrameTime) {
+			return settings.marginFrameTime;
+		}
+		return 0;
+	}
+
+	PidController::PidController(const DynamicControllerSettings &settings, float kp, float ki, float kd)
+			: DynamicController(settings), kp(kp), ki(ki), kd(kd) {}
+
+	void PidController::Reset() {
+		DynamicController::Reset();
+		integral = 0;
+	}
+
+	float PidController::ComputeStep(float currentValue) {
+		float setpoint = Setpoint(smoothedFrameTime);
+		if (setpoint <= 0) {
+			// within the hysteresis band: hold the value and let the accumulated error fade out
+			integral *= 0.5f;
+			return 0;
+		}
+
+		// relative error, so that the gains don't depend on the target frame rate;
+		// positive means there is headroom and the value can be raised
+		float error = (setpoint - smoothedFrameTime) / setpoint;
+
+		// don't wind up the integral while the value is already pinned at the limit it is pushed against
+		bool saturated = (error < 0 && currentValue <= settings.minValue) || (error > 0 && currentValue >= settings.maxValue);
+		if (!saturated) {
+			integral = std::clamp(integral + error, -MAX_INTEGRAL, MAX_INTEGRAL);
+		}
+
+		// derivative on the measurement rather than the error avoids a kick when the setpoint switches
+		float derivative = -(smoothedFrameTime - previousSmoothedFrameTime) / setpoint;
+
+		return kp * error + ki * integral + kd * derivative;
+	}
+
+	PredictiveController::PredictiveController(const DynamicControllerSettings &settings, float forgetting)
+			: DynamicController(settings), forgetting(std::clamp(forgetting, 0.f, 1.f)) {}
+
+	void PredictiveController::Reset() {
+		DynamicController::Reset();
+		weight = sumValue = sumFrameTime = sumValueSq = sumValueFrameTime = 0;
+	}
+
+	float PredictiveController::ComputeStep(float currentValue) {
+		// currentValue is what the last sample was rendered with
+		weight = forgetting * weight + 1;
+		sumValue = forgetting * sumValue + currentValue;
+		sumFrameTime = forgetting * sumFrameTime + smoothedFrameTime;
+		sumValueSq = forgetting * sumValueSq + currentValue * currentValue;
+		sumValueFrameTime = forgetting * sumValueFrameTime + currentValue * smoothedFrameTime;
+
+		float predicted = smoothedFrameTime + (smoothedFrameTime - previousSmoothedFrameTime);
+		float setpoint = Setpoint(predicted);
+		if (setpoint <= 0) {
+			return 0;
+		}
+
+		float meanValue = sumValue / weight;
+		float meanFrameTime = sumFrameTime / weight;
+		float variance = sumValueSq / weight - meanValue * meanValue;
+		if (variance > MIN_VALUE_VARIANCE) {
+			float slope = (sumValueFrameTime / weight - meanValue * meanFrameTime) / variance;
+			if (slope > MIN_COST_SLOPE) {
+				return (setpoint - predicted) / slope;
+			}
+		}
+
+		// not enough variation in the observed values yet to trust the model; take a proportional step,
+		// which also creates the variation needed for the next fit
+		return 0.5f * (setpoint - predicted) / setpoint;
+	}
+
+	std::unique_ptr<DynamicController> CreateDynamicController(DynamicControllerType type, const DynamicControllerSettings &settings) {
+		switch (type) {
+		case DynamicControllerType::PREDICTIVE:
+			return std::make_unique<PredictiveController>(settings);
+		case DynamicControllerType::PID:
+		default:
+			return std::make_unique<PidController>(settings);
+		}
+	}
+}
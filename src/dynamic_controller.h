@@ -0,0 +1,95 @@
+#pragma once
+#include "types.h"
+
+#include <memory>
+
+namespace vrperfkit {
+	struct DynamicControllerSettings {
+		// frame times above target reduce the controlled value, frame times below margin restore it;
+		// anything in between is the hysteresis band in which the value is left alone
+		float targetFrameTime = 0.0167f;
+		float marginFrameTime = 0.0154f;
+		float minValue = 0.f;
+		float maxValue = 1.f;
+		// maximum change of the controlled value per update
+		float maxDecreaseStep = 0.01f;
+		float maxIncreaseStep = 0.03f;
+		// weight of a new frame time sample in the exponential moving average, 1 disables smoothing
+		float smoothing = 0.3f;
+	};
+
+	enum class FrameTimeBand {
+		ABOVE_TARGET,
+		WITHIN_BAND,
+		BELOW_MARGIN,
+	};
+
+	// Adjusts a quality value (e.g. a foveation radius) from measured frame times.
+	// Does not depend on any graphics API so that it can be driven by recorded frame time traces.
+	class DynamicController {
+	public:
+		explicit DynamicController(const DynamicControllerSettings &settings);
+		virtual ~DynamicController() = default;
+
+		// feeds a frame time sample (in seconds) and returns the band its smoothed value falls into
+		FrameTimeBand Observe(float frameTime);
+
+		// feeds a frame time sample and returns the new value to use in place of currentValue
+		float Update(float frameTime, float currentValue);
+
+		virtual void Reset();
+
+		float SmoothedFrameTime() const { return smoothedFrameTime; }
+		const DynamicControllerSettings &Settings() const { return settings; }
+
+	protected:
+		DynamicControllerSettings settings;
+		float smoothedFrameTime = 0;
+		float previousSmoothedFrameTime = 0;
+		bool hasSamples = false;
+
+		// returns the frame time the controller should steer towards, or 0 while within the hysteresis band
+		float Setpoint(float frameTime) const;
+
+		// returns the desired, unclamped change of the controlled value
+		virtual float ComputeStep(float currentValue) = 0;
+	};
+
+	// Incremental PID controller working on the frame time error relative to the setpoint.
+	class PidController : public DynamicController {
+	public:
+		explicit PidController(const DynamicControllerSettings &settings, float kp = 0.5f, float ki = 0.1f, float kd = 0.1f);
+
+		void Reset() override;
+
+	protected:
+		float ComputeStep(float currentValue) override;
+
+	private:
+		float kp, ki, kd;
+		float integral = 0;
+	};
+
+	// Fits a linear cost model frameTime = a + b * value from the observed samples and
+	// jumps directly to the value predicted to hit the setpoint, extrapolating the current trend.
+	class PredictiveController : public DynamicController {
+	public:
+		explicit PredictiveController(const DynamicControllerSettings &settings, float forgetting = 0.9f);
+
+		void Reset() override;
+
+	protected:
+		float ComputeStep(float currentValue) override;
+
+	private:
+		float forgetting;
+		// exponentially weighted sums for the least squares fit
+		float weight = 0;
+		float sumValue = 0;
+		float sumFrameTime = 0;
+		float sumValueSq = 0;
+		float sumValueFrameTime = 0;
+	};
+
+	std::unique_ptr<DynamicController> CreateDynamicController(DynamicControllerType type, const DynamicControllerSettings &settings);
+}
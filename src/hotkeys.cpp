@@ -1,8 +1,10 @@
 #include "hotkeys.h"
 #include "logging.h"
 
+#include <atomic>
 #include <functional>
-#include <yaml-cpp/yaml.h>
+#include <mutex>
+#include <sstream>
 
 #include "win_header_sane.h"
 
@@ -73,6 +75,10 @@ namespace {
 	std::vector<HotkeyDefinition> g_hotkeyDefinitions;
 
 	void InitDefinitions() {
+		// the render thread runs actions by index, so the list must not change once it exists
+		if (!g_hotkeyDefinitions.empty()) {
+			return;
+		}
 		g_hotkeyDefinitions = {
 			{"cycleUpscalingMethod", CycleUpscalingMethod},
 			{"increaseUpscalingRadius", IncreaseUpscalingRadius},
@@ -88,10 +94,51 @@ namespace {
 
 	struct HotkeyState {
 		std::vector<int> keys;
-		std::function<void()> action;
+		// index into g_hotkeyDefinitions
+		uint32_t definition = 0;
 		bool wasActive = false;
 	};
 	std::vector<HotkeyState> g_hotkeyStates;
+	// the input thread polls g_hotkeyStates while the config may be reloaded
+	std::mutex g_hotkeyMutex;
+
+	// Hands the triggered hotkeys from the input thread to the render thread without locking.
+	// Only the input thread pushes and only the render thread pops.
+	class HotkeyQueue {
+	public:
+		bool Push(uint32_t definition) {
+			uint32_t tail = this->tail.load(std::memory_order_relaxed);
+			if (tail - head.load(std::memory_order_acquire) == CAPACITY) {
+				return false;
+			}
+			definitions[tail % CAPACITY] = definition;
+			this->tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool Pop(uint32_t &definition) {
+			uint32_t head = this->head.load(std::memory_order_relaxed);
+			if (head == tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			definition = definitions[head % CAPACITY];
+			this->head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		static constexpr uint32_t CAPACITY = 64;
+		uint32_t definitions[CAPACITY] = {};
+		std::atomic<uint32_t> head = 0;
+		std::atomic<uint32_t> tail = 0;
+	};
+	HotkeyQueue g_triggeredHotkeys;
+
+	// fast enough to catch a quick tap, while keeping the thread's cost negligible
+	const DWORD HOTKEY_POLL_INTERVAL_MS = 20;
+	HANDLE g_hotkeyThread = nullptr;
+	// manual reset, tells the input thread to stop
+	HANDLE g_hotkeyStopEvent = nullptr;
 
 	std::unordered_map<std::string, int> g_virtualKeyMap = {
 		{ "backspace", VK_BACK },
@@ -163,44 +210,6 @@ namespace {
 	}
 
 	bool g_hotkeysEnabled = false;
-}
-
-namespace vrperfkit {
-
-	void LoadHotkeys(const std::filesystem::path &configPath) {
-		InitDefinitions();
-		g_hotkeyStates.clear();
-		g_hotkeysEnabled = false;
-
-		if (!exists(configPath)) {
-			LOG_ERROR << "Config file not found, hotkeys will be disabled";
-			return;
-		}
-
-		try {
-			std::ifstream cfgFile (configPath);
-			YAML::Node cfg = YAML::Load(cfgFile);
-
-			YAML::Node hotkeysCfg = cfg["hotkeys"];
-			g_hotkeysEnabled = hotkeysCfg["enabled"].as<bool>(g_hotkeysEnabled);
-			for (const auto &def : g_hotkeyDefinitions) {
-				auto &state = g_hotkeyStates.emplace_back();
-				state.action = def.action;
-				auto node = hotkeysCfg[def.name];
-				if (node.IsSequence()) {
-					for (auto key : node) {
-						state.keys.push_back(ToVirtualKey(key.as<std::string>("")));
-					}
-				}
-				else {
-					state.keys.push_back(ToVirtualKey(node.as<std::string>("")));
-				}
-			}
-		}
-		catch (const YAML::Exception &e) {
-			LOG_ERROR << "Failed to load configuration file: " << e.msg;
-		}
-	}
 
 	bool CheckKey(int key) {
 		// ignore the least significant bit as it encodes if the key was pressed since the last call
@@ -209,7 +218,8 @@ namespace vrperfkit {
 		return GetAsyncKeyState(key) & (~1);
 	}
 
-	void CheckHotkeys() {
+	void PollHotkeys() {
+		std::lock_guard lock (g_hotkeyMutex);
 		if (!g_hotkeysEnabled) {
 			return;
 		}
@@ -223,15 +233,98 @@ namespace vrperfkit {
 				isActive = isActive && CheckKey(key);
 			}
 
-			if (isActive && !state.wasActive) {
-				state.action();
+			// only trigger once per press, however long the keys are held
+			if (isActive && !state.wasActive && !g_triggeredHotkeys.Push(state.definition)) {
+				LOG_ERROR << "Too many hotkeys pressed, ignoring " << g_hotkeyDefinitions[state.definition].name;
 			}
 
 			state.wasActive = isActive;
 		}
 	}
 
+	// module is the reference to our DLL that StartHotkeyThread took for the thread. Releasing it
+	// with FreeLibraryAndExitThread keeps the DLL loaded until the thread has left its code for good.
+	DWORD WINAPI HotkeyThread(LPVOID module) {
+		while (WaitForSingleObject(g_hotkeyStopEvent, HOTKEY_POLL_INTERVAL_MS) == WAIT_TIMEOUT) {
+			PollHotkeys();
+		}
+		FreeLibraryAndExitThread((HMODULE)module, 0);
+	}
+}
+
+namespace vrperfkit {
+
+	void LoadHotkeys(const HotkeyBindings &bindings) {
+		std::lock_guard lock (g_hotkeyMutex);
+		InitDefinitions();
+		g_hotkeyStates.clear();
+		g_hotkeysEnabled = bindings.enabled;
+
+		for (uint32_t i = 0; i < g_hotkeyDefinitions.size(); ++i) {
+			auto &state = g_hotkeyStates.emplace_back();
+			state.definition = i;
+			// keys still held when the config is reloaded shouldn't trigger anything
+			state.wasActive = true;
+			auto it = bindings.keys.find(g_hotkeyDefinitions[i].name);
+			if (it != bindings.keys.end()) {
+				for (const std::string &key : it->second) {
+					state.keys.push_back(ToVirtualKey(key));
+				}
+			}
+		}
+	}
+
+	void StartHotkeyThread() {
+		if (g_hotkeyThread != nullptr) {
+			return;
+		}
+		HMODULE module;
+		if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)&HotkeyThread, &module)) {
+			LOG_ERROR << "Failed to reference our module for the hotkey thread: " << GetLastError();
+			return;
+		}
+		g_hotkeyStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (g_hotkeyStopEvent != nullptr) {
+			g_hotkeyThread = CreateThread(nullptr, 0, &HotkeyThread, module, 0, nullptr);
+		}
+		if (g_hotkeyThread == nullptr) {
+			LOG_ERROR << "Failed to start the hotkey thread: " << GetLastError();
+			if (g_hotkeyStopEvent != nullptr) {
+				CloseHandle(g_hotkeyStopEvent);
+				g_hotkeyStopEvent = nullptr;
+			}
+			FreeLibrary(module);
+		}
+	}
+
+	void StopHotkeyThread(bool processExiting) {
+		if (g_hotkeyThread == nullptr) {
+			return;
+		}
+		// Nothing to wait for, the thread's module reference keeps the DLL loaded for as long as it runs.
+		// When the process is exiting, Windows has already ended the thread and the event can go;
+		// otherwise the thread may still be waiting on it, so it stays open.
+		if (processExiting) {
+			CloseHandle(g_hotkeyStopEvent);
+			g_hotkeyStopEvent = nullptr;
+		}
+		else {
+			SetEvent(g_hotkeyStopEvent);
+		}
+		CloseHandle(g_hotkeyThread);
+		g_hotkeyThread = nullptr;
+	}
+
+	void ApplyHotkeys() {
+		uint32_t definition;
+		while (g_triggeredHotkeys.Pop(definition)) {
+			g_hotkeyDefinitions[definition].action();
+			MarkConfigChanged();
+		}
+	}
+
 	void PrintHotkeys() {
+		std::lock_guard lock (g_hotkeyMutex);
 		if (!g_hotkeysEnabled)
 			return;
 
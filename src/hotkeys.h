@@ -1,8 +1,15 @@
 #pragma once
-#include <filesystem>
+#include "config.h"
 
 namespace vrperfkit {
-	void LoadHotkeys(const std::filesystem::path &configPath);
-	void CheckHotkeys();
+	void LoadHotkeys(const HotkeyBindings &bindings);
+	// polls the keys on a thread of its own, so that the submit path doesn't spend syscalls on it;
+	// the thread holds a reference to our module, so the DLL stays loaded while it runs
+	void StartHotkeyThread();
+	// processExiting: see ShutdownVrPerfkit, the thread is already gone then
+	void StopHotkeyThread(bool processExiting);
+	// runs the actions of the hotkeys pressed since the last call, once per frame between frames
+	// so that the config doesn't change while a frame is being processed
+	void ApplyHotkeys();
 	void PrintHotkeys();
 }
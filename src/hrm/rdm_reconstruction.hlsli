@@ -0,0 +1,230 @@
+/**
+ * Adapted from Ogre: https://github.com/OGRECave/ogre-next under the MIT license
+ */
+
+// Reconstruction of an image rendered with the radial density mask, shared by the separate
+// reconstruction pass (reconstruction.compute.hlsl) and the upscalers that reconstruct their input
+// while reading it (RDM_RECONSTRUCT). The includer declares the constants below and defines
+// RDM_FETCH(texel) and RDM_SAMPLE(uv), which read the masked image.
+//   uint2 u_offset; float2 u_projectionCenter; float2 u_invClusterResolution;
+//   float2 u_invResolution; float3 u_radius; float edgeRadius;
+
+// FIXME: AMD/NVIDIA extensions?
+#define anyInvocationARB(value) (value)
+#define texelFetch(srcImage, iuv, lod) RDM_FETCH(iuv)
+#define textureLod(srcTex, uv, lod) RDM_SAMPLE(uv)
+
+/** Takes the pattern (low quality):
+		ab xx ef xx
+		cd xx gh xx
+		xx ij xx mn
+		xx kl xx op
+	And outputs:
+		ab ab ef ef
+		cd cd gh gh
+		ij ij mn mn
+		kl kl op op
+*/
+float4 reconstructHalfResLow( int2 dstUV, uint2 uFragCoordHalf )
+{
+	int2 offset;
+	if( (uFragCoordHalf.x & 0x01u) != (uFragCoordHalf.y & 0x01u) )
+		offset.x = (uFragCoordHalf.y & 0x01u) == 0 ? -2 : 2;
+	else
+		offset.x = 0;
+	offset.y = 0;
+
+	int2 uv = dstUV + offset;
+	float4 srcVal = texelFetch( u_srcTex, uv.xy, 0 );
+
+	return srcVal;
+}
+
+/* Uses Valve's Alex Vlachos Advanced VR Rendering Performance technique
+   (bilinear approximation) GDC 2016
+*/
+float4 reconstructHalfResHigh( int2 dstUV, uint2 uFragCoordHalf )
+{
+	if( (uFragCoordHalf.x & 0x01u) != (uFragCoordHalf.y & 0x01u) )
+	{
+		float2 offset0;
+		float2 offset1;
+		offset0.x = (dstUV.x & 0x01) == 0 ? -0.5f : 1.5f;
+		offset0.y =	(dstUV.y & 0x01) == 0 ? 0.75f : 0.25f;
+
+		offset1.x = (dstUV.x & 0x01) == 0 ? 0.75f : 0.25f;
+		offset1.y = (dstUV.y & 0x01) == 0 ? -0.5f : 1.5f;
+
+		float2 offset0N = offset0;
+		offset0N.x = (dstUV.x & 0x01) == 0 ? 2.5f : -1.5f;
+		float2 offset1N = offset1;
+		offset1N.y = (dstUV.y & 0x01) == 0 ? 2.5f : -1.5f;
+
+		float2 uv0 = ( float2( dstUV ) + offset0 ) * u_invResolution;
+		float4 srcVal0 = textureLod( u_srcTex, uv0.xy, 0 );
+		float2 uv1 = ( float2( dstUV ) + offset1 ) * u_invResolution;
+		float4 srcVal1 = textureLod( u_srcTex, uv1.xy, 0 );
+		float2 uv0N = ( float2( dstUV ) + offset0N ) * u_invResolution;
+		float4 srcVal0N = textureLod( u_srcTex, uv0N.xy, 0 );
+		float2 uv1N = ( float2( dstUV ) + offset1N ) * u_invResolution;
+		float4 srcVal1N = textureLod( u_srcTex, uv1N.xy, 0 );
+
+		float4 finalVal = srcVal0 * 0.375f + srcVal1 * 0.375f + srcVal0N * 0.125f + srcVal1N * 0.125f;
+		return finalVal;
+	}
+	else
+	{
+		float2 uv = float2( dstUV );
+		uv.x += (dstUV.x & 0x01) == 0 ? 0.75f : 0.25f;
+		uv.y += (dstUV.y & 0x01) == 0 ? 0.75f : 0.25f;
+		uv.xy *= u_invResolution;
+		float4 srcVal = textureLod( u_srcTex, uv.xy, 0 );
+
+		int2 uv0 = int2( uFragCoordHalf << 1u );
+		float4 srcTL = texelFetch( u_srcTex, uv0 + int2( -1, -1 ), 0 );
+		float4 srcTR = texelFetch( u_srcTex, uv0 + int2(  2, -1 ), 0 );
+		float4 srcBL = texelFetch( u_srcTex, uv0 + int2( -1,  2 ), 0 );
+		float4 srcBR = texelFetch( u_srcTex, uv0 + int2(  2,  2 ), 0 );
+
+		float weights[4] = { 0.28125f, 0.09375f, 0.09375f, 0.03125f };
+
+		int idx = (dstUV.x & 0x01) + ((dstUV.y & 0x01) << 1u);
+
+		float4 finalVal =	srcVal * 0.5f +
+							srcTL * weights[(idx + 0)] +
+							srcTR * weights[(idx + 1) & 0x03] +
+							srcBL * weights[(idx + 2) & 0x03] +
+							srcBR * weights[(idx + 3) & 0x03];
+
+		return finalVal;
+	}
+}
+
+/** Takes the pattern:
+		a b x x
+		c d x x
+		x x x x
+		x x x x
+	And outputs:
+		a b a b
+		c d c d
+		a b a b
+		c d c d
+*/
+float4 reconstructQuarterRes( int2 dstUV, uint2 uFragCoordHalf )
+{
+	int2 offset;
+	offset.x = (uFragCoordHalf.x & 0x01u) == 0 ? 0 : -2;
+	offset.y = (uFragCoordHalf.y & 0x01u) == 0 ? 0 : -2;
+
+	int2 uv = int2( int2( dstUV ) + offset );
+	float4 srcVal = texelFetch( u_srcTex, uv.xy, 0 );
+
+	return srcVal;
+}
+
+/** Same as reconstructQuarterRes, but a lot more samples to repeat:
+		a b x x x x x x
+		c d x x x x x x
+		x x x x x x x x
+		x x x x x x x x
+		x x x x x x x x
+		x x x x x x x x
+		x x x x x x x x
+		x x x x x x x x
+	And outputs:
+		a b a b a b a b
+		c d c d c d c d
+		a b a b a b a b
+		c d c d c d c d
+		a b a b a b a b
+		c d c d c d c d
+		a b a b a b a b
+		c d c d c d c d
+*/
+float4 reconstructSixteenthRes( int2 dstUV, uint2 uFragCoordHalf )
+{
+	int2 block = int2( uFragCoordHalf ) & 0x03;
+
+	int2 offset;
+	offset.x = block.x * -2;
+	offset.y = block.y * -2;
+
+	int2 uv = int2( int2( dstUV ) + offset );
+	float4 srcVal = texelFetch( u_srcTex, uv.xy, 0 );
+
+	return srcVal;
+}
+
+// the reconstructed value of a texel, in coordinates of the whole texture
+float4 RdmReconstruct( int2 currentUV )
+{
+	uint2 uFragCoordHalf = uint2(currentUV >> 1u);
+
+	//We must work in blocks so the reconstruction filter can work properly
+	float2 toCenter     = (uint2(currentUV) >> 3u) * u_invClusterResolution - u_projectionCenter;
+	float  distToCenter = 2 * length(toCenter);
+
+	//We know for a fact distToCenter is in blocks of 8x8
+	if( anyInvocationARB( distToCenter >= u_radius.x ) && anyInvocationARB( distToCenter <= edgeRadius ) )
+	{
+		if( anyInvocationARB( distToCenter < u_radius.y ) )
+		{
+			if( anyInvocationARB( distToCenter + 2 * u_invClusterResolution.x < u_radius.y ) )
+			{
+				return reconstructHalfResHigh( currentUV, uFragCoordHalf );
+			}
+			else
+			{
+				//Right next to the border with lower res rendering.
+				//We can't use anything else than low quality filter
+				return reconstructHalfResLow( currentUV, uFragCoordHalf );
+			}
+		}
+		else if( anyInvocationARB( distToCenter < u_radius.z ) )
+		{
+			return reconstructQuarterRes( currentUV, uFragCoordHalf );
+		}
+		else
+		{
+			return reconstructSixteenthRes( currentUV, uFragCoordHalf );
+		}
+	}
+	else
+	{
+		return texelFetch( u_srcTex, currentUV, 0 );
+	}
+}
+
+// bilinear filtering of the reconstructed image, in place of sampling the masked one
+float4 RdmSampleBilinear( float2 uv )
+{
+	float2 texel = uv / u_invResolution - 0.5f;
+	int2 maxTexel = int2( 1.f / u_invResolution + 0.5f ) - 1;
+	// the upscalers mostly read at texel centres
+	float2 nearest = round( texel );
+	if( all( abs( texel - nearest ) < 1.f / 256.f ) )
+		return RdmReconstruct( clamp( int2( nearest ), 0, maxTexel ) );
+
+	int2 base = int2( floor( texel ) );
+	float2 f = texel - float2( base );
+	int2 p0 = clamp( base, 0, maxTexel );
+	int2 p1 = clamp( base + 1, 0, maxTexel );
+	float4 top = lerp( RdmReconstruct( p0 ), RdmReconstruct( int2( p1.x, p0.y ) ), f.x );
+	float4 bottom = lerp( RdmReconstruct( int2( p0.x, p1.y ) ), RdmReconstruct( p1 ), f.x );
+	return lerp( top, bottom, f.y );
+}
+
+// the reconstructed 2x2 footprint of a Gather at uv, one channel per row in Gather order
+float4x4 RdmGather( float2 uv )
+{
+	int2 maxTexel = int2( 1.f / u_invResolution + 0.5f ) - 1;
+	int2 base = int2( floor( uv / u_invResolution - 0.5f ) );
+	int2 p0 = clamp( base, 0, maxTexel );
+	int2 p1 = clamp( base + 1, 0, maxTexel );
+	return transpose( float4x4(
+		RdmReconstruct( int2( p0.x, p1.y ) ),
+		RdmReconstruct( p1 ),
+		RdmReconstruct( int2( p1.x, p0.y ) ),
+		RdmReconstruct( p0 ) ) );
+}
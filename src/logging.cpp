@@ -1,41 +1,301 @@
 #include "logging.h"
 
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
 
 namespace {
-	std::mutex g_logMutex;
-}
+	const size_t MAX_MESSAGE_LENGTH = 480;
+	const uint32_t RING_SIZE = 256;
+	// messages logged while formatting another one, e.g. from a function called in the stream expression
+	const int MAX_NESTING = 4;
+	const auto WRITE_INTERVAL = std::chrono::milliseconds(10);
+	// logging threads include the render thread, so a full ring is only waited on very briefly
+	const auto FULL_RING_TIMEOUT = std::chrono::milliseconds(1);
+	const auto CLOSE_TIMEOUT = std::chrono::milliseconds(100);
 
-namespace vrperfkit {
+	struct LogRecord {
+		steady_clock::rep timestamp;
+		uint32_t length;
+		char text[MAX_MESSAGE_LENGTH];
+	};
+
+	// single producer (the owning thread), single consumer (whoever holds g_drainMutex)
+	struct LogRing {
+		LogRecord records[RING_SIZE];
+		std::atomic<uint32_t> head { 0 };
+		std::atomic<uint32_t> tail { 0 };
+		std::atomic<uint32_t> dropped { 0 };
+		std::atomic<bool> orphaned { false };
+		std::string threadId;
+	};
+
+	// formats into a fixed buffer, anything beyond its end is cut off
+	class FixedStreamBuf : public std::streambuf {
+	public:
+		void Reset(char *begin, char *end) {
+			setp(begin, end);
+		}
+
+		size_t Length() const {
+			return pptr() - pbase();
+		}
+	};
+
+	std::mutex g_registryMutex;
+	std::vector<std::shared_ptr<LogRing>> g_rings;
+
+	std::timed_mutex g_drainMutex;
 	std::ofstream g_logFile;
+	system_clock::time_point g_systemBase;
+	steady_clock::time_point g_steadyBase;
+	std::time_t g_lastFormattedTime = -1;
+	char g_timeBuf[16] = "";
+
+	std::atomic<bool> g_writerRunning { false };
+	std::atomic<bool> g_writerStop { false };
+	std::mutex g_wakeMutex;
+	std::condition_variable g_wakeWriter;
+
+	class ThreadLog {
+	public:
+		ThreadLog() : ring(std::make_shared<LogRing>()) {
+			std::ostringstream id;
+			id << std::this_thread::get_id();
+			ring->threadId = id.str();
+
+			std::lock_guard<std::mutex> lock(g_registryMutex);
+			g_rings.push_back(ring);
+		}
+
+		~ThreadLog() {
+			// the writer still drains what's left and then forgets about the ring
+			ring->orphaned = true;
+		}
+
+		std::ostream &Begin(const char *prefix) {
+			// messages nested deeper than the limit are formatted into a spare level and dropped on commit
+			Level &level = levels[std::min(depth, MAX_NESTING)];
+			++depth;
+
+			level.buffer.Reset(level.pending.text, level.pending.text + sizeof(level.pending.text));
+			std::ostream &stream = level.stream;
+			stream.clear();
+			stream.flags(std::ios::showbase | std::ios::dec | std::ios::skipws);
+			stream.precision(6);
+			stream << prefix;
+			level.pending.timestamp = steady_clock::now().time_since_epoch().count();
+			return stream;
+		}
+
+		void Commit() {
+			--depth;
+			if (depth >= MAX_NESTING) {
+				ring->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			LogRecord &message = levels[depth].pending;
+			message.length = (uint32_t)levels[depth].buffer.Length();
+
+			uint32_t head = ring->head.load(std::memory_order_relaxed);
+			if (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE && !WaitForSpace(head)) {
+				ring->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			LogRecord &record = ring->records[head % RING_SIZE];
+			record.timestamp = message.timestamp;
+			record.length = message.length;
+			std::memcpy(record.text, message.text, message.length);
+			ring->head.store(head + 1, std::memory_order_release);
+		}
+
+	private:
+		struct Level {
+			LogRecord pending;
+			FixedStreamBuf buffer;
+			std::ostream stream { &buffer };
+		};
+
+		std::shared_ptr<LogRing> ring;
+		Level levels[MAX_NESTING + 1];
+		int depth = 0;
 
+		bool WaitForSpace(uint32_t head) {
+			// only worth waiting if somebody is going to empty the ring
+			if (!g_writerRunning || g_writerStop) {
+				return false;
+			}
+			g_wakeWriter.notify_one();
+			auto deadline = steady_clock::now() + FULL_RING_TIMEOUT;
+			while (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+				if (steady_clock::now() > deadline) {
+					return false;
+				}
+				std::this_thread::yield();
+			}
+			return true;
+		}
+	};
+
+	ThreadLog &GetThreadLog() {
+		thread_local ThreadLog threadLog;
+		return threadLog;
+	}
+
+	const char *FormatTime(steady_clock::rep timestamp) {
+		auto time = g_systemBase + std::chrono::duration_cast<system_clock::duration>(steady_clock::duration(timestamp) - g_steadyBase.time_since_epoch());
+		std::time_t seconds = system_clock::to_time_t(time);
+		if (seconds != g_lastFormattedTime) {
+			tm localTime;
+			localtime_s(&localTime, &seconds);
+			std::strftime(g_timeBuf, sizeof(g_timeBuf), "%H:%M:%S", &localTime);
+			g_lastFormattedTime = seconds;
+		}
+		return g_timeBuf;
+	}
+
+	// must be called with g_drainMutex held, which makes the caller the rings' only consumer;
+	// during process exit the registry is read without its lock, which a killed thread may still own
+	void DrainRings(bool processExiting = false) {
+		struct Entry {
+			steady_clock::rep timestamp;
+			const LogRing *ring;
+			const LogRecord *record;
+		};
+		std::vector<Entry> entries;
+		std::vector<std::pair<LogRing*, uint32_t>> drained;
+
+		std::vector<std::shared_ptr<LogRing>> rings;
+		if (processExiting) {
+			rings = g_rings;
+		}
+		else {
+			std::lock_guard<std::mutex> lock(g_registryMutex);
+			rings = g_rings;
+		}
+
+		for (auto &ring : rings) {
+			uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+			uint32_t head = ring->head.load(std::memory_order_acquire);
+			for (uint32_t i = tail; i != head; ++i) {
+				const LogRecord &record = ring->records[i % RING_SIZE];
+				entries.push_back({ record.timestamp, ring.get(), &record });
+			}
+			drained.emplace_back(ring.get(), head);
+
+			uint32_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+			if (dropped > 0 && g_logFile.is_open()) {
+				g_logFile << "(!) " << dropped << " log messages of thread " << ring->threadId << " were dropped\n";
+			}
+		}
+
+		// keep the order in which messages were logged across threads
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.timestamp < b.timestamp; });
+		if (g_logFile.is_open()) {
+			for (const Entry &entry : entries) {
+				g_logFile << FormatTime(entry.timestamp) << " [" << entry.ring->threadId << "] ";
+				g_logFile.write(entry.record->text, entry.record->length);
+				g_logFile << '\n';
+			}
+			if (!entries.empty()) {
+				g_logFile << std::flush;
+			}
+		}
+
+		for (auto &d : drained) {
+			d.first->tail.store(d.second, std::memory_order_release);
+		}
+		if (processExiting) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(g_registryMutex);
+		g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [](const std::shared_ptr<LogRing> &ring) {
+			return ring->orphaned && ring->tail == ring->head;
+		}), g_rings.end());
+	}
+
+	void WriterThread() {
+		while (!g_writerStop) {
+			{
+				std::unique_lock<std::mutex> lock(g_wakeMutex);
+				g_wakeWriter.wait_for(lock, WRITE_INTERVAL);
+			}
+			std::lock_guard<std::timed_mutex> lock(g_drainMutex);
+			DrainRings();
+		}
+		// CloseLogFile waits for this before taking over the rings
+		g_writerRunning = false;
+	}
+}
+
+namespace vrperfkit {
 	void OpenLogFile(fs::path path) {
-		g_logFile.open(path, std::ios_base::trunc | std::ios_base::out);
-		g_logFile.setf(std::ios::showbase);
+		{
+			std::lock_guard<std::timed_mutex> lock(g_drainMutex);
+			g_logFile.open(path, std::ios_base::trunc | std::ios_base::out);
+			g_systemBase = system_clock::now();
+			g_steadyBase = steady_clock::now();
+		}
+
+		if (!g_writerRunning.exchange(true)) {
+			g_writerStop = false;
+			std::thread(WriterThread).detach();
+		}
 	}
 
 	void FlushLog() {
-		g_logFile << std::flush;
+		// if the lock is busy, the writer is draining right now and takes care of our messages
+		if (g_drainMutex.try_lock_for(std::chrono::milliseconds(100))) {
+			DrainRings();
+			g_drainMutex.unlock();
+		}
 	}
 
-	LogMessage::LogMessage(const std::string &prefix, bool flush) : flush(flush) {
-		char timeBuf[16];
-		std::time_t now = std::time(nullptr);
-		tm localTime;
-		localtime_s(&localTime, &now);
-		std::strftime(timeBuf, sizeof(timeBuf), "%H:%M:%S", &localTime);
+	void CloseLogFile(bool processExiting) {
+		g_writerStop = true;
+		g_wakeWriter.notify_one();
 
-		g_logMutex.lock();
-		g_logFile << timeBuf << " [" << std::this_thread::get_id() << "] " << prefix;
+		if (processExiting) {
+			// Windows has already terminated every other thread, possibly the writer while it held
+			// g_drainMutex, so we are the rings' only consumer and must not wait for the lock
+			DrainRings(true);
+			g_logFile.close();
+			return;
+		}
+
+		// the writer sees g_writerStop after its current batch and leaves the rings to us
+		auto deadline = steady_clock::now() + CLOSE_TIMEOUT;
+		while (g_writerRunning && steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		if (g_drainMutex.try_lock_for(CLOSE_TIMEOUT)) {
+			DrainRings();
+			g_logFile.close();
+			g_drainMutex.unlock();
+		}
 	}
 
+	LogMessage::LogMessage(const char *prefix, bool urgent) : stream(GetThreadLog().Begin(prefix)), urgent(urgent) {}
+
 	LogMessage::~LogMessage() {
-		g_logFile << "\n";
-		if (flush)
-			g_logFile << std::flush;
-		g_logMutex.unlock();
+		GetThreadLog().Commit();
+		if (urgent) {
+			g_wakeWriter.notify_one();
+		}
 	}
 }
@@ -1,31 +1,36 @@
 #pragma once
 #include <codecvt>
 #include <filesystem>
-#include <fstream>
+#include <ostream>
 #include "config.h"
 
-#define LOG_INFO vrperfkit::LogMessage("", true)
+#define LOG_INFO vrperfkit::LogMessage("")
 #define LOG_DEBUG if (vrperfkit::g_config.debugMode) vrperfkit::LogMessage("(DEBUG) ")
 #define LOG_ERROR vrperfkit::LogMessage("(!) ERROR: ", true)
 
 namespace vrperfkit {
-	extern std::ofstream g_logFile;
-
 	void OpenLogFile(std::filesystem::path path);
+	// writes out everything that was logged so far, from any thread
 	void FlushLog();
+	// processExiting: called while the process terminates, after Windows has killed all other threads
+	void CloseLogFile(bool processExiting);
 
+	// Messages are formatted into a fixed per-thread buffer and queued in a per-thread ring,
+	// which a background thread drains into the log file. Logging never takes a lock or
+	// allocates, except the first time a thread logs anything. A message may be logged while
+	// another one is being formatted on the same thread, up to a few levels deep.
 	class LogMessage {
 	public:
-		explicit LogMessage(const std::string &prefix = "", bool flush = false);
+		// urgent messages wake up the writer right away instead of waiting for its next batch
+		explicit LogMessage(const char *prefix = "", bool urgent = false);
 		~LogMessage();
 
 		template<typename T>
 		LogMessage& operator<<(const T &t) {
-			g_logFile << t;
+			stream << t;
 			return *this;
 		}
 
-		template<>
 		LogMessage& operator<<(const std::wstring &str) {
 			std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
 			return *this << conv.to_bytes(str);
@@ -44,6 +49,7 @@ namespace vrperfkit {
 		}
 
 	private:
-		bool flush;
+		std::ostream &stream;
+		bool urgent;
 	};
 }
@@ -1,4 +1,72 @@
 
+#ifndef NIS_STEREO
+#define NIS_STEREO 0
+#endif
+
+// compiled in all combinations, see add_compute_shader_permutations in cmake/ShaderPermutations.cmake
+#ifndef RADIUS_CUTOFF
+#define RADIUS_CUTOFF 1
+#endif
+#ifndef DEBUG_MODE
+#define DEBUG_MODE 0
+#endif
+#ifndef HALF_PRECISION
+#define HALF_PRECISION 0
+#endif
+#ifndef RDM_RECONSTRUCT
+#define RDM_RECONSTRUCT 0
+#endif
+#define NIS_USE_HALF_PRECISION HALF_PRECISION
+
+#if NIS_STEREO
+// Both eyes are processed in a single dispatch, with the eye index in SV_GroupID.z. Each eye has
+// its own set of constants, and the selected eye's constants are copied to the globals the NIS code
+// expects. The two reserved fields hold the array slices to read from and write to.
+#define NIS_CONSTANTS(X) \
+	X(float, kDetectRatio) X(float, kDetectThres) X(float, kMinContrastRatio) X(float, kRatioNorm) \
+	X(float, kContrastBoost) X(float, kEps) X(float, kSharpStartY) X(float, kSharpScaleY) \
+	X(float, kSharpStrengthMin) X(float, kSharpStrengthScale) X(float, kSharpLimitMin) X(float, kSharpLimitScale) \
+	X(float, kScaleX) X(float, kScaleY) X(float, kDstNormX) X(float, kDstNormY) \
+	X(float, kSrcNormX) X(float, kSrcNormY) \
+	X(uint, kInputViewportOriginX) X(uint, kInputViewportOriginY) X(uint, kInputViewportWidth) X(uint, kInputViewportHeight) \
+	X(uint, kOutputViewportOriginX) X(uint, kOutputViewportOriginY) X(uint, kOutputViewportWidth) X(uint, kOutputViewportHeight) \
+	X(float, reserved0) X(float, reserved1) \
+	X(uint2, projCentre) X(uint, squaredRadius) X(uint, debugMode)
+
+#define NIS_DECLARE_MEMBER(type, name) type name;
+#define NIS_DECLARE_GLOBAL(type, name) static type name;
+#define NIS_COPY_FROM_EYE(type, name) name = eyeConfig[eye].name;
+
+struct NISEyeConfig
+{
+	NIS_CONSTANTS(NIS_DECLARE_MEMBER)
+	float4 padding[8]; // NISConfig is aligned to 256 bytes
+};
+
+cbuffer cb : register(b0)
+{
+	NISEyeConfig eyeConfig[2];
+};
+
+NIS_CONSTANTS(NIS_DECLARE_GLOBAL)
+
+void NISSelectEye(uint eye)
+{
+	NIS_CONSTANTS(NIS_COPY_FROM_EYE)
+}
+
+#define kInputSlice ((uint)reserved0)
+#define kOutputSlice ((uint)reserved1)
+#define NVTEX_SAMPLE(x, sampler, pos) x.SampleLevel(sampler, float3(pos, kInputSlice), 0)
+#define NVTEX_SAMPLE_RED(x, sampler, pos) x.GatherRed(sampler, float3(pos, kInputSlice))
+#define NVTEX_SAMPLE_GREEN(x, sampler, pos) x.GatherGreen(sampler, float3(pos, kInputSlice))
+#define NVTEX_SAMPLE_BLUE(x, sampler, pos) x.GatherBlue(sampler, float3(pos, kInputSlice))
+#define NVTEX_STORE(x, pos, v) x[uint3(pos, kOutputSlice)] = v
+
+SamplerState samplerLinearClamp : register(s0);
+Texture2DArray in_texture       : register(t0);
+RWTexture2DArray<unorm float4> out_texture : register(u0);
+#else
 cbuffer cb : register(b0)
 {
 	float kDetectRatio;
@@ -46,18 +114,35 @@ SamplerState samplerLinearClamp : register(s0);
 Texture2D in_texture            : register(t0);
 RWTexture2D<unorm float4> out_texture : register(u0);
 
-
-void DirectCopy(uint2 blockIdx, uint threadIdx)
+#if RDM_RECONSTRUCT
+// The input was rendered with the radial density mask and is reconstructed on the fly as it is read,
+// straight into the group shared tiles, instead of in a separate pass over the whole texture.
+// Stereo dispatches are never used with RDM.
+cbuffer rdm : register(b1)
 {
-	const float4 mul = float4(1, 1, 1, 1);
-	const int dstBlockX = NIS_BLOCK_WIDTH * blockIdx.x;
-	const int dstBlockY = NIS_BLOCK_HEIGHT * blockIdx.y;
-	for (uint k = threadIdx; k < NIS_BLOCK_WIDTH * NIS_BLOCK_HEIGHT; k += NIS_THREAD_GROUP_SIZE)
-	{
-		const int2 pos = int2(k % NIS_BLOCK_WIDTH, k / NIS_BLOCK_WIDTH);
-		const int dstX = dstBlockX + pos.x + kOutputViewportOriginX;
-		const int dstY = dstBlockY + pos.y + kOutputViewportOriginY;
-		float3 c = in_texture.SampleLevel(samplerLinearClamp, float2(dstX * kDstNormX, dstY * kDstNormY), 0).rgb;
-		out_texture[uint2(dstX, dstY)] = float4(c, 1) * mul;
-	}
-}
+	uint2 u_offset;
+	float2 u_projectionCenter;
+	float2 u_invClusterResolution;
+	float2 u_invResolution;
+	float3 u_radius;
+	float edgeRadius;
+};
+
+#define RDM_FETCH(texel) in_texture.Load(int3(texel, 0))
+#define RDM_SAMPLE(uv) in_texture.SampleLevel(samplerLinearClamp, uv, 0)
+#include "../hrm/rdm_reconstruction.hlsli"
+// NIS reads at texel centres, where RdmSampleBilinear reconstructs a single texel, and each texel of
+// the luma tile is read once per thread group. Overriding NVTEX_SAMPLE skips all of NIS_Scaler.h's
+// texture macros, so the others are defined here too.
+#define NVTEX_SAMPLE(x, sampler, pos) RdmSampleBilinear(pos)
+#define NVTEX_SAMPLE_RED(x, sampler, pos) RdmGather(pos)[0]
+#define NVTEX_SAMPLE_GREEN(x, sampler, pos) RdmGather(pos)[1]
+#define NVTEX_SAMPLE_BLUE(x, sampler, pos) RdmGather(pos)[2]
+#define NVTEX_STORE(x, pos, v) x[pos] = v
+#endif
+#endif
+
+
+// blocks or copy tiles to process with RADIUS_CUTOFF, one per thread group, see tile_list.h
+StructuredBuffer<uint> tileList : register(t3);
+#include "../tile_list.h"
@@ -0,0 +1,37 @@
+// Copies the input to the output outside the upscaling radius, for the copy tiles in tileList.
+// Runs as a separate pass from the filter, so that it needs none of the filter's group shared
+// memory and every thread writes exactly one pixel.
+#include "NIS_Common.h"
+
+[numthreads(COPY_TILE_WIDTH, COPY_TILE_HEIGHT, 1)]
+void main(uint3 groupIdx : SV_GroupID, uint3 threadIdx : SV_GroupThreadID)
+{
+	uint tile = tileList[TileListIndex(groupIdx.x, groupIdx.y, tileList[0])];
+#if NIS_STEREO
+	NISSelectEye(TileEye(tile));
+#endif
+#if DEBUG_MODE
+	// tint the area outside the radius
+	const float4 mul = float4(0.8, 1, 0.8, 1);
+#else
+	const float4 mul = float4(1, 1, 1, 1);
+#endif
+	const uint x = TileX(tile) * COPY_TILE_WIDTH + threadIdx.x;
+	const uint y = TileY(tile) * COPY_TILE_HEIGHT + threadIdx.y;
+	// stay inside the viewport, the other eye may be written to concurrently right next to it
+	if (x >= kOutputViewportWidth || y >= kOutputViewportHeight)
+		return;
+	const uint dstX = x + kOutputViewportOriginX;
+	const uint dstY = y + kOutputViewportOriginY;
+#if NIS_STEREO
+	float3 c = NVTEX_SAMPLE(in_texture, samplerLinearClamp, float2(dstX * kDstNormX, dstY * kDstNormY)).rgb;
+	NVTEX_STORE(out_texture, uint2(dstX, dstY), float4(c, 1) * mul);
+#else
+#if RDM_RECONSTRUCT
+	float3 c = RdmSampleBilinear(float2(dstX * kDstNormX, dstY * kDstNormY)).rgb;
+#else
+	float3 c = in_texture.SampleLevel(samplerLinearClamp, float2(dstX * kDstNormX, dstY * kDstNormY), 0).rgb;
+#endif
+	out_texture[uint2(dstX, dstY)] = float4(c, 1) * mul;
+#endif
+}
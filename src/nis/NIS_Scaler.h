@@ -180,11 +180,13 @@
 #endif // NIS_USE_HALF_PRECISION
 #define NVSHARED groupshared
 #define NVTEX_LOAD(x, pos) x[pos]
+#ifndef NVTEX_SAMPLE // overridden for texture arrays
 #define NVTEX_SAMPLE(x, sampler, pos) x.SampleLevel(sampler, pos, 0)
 #define NVTEX_SAMPLE_RED(x, sampler, pos) x.GatherRed(sampler, pos)
 #define NVTEX_SAMPLE_GREEN(x, sampler, pos) x.GatherGreen(sampler, pos)
 #define NVTEX_SAMPLE_BLUE(x, sampler, pos) x.GatherBlue(sampler, pos)
 #define NVTEX_STORE(x, pos, v) x[pos] = v
+#endif
 #ifndef NIS_UNROLL
 #define NIS_UNROLL [unroll]
 #endif
@@ -713,7 +715,7 @@ void NVScaler(NVU2 blockIdx, NVU threadIdx)
     // discretized phase
     const NVI fx_int = NVI(fx * kPhaseCount);
 #if NIS_VIEWPORT_SUPPORT
-    if (NVU(srcX) > kInputViewportWidth || NVU(dstX) > kOutputViewportWidth)
+    if (NVU(srcX) > kInputViewportWidth || NVU(dstX) >= kOutputViewportWidth)
     {
         return;
     }
@@ -725,7 +727,7 @@ void NVScaler(NVU2 blockIdx, NVU threadIdx)
         // y coord inside the input image
         const NVF srcY = (0.5f + dstY) * kScaleY - 0.5f;
 #if NIS_VIEWPORT_SUPPORT
-        if (!(NVU(srcY) > kInputViewportHeight || NVU(dstY) > kOutputViewportHeight))
+        if (!(NVU(srcY) > kInputViewportHeight || NVU(dstY) >= kOutputViewportHeight))
 #endif
         {
             // nearest integer part
@@ -986,7 +988,7 @@ void NVSharpen(NVU2 blockIdx, NVU threadIdx)
 #if NIS_VIEWPORT_SUPPORT
         NVF2 coord = NVF2((dstX + kInputViewportOriginX + 0.5f) * kSrcNormX, (dstY + kInputViewportOriginY + 0.5f) * kSrcNormY);
         NVF2 dstCoord = NVF2(dstX + kOutputViewportOriginX, dstY + kOutputViewportOriginY);
-        if (!(NVU(dstX) > kOutputViewportWidth || NVU(dstY) > kOutputViewportHeight))
+        if (!(NVU(dstX) >= kOutputViewportWidth || NVU(dstY) >= kOutputViewportHeight))
 #else
         NVF2 coord = NVF2((dstX + 0.5f) * kSrcNormX, (dstY + 0.5f) * kSrcNormY);
         NVF2 dstCoord = NVF2(dstX, dstY);
@@ -36,12 +36,13 @@ Texture2D coef_usm              : register(t2);
 [numthreads(NIS_THREAD_GROUP_SIZE, 1, 1)]
 void main(uint3 blockIdx : SV_GroupID, uint3 threadIdx : SV_GroupThreadID)
 {
-	uint2 groupCentre = uint2((blockIdx.x * 32) + 16, (blockIdx.y * 24) + 12);
-	uint2 dc = projCentre.xy - groupCentre;
-	if (dot(dc, dc) <= squaredRadius) {
-		NVScaler(blockIdx.xy, threadIdx.x);
-	}
-	else {
-		DirectCopy(blockIdx.xy, threadIdx.x);
-	}
+#if RADIUS_CUTOFF
+	// only the blocks within the radius are dispatched, NIS_Copy.hlsl takes care of the rest
+	uint tile = tileList[TileListIndex(blockIdx.x, blockIdx.y, tileList[0])];
+	blockIdx = uint3(TileX(tile), TileY(tile), TileEye(tile));
+#endif
+#if NIS_STEREO
+	NISSelectEye(blockIdx.z);
+#endif
+	NVScaler(blockIdx.xy, threadIdx.x);
 }
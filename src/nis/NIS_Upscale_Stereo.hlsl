@@ -0,0 +1,3 @@
+// Processes both eyes in a single dispatch, see NIS_STEREO in NIS_Common.h
+#define NIS_STEREO 1
+#include "NIS_Upscale.hlsl"
@@ -1,5 +1,6 @@
 #include "oculus_manager.h"
 
+#include "config_watcher.h"
 #include "hotkeys.h"
 #include "logging.h"
 #include "resolution_scaling.h"
@@ -60,10 +61,34 @@ namespace vrperfkit {
 				return false;
 			}
 		}
+
+		bool SameFov(const ovrFovPort &a, const ovrFovPort &b) {
+			return a.LeftTan == b.LeftTan && a.RightTan == b.RightTan && a.DownTan == b.DownTan && a.UpTan == b.UpTan;
+		}
 	}
 
 	OculusManager g_oculus;
 
+	// what post processing needs of one texture of a submitted swapchain, fixed once the swapchains are set up
+	struct OculusInputRecord {
+		ID3D12Resource *texture = nullptr;
+		ID3D12ShaderResourceView *view = nullptr;
+		// set if the texture is multi-sampled and resolved for this eye
+		ID3D12Resource *resolveTexture = nullptr;
+		UINT resolveSubresource = 0;
+		UINT sourceSubresource = 0;
+		DXGI_FORMAT resolveFormat = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		TextureMode mode = TextureMode::SINGLE;
+	};
+
+	struct OculusOutputRecord {
+		ID3D12Resource *texture = nullptr;
+		ID3D12ShaderResourceView *view = nullptr;
+		ID3D12UnorderedAccessView *uav = nullptr;
+	};
+
 	struct OculusD3D12Resources {
 		std::unique_ptr<D3D12Injector> injector;
 		std::unique_ptr<D3D12VariableRateShading> variableRateShading;
@@ -78,6 +103,17 @@ namespace vrperfkit {
 		std::vector<ComPtr<ID3D12UnorderedAccessView>> outputUavs[2];
 		bool multisampled[2];
 		bool usingArrayTex;
+
+		// indexed by eye and swapchain index, the records point into the resources above
+		std::vector<OculusInputRecord> inputs[2];
+		std::vector<OculusOutputRecord> outputs[2];
+		// the output swapchains are only committed by us, so we can follow their current index ourselves
+		int outputIndex[2] = { 0, 0 };
+
+		bool projectionKnown = false;
+		ovrFovPort projectionFov[2];
+		bool projectionFlippedY = false;
+		ProjectionCenters projCenters;
 	};
 
 	void OculusManager::Init(ovrSession session, ovrTextureSwapChain leftEyeChain, ovrTextureSwapChain rightEyeChain) {
@@ -125,7 +161,12 @@ namespace vrperfkit {
 	}
 
 	void OculusManager::EnsureInit(ovrSession session, ovrTextureSwapChain leftEyeChain, ovrTextureSwapChain rightEyeChain) {
-		if (!initialized || session != this->session || leftEyeChain != submittedEyeChains[0] || rightEyeChain != submittedEyeChains[1]) {
+		// the output swapchains are set up along with everything else, so a new render scale recreates it all
+		bool outputsChanged = initialized && g_config.upscaling.enabled && g_config.upscaling.renderScale != outputRenderScale;
+		if (outputsChanged) {
+			LOG_INFO << "Render scale changed, recreating output swapchains";
+		}
+		if (!initialized || outputsChanged || session != this->session || leftEyeChain != submittedEyeChains[0] || rightEyeChain != submittedEyeChains[1]) {
 			Shutdown();
 			Init(session, leftEyeChain, rightEyeChain);
 		}
@@ -145,7 +186,12 @@ namespace vrperfkit {
 				PostProcessD3D12(eyeLayer);
 			}
 
-			CheckHotkeys();
+			ApplyHotkeys();
+			if (ApplyConfigReload() && d3d12Res != nullptr) {
+				d3d12Res->postProcessor->OnConfigReloaded(false);
+				d3d12Res->variableRateShading->OnConfigReloaded();
+			}
+			PublishConfig();
 		}
 		catch (const std::exception &e) {
 			LOG_ERROR << "Failed during post processing: " << e.what();
@@ -154,15 +200,31 @@ namespace vrperfkit {
 		}
 	}
 
-	ProjectionCenters OculusManager::CalculateProjectionCenter(const ovrFovPort *fov) {
-		ProjectionCenters projCenters;
+	const ProjectionCenters &OculusManager::UpdateProjectionCenters(const ovrFovPort *fov, bool flippedY) {
+		OculusD3D12Resources &res = *d3d12Res;
+		if (res.projectionKnown && res.projectionFlippedY == flippedY && SameFov(res.projectionFov[0], fov[0]) && SameFov(res.projectionFov[1], fov[1])) {
+			return res.projCenters;
+		}
+
+		ProjectionCenters &projCenters = res.projCenters;
 		for (int eye = 0; eye < 2; ++eye) {
 			projCenters.eyeCenter[eye].x = 0.5f * (1.f + (fov[eye].LeftTan - fov[eye].RightTan) / (fov[eye].RightTan + fov[eye].LeftTan));
 			projCenters.eyeCenter[eye].y = 0.5f * (1.f + (fov[eye].DownTan - fov[eye].UpTan) / (fov[eye].DownTan + fov[eye].UpTan));
+			res.projectionFov[eye] = fov[eye];
 		}
+		res.projectionFlippedY = flippedY;
+		res.projectionKnown = true;
+
+		res.postProcessor->SetProjCenters(projCenters.eyeCenter[0].x, projCenters.eyeCenter[0].y, projCenters.eyeCenter[1].x, projCenters.eyeCenter[1].y);
+
+		// all textures of the submitted swapchains share size and layout, so the targets only change along with the FOV
+		const OculusInputRecord &target = res.inputs[1][0];
+		float projLX = projCenters.eyeCenter[0].x;
+		float projLY = flippedY ? 1.f - projCenters.eyeCenter[0].y : projCenters.eyeCenter[0].y;
+		float projRX = projCenters.eyeCenter[1].x;
+		float projRY = flippedY ? 1.f - projCenters.eyeCenter[1].y : projCenters.eyeCenter[1].y;
+		res.variableRateShading->UpdateTargetInformation(target.width, target.height, target.mode, projLX, projLY, projRX, projRY);
 
-		d3d12Res->postProcessor.get()->SetProjCenters(projCenters.eyeCenter[0].x, projCenters.eyeCenter[0].y, projCenters.eyeCenter[1].x, projCenters.eyeCenter[1].y);
-		
 		return projCenters;
 	}
 
@@ -170,6 +232,7 @@ namespace vrperfkit {
 		LOG_INFO << "Game is using D3D12 swapchains, initializing D3D12 resources";
 		graphicsApi = GraphicsApi::D3D12;
 		d3d12Res.reset(new OculusD3D12Resources);
+		outputRenderScale = g_config.upscaling.renderScale;
 
 		for (int eye = 0; eye < 2; ++eye) {
 			d3d12Res->multisampled[eye] = false;
@@ -270,66 +333,103 @@ namespace vrperfkit {
 		d3d12Res->injector.reset(new D3D12Injector(d3d12Res->device));
 		d3d12Res->injector->AddListener(d3d12Res->postProcessor.get());
 		d3d12Res->injector->AddListener(d3d12Res->variableRateShading.get());
+		d3d12Res->postProcessor->SetStateTracker(d3d12Res->injector->GetStateTracker());
+
+		CreateD3D12Records();
 
 		LOG_INFO << "D3D12 resource creation complete";
 		initialized = true;
 	}
 
+	void OculusManager::CreateD3D12Records() {
+		TextureMode mode = TextureMode::SINGLE;
+		if (submittedEyeChains[1] == nullptr || submittedEyeChains[1] == submittedEyeChains[0]) {
+			mode = d3d12Res->usingArrayTex ? TextureMode::ARRAY : TextureMode::COMBINED;
+		}
+
+		for (int eye = 0; eye < 2; ++eye) {
+			bool resolve = d3d12Res->multisampled[eye] && (d3d12Res->usingArrayTex || submittedEyeChains[eye] != nullptr);
+			UINT slice = d3d12Res->usingArrayTex ? eye : 0;
+
+			for (size_t i = 0; i < d3d12Res->submittedTextures[eye].size(); ++i) {
+				OculusInputRecord record;
+				record.texture = d3d12Res->submittedTextures[eye][i].Get();
+				record.view = d3d12Res->submittedViews[eye][i].Get();
+				record.mode = mode;
+				D3D12_TEXTURE2D_DESC td;
+				record.texture->GetDesc(&td);
+				record.width = td.Width;
+				record.height = td.Height;
+				if (resolve) {
+					record.resolveTexture = d3d12Res->resolveTexture[eye].Get();
+					record.resolveSubresource = D3D12CalcSubresource(0, slice, 1);
+					record.sourceSubresource = D3D12CalcSubresource(0, slice, td.MipLevels);
+					record.resolveFormat = TranslateTypelessFormats(td.Format);
+				}
+				d3d12Res->inputs[eye].push_back(record);
+			}
+
+			for (size_t i = 0; i < d3d12Res->outputTextures[eye].size(); ++i) {
+				OculusOutputRecord record;
+				record.texture = d3d12Res->outputTextures[eye][i].Get();
+				record.view = d3d12Res->outputViews[eye][i].Get();
+				record.uav = d3d12Res->outputUavs[eye][i].Get();
+				d3d12Res->outputs[eye].push_back(record);
+			}
+		}
+	}
+
 	void OculusManager::PostProcessD3D12(ovrLayerEyeFovDepth &eyeLayer) {
-		auto projCenters = CalculateProjectionCenter(eyeLayer.Fov);
 		bool successfulPostprocessing = false;
 		bool isFlippedY = eyeLayer.Header.Flags & ovrLayerFlag_TextureOriginAtBottomLeft;
+		const ProjectionCenters &projCenters = UpdateProjectionCenters(eyeLayer.Fov, isFlippedY);
 
+		const OculusInputRecord *inputs[2];
+		int index = 0;
 		for (int eye = 0; eye < 2; ++eye) {
-			int index;
-			ovrTextureSwapChain curSwapChain = submittedEyeChains[eye] != nullptr ? submittedEyeChains[eye] : submittedEyeChains[0];
-			Check("getting current swapchain index", ovr_GetTextureSwapChainCurrentIndex(session, curSwapChain, &index));
-			// since the current submitted texture has already been committed, the index will point past the current texture
-			index = (index - 1 + d3d12Res->submittedTextures[eye].size()) % d3d12Res->submittedTextures[eye].size();
-
-			// if the incoming texture is multi-sampled, we need to resolve it before we can post-process it
-			if (d3d12Res->multisampled[eye]) {
-				if (d3d12Res->usingArrayTex || submittedEyeChains[eye] != nullptr) {
-					D3D12_TEXTURE2D_DESC td;
-					d3d12Res->submittedTextures[eye][index]->GetDesc(&td);
-					d3d12Res->context->ResolveSubresource(
-						d3d12Res->resolveTexture[eye].Get(),
-						D3D12CalcSubresource(0, d3d12Res->usingArrayTex ? eye : 0, 1),
-						d3d12Res->submittedTextures[eye][index].Get(),
-						D3D12CalcSubresource(0, d3d12Res->usingArrayTex ? eye : 0, td.MipLevels),
-						TranslateTypelessFormats(td.Format));
-				}
+			// the game commits its own swapchains, so their index has to be queried, but only once if both eyes share one
+			if (eye == 0 || (submittedEyeChains[1] != nullptr && submittedEyeChains[1] != submittedEyeChains[0])) {
+				Check("getting current swapchain index", ovr_GetTextureSwapChainCurrentIndex(session, submittedEyeChains[eye], &index));
+				// since the current submitted texture has already been committed, the index will point past the current texture
+				int length = (int)d3d12Res->inputs[eye].size();
+				index = (index - 1 + length) % length;
 			}
+			inputs[eye] = &d3d12Res->inputs[eye][index];
 
-			int outIndex = 0;
-			ovr_GetTextureSwapChainCurrentIndex(session, outputEyeChains[eye], &outIndex);
+			// if the incoming texture is multi-sampled, we need to resolve it before we can post-process it;
+			// done for both eyes up front, as the first eye may upscale the second one along with it
+			const OculusInputRecord &in = *inputs[eye];
+			if (in.resolveTexture != nullptr) {
+				d3d12Res->context->ResolveSubresource(in.resolveTexture, in.resolveSubresource, in.texture, in.sourceSubresource, in.resolveFormat);
+			}
+		}
+
+		for (int eye = 0; eye < 2; ++eye) {
+			const OculusInputRecord &in = *inputs[eye];
+			int outIndex = d3d12Res->outputIndex[eye];
+			const OculusOutputRecord &out = d3d12Res->outputs[eye][outIndex];
 
 			D3D12PostProcessInput input;
-			input.inputTexture = d3d12Res->submittedTextures[eye][index].Get();
-			input.inputView = d3d12Res->submittedViews[eye][index].Get();
-			input.outputTexture = d3d12Res->outputTextures[eye][outIndex].Get();
-			input.outputView = d3d12Res->outputViews[eye][outIndex].Get();
-			input.outputUav = d3d12Res->outputUavs[eye][outIndex].Get();
+			input.inputTexture = in.texture;
+			input.inputView = in.view;
+			input.outputTexture = out.texture;
+			input.outputView = out.view;
+			input.outputUav = out.uav;
+			input.outputSlot = outIndex;
 			input.inputViewport.x = eyeLayer.Viewport[eye].Pos.x;
 			input.inputViewport.y = eyeLayer.Viewport[eye].Pos.y;
 			input.inputViewport.width = eyeLayer.Viewport[eye].Size.w;
 			input.inputViewport.height = eyeLayer.Viewport[eye].Size.h;
 			input.eye = eye;
 			input.projectionCenter = projCenters.eyeCenter[eye];
+			input.otherEyeProjectionCenter = projCenters.eyeCenter[1 - eye];
 
 			if (isFlippedY) {
 				input.projectionCenter.y = 1.f - input.projectionCenter.y;
+				input.otherEyeProjectionCenter.y = 1.f - input.otherEyeProjectionCenter.y;
 			}
 
-			if (submittedEyeChains[1] == nullptr || submittedEyeChains[1] == submittedEyeChains[0]) {
-				if (d3d12Res->usingArrayTex) {
-					input.mode = TextureMode::ARRAY;
-				} else {
-					input.mode = TextureMode::COMBINED;
-				}
-			} else {
-				input.mode = TextureMode::SINGLE;
-			}
+			input.mode = in.mode;
 
 			Viewport outputViewport;
 			if (d3d12Res->postProcessor->Apply(input, outputViewport)) {
@@ -340,22 +440,19 @@ namespace vrperfkit {
 				eyeLayer.Viewport[eye].Size.h = outputViewport.height;
 				successfulPostprocessing = true;
 			}
-
-			D3D12_TEXTURE2D_DESC td;
-			input.inputTexture->GetDesc(&td);
-			float projLX = projCenters.eyeCenter[0].x;
-			float projLY = isFlippedY ? 1.f - projCenters.eyeCenter[0].y : projCenters.eyeCenter[0].y;
-			float projRX = projCenters.eyeCenter[1].x;
-			float projRY = isFlippedY ? 1.f - projCenters.eyeCenter[1].y : projCenters.eyeCenter[1].y;
-			d3d12Res->variableRateShading->UpdateTargetInformation(td.Width, td.Height, input.mode, projLX, projLY, projRX, projRY);
 		}
 
 		d3d12Res->variableRateShading->EndFrame();
 
 		if (successfulPostprocessing) {
-			ovr_CommitTextureSwapChain(session, outputEyeChains[0]);
-			if (outputEyeChains[1] != outputEyeChains[0]) {
-				ovr_CommitTextureSwapChain(session, outputEyeChains[1]);
+			for (int eye = 0; eye < 2; ++eye) {
+				if (eye == 1 && outputEyeChains[1] == outputEyeChains[0]) {
+					d3d12Res->outputIndex[1] = d3d12Res->outputIndex[0];
+					continue;
+				}
+				if (OVR_SUCCESS(ovr_CommitTextureSwapChain(session, outputEyeChains[eye]))) {
+					d3d12Res->outputIndex[eye] = (d3d12Res->outputIndex[eye] + 1) % (int)d3d12Res->outputs[eye].size();
+				}
 			}
 		}
 	}
@@ -22,11 +22,14 @@ namespace vrperfkit {
 		ovrSession session = nullptr;
 		ovrTextureSwapChain submittedEyeChains[2] = { nullptr, nullptr };
 		ovrTextureSwapChain outputEyeChains[2] = { nullptr, nullptr };
-
-		ProjectionCenters CalculateProjectionCenter(const ovrFovPort *fov);
+		// the render scale the output swapchains were created for
+		float outputRenderScale = 1.f;
 
 		std::unique_ptr<OculusD3D12Resources> d3d12Res;
 		void InitD3D12();
+		void CreateD3D12Records();
+		// only recalculated when the submitted FOV changes
+		const ProjectionCenters &UpdateProjectionCenters(const ovrFovPort *fov, bool flippedY);
 
 		void PostProcessD3D12(ovrLayerEyeFovDepth &eyeLayer);
 	};
@@ -1,5 +1,6 @@
 #include "openvr_manager.h"
 
+#include "config_watcher.h"
 #include "hotkeys.h"
 #include "logging.h"
 #include "openvr_hooks.h"
@@ -11,7 +12,7 @@
 
 #include "dxgi/dxgi_interfaces.h"
 
-#include <unordered_map>
+#include <vector>
 
 namespace vrperfkit {
 	OpenVrManager g_openVr;
@@ -54,6 +55,79 @@ namespace vrperfkit {
 		}
 	}
 
+	enum class OpenVrTextureKind {
+		D3D12,
+		DXVK,
+		D3D10,
+	};
+
+	// What we need to know about a submitted texture, filled in the first time it is submitted,
+	// so that the game cycling through its swapchain textures takes no calls into them per submit.
+	struct OpenVrTextureInfo {
+		// holding on to the texture keeps its address from being reused by another one while it is cached
+		ComPtr<ID3D12Resource> texture;
+		OpenVrTextureKind kind = OpenVrTextureKind::D3D12;
+		D3D12_TEXTURE2D_DESC desc;
+		// per eye, created on first use by the D3D12 resources
+		ComPtr<ID3D12ShaderResourceView> views[2];
+	};
+
+	// Looked up by texture address with a scan over all entries, so that every texture a game cycles through
+	// stays cached whatever their addresses; once all entries are taken, the least recently used one is refilled.
+	// Emptied on shutdown, which also drops the views along with the device they were created on.
+	struct OpenVrTextureCache {
+		static constexpr int SIZE = 16;
+		// kept apart from the entries, so that the scan only reads the keys and stamps, four cache lines
+		ID3D12Resource *keys[SIZE] = {};
+		// 0 for an empty entry
+		uint64_t lastUse[SIZE] = {};
+		OpenVrTextureInfo entries[SIZE];
+		uint64_t uses = 0;
+
+		OpenVrTextureInfo &Get(ID3D12Resource *texture) {
+			++uses;
+			int victim = 0;
+			for (int i = 0; i < SIZE; ++i) {
+				if (keys[i] == texture && lastUse[i] != 0) {
+					lastUse[i] = uses;
+					return entries[i];
+				}
+				if (lastUse[i] < lastUse[victim]) {
+					victim = i;
+				}
+			}
+
+			keys[victim] = texture;
+			lastUse[victim] = uses;
+			OpenVrTextureInfo &info = entries[victim];
+			info = OpenVrTextureInfo();
+			info.texture = texture;
+			texture->GetDesc(&info.desc);
+
+			// check if this texture is actually a Vulkan dxvk texture or a D3D10 texture in disguise
+			ComPtr<IDXGIVkInteropSurface> dxvkSurface;
+			ComPtr<ID3D12Device> device;
+			ComPtr<ID3D10Device> d3d10Device;
+			texture->GetDevice(device.GetAddressOf());
+			if (texture->QueryInterface(IID_PPV_ARGS(dxvkSurface.GetAddressOf())) == S_OK) {
+				info.kind = OpenVrTextureKind::DXVK;
+			}
+			else if (device->QueryInterface(d3d10Device.GetAddressOf()) == S_OK) {
+				info.kind = OpenVrTextureKind::D3D10;
+			}
+			return info;
+		}
+
+		void Clear() {
+			for (int i = 0; i < SIZE; ++i) {
+				keys[i] = nullptr;
+				lastUse[i] = 0;
+				entries[i] = OpenVrTextureInfo();
+			}
+			uses = 0;
+		}
+	};
+
 	struct OpenVrD3D12Resources {
 		std::unique_ptr<D3D12PostProcessor> postProcessor;
 		std::unique_ptr<D3D12VariableRateShading> variableRateShading;
@@ -62,20 +136,82 @@ namespace vrperfkit {
 		ComPtr<ID3D12DeviceContext> context;
 		ComPtr<ID3D12Resource> resolveTexture;
 		ComPtr<ID3D12ShaderResourceView> resolveView;
-		ComPtr<ID3D12Resource> outputTexture;
-		ComPtr<ID3D12ShaderResourceView> outputView;
-		ComPtr<ID3D12UnorderedAccessView> outputUav;
 		bool requiresResolve;
 		bool usingArrayTex;
-
-		struct EyeViews {
-			ComPtr<ID3D12ShaderResourceView> view[2];
+		DXGI_FORMAT outputFormat;
+		uint32_t outputWidth = 0;
+		uint32_t outputHeight = 0;
+
+		// Output textures are cycled through per frame, so that post-processing the next frame doesn't have
+		// to wait for the compositor to be done with the previous one. The query tells us when our writes
+		// to a slot have completed; by the time we come back around to it, the compositor has read it, too.
+		struct OutputSlot {
+			ComPtr<ID3D12Resource> texture;
+			ComPtr<ID3D12ShaderResourceView> view;
+			ComPtr<ID3D12UnorderedAccessView> uav;
+			ComPtr<ID3D12Query> written;
+			bool inFlight = false;
 		};
-		std::unordered_map<ID3D12Resource*, EyeViews> inputViews;
+		std::vector<OutputSlot> outputs;
+		int currentOutput = 0;
+		bool outputFrameOpen = false;
+		uint64_t outputFrames = 0;
+		uint64_t outputStalls = 0;
+
+		void CreateOutputs(uint32_t width, uint32_t height, DXGI_FORMAT format, int count) {
+			D3D12_QUERY_DESC qd;
+			qd.Query = D3D12_QUERY_EVENT;
+			qd.MiscFlags = 0;
+			outputs.clear();
+			outputs.resize(count);
+			for (OutputSlot &slot : outputs) {
+				slot.texture = CreatePostProcessTexture(device.Get(), width, height, format);
+				slot.view = CreateShaderResourceView(device.Get(), slot.texture.Get());
+				slot.uav = CreateUnorderedAccessView(device.Get(), slot.texture.Get());
+				CheckResult("creating output event query", device->CreateQuery(&qd, slot.written.GetAddressOf()));
+			}
+			outputWidth = width;
+			outputHeight = height;
+			currentOutput = count - 1;
+		}
+
+		// both eyes of a frame go to the same slot
+		int AcquireOutput() {
+			if (outputFrameOpen) {
+				return currentOutput;
+			}
+
+			currentOutput = (currentOutput + 1) % (int)outputs.size();
+			OutputSlot &slot = outputs[currentOutput];
+			if (slot.inFlight) {
+				BOOL done = FALSE;
+				if (context->GetData(slot.written.Get(), &done, sizeof(done), D3D12_ASYNC_GETDATA_DONOTFLUSH) != S_OK || !done) {
+					// nothing better to do than to write to it anyway and let the driver sort it out
+					++outputStalls;
+				}
+				slot.inFlight = false;
+			}
+			if (++outputFrames % 1000 == 0 && outputStalls > 0) {
+				LOG_DEBUG << "Output texture was still in use in " << outputStalls << " of the last 1000 frames";
+				outputStalls = 0;
+			}
+			outputFrameOpen = true;
+			return currentOutput;
+		}
+
+		void ReleaseOutput() {
+			if (!outputFrameOpen) {
+				return;
+			}
+			OutputSlot &slot = outputs[currentOutput];
+			context->End(slot.written.Get());
+			slot.inFlight = true;
+			outputFrameOpen = false;
+		}
 
-		ID3D12ShaderResourceView *GetInputView(ID3D12Resource *inputTexture, int eye) {
-			D3D12_TEXTURE2D_DESC td;
-			inputTexture->GetDesc(&td);
+		ID3D12ShaderResourceView *GetInputView(OpenVrTextureInfo &input, int eye) {
+			ID3D12Resource *inputTexture = input.texture.Get();
+			const D3D12_TEXTURE2D_DESC &td = input.desc;
 
 			if (requiresResolve) {
 				if (td.SampleDesc.Count > 1) {
@@ -91,19 +227,18 @@ namespace vrperfkit {
 				return resolveView.Get();
 			}
 
-			if (inputViews.find(inputTexture) == inputViews.end()) {
+			if (input.views[0] == nullptr) {
 				LOG_INFO << "Creating shader resource view for input texture " << inputTexture;
-				EyeViews &views = inputViews[inputTexture];
-				views.view[0] = CreateShaderResourceView(device.Get(), inputTexture);
+				input.views[0] = CreateShaderResourceView(device.Get(), inputTexture);
 				if (td.ArraySize > 1) {
-					views.view[1] = CreateShaderResourceView(device.Get(), inputTexture, 1);
+					input.views[1] = CreateShaderResourceView(device.Get(), inputTexture, 1);
 				}
 				else {
-					views.view[1] = views.view[0];
+					input.views[1] = input.views[0];
 				}
 			}
 
-			return inputViews[inputTexture].view[eye].Get();
+			return input.views[eye].Get();
 		}
 	};
 
@@ -117,6 +252,9 @@ namespace vrperfkit {
 
 	void OpenVrManager::Shutdown() {
 		d3d12Res.reset();
+		if (textureCache != nullptr) {
+			textureCache->Clear();
+		}
 		initialized = false;
 		failed = false;
 		graphicsApi = GraphicsApi::UNKNOWN;
@@ -154,7 +292,14 @@ namespace vrperfkit {
 			failed = true;
 		}
 
-		CheckHotkeys();
+		// between frames, once both eyes are through; single mode games submit both eyes as well
+		if (info.eye == vr::Eye_Right) {
+			ApplyHotkeys();
+			if (ApplyConfigReload()) {
+				OnConfigReloaded();
+			}
+			PublishConfig();
+		}
 	}
 
 	void OpenVrManager::PreCompositorWorkCall(bool transition) {
@@ -179,6 +324,7 @@ namespace vrperfkit {
 			dxvkRes->dxvkDevice->FlushRenderingCommands();
 		}
 		dxvkRes->dxvkDevice->LockSubmissionQueue();
+		// read straight from g_config by the proxy, so this doesn't need to be published
 		g_config.dxvk.shouldUseDxvk = false;
 	}
 
@@ -225,13 +371,12 @@ namespace vrperfkit {
 
 	void OpenVrManager::EnsureInit(const OpenVrSubmitInfo &info) {
 		if (info.texture->eType == TextureType_DirectX) {
-			ID3D12Resource *d3d12Tex = (ID3D12Resource*)info.texture->handle;
-			ComPtr<ID3D12Device> device;
-			d3d12Tex->GetDevice(device.GetAddressOf());
+			if (textureCache == nullptr) {
+				textureCache.reset(new OpenVrTextureCache);
+			}
+			const OpenVrTextureInfo &tex = textureCache->Get((ID3D12Resource*)info.texture->handle);
 
-			// check if this texture is actually a Vulkan dxvk texture...
-			ComPtr<IDXGIVkInteropSurface> dxvkSurface;
-			if (d3d12Tex->QueryInterface(IID_PPV_ARGS(dxvkSurface.GetAddressOf())) == S_OK) {
+			if (tex.kind == OpenVrTextureKind::DXVK) {
 				if (!initialized) {
 					Shutdown();
 					InitDxvk(info);
@@ -239,16 +384,14 @@ namespace vrperfkit {
 				return;
 			}
 
-			// check if this texture is a D3D10 texture in disguise
-			ComPtr<ID3D10Device> d3d10Device;
-			if (device->QueryInterface(d3d10Device.GetAddressOf()) == S_OK) {
+			if (tex.kind == OpenVrTextureKind::D3D10) {
 				LOG_ERROR << "Game is submitting D3D10 textures. Not supported.";
 				failed = true;
 				return;
 			}
 
-			D3D12_TEXTURE2D_DESC td;
-			d3d12Tex->GetDesc(&td);
+			// a copy, as shutting down empties the cache
+			D3D12_TEXTURE2D_DESC td = tex.desc;
 
 			if (!initialized || graphicsApi != GraphicsApi::D3D12
 					|| td.Width > textureWidth || td.Width < textureWidth - 10
@@ -280,6 +423,7 @@ namespace vrperfkit {
 		d3d12Res->injector.reset(new D3D12Injector(d3d12Res->device));
 		d3d12Res->injector->AddListener(d3d12Res->postProcessor.get());
 		d3d12Res->injector->AddListener(d3d12Res->variableRateShading.get());
+		d3d12Res->postProcessor->SetStateTracker(d3d12Res->injector->GetStateTracker());
 
 		graphicsApi = GraphicsApi::D3D12;
 		textureWidth = td.Width;
@@ -295,9 +439,9 @@ namespace vrperfkit {
 
 		uint32_t outputWidth = td.Width, outputHeight = td.Height;
 		AdjustOutputResolution(outputWidth, outputHeight);
-		d3d12Res->outputTexture = CreatePostProcessTexture(d3d12Res->device.Get(), outputWidth, outputHeight, DetermineOutputFormat(td.Format));
-		d3d12Res->outputView = CreateShaderResourceView(d3d12Res->device.Get(), d3d12Res->outputTexture.Get());
-		d3d12Res->outputUav = CreateUnorderedAccessView(d3d12Res->device.Get(), d3d12Res->outputTexture.Get());
+		d3d12Res->outputFormat = DetermineOutputFormat(td.Format);
+		d3d12Res->CreateOutputs(outputWidth, outputHeight, d3d12Res->outputFormat, g_config.upscaling.outputTextures);
+		outputRenderScale = g_config.upscaling.renderScale;
 
 		CalculateProjectionCenters();
 		CalculateEyeTextureAspectRatio();
@@ -307,6 +451,31 @@ namespace vrperfkit {
 		initialized = true;
 	}
 
+	void OpenVrManager::OnConfigReloaded() {
+		if (!initialized || graphicsApi != GraphicsApi::D3D12) {
+			return;
+		}
+
+		try {
+			// the game keeps rendering at the size it asked for, only what we upscale to changes
+			bool outputsChanged = g_config.upscaling.enabled && g_config.upscaling.renderScale != outputRenderScale;
+			if (outputsChanged) {
+				uint32_t outputWidth = textureWidth, outputHeight = textureHeight;
+				AdjustOutputResolution(outputWidth, outputHeight);
+				LOG_INFO << "Render scale changed, recreating output textures with resolution " << outputWidth << "x" << outputHeight;
+				d3d12Res->CreateOutputs(outputWidth, outputHeight, d3d12Res->outputFormat, g_config.upscaling.outputTextures);
+				outputRenderScale = g_config.upscaling.renderScale;
+			}
+			d3d12Res->postProcessor->OnConfigReloaded(outputsChanged);
+			d3d12Res->variableRateShading->OnConfigReloaded();
+		}
+		catch (const std::exception &e) {
+			LOG_ERROR << "Failed to apply the reloaded configuration: " << e.what();
+			Shutdown();
+			failed = true;
+		}
+	}
+
 	void OpenVrManager::InitDxvk(const OpenVrSubmitInfo &info) {
 		LOG_INFO << "DXVK is active as a D3D12 -> Vulkan wrapper!";
 		LOG_INFO << "Mod features are currently not supported on Vulkan output...";
@@ -378,9 +547,11 @@ namespace vrperfkit {
 
 	void OpenVrManager::PostProcessD3D12(OpenVrSubmitInfo &info) {
 		ID3D12Resource *inputTexture = reinterpret_cast<ID3D12Resource *>(info.texture->handle);
-		D3D12_TEXTURE2D_DESC itd, otd;
-		inputTexture->GetDesc(&itd);
-		d3d12Res->outputTexture->GetDesc(&otd);
+		// already filled in by EnsureInit
+		OpenVrTextureInfo &inputInfo = textureCache->Get(inputTexture);
+		const D3D12_TEXTURE2D_DESC &itd = inputInfo.desc;
+		int outputSlot = d3d12Res->AcquireOutput();
+		const OpenVrD3D12Resources::OutputSlot &output = d3d12Res->outputs[outputSlot];
 
 		bool isFlippedX = info.bounds->uMin > info.bounds->uMax;
 		bool isFlippedY = info.bounds->vMin > info.bounds->vMax;
@@ -391,30 +562,34 @@ namespace vrperfkit {
 		D3D12PostProcessInput input;
 		input.eye = info.eye;
 		input.inputTexture = inputTexture;
-		input.inputView = d3d12Res->GetInputView(inputTexture, info.eye);
+		input.inputView = d3d12Res->GetInputView(inputInfo, info.eye);
 		input.inputViewport.x = std::roundf(itd.Width * min(info.bounds->uMin, info.bounds->uMax));
 		input.inputViewport.y = std::roundf(itd.Height * min(info.bounds->vMin, info.bounds->vMax));
 		input.inputViewport.width = std::roundf(itd.Width * std::abs(info.bounds->uMax - info.bounds->uMin));
 		input.inputViewport.height = std::roundf(itd.Height * std::abs(info.bounds->vMax - info.bounds->vMin));
-		input.outputTexture = d3d12Res->outputTexture.Get();
-		input.outputView = d3d12Res->outputView.Get();
-		input.outputUav = d3d12Res->outputUav.Get();
+		input.outputTexture = output.texture.Get();
+		input.outputView = output.view.Get();
+		input.outputUav = output.uav.Get();
+		input.outputSlot = outputSlot;
 		input.projectionCenter = projCenters.eyeCenter[info.eye];
+		input.otherEyeProjectionCenter = projCenters.eyeCenter[1 - info.eye];
 		input.mode = d3d12Res->usingArrayTex ? TextureMode::ARRAY : (isCombinedTex ? TextureMode::COMBINED : TextureMode::SINGLE);
 
 		if (isFlippedX) {
 			input.projectionCenter.x = 1.f - input.projectionCenter.x;
+			input.otherEyeProjectionCenter.x = 1.f - input.otherEyeProjectionCenter.x;
 		}
 		if (isFlippedY) {
 			input.projectionCenter.y = 1.f - input.projectionCenter.y;
+			input.otherEyeProjectionCenter.y = 1.f - input.otherEyeProjectionCenter.y;
 		}
 
 		Viewport outputViewport;
 		if (d3d12Res->postProcessor->Apply(input, outputViewport)) {
-			outputBounds.uMin = float(outputViewport.x) / otd.Width;
-			outputBounds.vMin = float(outputViewport.y) / otd.Height;
-			outputBounds.uMax = float(outputViewport.width + outputViewport.x) / otd.Width;
-			outputBounds.vMax = float(outputViewport.height + outputViewport.y) / otd.Height;
+			outputBounds.uMin = float(outputViewport.x) / d3d12Res->outputWidth;
+			outputBounds.vMin = float(outputViewport.y) / d3d12Res->outputHeight;
+			outputBounds.uMax = float(outputViewport.width + outputViewport.x) / d3d12Res->outputWidth;
+			outputBounds.vMax = float(outputViewport.height + outputViewport.y) / d3d12Res->outputHeight;
 			if (info.bounds->uMin > info.bounds->uMax) {
 				std::swap(outputBounds.uMin, outputBounds.uMax);
 			}
@@ -425,7 +600,7 @@ namespace vrperfkit {
 
 			PrepareOutputTexInfo(info.texture, info.submitFlags);
 			
-			outputTexInfo->handle = d3d12Res->outputTexture.Get();
+			outputTexInfo->handle = output.texture.Get();
 			outputTexInfo->eColorSpace = inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
 			info.texture = outputTexInfo.get();
 		}
@@ -436,6 +611,10 @@ namespace vrperfkit {
 		float projRY = isFlippedY ? 1.f - projCenters.eyeCenter[1].y : projCenters.eyeCenter[1].y;
 		d3d12Res->variableRateShading->UpdateTargetInformation(itd.Width, itd.Height, input.mode, projLX, projLY, projRX, projRY);
 		d3d12Res->variableRateShading->EndFrame();
+
+		if (info.eye == Eye_Right) {
+			d3d12Res->ReleaseOutput();
+		}
 	}
 
 	void OpenVrManager::PatchDxvkSubmit(OpenVrSubmitInfo &info) {
@@ -14,6 +14,7 @@ namespace vrperfkit {
 
 	struct OpenVrD3D12Resources;
 	struct OpenVrDxvkResources;
+	struct OpenVrTextureCache;
 
 	class OpenVrManager {
 	public:
@@ -35,6 +36,8 @@ namespace vrperfkit {
 		GraphicsApi graphicsApi = GraphicsApi::UNKNOWN;
 		uint32_t textureWidth = 0;
 		uint32_t textureHeight = 0;
+		// the render scale the output textures were created for
+		float outputRenderScale = 1.f;
 		ProjectionCenters projCenters;
 		float aspectRatio;
 		vr::VRTextureBounds_t outputBounds;
@@ -42,9 +45,11 @@ namespace vrperfkit {
 
 		std::unique_ptr<OpenVrD3D12Resources> d3d12Res;
 		std::unique_ptr<OpenVrDxvkResources> dxvkRes;
+		std::unique_ptr<OpenVrTextureCache> textureCache;
 
 		void EnsureInit(const OpenVrSubmitInfo &info);
 		void InitD3D12(const OpenVrSubmitInfo &info);
+		void OnConfigReloaded();
 
 		void InitDxvk(const OpenVrSubmitInfo &info);
 
@@ -0,0 +1,200 @@
+#include "render_heuristics.h"
+
+namespace vrperfkit {
+	namespace {
+		bool ResolutionMatches(int actualSize, int targetSize, bool preciseResolution) {
+			if (preciseResolution) {
+				return actualSize == targetSize;
+			}
+			return actualSize >= targetSize && actualSize <= targetSize + 2;
+		}
+	}
+
+	bool TargetSelection::Selects(int index, int previousCount) const {
+		if ((renderOnly > 0 && renderOnly != index) || (renderOnly < 0 && previousCount + 1 + renderOnly != index)) {
+			return false;
+		}
+
+		bool ignoredFirst = ignoreFirstInclusive ? index <= ignoreFirst : index < ignoreFirst;
+		if (ignoredFirst || (ignoreLast > 0 && index > previousCount - ignoreLast)) {
+			return false;
+		}
+
+		return true;
+	}
+
+	int GuessRenderingEye(bool separateEyeTextures) {
+		int eye = LEFT_EYE;
+		if (g_config.gameMode == GameMode::LEFT_EYE_FIRST) {
+			if (g_frameState.renderingSecondEye) {
+				eye = RIGHT_EYE;
+			}
+		}
+		else if (g_config.gameMode == GameMode::RIGHT_EYE_FIRST) {
+			if (!g_frameState.renderingSecondEye) {
+				eye = RIGHT_EYE;
+			}
+		}
+
+		if (separateEyeTextures && g_frameState.renderingSecondEye) {
+			eye = RIGHT_EYE;
+		}
+		return eye;
+	}
+
+	void EndSubmittedEye() {
+		g_frameState.renderingSecondEye = !g_frameState.renderingSecondEye;
+		g_frameState.ffrRenderTargetCountMax = g_frameState.ffrRenderTargetCount;
+		g_frameState.ffrRenderTargetCount = 0;
+	}
+
+	bool IsEyeDepthBuffer(uint32_t width, uint32_t height, uint32_t eyeWidth, uint32_t eyeHeight, bool preciseResolution) {
+		if (preciseResolution) {
+			return width == eyeWidth && height == eyeHeight;
+		}
+
+		// smaller than submitted texture size, so not the correct render target
+		// if equals, this is probably the shadow map or something similar
+		return width >= eyeWidth && height >= eyeHeight && width != height;
+	}
+
+	bool DepthClearCounter::OnDepthClear(bool maskingEnabled) {
+		++count;
+
+		if (!maskingEnabled) {
+			return false;
+		}
+
+		bool selected = selection.Selects(count, countMax);
+		if (g_config.ffrFastModeUsesHRMCount) {
+			g_frameState.ffrApplyFastMode = selected;
+		}
+		return selected;
+	}
+
+	void DepthClearCounter::EndEye() {
+		countMax = count;
+		count = 0;
+	}
+
+	const char *VrsTargetToString(VrsTarget target) {
+		switch (target) {
+		case VrsTarget::NONE:
+			return "none";
+		case VrsTarget::LEFT_EYE:
+			return "left";
+		case VrsTarget::RIGHT_EYE:
+			return "right";
+		case VrsTarget::COMBINED:
+			return "combined";
+		case VrsTarget::ARRAY:
+			return "array";
+		case VrsTarget::UNKNOWN_EYE:
+			return "unknown eye";
+		}
+		return "";
+	}
+
+	VrsTargetClassifier::VrsTargetClassifier() {
+		Configure(g_config.ffr);
+	}
+
+	void VrsTargetClassifier::Configure(const FixedFoveatedConfig &ffr) {
+		selection.ignoreFirst = ffr.ignoreFirstTargetRenders;
+		selection.ignoreLast = ffr.ignoreLastTargetRenders;
+		selection.renderOnly = ffr.renderOnlyTarget;
+		selection.ignoreFirstInclusive = false;
+	}
+
+	void VrsTargetClassifier::SetEyeTarget(int width, int height, TextureMode mode) {
+		targetWidth = width;
+		targetHeight = height;
+		targetMode = mode;
+	}
+
+	VrsTarget VrsTargetClassifier::Classify(const Config &config, uint32_t width, uint32_t height, uint32_t arraySize) {
+		if (!config.ffr.apply || !g_frameState.ffrApplyFastMode) {
+			return VrsTarget::NONE;
+		}
+
+		if (width == height) {
+			// probably a shadow map or similar extra resources
+			return VrsTarget::NONE;
+		}
+
+		if (!config.ffrFastModeUsesHRMCount) {
+			++g_frameState.ffrRenderTargetCount;
+			if (!selection.Selects(g_frameState.ffrRenderTargetCount, g_frameState.ffrRenderTargetCountMax)) {
+				return VrsTarget::NONE;
+			}
+		}
+
+		bool precise = config.ffr.preciseResolution;
+		bool matchesEye = ResolutionMatches(width, targetWidth, precise) && ResolutionMatches(height, targetHeight, precise);
+
+		if (config.ffr.fastMode) {
+			if (!matchesEye) {
+				return VrsTarget::NONE;
+			}
+			bool rightEye = config.gameMode == GameMode::RIGHT_EYE_FIRST ? !g_frameState.renderingSecondEye : g_frameState.renderingSecondEye;
+			return rightEye ? VrsTarget::RIGHT_EYE : VrsTarget::LEFT_EYE;
+		}
+
+		if (targetMode == TextureMode::SINGLE && ResolutionMatches(width, 2 * targetWidth, precise) && ResolutionMatches(height, targetHeight, precise)) {
+			return VrsTarget::COMBINED;
+		}
+		if (targetMode == TextureMode::COMBINED && matchesEye) {
+			return VrsTarget::COMBINED;
+		}
+		if (targetMode != TextureMode::COMBINED && arraySize == 2 && matchesEye) {
+			return VrsTarget::ARRAY;
+		}
+		if (targetMode == TextureMode::SINGLE && arraySize == 1 && matchesEye) {
+			// count every single eye target, so that EndFrame can guess the order even if it isn't known yet
+			int index = currentSingleEyeTarget++;
+			if (index >= (int)singleEyeOrder.size()) {
+				return VrsTarget::UNKNOWN_EYE;
+			}
+			switch (singleEyeOrder[index]) {
+			case 'L':
+			case 'l':
+				return VrsTarget::LEFT_EYE;
+			case 'R':
+			case 'r':
+				return VrsTarget::RIGHT_EYE;
+			default:
+				return VrsTarget::NONE;
+			}
+		}
+
+		return VrsTarget::NONE;
+	}
+
+	bool VrsTargetClassifier::EndFrame(const Config &config) {
+		if (config.ffr.fastMode || currentSingleEyeTarget == 0) {
+			return false;
+		}
+
+		bool guessed = false;
+		lastSingleEyeTargetCount = currentSingleEyeTarget;
+		if (currentSingleEyeTarget != (int)singleEyeOrder.size()) {
+			// guess left eye being rendered first, followed by right eye
+			singleEyeOrder.clear();
+			for (int i = 0; i < currentSingleEyeTarget / 2; ++i) {
+				singleEyeOrder.push_back('L');
+			}
+			for (int i = 0; i < currentSingleEyeTarget / 2; ++i) {
+				singleEyeOrder.push_back('R');
+			}
+			for (int i = (int)singleEyeOrder.size(); i < currentSingleEyeTarget; ++i) {
+				singleEyeOrder.push_back('S');
+			}
+			if (config.ffr.overrideSingleEyeOrder.size() == singleEyeOrder.size()) {
+				singleEyeOrder = config.ffr.overrideSingleEyeOrder;
+			}
+			guessed = true;
+		}
+		currentSingleEyeTarget = 0;
+		return guessed;
+	}
+}
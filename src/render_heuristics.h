@@ -0,0 +1,83 @@
+#pragma once
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+
+// The guesswork that decides which of the game's render targets and depth buffers belong to
+// which eye, kept free of any graphics API so that tools/trace_replay can run it on recorded traces.
+namespace vrperfkit {
+	// Selects the render targets or depth clears within one eye's rendering that should be processed,
+	// as configured by ignoreFirstTargetRenders, ignoreLastTargetRenders and renderOnlyTarget.
+	struct TargetSelection {
+		int ignoreFirst = 0;
+		int ignoreLast = 0;
+		int renderOnly = 0;
+		// VRS has always ignored one render target less than HRM for the same ignoreFirstTargetRenders
+		bool ignoreFirstInclusive = true;
+
+		// index counts from 1 within the current eye, previousCount is the number seen for the previous eye
+		bool Selects(int index, int previousCount) const;
+	};
+
+	// the eye the game is currently rendering, based on the game mode and the order eyes are submitted in
+	int GuessRenderingEye(bool separateEyeTextures);
+
+	// advances the per-eye bookkeeping once an eye has been submitted
+	void EndSubmittedEye();
+
+	bool IsEyeDepthBuffer(uint32_t width, uint32_t height, uint32_t eyeWidth, uint32_t eyeHeight, bool preciseResolution);
+
+	// Counts the depth buffer clears for each eye and decides which of them HRM or RDM mask.
+	class DepthClearCounter {
+	public:
+		void Configure(const TargetSelection &selection) { this->selection = selection; }
+
+		// returns whether the depth buffer should be masked
+		bool OnDepthClear(bool maskingEnabled);
+		void EndEye();
+
+		int Count() const { return count; }
+
+	private:
+		TargetSelection selection;
+		int count = 0;
+		int countMax = 0;
+	};
+
+	enum class VrsTarget {
+		NONE,
+		LEFT_EYE,
+		RIGHT_EYE,
+		COMBINED,
+		ARRAY,
+		// a single eye render target, but the order of eyes within the frame isn't known yet
+		UNKNOWN_EYE,
+	};
+	const char *VrsTargetToString(VrsTarget target);
+
+	// Decides which VRS pattern, if any, to use for the render targets the game binds.
+	class VrsTargetClassifier {
+	public:
+		VrsTargetClassifier();
+
+		// takes which render targets to select from the config
+		void Configure(const FixedFoveatedConfig &ffr);
+		void SetEyeTarget(int width, int height, TextureMode mode);
+		VrsTarget Classify(const Config &config, uint32_t width, uint32_t height, uint32_t arraySize);
+		// returns true if the order of single eye render targets had to be guessed anew
+		bool EndFrame(const Config &config);
+
+		int SingleEyeTargetCount() const { return lastSingleEyeTargetCount; }
+		const std::string &SingleEyeOrder() const { return singleEyeOrder; }
+
+	private:
+		TargetSelection selection;
+		int targetWidth = 1000000;
+		int targetHeight = 1000000;
+		TextureMode targetMode = TextureMode::SINGLE;
+		std::string singleEyeOrder;
+		int currentSingleEyeTarget = 0;
+		int lastSingleEyeTargetCount = 0;
+	};
+}
@@ -37,4 +37,21 @@ namespace vrperfkit {
 		if (height & 1)
 			++height;
 	}
+
+	// Shrinks a full sized eye viewport to the part the game actually renders to at the current
+	// dynamic resolution. Used for both the game's viewports and the submitted region, so they have to
+	// pass the same config snapshot to match up.
+	template<typename Num>
+	void AdjustDynamicResolution(const UpscaleConfig &upscaling, Num &width, Num &height) {
+		if (!upscaling.enabled || !upscaling.dynamic || upscaling.dynamicScale >= 1.f) {
+			return;
+		}
+
+		width = std::roundf(width * upscaling.dynamicScale);
+		height = std::roundf(height * upscaling.dynamicScale);
+		if (width < 1)
+			width = 1;
+		if (height < 1)
+			height = 1;
+	}
 }
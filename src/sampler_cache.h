@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace vrperfkit {
+	// Remembers, per game sampler and MIP LOD bias, which sampler to bind in its place: either a replacement
+	// with the bias applied, or the sampler itself if it is one we must not touch. Entries are kept in a
+	// flat open-addressing table, so that the lookup on every sampler bind stays within a cache line or two.
+	// Biases are quantized, so that switching between biases reuses the replacements created before.
+	// Once the table holds maxEntries, the least recently used entries are evicted.
+	// Owner keeps a created replacement sampler alive (e.g. a ComPtr), Sampler is the raw sampler type.
+	template<typename Sampler, typename Owner>
+	class SamplerReplacementCache {
+	public:
+		// 1/32 of a MIP level is well below anything visible
+		static constexpr float BIAS_STEP = 1.f / 32.f;
+
+		explicit SamplerReplacementCache(size_t maxEntries = 2048) : maxEntries(maxEntries) {
+			size_t capacity = 16;
+			while (capacity < 2 * maxEntries) {
+				capacity *= 2;
+			}
+			slots.resize(capacity);
+		}
+
+		static int QuantizeBias(float bias) {
+			return (int)std::lround(bias / BIAS_STEP);
+		}
+
+		static float BiasFromKey(int biasKey) {
+			return biasKey * BIAS_STEP;
+		}
+
+		// returns the sampler to bind in place of sampler, or nullptr if it hasn't been seen with this bias yet
+		Sampler *Find(Sampler *sampler, int biasKey) {
+			Slot &slot = slots[Probe(sampler, biasKey)];
+			if (slot.sampler == nullptr) {
+				return nullptr;
+			}
+			slot.lastUse = ++useCounter;
+			return slot.replacement;
+		}
+
+		// replacement may be sampler itself to pass it through unchanged
+		void Insert(Sampler *sampler, int biasKey, Sampler *replacement, Owner owner = Owner()) {
+			size_t i = Probe(sampler, biasKey);
+			if (slots[i].sampler == nullptr) {
+				if (count >= maxEntries) {
+					EvictLeastRecentlyUsed();
+					// the eviction rebuilt the table
+					i = Probe(sampler, biasKey);
+				}
+				++count;
+			}
+
+			Slot &slot = slots[i];
+			slot.sampler = sampler;
+			slot.biasKey = biasKey;
+			slot.replacement = replacement;
+			slot.owner = std::move(owner);
+			slot.lastUse = ++useCounter;
+		}
+
+		void Clear() {
+			for (Slot &slot : slots) {
+				slot = Slot();
+			}
+			count = 0;
+		}
+
+		size_t Size() const { return count; }
+		size_t Evictions() const { return evictions; }
+
+	private:
+		struct Slot {
+			Sampler *sampler = nullptr;
+			Sampler *replacement = nullptr;
+			int biasKey = 0;
+			uint64_t lastUse = 0;
+			Owner owner = Owner();
+		};
+
+		std::vector<Slot> slots;
+		size_t maxEntries;
+		size_t count = 0;
+		size_t evictions = 0;
+		uint64_t useCounter = 0;
+
+		static size_t Hash(Sampler *sampler, int biasKey) {
+			// objects are at least 16 byte aligned, so the low bits carry no information
+			uint64_t h = ((uint64_t)(uintptr_t)sampler >> 4) ^ ((uint64_t)(uint32_t)biasKey << 32);
+			h *= 0x9e3779b97f4a7c15ull;
+			return (size_t)(h >> 32);
+		}
+
+		// returns the slot holding the entry, or the empty slot where it belongs
+		size_t Probe(Sampler *sampler, int biasKey) const {
+			size_t mask = slots.size() - 1;
+			size_t i = Hash(sampler, biasKey) & mask;
+			while (slots[i].sampler != nullptr && !(slots[i].sampler == sampler && slots[i].biasKey == biasKey)) {
+				i = (i + 1) & mask;
+			}
+			return i;
+		}
+
+		// evicts the least recently used eighth of the entries at once, so that the scan is
+		// amortized over many inserts when the cache is thrashing
+		void EvictLeastRecentlyUsed() {
+			std::vector<uint64_t> uses;
+			uses.reserve(count);
+			for (const Slot &slot : slots) {
+				if (slot.sampler != nullptr) {
+					uses.push_back(slot.lastUse);
+				}
+			}
+			size_t evictCount = std::max<size_t>(1, uses.size() / 8);
+			std::nth_element(uses.begin(), uses.begin() + (evictCount - 1), uses.end());
+			uint64_t threshold = uses[evictCount - 1];
+
+			std::vector<Slot> old (slots.size());
+			old.swap(slots);
+			count = 0;
+			for (Slot &slot : old) {
+				if (slot.sampler == nullptr) {
+					continue;
+				}
+				if (slot.lastUse <= threshold) {
+					++evictions;
+					continue;
+				}
+				slots[Probe(slot.sampler, slot.biasKey)] = std::move(slot);
+				++count;
+			}
+		}
+	};
+}
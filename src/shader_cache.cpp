@@ -0,0 +1,136 @@
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace vrperfkit {
+	namespace {
+		const uint32_t MANIFEST_MAGIC = 0x534b5056; // "VPKS"
+		const uint32_t MANIFEST_VERSION = 1;
+		const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+		const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+		uint64_t Fnv1a(const uint8_t *data, size_t size, uint64_t hash = FNV_OFFSET) {
+			for (size_t i = 0; i < size; ++i) {
+				hash = (hash ^ data[i]) * FNV_PRIME;
+			}
+			return hash;
+		}
+
+		// little endian regardless of the host, so that manifests stay readable by the check tool
+		template<typename T>
+		void Write(std::vector<uint8_t> &out, T value) {
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				out.push_back((uint8_t)(value >> (8 * i)));
+			}
+		}
+
+		template<typename T>
+		bool Read(const std::vector<uint8_t> &in, size_t &pos, T &value) {
+			if (in.size() - pos < sizeof(T)) {
+				return false;
+			}
+			value = 0;
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				value |= (T)in[pos++] << (8 * i);
+			}
+			return true;
+		}
+	}
+
+	uint64_t HashShaderBytecode(const void *data, size_t size) {
+		return Fnv1a((const uint8_t*)data, size);
+	}
+
+	bool ShaderCacheManifest::Contains(uint64_t hash) const {
+		return std::any_of(entries.begin(), entries.end(), [hash](const ShaderCacheEntry &entry) { return entry.hash == hash; });
+	}
+
+	bool ShaderCacheManifest::Add(uint64_t hash, ShaderStage stage) {
+		if (Contains(hash) || entries.size() >= MAX_ENTRIES) {
+			return false;
+		}
+		entries.push_back({ hash, stage });
+		return true;
+	}
+
+	std::vector<uint8_t> ShaderCacheManifest::Serialize() const {
+		std::vector<uint8_t> out;
+		Write(out, MANIFEST_MAGIC);
+		Write(out, MANIFEST_VERSION);
+		Write(out, key.vendorId);
+		Write(out, key.deviceId);
+		Write(out, key.driverVersion);
+		Write(out, (uint32_t)entries.size());
+		for (const ShaderCacheEntry &entry : entries) {
+			Write(out, entry.hash);
+			Write(out, (uint8_t)entry.stage);
+		}
+		Write(out, Fnv1a(out.data(), out.size()));
+		return out;
+	}
+
+	bool ShaderCacheManifest::Deserialize(const std::vector<uint8_t> &data) {
+		entries.clear();
+
+		size_t pos = 0;
+		uint32_t magic, version, count;
+		ShaderCacheKey fileKey;
+		if (!Read(data, pos, magic) || magic != MANIFEST_MAGIC || !Read(data, pos, version) || version != MANIFEST_VERSION) {
+			return false;
+		}
+		if (!Read(data, pos, fileKey.vendorId) || !Read(data, pos, fileKey.deviceId) || !Read(data, pos, fileKey.driverVersion) || fileKey != key) {
+			return false;
+		}
+		if (!Read(data, pos, count) || count > MAX_ENTRIES) {
+			return false;
+		}
+
+		std::vector<ShaderCacheEntry> loaded (count);
+		for (ShaderCacheEntry &entry : loaded) {
+			uint8_t stage;
+			if (!Read(data, pos, entry.hash) || !Read(data, pos, stage) || stage >= (uint8_t)ShaderStage::COUNT) {
+				return false;
+			}
+			entry.stage = (ShaderStage)stage;
+		}
+
+		uint64_t checksum;
+		size_t checksummed = pos;
+		if (!Read(data, pos, checksum) || pos != data.size() || checksum != Fnv1a(data.data(), checksummed)) {
+			return false;
+		}
+
+		for (const ShaderCacheEntry &entry : loaded) {
+			Add(entry.hash, entry.stage);
+		}
+		return true;
+	}
+
+	bool ShaderCacheManifest::Load(const std::filesystem::path &path) {
+		std::ifstream file (path, std::ios::binary);
+		if (!file) {
+			entries.clear();
+			return false;
+		}
+		std::vector<uint8_t> data ((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return Deserialize(data);
+	}
+
+	bool ShaderCacheManifest::Save(const std::filesystem::path &path) const {
+		std::vector<uint8_t> data = Serialize();
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream file (tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.write((const char*)data.data(), data.size())) {
+				return false;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		return !error;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace vrperfkit {
+	enum class ShaderStage : uint8_t {
+		VERTEX,
+		PIXEL,
+		COMPUTE,
+		COUNT,
+	};
+
+	// FNV-1a over the compiled bytecode
+	uint64_t HashShaderBytecode(const void *data, size_t size);
+
+	// The GPU and driver a manifest was written for. Which permutations a session picks depends
+	// on the GPU's capabilities, so a manifest of a different GPU or driver is not used.
+	struct ShaderCacheKey {
+		uint32_t vendorId = 0;
+		uint32_t deviceId = 0;
+		uint64_t driverVersion = 0;
+
+		bool operator==(const ShaderCacheKey &other) const {
+			return vendorId == other.vendorId && deviceId == other.deviceId && driverVersion == other.driverVersion;
+		}
+		bool operator!=(const ShaderCacheKey &other) const { return !(*this == other); }
+	};
+
+	struct ShaderCacheEntry {
+		uint64_t hash = 0;
+		ShaderStage stage = ShaderStage::COMPUTE;
+	};
+
+	// Remembers which shaders the toolkit created in previous sessions, so that they can be created on a
+	// background thread at startup instead of on the render thread when a pass first needs them, e.g. after
+	// switching the upscaler by hotkey. Only the hashes are stored, the bytecode is part of the binary.
+	// Does not depend on any graphics API, see tools/shader_cache_check.
+	class ShaderCacheManifest {
+	public:
+		// at most this many entries are loaded or stored, anything beyond is not ours
+		static constexpr uint32_t MAX_ENTRIES = 4096;
+
+		explicit ShaderCacheManifest(const ShaderCacheKey &key = ShaderCacheKey()) : key(key) {}
+
+		const ShaderCacheKey &Key() const { return key; }
+		const std::vector<ShaderCacheEntry> &Entries() const { return entries; }
+		bool Contains(uint64_t hash) const;
+		// returns whether the entry is new
+		bool Add(uint64_t hash, ShaderStage stage);
+
+		std::vector<uint8_t> Serialize() const;
+		// keeps the entries only if the data is intact and was written for this manifest's key
+		bool Deserialize(const std::vector<uint8_t> &data);
+
+		bool Load(const std::filesystem::path &path);
+		// writes to a temporary file first, so an interrupted save leaves the previous manifest intact
+		bool Save(const std::filesystem::path &path) const;
+
+	private:
+		ShaderCacheKey key;
+		std::vector<ShaderCacheEntry> entries;
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace vrperfkit {
+	// One compiled permutation of a shader, as generated by add_compute_shader_permutations
+	// in cmake/ShaderPermutations.cmake
+	struct ShaderBytecode {
+		const void *data;
+		size_t size;
+		// the defines it was compiled with, for logging
+		const char *defines;
+	};
+
+	// Bits of a permutation index, in the order of SHADER_PERMUTATION_DEFINES
+	enum ShaderPermutationFlags : uint32_t {
+		// only the blocks within the radius are upscaled or sharpened, the rest is copied by a separate
+		// pass, both dispatched over tile lists (see tile_classifier.h)
+		SHADER_RADIUS_CUTOFF = 1 << 0,
+		// the copied area outside the radius is tinted
+		SHADER_DEBUG_MODE = 1 << 1,
+		SHADER_HALF_PRECISION = 1 << 2,
+		// the input is still masked by RDM and gets reconstructed while reading it
+		SHADER_RDM_RECONSTRUCT = 1 << 3,
+	};
+	const uint32_t SHADER_PERMUTATION_COUNT = 16;
+
+	// Picks the permutation for an output viewport, with the projection centre and radius relative to it.
+	// The tile lists are skipped if the radius covers the whole viewport anyway, and with them the
+	// debug tint, since there is nothing outside the radius left to tint.
+	inline uint32_t SelectShaderPermutation(bool debugMode, bool halfPrecision, uint32_t viewportWidth, uint32_t viewportHeight,
+			uint32_t projCentreX, uint32_t projCentreY, uint32_t squaredRadius) {
+		uint64_t dx = projCentreX > viewportWidth / 2 ? projCentreX : viewportWidth - projCentreX;
+		uint64_t dy = projCentreY > viewportHeight / 2 ? projCentreY : viewportHeight - projCentreY;
+
+		uint32_t flags = 0;
+		if (dx * dx + dy * dy > squaredRadius) {
+			flags |= SHADER_RADIUS_CUTOFF;
+			if (debugMode) {
+				flags |= SHADER_DEBUG_MODE;
+			}
+		}
+		if (halfPrecision) {
+			flags |= SHADER_HALF_PRECISION;
+		}
+		return flags;
+	}
+}
@@ -0,0 +1,74 @@
+#include "tile_classifier.h"
+
+#include <algorithm>
+
+namespace vrperfkit {
+	bool TileClassifier::Classify(uint32_t blockWidth, uint32_t blockHeight, const TileClassifierEye *eyes, int eyeCount) {
+		if (blockWidth == this->blockWidth && blockHeight == this->blockHeight && !filterList.empty()
+				&& this->eyes.size() == (size_t)eyeCount && std::equal(eyes, eyes + eyeCount, this->eyes.begin())) {
+			return false;
+		}
+
+		this->blockWidth = blockWidth;
+		this->blockHeight = blockHeight;
+		this->eyes.assign(eyes, eyes + eyeCount);
+
+		// the first element is filled in by FinishList
+		filterList.assign(1, 0);
+		copyList.assign(1, 0);
+		for (int i = 0; i < eyeCount; ++i) {
+			ClassifyEye(eyes[i], i);
+		}
+		FinishList(filterList);
+		FinishList(copyList);
+		return true;
+	}
+
+	bool TileClassifier::DispatchSize(const std::vector<uint32_t> &list, uint32_t &groupsX, uint32_t &groupsY) {
+		if (list.size() <= 1) {
+			return false;
+		}
+		groupsX = list[0];
+		groupsY = (uint32_t)(list.size() - 1) / groupsX;
+		return true;
+	}
+
+	void TileClassifier::ClassifyEye(const TileClassifierEye &eye, uint32_t index) {
+		uint32_t blocksX = (eye.viewportWidth + blockWidth - 1) / blockWidth;
+		uint32_t blocksY = (eye.viewportHeight + blockHeight - 1) / blockHeight;
+		uint32_t copyTilesX = blockWidth / COPY_TILE_WIDTH;
+		uint32_t copyTilesY = blockHeight / COPY_TILE_HEIGHT;
+
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			int64_t dy = (int64_t)eye.projCentreY - (by * blockHeight + blockHeight / 2);
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				int64_t dx = (int64_t)eye.projCentreX - (bx * blockWidth + blockWidth / 2);
+				if (dx * dx + dy * dy <= eye.squaredRadius) {
+					filterList.push_back(PackTile(bx, by, index));
+					continue;
+				}
+
+				// skip the copy tiles of edge blocks that lie entirely outside the viewport
+				for (uint32_t ty = by * copyTilesY; ty < (by + 1) * copyTilesY && ty * COPY_TILE_HEIGHT < eye.viewportHeight; ++ty) {
+					for (uint32_t tx = bx * copyTilesX; tx < (bx + 1) * copyTilesX && tx * COPY_TILE_WIDTH < eye.viewportWidth; ++tx) {
+						copyList.push_back(PackTile(tx, ty, index));
+					}
+				}
+			}
+		}
+	}
+
+	void TileClassifier::FinishList(std::vector<uint32_t> &list) {
+		uint32_t count = (uint32_t)list.size() - 1;
+		if (count == 0) {
+			list[0] = 0;
+			return;
+		}
+		// spread the tiles evenly across as few rows as possible, so that the padding stays below one group per row
+		uint32_t rows = (count + TILE_LIST_MAX_ROW - 1) / TILE_LIST_MAX_ROW;
+		uint32_t rowWidth = (count + rows - 1) / rows;
+		list[0] = rowWidth;
+		// repeating a tile writes the same pixels with the same values again
+		list.resize(1 + (size_t)rows * rowWidth, list.back());
+	}
+}
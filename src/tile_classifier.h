@@ -0,0 +1,51 @@
+#pragma once
+#include "tile_list.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace vrperfkit {
+	struct TileClassifierEye {
+		uint32_t viewportWidth = 0;
+		uint32_t viewportHeight = 0;
+		// relative to the viewport, in pixels
+		uint32_t projCentreX = 0;
+		uint32_t projCentreY = 0;
+		uint32_t squaredRadius = 0;
+
+		bool operator==(const TileClassifierEye &other) const {
+			return viewportWidth == other.viewportWidth && viewportHeight == other.viewportHeight
+				&& projCentreX == other.projCentreX && projCentreY == other.projCentreY && squaredRadius == other.squaredRadius;
+		}
+	};
+
+	// Sorts the blocks of a filter pass into those whose centre lies within the upscaling radius, which get
+	// the full filter, and the rest, which are split into copy tiles for a cheap pass. Both lists are laid
+	// out as described in tile_list.h, so that each pass dispatches exactly the thread groups it needs.
+	// The block size must be a multiple of the copy tile size. Each tile carries the index of its eye in the
+	// array passed to Classify, which the stereo shaders use to select that eye's constants, so the
+	// constants must be laid out in the same order as the eyes, whichever eye the game submitted first.
+	// Classifying the same eyes again keeps the lists and reports them as unchanged.
+	// Does not depend on any graphics API, see tools/tile_classifier_check.
+	class TileClassifier {
+	public:
+		// returns whether the lists changed
+		bool Classify(uint32_t blockWidth, uint32_t blockHeight, const TileClassifierEye *eyes, int eyeCount);
+
+		const std::vector<uint32_t> &FilterList() const { return filterList; }
+		const std::vector<uint32_t> &CopyList() const { return copyList; }
+
+		// thread groups to dispatch for a list, returns false if there is nothing to dispatch
+		static bool DispatchSize(const std::vector<uint32_t> &list, uint32_t &groupsX, uint32_t &groupsY);
+
+	private:
+		uint32_t blockWidth = 0;
+		uint32_t blockHeight = 0;
+		std::vector<TileClassifierEye> eyes;
+		std::vector<uint32_t> filterList;
+		std::vector<uint32_t> copyList;
+
+		void ClassifyEye(const TileClassifierEye &eye, uint32_t index);
+		static void FinishList(std::vector<uint32_t> &list);
+	};
+}
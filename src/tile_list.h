@@ -0,0 +1,55 @@
+#ifndef VRPERFKIT_TILE_LIST_H
+#define VRPERFKIT_TILE_LIST_H
+// Layout of the tile lists the foveated upscaling passes are dispatched over, shared between C++
+// (TileClassifier) and the HLSL shaders. A list is a buffer of uints: the first holds the number of
+// thread groups per dispatch row, the rest one packed tile per thread group. Dispatching
+// (width, rows, 1) groups therefore runs exactly the listed tiles, apart from fewer than one
+// group per row of padding in lists too long for a single row, which repeats the last tile.
+
+#ifdef __cplusplus
+#include <cstdint>
+#define TILE_UINT uint32_t
+#define TILE_FUNC inline
+#define TILE_CONST const
+namespace vrperfkit {
+#else
+#define TILE_UINT uint
+#define TILE_FUNC
+#define TILE_CONST static const
+#endif
+
+// outside the upscaling radius the input is only copied, in tiles of this size
+TILE_CONST TILE_UINT COPY_TILE_WIDTH = 32;
+TILE_CONST TILE_UINT COPY_TILE_HEIGHT = 8;
+// the API limit for thread groups per dispatch dimension
+TILE_CONST TILE_UINT TILE_LIST_MAX_ROW = 65535;
+
+TILE_FUNC TILE_UINT PackTile(TILE_UINT x, TILE_UINT y, TILE_UINT eye) {
+	return x | (y << 14) | (eye << 28);
+}
+
+TILE_FUNC TILE_UINT TileX(TILE_UINT tile) {
+	return tile & 0x3fff;
+}
+
+TILE_FUNC TILE_UINT TileY(TILE_UINT tile) {
+	return (tile >> 14) & 0x3fff;
+}
+
+TILE_FUNC TILE_UINT TileEye(TILE_UINT tile) {
+	return (tile >> 28) & 1;
+}
+
+// position in the list of the tile a thread group handles, given the row width in the list's first element
+TILE_FUNC TILE_UINT TileListIndex(TILE_UINT groupX, TILE_UINT groupY, TILE_UINT rowWidth) {
+	return 1 + groupY * rowWidth + groupX;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef TILE_UINT
+#undef TILE_FUNC
+#undef TILE_CONST
+#endif
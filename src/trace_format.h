@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of the event traces written by TraceRecorder and read by tools/trace_replay.
+// The file is a header followed by a ring of fixed-size records; once the ring is full,
+// the oldest records are overwritten.
+namespace vrperfkit {
+	const char TRACE_MAGIC[4] = { 'V', 'P', 'K', 'T' };
+	const uint32_t TRACE_VERSION = 1;
+
+	enum class TraceEventType : uint8_t {
+		NONE,
+		// the first render target bound by the game; info is the number of bound render targets
+		RENDER_TARGETS,
+		// info holds the clear flags
+		DEPTH_CLEAR,
+		// an eye texture submitted to the runtime; info holds the TextureMode
+		SUBMIT,
+		// the runtime's frame is complete, after all eyes were submitted
+		FRAME_END,
+	};
+
+	struct TraceHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t capacity;
+		// number of records written so far, the ring holds the last `capacity` of them
+		uint64_t written;
+		uint64_t reserved;
+	};
+
+	struct TraceRecord {
+		// nanoseconds since the trace was started
+		uint64_t timestamp;
+		// index of the record + 1, written last so that incomplete records can be told apart
+		uint32_t sequence;
+		TraceEventType type;
+		// the submitted eye, or for other events the eye the game is guessed to be rendering
+		uint8_t eye;
+		uint8_t info;
+		uint8_t renderingSecondEye;
+		uint32_t width;
+		uint32_t height;
+		uint16_t arraySize;
+		uint16_t sampleCount;
+		uint32_t format;
+	};
+
+	static_assert(sizeof(TraceHeader) == 32, "trace header layout changed");
+	static_assert(sizeof(TraceRecord) == 32, "trace record layout changed");
+}
@@ -0,0 +1,84 @@
+#include "trace_recorder.h"
+#include "config.h"
+#include "logging.h"
+#include "win_header_sane.h"
+
+#include <cstring>
+
+namespace vrperfkit {
+	TraceRecorder g_trace;
+
+	bool TraceRecorder::Open(const std::filesystem::path &path, uint32_t capacity) {
+		Close();
+
+		uint64_t size = sizeof(TraceHeader) + uint64_t(capacity) * sizeof(TraceRecord);
+		HANDLE fileHandle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			LOG_ERROR << "Could not create trace file " << path.wstring() << ": " << GetLastError();
+			return false;
+		}
+		HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+		void *view = mappingHandle != nullptr ? MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+		if (view == nullptr) {
+			LOG_ERROR << "Could not map trace file " << path.wstring() << ": " << GetLastError();
+			if (mappingHandle != nullptr) {
+				CloseHandle(mappingHandle);
+			}
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		file = fileHandle;
+		mapping = mappingHandle;
+		header = (TraceHeader*)view;
+		records = (TraceRecord*)(header + 1);
+		std::memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+		header->version = TRACE_VERSION;
+		header->recordSize = sizeof(TraceRecord);
+		header->capacity = capacity;
+		header->written = 0;
+		start = std::chrono::steady_clock::now();
+
+		LOG_INFO << "Recording hook events to " << path.wstring();
+		return true;
+	}
+
+	void TraceRecorder::Close() {
+		if (header != nullptr) {
+			FlushViewOfFile(header, 0);
+			UnmapViewOfFile(header);
+			header = nullptr;
+			records = nullptr;
+		}
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+		if (file != nullptr) {
+			CloseHandle(file);
+			file = nullptr;
+		}
+	}
+
+	void TraceRecorder::Record(TraceEventType type, uint8_t eye, uint32_t width, uint32_t height, uint32_t arraySize, uint32_t sampleCount, uint32_t format, uint8_t info) {
+		if (header == nullptr) {
+			return;
+		}
+
+		uint64_t index = InterlockedIncrement64((volatile LONG64*)&header->written) - 1;
+		TraceRecord &record = records[index % header->capacity];
+		record.sequence = 0;
+		record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		record.type = type;
+		record.eye = eye;
+		record.info = info;
+		record.renderingSecondEye = g_frameState.renderingSecondEye;
+		record.width = width;
+		record.height = height;
+		record.arraySize = (uint16_t)arraySize;
+		record.sampleCount = (uint16_t)sampleCount;
+		record.format = format;
+		MemoryBarrier();
+		record.sequence = uint32_t(index + 1);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "trace_format.h"
+
+#include <chrono>
+#include <filesystem>
+
+namespace vrperfkit {
+	// Records the hook events our render target heuristics are based on into a memory-mapped
+	// ring file, so that per-game settings can be worked out offline with tools/trace_replay.
+	class TraceRecorder {
+	public:
+		~TraceRecorder() { Close(); }
+
+		bool Open(const std::filesystem::path &path, uint32_t capacity);
+		void Close();
+		bool IsActive() const { return header != nullptr; }
+
+		void Record(TraceEventType type, uint8_t eye = 0, uint32_t width = 0, uint32_t height = 0,
+			uint32_t arraySize = 0, uint32_t sampleCount = 0, uint32_t format = 0, uint8_t info = 0);
+
+	private:
+		void *file = nullptr;
+		void *mapping = nullptr;
+		TraceHeader *header = nullptr;
+		TraceRecord *records = nullptr;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	extern TraceRecorder g_trace;
+}
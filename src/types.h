@@ -6,7 +6,6 @@ namespace vrperfkit {
 	enum class GraphicsApi {
 		UNKNOWN,
 		D3D12,
-		D3D12,
 		DXVK,
 	};
 
@@ -69,4 +68,11 @@ namespace vrperfkit {
 	};
 	GameMode GameModeFromString(std::string s);
 	std::string GameModeToString(GameMode mode);
+
+	enum class DynamicControllerType {
+		PID,
+		PREDICTIVE,
+	};
+	DynamicControllerType DynamicControllerFromString(std::string s);
+	std::string DynamicControllerToString(DynamicControllerType type);
 }
@@ -0,0 +1,316 @@
+#include "vrs_pattern.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VRS_PATTERN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define VRS_PATTERN_AVX2
+#else
+#define VRS_PATTERN_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace vrperfkit {
+	namespace {
+		// patterns with fewer tiles are generated faster than a thread can be started
+		const size_t MULTITHREAD_MIN_TILES = 1 << 19;
+		const int MIN_ROWS_PER_THREAD = 64;
+
+		using FillFn = void (*)(uint8_t *out, const float *columnDistSq, int count, float rowDistSq, const float *thresholds);
+
+		inline uint8_t Level(float distSq, const float *thresholds) {
+			if (distSq < thresholds[0]) {
+				return 0;
+			}
+			if (distSq < thresholds[1]) {
+				return 1;
+			}
+			if (distSq < thresholds[2]) {
+				return 2;
+			}
+			return 3;
+		}
+
+		void FillScalar(uint8_t *out, const float *columnDistSq, int count, float rowDistSq, const float *thresholds) {
+			for (int x = 0; x < count; ++x) {
+				out[x] = Level(columnDistSq[x] + rowDistSq, thresholds);
+			}
+		}
+
+#ifdef VRS_PATTERN_X86
+		// The level is the number of rings the tile lies outside of. A ring only counts if all inner ones
+		// do as well, so that the result matches Level even if the radii are not ordered.
+		// Comparison masks are all ones (-1), so subtracting them counts the rings.
+		inline __m128i Levels4(__m128 distSq, __m128 inner, __m128 mid, __m128 outer) {
+			__m128i c0 = _mm_castps_si128(_mm_cmpge_ps(distSq, inner));
+			__m128i c1 = _mm_and_si128(c0, _mm_castps_si128(_mm_cmpge_ps(distSq, mid)));
+			__m128i c2 = _mm_and_si128(c1, _mm_castps_si128(_mm_cmpge_ps(distSq, outer)));
+			return _mm_sub_epi32(_mm_sub_epi32(_mm_sub_epi32(_mm_setzero_si128(), c0), c1), c2);
+		}
+
+		void FillSse2(uint8_t *out, const float *columnDistSq, int count, float rowDistSq, const float *thresholds) {
+			__m128 dy = _mm_set1_ps(rowDistSq);
+			__m128 inner = _mm_set1_ps(thresholds[0]);
+			__m128 mid = _mm_set1_ps(thresholds[1]);
+			__m128 outer = _mm_set1_ps(thresholds[2]);
+
+			int x = 0;
+			for (; x + 16 <= count; x += 16) {
+				__m128i a = Levels4(_mm_add_ps(_mm_loadu_ps(columnDistSq + x), dy), inner, mid, outer);
+				__m128i b = Levels4(_mm_add_ps(_mm_loadu_ps(columnDistSq + x + 4), dy), inner, mid, outer);
+				__m128i c = Levels4(_mm_add_ps(_mm_loadu_ps(columnDistSq + x + 8), dy), inner, mid, outer);
+				__m128i d = Levels4(_mm_add_ps(_mm_loadu_ps(columnDistSq + x + 12), dy), inner, mid, outer);
+				__m128i levels = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+				_mm_storeu_si128((__m128i*)(out + x), levels);
+			}
+			FillScalar(out + x, columnDistSq + x, count - x, rowDistSq, thresholds);
+		}
+
+		VRS_PATTERN_AVX2 inline __m256i Levels8(__m256 distSq, __m256 inner, __m256 mid, __m256 outer) {
+			__m256i c0 = _mm256_castps_si256(_mm256_cmp_ps(distSq, inner, _CMP_GE_OQ));
+			__m256i c1 = _mm256_and_si256(c0, _mm256_castps_si256(_mm256_cmp_ps(distSq, mid, _CMP_GE_OQ)));
+			__m256i c2 = _mm256_and_si256(c1, _mm256_castps_si256(_mm256_cmp_ps(distSq, outer, _CMP_GE_OQ)));
+			return _mm256_sub_epi32(_mm256_sub_epi32(_mm256_sub_epi32(_mm256_setzero_si256(), c0), c1), c2);
+		}
+
+		VRS_PATTERN_AVX2 void FillAvx2(uint8_t *out, const float *columnDistSq, int count, float rowDistSq, const float *thresholds) {
+			__m256 dy = _mm256_set1_ps(rowDistSq);
+			__m256 inner = _mm256_set1_ps(thresholds[0]);
+			__m256 mid = _mm256_set1_ps(thresholds[1]);
+			__m256 outer = _mm256_set1_ps(thresholds[2]);
+			// the packs work within 128-bit lanes, this puts the 4-byte groups back in order
+			__m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+			int x = 0;
+			for (; x + 32 <= count; x += 32) {
+				__m256i a = Levels8(_mm256_add_ps(_mm256_loadu_ps(columnDistSq + x), dy), inner, mid, outer);
+				__m256i b = Levels8(_mm256_add_ps(_mm256_loadu_ps(columnDistSq + x + 8), dy), inner, mid, outer);
+				__m256i c = Levels8(_mm256_add_ps(_mm256_loadu_ps(columnDistSq + x + 16), dy), inner, mid, outer);
+				__m256i d = Levels8(_mm256_add_ps(_mm256_loadu_ps(columnDistSq + x + 24), dy), inner, mid, outer);
+				__m256i levels = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+				_mm256_storeu_si256((__m256i*)(out + x), _mm256_permutevar8x32_epi32(levels, order));
+			}
+			FillSse2(out + x, columnDistSq + x, count - x, rowDistSq, thresholds);
+		}
+
+		bool CpuSupportsAvx2() {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+		FillFn SelectKernel(const char **name) {
+#ifdef VRS_PATTERN_X86
+			if (CpuSupportsAvx2()) {
+				*name = "AVX2";
+				return FillAvx2;
+			}
+			*name = "SSE2";
+			return FillSse2;
+#else
+			*name = "scalar";
+			return FillScalar;
+#endif
+		}
+
+		const char *g_kernelName = "";
+		const FillFn g_fill = SelectKernel(&g_kernelName);
+
+		float Quantize(float value, float step) {
+			return std::round(value / step) * step;
+		}
+
+		// the original pattern compared 2 * sqrt(distSq) against the radius
+		float ThresholdFromRadius(float radius) {
+			return radius > 0 ? 0.25f * radius * radius : -1.f;
+		}
+	}
+
+	bool VrsPatternGenerator::Key::operator==(const Key &other) const {
+		return width == other.width && height == other.height && combined == other.combined
+			&& std::equal(proj, proj + 4, other.proj);
+	}
+
+	const char *VrsPatternGenerator::KernelName() {
+		return g_kernelName;
+	}
+
+	void VrsPatternGenerator::EnableCache(float radiusStep, size_t maxPatterns) {
+		cacheRadiusStep = maxPatterns > 0 ? radiusStep : 0;
+		cacheCapacity = radiusStep > 0 ? maxPatterns : 0;
+		cache.clear();
+	}
+
+	const std::vector<uint8_t> &VrsPatternGenerator::SingleEye(int width, int height, float projX, float projY, const VrsPatternRadii &radii) {
+		Key newKey;
+		newKey.width = width;
+		newKey.height = height;
+		newKey.proj[0] = projX;
+		newKey.proj[1] = projY;
+		return GenerateCached(newKey, radii);
+	}
+
+	const std::vector<uint8_t> &VrsPatternGenerator::Combined(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY, const VrsPatternRadii &radii) {
+		Key newKey;
+		newKey.width = width;
+		newKey.height = height;
+		newKey.combined = true;
+		newKey.proj[0] = leftProjX;
+		newKey.proj[1] = leftProjY;
+		newKey.proj[2] = rightProjX;
+		newKey.proj[3] = rightProjY;
+		return GenerateCached(newKey, radii);
+	}
+
+	const std::vector<uint8_t> &VrsPatternGenerator::GenerateCached(const Key &newKey, const VrsPatternRadii &newRadii) {
+		if (cacheCapacity == 0) {
+			return Generate(newKey, newRadii);
+		}
+
+		if (!(newKey == key)) {
+			cache.clear();
+		}
+
+		VrsPatternRadii quantized;
+		quantized.inner = Quantize(newRadii.inner, cacheRadiusStep);
+		quantized.mid = Quantize(newRadii.mid, cacheRadiusStep);
+		quantized.outer = Quantize(newRadii.outer, cacheRadiusStep);
+
+		for (CachedPattern &entry : cache) {
+			if (entry.radii == quantized) {
+				entry.lastUse = ++cacheUseCounter;
+				return entry.pattern;
+			}
+		}
+
+		Generate(newKey, quantized);
+
+		if (cache.size() < cacheCapacity) {
+			cache.emplace_back();
+		}
+		else {
+			auto lru = std::min_element(cache.begin(), cache.end(), [](const CachedPattern &a, const CachedPattern &b) { return a.lastUse < b.lastUse; });
+			std::rotate(lru, lru + 1, cache.end());
+		}
+		CachedPattern &entry = cache.back();
+		entry.radii = quantized;
+		entry.lastUse = ++cacheUseCounter;
+		entry.pattern = pattern;
+		return entry.pattern;
+	}
+
+	const std::vector<uint8_t> &VrsPatternGenerator::Generate(const Key &newKey, const VrsPatternRadii &newRadii) {
+		if (valid && newKey == key && newRadii == radii) {
+			return pattern;
+		}
+
+		bool rebuildTables = !valid || !(newKey == key);
+		key = newKey;
+		radii = newRadii;
+		valid = true;
+
+		if (key.width <= 0 || key.height <= 0) {
+			pattern.clear();
+			return pattern;
+		}
+
+		if (rebuildTables) {
+			BuildDistanceTables();
+		}
+		pattern.resize((size_t)key.width * key.height);
+
+		float thresholds[3] = { ThresholdFromRadius(radii.inner), ThresholdFromRadius(radii.mid), ThresholdFromRadius(radii.outer) };
+
+		int threadCount = 1;
+		if (multithreading && pattern.size() >= MULTITHREAD_MIN_TILES) {
+			threadCount = std::min((int)std::thread::hardware_concurrency(), key.height / MIN_ROWS_PER_THREAD);
+		}
+
+		if (threadCount <= 1) {
+			FillRows(0, key.height, thresholds);
+			return pattern;
+		}
+
+		std::vector<std::thread> threads;
+		int rowsPerThread = (key.height + threadCount - 1) / threadCount;
+		for (int first = rowsPerThread; first < key.height; first += rowsPerThread) {
+			int last = std::min(first + rowsPerThread, key.height);
+			threads.emplace_back([this, first, last, &thresholds]() { FillRows(first, last, thresholds); });
+		}
+		FillRows(0, rowsPerThread, thresholds);
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		return pattern;
+	}
+
+	void VrsPatternGenerator::BuildDistanceTables() {
+		int width = key.width;
+		int height = key.height;
+		columnDistSq.resize(width);
+		rowDistSq[0].resize(height);
+		rowDistSq[1].resize(height);
+
+		// same coordinate math as the original per-tile evaluation, just hoisted out of the inner loop
+		if (key.combined) {
+			int halfWidth = width / 2;
+			for (int x = 0; x < halfWidth; ++x) {
+				float dx = float(x) / halfWidth - key.proj[0];
+				columnDistSq[x] = dx * dx;
+			}
+			for (int x = halfWidth; x < width; ++x) {
+				float dx = float(x - halfWidth) / halfWidth - key.proj[2];
+				columnDistSq[x] = dx * dx;
+			}
+		}
+		else {
+			for (int x = 0; x < width; ++x) {
+				float dx = float(x) / width - key.proj[0];
+				columnDistSq[x] = dx * dx;
+			}
+		}
+
+		for (int eye = 0; eye < 2; ++eye) {
+			float projY = key.combined ? key.proj[2 * eye + 1] : key.proj[1];
+			for (int y = 0; y < height; ++y) {
+				float dy = float(y) / height - projY;
+				rowDistSq[eye][y] = dy * dy;
+			}
+		}
+	}
+
+	void VrsPatternGenerator::FillRows(int firstRow, int lastRow, const float *thresholds) {
+		int width = key.width;
+		int leftWidth = key.combined ? width / 2 : width;
+		uint8_t *out = pattern.data();
+		FillFn fill = forceScalar ? FillScalar : g_fill;
+
+		for (int y = firstRow; y < lastRow; ++y) {
+			uint8_t *row = out + (size_t)y * width;
+			fill(row, columnDistSq.data(), leftWidth, rowDistSq[0][y], thresholds);
+			if (leftWidth < width) {
+				fill(row + leftWidth, columnDistSq.data() + leftWidth, width - leftWidth, rowDistSq[1][y], thresholds);
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vrperfkit {
+	// radii of the foveation rings, as fractions of the eye's half extent
+	struct VrsPatternRadii {
+		float inner = 0.50f;
+		float mid = 0.65f;
+		float outer = 0.80f;
+
+		bool operator==(const VrsPatternRadii &other) const {
+			return inner == other.inner && mid == other.mid && outer == other.outer;
+		}
+	};
+
+	// Generates the per-tile shading rate levels (0 = full rate ... 3 = lowest rate) of a fixed
+	// foveated VRS pattern. Keeps its buffers between calls, so regenerating a pattern of the same
+	// size only touches memory that is already allocated, and if only the radii changed the
+	// per-column and per-row distance tables are reused.
+	// With the pattern cache enabled, radii are rounded to a fixed step and the patterns generated for
+	// them are kept, so that radii a dynamic controller keeps returning to cost only a lookup.
+	// Returned patterns stay valid until the next call.
+	// Does not depend on any graphics API, see tools/vrs_pattern_bench.
+	class VrsPatternGenerator {
+	public:
+		// one eye covering the whole pattern
+		const std::vector<uint8_t> &SingleEye(int width, int height, float projX, float projY, const VrsPatternRadii &radii);
+		// left eye in the left half, right eye in the right half
+		const std::vector<uint8_t> &Combined(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY, const VrsPatternRadii &radii);
+
+		const std::vector<uint8_t> &Pattern() const { return pattern; }
+
+		// allow or forbid splitting large patterns across threads, mostly for benchmarking
+		void SetMultithreading(bool enabled) { multithreading = enabled; }
+		// use the plain C++ kernel even if the CPU supports a faster one
+		void SetForceScalar(bool enabled) { forceScalar = enabled; }
+
+		// keep up to maxPatterns patterns for radii rounded to multiples of radiusStep, 0 disables the cache
+		void EnableCache(float radiusStep, size_t maxPatterns);
+
+		static const char *KernelName();
+
+	private:
+		struct Key {
+			int width = 0;
+			int height = 0;
+			bool combined = false;
+			float proj[4] = { 0, 0, 0, 0 };
+
+			bool operator==(const Key &other) const;
+		};
+
+		struct CachedPattern {
+			VrsPatternRadii radii;
+			uint64_t lastUse = 0;
+			std::vector<uint8_t> pattern;
+		};
+
+		Key key;
+		VrsPatternRadii radii;
+		float cacheRadiusStep = 0;
+		size_t cacheCapacity = 0;
+		uint64_t cacheUseCounter = 0;
+		std::vector<CachedPattern> cache;
+		bool valid = false;
+		bool multithreading = true;
+		bool forceScalar = false;
+		std::vector<uint8_t> pattern;
+		// squared horizontal distance to the projection center for every column
+		std::vector<float> columnDistSq;
+		// squared vertical distance to the projection center for every row, per eye
+		std::vector<float> rowDistSq[2];
+
+		const std::vector<uint8_t> &Generate(const Key &newKey, const VrsPatternRadii &newRadii);
+		const std::vector<uint8_t> &GenerateCached(const Key &newKey, const VrsPatternRadii &newRadii);
+		void BuildDistanceTables();
+		void FillRows(int firstRow, int lastRow, const float *thresholds);
+	};
+}
@@ -0,0 +1,183 @@
+// Steps the dynamic controllers through frame time traces generated from a simple cost model,
+// frameTime = base + cost * value plus noise, and checks that they bring an overloaded game back
+// below the target, give back quality when there is headroom, hold still inside the hysteresis band,
+// follow a change of load and never leave their limits or step further than allowed.
+#include "dynamic_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace vrperfkit;
+
+namespace {
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		if (g_failures < 20) {
+			std::printf("FAILED: %s\n", message.c_str());
+		}
+		++g_failures;
+	}
+
+	struct CostModel {
+		float base;
+		float cost;
+		// relative amplitude of the uniform noise on each frame time
+		float noise;
+	};
+
+	struct TraceResult {
+		float finalValue = 0;
+		// over the last frames of the trace
+		float meanFrameTime = 0;
+		float aboveTargetFraction = 0;
+		int directionChanges = 0;
+	};
+
+	const DynamicControllerType TYPES[] = { DynamicControllerType::PID, DynamicControllerType::PREDICTIVE };
+
+	const char *TypeName(DynamicControllerType type) {
+		return type == DynamicControllerType::PID ? "pid" : "predictive";
+	}
+
+	DynamicControllerSettings DefaultSettings() {
+		DynamicControllerSettings settings;
+		settings.targetFrameTime = 0.0167f;
+		settings.marginFrameTime = 0.0154f;
+		settings.minValue = 0.f;
+		settings.maxValue = 1.f;
+		return settings;
+	}
+
+	// runs the controller for the given number of frames, the statistics cover the last `tail` of them
+	TraceResult RunTrace(DynamicController &controller, const CostModel &model, float &value, int frames, int tail, std::mt19937 &rng, const std::string &name) {
+		const DynamicControllerSettings &settings = controller.Settings();
+		std::uniform_real_distribution<float> noise (-model.noise, model.noise);
+		TraceResult result;
+		float previousStep = 0;
+		int aboveTarget = 0;
+		double sumFrameTime = 0;
+
+		for (int frame = 0; frame < frames; ++frame) {
+			float frameTime = (model.base + model.cost * value) * (1.f + noise(rng));
+			float next = controller.Update(frameTime, value);
+			float step = next - value;
+
+			if (next < settings.minValue || next > settings.maxValue || !std::isfinite(next)) {
+				Fail(name + ": value " + std::to_string(next) + " outside of its limits");
+			}
+			if (step < -settings.maxDecreaseStep - 1e-6f || step > settings.maxIncreaseStep + 1e-6f) {
+				Fail(name + ": step " + std::to_string(step) + " exceeds the configured maximum");
+			}
+
+			if (frame >= frames - tail) {
+				sumFrameTime += frameTime;
+				if (frameTime > settings.targetFrameTime) {
+					++aboveTarget;
+				}
+				if (step != 0 && previousStep != 0 && (step > 0) != (previousStep > 0)) {
+					++result.directionChanges;
+				}
+			}
+			if (step != 0) {
+				previousStep = step;
+			}
+			value = next;
+		}
+
+		result.finalValue = value;
+		result.meanFrameTime = float(sumFrameTime / tail);
+		result.aboveTargetFraction = float(aboveTarget) / tail;
+		return result;
+	}
+
+	void CheckOverload(DynamicControllerType type, std::mt19937 &rng) {
+		// needs a value below ~0.67 to reach the target
+		auto controller = CreateDynamicController(type, DefaultSettings());
+		float value = 1.f;
+		TraceResult result = RunTrace(*controller, { 0.010f, 0.010f, 0.02f }, value, 600, 200, rng, std::string(TypeName(type)) + " overload");
+		if (result.meanFrameTime > controller->Settings().targetFrameTime) {
+			Fail(std::string(TypeName(type)) + ": overloaded trace settled at " + std::to_string(result.meanFrameTime * 1000) + " ms, above the target");
+		}
+		if (result.aboveTargetFraction > 0.2f) {
+			Fail(std::string(TypeName(type)) + ": " + std::to_string(result.aboveTargetFraction * 100) + "% of settled frames above the target");
+		}
+		if (result.finalValue < 0.3f) {
+			Fail(std::string(TypeName(type)) + ": gave up more quality than needed, value " + std::to_string(result.finalValue));
+		}
+		if (result.directionChanges > 20) {
+			Fail(std::string(TypeName(type)) + ": value oscillates, " + std::to_string(result.directionChanges) + " direction changes");
+		}
+	}
+
+	void CheckHeadroom(DynamicControllerType type, std::mt19937 &rng) {
+		auto controller = CreateDynamicController(type, DefaultSettings());
+		float value = 0.f;
+		TraceResult result = RunTrace(*controller, { 0.008f, 0.004f, 0.02f }, value, 400, 100, rng, std::string(TypeName(type)) + " headroom");
+		if (result.finalValue < controller->Settings().maxValue) {
+			Fail(std::string(TypeName(type)) + ": didn't restore full quality with headroom, value " + std::to_string(result.finalValue));
+		}
+	}
+
+	void CheckHold(DynamicControllerType type, std::mt19937 &rng) {
+		// the frame time stays inside the hysteresis band whatever the value
+		auto controller = CreateDynamicController(type, DefaultSettings());
+		float value = 0.5f;
+		RunTrace(*controller, { 0.0160f, 0.f, 0.f }, value, 300, 100, rng, std::string(TypeName(type)) + " hold");
+		if (value != 0.5f) {
+			Fail(std::string(TypeName(type)) + ": changed the value inside the hysteresis band to " + std::to_string(value));
+		}
+	}
+
+	void CheckLoadChange(DynamicControllerType type, std::mt19937 &rng) {
+		auto controller = CreateDynamicController(type, DefaultSettings());
+		std::string name = std::string(TypeName(type)) + " load change";
+		float value = 1.f;
+		RunTrace(*controller, { 0.010f, 0.010f, 0.02f }, value, 400, 100, rng, name);
+		// the game gets heavier, now needs a value below ~0.27
+		TraceResult heavier = RunTrace(*controller, { 0.014f, 0.010f, 0.02f }, value, 400, 100, rng, name);
+		if (heavier.meanFrameTime > controller->Settings().targetFrameTime) {
+			Fail(std::string(TypeName(type)) + ": didn't follow a heavier load, settled at " + std::to_string(heavier.meanFrameTime * 1000) + " ms");
+		}
+		// and lighter again
+		TraceResult lighter = RunTrace(*controller, { 0.008f, 0.004f, 0.02f }, value, 400, 100, rng, name);
+		if (lighter.finalValue < controller->Settings().maxValue) {
+			Fail(std::string(TypeName(type)) + ": didn't restore quality once the load dropped, value " + std::to_string(lighter.finalValue));
+		}
+	}
+
+	void CheckReset(DynamicControllerType type, std::mt19937 &rng) {
+		auto controller = CreateDynamicController(type, DefaultSettings());
+		float value = 1.f;
+		RunTrace(*controller, { 0.010f, 0.010f, 0.f }, value, 100, 10, rng, std::string(TypeName(type)) + " reset");
+		controller->Reset();
+		auto fresh = CreateDynamicController(type, DefaultSettings());
+		for (float frameTime : { 0.015f, 0.018f, 0.020f, 0.014f }) {
+			if (controller->Update(frameTime, 0.5f) != fresh->Update(frameTime, 0.5f)) {
+				Fail(std::string(TypeName(type)) + ": behaves differently after a reset than a new controller");
+				break;
+			}
+		}
+	}
+}
+
+int main() {
+	std::mt19937 rng (2);
+	for (DynamicControllerType type : TYPES) {
+		CheckOverload(type, rng);
+		CheckHeadroom(type, rng);
+		CheckHold(type, rng);
+		CheckLoadChange(type, rng);
+		CheckReset(type, rng);
+	}
+
+	if (g_failures > 0) {
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
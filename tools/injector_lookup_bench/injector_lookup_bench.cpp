@@ -0,0 +1,154 @@
+// Measures the per-call overhead a hooked context method pays for finding its injector, using a mock
+// context whose private data behaves like the D3D runtime's: a lock around a search through the
+// attached entries. The hooks mirror the ones in d3d12_injector.cpp, minus the actual work.
+#include "context_registry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+using namespace vrperfkit;
+
+namespace {
+	struct Guid {
+		uint32_t data[4];
+	};
+	const Guid INJECTOR_GUID = { 0xc0d7b492, 0x1bfb4099, 0x9c677144, 0xe1f586ed };
+	// games and runtimes attach debug names and the like, so ours is rarely the only entry
+	const Guid OTHER_GUIDS[] = {
+		{ 0x429b8c22, 0x9188473b, 0xbdbbac47, 0xa1da0001 },
+		{ 0x429b8c22, 0x9188473b, 0xbdbbac47, 0xa1da0002 },
+		{ 0x429b8c22, 0x9188473b, 0xbdbbac47, 0xa1da0003 },
+	};
+
+	class MockContext {
+	public:
+		void SetPrivateData(const Guid &guid, uint32_t size, const void *data) {
+			std::lock_guard<std::mutex> lock (mutex);
+			Entry entry;
+			entry.guid = guid;
+			entry.data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+			entries.push_back(entry);
+		}
+
+		NOINLINE bool GetPrivateData(const Guid &guid, uint32_t *size, void *data) {
+			std::lock_guard<std::mutex> lock (mutex);
+			for (const Entry &entry : entries) {
+				if (std::memcmp(&entry.guid, &guid, sizeof(Guid)) == 0) {
+					if (*size < entry.data.size()) {
+						return false;
+					}
+					std::memcpy(data, entry.data.data(), entry.data.size());
+					*size = (uint32_t)entry.data.size();
+					return true;
+				}
+			}
+			*size = 0;
+			return false;
+		}
+
+		uint64_t calls = 0;
+
+	private:
+		struct Entry {
+			Guid guid;
+			std::vector<uint8_t> data;
+		};
+		std::mutex mutex;
+		std::vector<Entry> entries;
+	};
+
+	struct MockInjector {
+		uint64_t notified = 0;
+
+		NOINLINE bool PrePSSetSamplers(uint32_t) {
+			++notified;
+			return false;
+		}
+	};
+
+	using PSSetSamplersFn = void (*)(MockContext *self, uint32_t startSlot);
+
+	// stands in for the original method the hook trampoline jumps back to
+	NOINLINE void Original_PSSetSamplers(MockContext *self, uint32_t startSlot) {
+		self->calls += startSlot;
+	}
+	PSSetSamplersFn volatile g_original = &Original_PSSetSamplers;
+
+	ContextRegistry<MockInjector> g_registry;
+
+	MockInjector *LookupPrivateData(MockContext *context) {
+		MockInjector *injector = nullptr;
+		uint32_t size = sizeof(injector);
+		context->GetPrivateData(INJECTOR_GUID, &size, &injector);
+		return injector;
+	}
+
+	NOINLINE void Hook_PrivateData(MockContext *self, uint32_t startSlot) {
+		MockInjector *injector = LookupPrivateData(self);
+		if (injector != nullptr && injector->PrePSSetSamplers(startSlot)) {
+			return;
+		}
+		g_original(self, startSlot);
+	}
+
+	NOINLINE void Hook_Registry(MockContext *self, uint32_t startSlot) {
+		MockInjector *injector = g_registry.Lookup(self);
+		if (injector != nullptr && injector->PrePSSetSamplers(startSlot)) {
+			return;
+		}
+		g_original(self, startSlot);
+	}
+
+	// the game calls through the vtable, which the hook has replaced
+	double MeasureNanoseconds(PSSetSamplersFn volatile fn, MockContext **contexts, int contextCount) {
+		const int CALLS = 20000000;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CALLS; ++i) {
+			fn(contexts[i % contextCount], 1);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / CALLS;
+	}
+}
+
+int main() {
+	MockContext immediate;
+	MockContext deferred;
+	MockInjector injector;
+
+	MockInjector *instance = &injector;
+	for (const Guid &guid : OTHER_GUIDS) {
+		uint32_t value = 0;
+		immediate.SetPrivateData(guid, sizeof(value), &value);
+	}
+	immediate.SetPrivateData(INJECTOR_GUID, sizeof(instance), &instance);
+	g_registry.Register(&immediate, &injector);
+
+	MockContext *immediateOnly[] = { &immediate };
+	MockContext *mixed[] = { &immediate, &deferred };
+
+	double baseline = MeasureNanoseconds(g_original, immediateOnly, 1);
+	double privateData = MeasureNanoseconds(&Hook_PrivateData, immediateOnly, 1);
+	double registry = MeasureNanoseconds(&Hook_Registry, immediateOnly, 1);
+	double privateDataMixed = MeasureNanoseconds(&Hook_PrivateData, mixed, 2);
+	double registryMixed = MeasureNanoseconds(&Hook_Registry, mixed, 2);
+
+	std::printf("Per call, including the original method:\n");
+	std::printf("  unhooked                          %6.2f ns\n", baseline);
+	std::printf("  hook, GetPrivateData lookup       %6.2f ns\n", privateData);
+	std::printf("  hook, registry lookup             %6.2f ns\n", registry);
+	std::printf("Alternating immediate and deferred context:\n");
+	std::printf("  hook, GetPrivateData lookup       %6.2f ns\n", privateDataMixed);
+	std::printf("  hook, registry lookup             %6.2f ns\n", registryMixed);
+
+	// keep the calls from being optimized away
+	return (immediate.calls + deferred.calls + injector.notified) == 0 ? 1 : 0;
+}
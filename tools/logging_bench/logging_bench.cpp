@@ -0,0 +1,143 @@
+// Measures what LOG_INFO costs the logging thread while several threads log at once, and checks
+// that the writer gets every message into the file intact, in order per thread. The paced run
+// logs in short bursts like the game's threads do; the flat out run fills the rings faster than
+// the writer empties them, so that some messages are dropped instead of stalling the caller.
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace vrperfkit;
+
+namespace {
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		if (g_failures < 20) {
+			std::printf("FAILED: %s\n", message.c_str());
+		}
+		++g_failures;
+	}
+
+	const int MESSAGES_PER_THREAD = 20000;
+
+	struct RunResult {
+		double nanosecondsPerMessage = 0;
+		int written = 0;
+		int dropped = 0;
+	};
+
+	std::string Nested(int thread, int i) {
+		LOG_INFO << "inner " << thread << " " << i;
+		return "outer";
+	}
+
+	RunResult Run(const fs::path &path, int threadCount, bool paced) {
+		OpenLogFile(path);
+
+		std::atomic<int64_t> totalNanoseconds { 0 };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t) {
+			threads.emplace_back([&, t]() {
+				std::chrono::steady_clock::duration elapsed {};
+				for (int i = 0; i < MESSAGES_PER_THREAD;) {
+					auto start = std::chrono::steady_clock::now();
+					for (int burst = 0; burst < 32 && i < MESSAGES_PER_THREAD; ++burst, ++i) {
+						if (i % 1000 == 0) {
+							LOG_INFO << Nested(t, i) << " " << t << " " << i;
+						}
+						else {
+							LOG_INFO << "message " << t << " " << i << " frame time " << 11.1f + i % 7 << " ms, scale " << 0.83667f;
+						}
+					}
+					elapsed += std::chrono::steady_clock::now() - start;
+					if (paced) {
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				}
+				totalNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+			});
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		CloseLogFile(false);
+
+		RunResult result;
+		result.nanosecondsPerMessage = double(totalNanoseconds) / (double(threadCount) * MESSAGES_PER_THREAD);
+
+		// every line is "HH:MM:SS [thread id] text"
+		std::ifstream file (path);
+		std::string line;
+		std::map<int, int> lastIndex;
+		while (std::getline(file, line)) {
+			// apart from the writer's "(!) N log messages of thread X were dropped"
+			if (line.compare(0, 4, "(!) ") == 0) {
+				result.dropped += std::stoi(line.substr(4));
+				continue;
+			}
+			size_t textStart = line.find("] ");
+			if (textStart == std::string::npos) {
+				Fail("malformed line: " + line);
+				continue;
+			}
+			std::istringstream text (line.substr(textStart + 2));
+			std::string word;
+			int thread, index;
+			text >> word;
+			if (!(text >> thread >> index) || (word != "message" && word != "inner" && word != "outer")) {
+				Fail("malformed line: " + line);
+				continue;
+			}
+			++result.written;
+			// the inner message of a nested pair is committed first, but stamped after the outer one
+			if (word == "inner") {
+				continue;
+			}
+			auto last = lastIndex.find(thread);
+			if (last != lastIndex.end() && last->second >= index) {
+				Fail("messages of thread " + std::to_string(thread) + " out of order: " + line);
+			}
+			lastIndex[thread] = index;
+		}
+
+		int expected = threadCount * (MESSAGES_PER_THREAD + MESSAGES_PER_THREAD / 1000);
+		if (result.written + result.dropped != expected) {
+			Fail(std::to_string(result.written) + " messages written and " + std::to_string(result.dropped) + " dropped, expected " + std::to_string(expected));
+		}
+		if (paced && result.dropped > 0) {
+			Fail(std::to_string(result.dropped) + " messages dropped while logging in bursts");
+		}
+		return result;
+	}
+}
+
+int main() {
+	fs::path path = fs::temp_directory_path() / "logging_bench.log";
+
+	for (bool paced : { true, false }) {
+		std::printf("%s:\n", paced ? "Bursts of 32 messages every millisecond" : "Flat out");
+		for (int threads : { 1, 2, 4, 8 }) {
+			RunResult result = Run(path, threads, paced);
+			std::printf("  %d threads  %7.1f ns per message, %6d written, %6d dropped\n",
+				threads, result.nanosecondsPerMessage, result.written, result.dropped);
+		}
+	}
+	fs::remove(path);
+
+	if (g_failures > 0) {
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+// Just the parts of src/config.h that logging.h uses, replacing it in the benchmark build.
+#include <ctime>
+#include <string>
+
+namespace vrperfkit {
+	enum class UpscaleMethod { NIS };
+	enum class GameMode { AUTO };
+
+	inline std::string MethodToString(UpscaleMethod) { return "NIS"; }
+	inline std::string GameModeToString(GameMode) { return "auto"; }
+
+	struct Config {
+		bool debugMode = false;
+	};
+	inline Config g_config;
+}
+
+#ifndef _WIN32
+// the MSVC variant logging.cpp uses
+inline int localtime_s(tm *result, const time_t *time) {
+	return localtime_r(time, result) != nullptr ? 0 : 1;
+}
+#endif
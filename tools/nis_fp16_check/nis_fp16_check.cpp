@@ -0,0 +1,437 @@
+// CPU reference of the NIS upscale shader (NVScaler in NIS_Scaler.h), run once at full precision and once
+// with the values the HALF_PRECISION permutation keeps at 16 bit (the luma tile, the filter coefficients and
+// the edge map) rounded to half floats. Bounds the difference this makes to the output on synthetic images
+// covering gradients, edges at all angles, fine detail and noise, at the scale factors the mod uses.
+// The filtering itself must stay within two 8 bit steps (maximum sharpening amplifies the rounding) and is
+// mostly far below one. The edge detection is a threshold decision, which the rounded luma flips for a few
+// pixels right at a threshold, just as any slight change of the input would. Those pixels pick a different
+// directional filter, which on a hard edge can move them by dozens of steps, more the stronger the
+// sharpening. So for the full half precision path the check bounds the maximum error depending on the
+// sharpness, the 99.9th percentile, and how many values move by more than a step.
+#include "nis/NIS_Config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+	// largest difference per output channel from half precision filtering, in 8 bit steps
+	const float MAX_FILTER_ERROR = 2.f;
+	// largest difference per output channel with half precision edge detection, in 8 bit steps,
+	// MAX_TOTAL_ERROR_BASE + MAX_TOTAL_ERROR_PER_SHARPNESS * sharpness
+	const float MAX_TOTAL_ERROR_BASE = 24.f;
+	const float MAX_TOTAL_ERROR_PER_SHARPNESS = 72.f;
+	// 99.9th percentile of the differences with half precision edge detection, in 8 bit steps
+	const float MAX_TOTAL_P999_ERROR = 6.f;
+	// share of output values that may move by more than one 8 bit step with half precision edge detection
+	const double MAX_FLIPPED_SHARE = 0.01;
+	const int SHADER_FILTER_SIZE = 6;
+	const int PHASE_COUNT = (int)kPhaseCount;
+
+	// rounds to the nearest half float, including subnormals, as a conversion to min16float would
+	float RoundToHalf(float value) {
+		if (value == 0 || !std::isfinite(value)) {
+			return value;
+		}
+		int exponent;
+		std::frexp(value, &exponent);
+		// 11 significant bits, and nothing finer than the smallest subnormal
+		float quantum = std::ldexp(1.f, std::max(exponent - 11, -24));
+		return std::nearbyint(value / quantum) * quantum;
+	}
+
+	struct Float4 {
+		float x = 0, y = 0, z = 0, w = 0;
+	};
+
+	float Lerp(float a, float b, float t) {
+		return a + (b - a) * t;
+	}
+
+	Float4 Lerp(const Float4 &a, const Float4 &b, float t) {
+		return { Lerp(a.x, b.x, t), Lerp(a.y, b.y, t), Lerp(a.z, b.z, t), Lerp(a.w, b.w, t) };
+	}
+
+	float Saturate(float value) {
+		return std::min(1.f, std::max(0.f, value));
+	}
+
+	struct Image {
+		int width = 0;
+		int height = 0;
+		std::vector<float> rgb;
+
+		Image(int width, int height) : width(width), height(height), rgb(3 * width * height) {}
+
+		float *At(int x, int y) {
+			return &rgb[3 * (y * width + x)];
+		}
+
+		// clamp addressing, like the shader's sampler
+		const float *At(int x, int y) const {
+			x = std::min(width - 1, std::max(0, x));
+			y = std::min(height - 1, std::max(0, y));
+			return &rgb[3 * (y * width + x)];
+		}
+	};
+
+	float Luma(const float *rgb) {
+		return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+	}
+
+	enum class Precision {
+		FULL,
+		// the edge map is detected at full precision, everything else as in HALF
+		HALF_FILTERING,
+		HALF,
+	};
+
+	class NisReference {
+	public:
+		NisReference(const NISConfig &config, Precision precision) : config(config), precision(precision) {
+			for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+				for (int i = 0; i < SHADER_FILTER_SIZE; ++i) {
+					coefScaler[phase][i] = Store(coef_scale[phase][i]);
+					coefUsm[phase][i] = Store(coef_usm[phase][i]);
+				}
+			}
+		}
+
+		void Upscale(const Image &input, Image &output) const {
+			for (int y = 0; y < output.height; ++y) {
+				for (int x = 0; x < output.width; ++x) {
+					UpscalePixel(input, x, y, output.At(x, y));
+				}
+			}
+		}
+
+	private:
+		const NISConfig &config;
+		Precision precision;
+		float coefScaler[kPhaseCount][SHADER_FILTER_SIZE];
+		float coefUsm[kPhaseCount][SHADER_FILTER_SIZE];
+
+		// what a value comes back as after being kept in an NVH variable
+		float Store(float value) const {
+			return precision != Precision::FULL ? RoundToHalf(value) : value;
+		}
+
+		float StoreEdge(float value) const {
+			return precision == Precision::HALF ? RoundToHalf(value) : value;
+		}
+
+		// shPixelsY
+		float TileLuma(const Image &input, int x, int y) const {
+			return Store(Luma(input.At(x, y)));
+		}
+
+		// shEdgeMap, from the 3x3 luma neighbourhood centred on the given texel
+		Float4 EdgeMap(const Image &input, int x, int y) const {
+			float p[3][3];
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					p[i][j] = StoreEdge(Luma(input.At(x - 1 + j, y - 1 + i)));
+				}
+			}
+			Float4 edge = GetEdgeMap(p);
+			return { StoreEdge(edge.x), StoreEdge(edge.y), StoreEdge(edge.z), StoreEdge(edge.w) };
+		}
+
+		Float4 GetEdgeMap(const float p[3][3]) const {
+			const float g_0 = std::abs(p[0][0] + p[0][1] + p[0][2] - p[2][0] - p[2][1] - p[2][2]);
+			const float g_45 = std::abs(p[1][0] + p[0][0] + p[0][1] - p[2][1] - p[2][2] - p[1][2]);
+			const float g_90 = std::abs(p[0][0] + p[1][0] + p[2][0] - p[0][2] - p[1][2] - p[2][2]);
+			const float g_135 = std::abs(p[1][0] + p[2][0] + p[2][1] - p[0][1] - p[0][2] - p[1][2]);
+
+			const float g_0_90_max = std::max(g_0, g_90);
+			const float g_0_90_min = std::min(g_0, g_90);
+			const float g_45_135_max = std::max(g_45, g_135);
+			const float g_45_135_min = std::min(g_45, g_135);
+
+			if (g_0_90_max + g_45_135_max == 0) {
+				return {};
+			}
+
+			const float e_0_90 = std::min(g_0_90_max / (g_0_90_max + g_45_135_max), 1.0f);
+			const float e_45_135 = 1.0f - e_0_90;
+
+			const bool c_0_90 = (g_0_90_max > (g_0_90_min * config.kDetectRatio)) && (g_0_90_max > config.kDetectThres) && (g_0_90_max > g_45_135_min);
+			const bool c_45_135 = (g_45_135_max > (g_45_135_min * config.kDetectRatio)) && (g_45_135_max > config.kDetectThres) && (g_45_135_max > g_0_90_min);
+			const bool c_g_0_90 = g_0_90_max == g_0;
+			const bool c_g_45_135 = g_45_135_max == g_45;
+
+			const float f_e_0_90 = (c_0_90 && c_45_135) ? e_0_90 : 1.0f;
+			const float f_e_45_135 = (c_0_90 && c_45_135) ? e_45_135 : 1.0f;
+
+			Float4 weights;
+			weights.x = (c_0_90 && c_g_0_90) ? f_e_0_90 : 0.0f;
+			weights.y = (c_0_90 && !c_g_0_90) ? f_e_0_90 : 0.0f;
+			weights.z = (c_45_135 && c_g_45_135) ? f_e_45_135 : 0.0f;
+			weights.w = (c_45_135 && !c_g_45_135) ? f_e_45_135 : 0.0f;
+			return weights;
+		}
+
+		float CalcLTI(const float p[6], int phase) const {
+			const bool selector = (phase <= PHASE_COUNT / 2);
+			float sel = selector ? p[0] : p[3];
+			const float a_min = std::min(std::min(p[1], p[2]), sel);
+			const float a_max = std::max(std::max(p[1], p[2]), sel);
+			sel = selector ? p[2] : p[5];
+			const float b_min = std::min(std::min(p[3], p[4]), sel);
+			const float b_max = std::max(std::max(p[3], p[4]), sel);
+
+			const float a_cont = a_max - a_min;
+			const float b_cont = b_max - b_min;
+
+			const float cont_ratio = std::max(a_cont, b_cont) / (std::min(a_cont, b_cont) + config.kEps);
+			return (1.0f - Saturate((cont_ratio - config.kMinContrastRatio) * config.kRatioNorm)) * config.kContrastBoost;
+		}
+
+		float EvalPoly6(const float pxl[6], int phase) const {
+			float y = 0.f;
+			float y_usm = 0.f;
+			for (int i = 0; i < 6; ++i) {
+				y += coefScaler[phase][i] * pxl[i];
+				y_usm += coefUsm[phase][i] * pxl[i];
+			}
+
+			const float y_scale = 1.0f - Saturate((y - config.kSharpStartY) * config.kSharpScaleY);
+			const float y_sharpness = y_scale * config.kSharpStrengthScale + config.kSharpStrengthMin;
+			y_usm *= y_sharpness;
+			const float y_sharpness_limit = (y_scale * config.kSharpLimitScale + config.kSharpLimitMin) * y;
+			y_usm = std::min(y_sharpness_limit, std::max(-y_sharpness_limit, y_usm));
+			y_usm *= CalcLTI(pxl, phase);
+			return y + y_usm;
+		}
+
+		float FilterNormal(const float p[6][6], int phaseX, int phaseY) const {
+			float h_acc = 0.0f;
+			for (int j = 0; j < 6; ++j) {
+				float v_acc = 0.0f;
+				for (int i = 0; i < 6; ++i) {
+					v_acc += p[i][j] * coefScaler[phaseY][i];
+				}
+				h_acc += v_acc * coefScaler[phaseX][j];
+			}
+			return h_acc;
+		}
+
+		float AddDirFilters(const float p[6][6], float fx, float fy, int phaseX, int phaseY, const Float4 &w) const {
+			float f = 0;
+			if (w.x > 0.0f) {
+				float interp[6];
+				for (int i = 0; i < 6; ++i) {
+					interp[i] = Lerp(p[i][2], p[i][3], fx);
+				}
+				f += EvalPoly6(interp, phaseY) * w.x;
+			}
+			if (w.y > 0.0f) {
+				float interp[6];
+				for (int i = 0; i < 6; ++i) {
+					interp[i] = Lerp(p[2][i], p[3][i], fy);
+				}
+				f += EvalPoly6(interp, phaseX) * w.y;
+			}
+			if (w.z > 0.0f) {
+				float phase = 0.5f + 0.5f * (fx - fy);
+				float temp[7];
+				temp[1] = Lerp(p[2][1], p[1][2], phase);
+				temp[3] = Lerp(p[3][2], p[2][3], phase);
+				temp[5] = Lerp(p[4][3], p[3][4], phase);
+				phase = phase - 0.5f;
+				const float a = (phase >= 0.f) ? p[0][2] : p[2][0];
+				const float b = (phase >= 0.f) ? p[1][3] : p[3][1];
+				const float c = (phase >= 0.f) ? p[2][4] : p[4][2];
+				const float d = (phase >= 0.f) ? p[3][5] : p[5][3];
+				temp[0] = Lerp(p[1][1], a, std::abs(phase));
+				temp[2] = Lerp(p[2][2], b, std::abs(phase));
+				temp[4] = Lerp(p[3][3], c, std::abs(phase));
+				temp[6] = Lerp(p[4][4], d, std::abs(phase));
+
+				float p45 = fx + fy;
+				int offset = 0;
+				if (p45 >= 1) {
+					offset = 1;
+					p45 = p45 - 1;
+				}
+				f += EvalPoly6(temp + offset, int(p45 * 64)) * w.z;
+			}
+			if (w.w > 0.0f) {
+				float phase = 0.5f * (fx + fy);
+				float temp[7];
+				temp[1] = Lerp(p[3][1], p[4][2], phase);
+				temp[3] = Lerp(p[2][2], p[3][3], phase);
+				temp[5] = Lerp(p[1][3], p[2][4], phase);
+				phase = phase - 0.5f;
+				const float a = (phase >= 0.f) ? p[5][2] : p[3][0];
+				const float b = (phase >= 0.f) ? p[4][3] : p[2][1];
+				const float c = (phase >= 0.f) ? p[3][4] : p[1][2];
+				const float d = (phase >= 0.f) ? p[2][5] : p[0][3];
+				temp[0] = Lerp(p[4][1], a, std::abs(phase));
+				temp[2] = Lerp(p[3][2], b, std::abs(phase));
+				temp[4] = Lerp(p[2][3], c, std::abs(phase));
+				temp[6] = Lerp(p[1][4], d, std::abs(phase));
+
+				float p135 = 1 + (fx - fy);
+				int offset = 0;
+				if (p135 >= 1) {
+					offset = 1;
+					p135 = p135 - 1;
+				}
+				f += EvalPoly6(temp + offset, int(p135 * 64)) * w.w;
+			}
+			return f;
+		}
+
+		void UpscalePixel(const Image &input, int dstX, int dstY, float *out) const {
+			const float srcX = (0.5f + dstX) * config.kScaleX - 0.5f;
+			const float srcY = (0.5f + dstY) * config.kScaleY - 0.5f;
+			const int ix = (int)std::floor(srcX);
+			const int iy = (int)std::floor(srcY);
+			const float fx = srcX - ix;
+			const float fy = srcY - iy;
+			const int phaseX = int(fx * PHASE_COUNT);
+			const int phaseY = int(fy * PHASE_COUNT);
+
+			Float4 edge[2][2];
+			for (int i = 0; i < 2; ++i) {
+				for (int j = 0; j < 2; ++j) {
+					edge[i][j] = EdgeMap(input, ix + j, iy + i);
+				}
+			}
+			const Float4 w = Lerp(Lerp(edge[0][0], edge[0][1], fx), Lerp(edge[1][0], edge[1][1], fx), fy);
+
+			float p[6][6];
+			for (int i = 0; i < 6; ++i) {
+				for (int j = 0; j < 6; ++j) {
+					p[i][j] = TileLuma(input, ix - 2 + j, iy - 2 + i);
+				}
+			}
+
+			const float baseWeight = 1.f - w.x - w.y - w.z - w.w;
+			float opY = FilterNormal(p, phaseX, phaseY) * baseWeight;
+			opY += AddDirFilters(p, fx, fy, phaseX, phaseY, w);
+
+			// bilinear tap for chroma, always at full precision
+			float op[3];
+			for (int c = 0; c < 3; ++c) {
+				float top = Lerp(input.At(ix, iy)[c], input.At(ix + 1, iy)[c], fx);
+				float bottom = Lerp(input.At(ix, iy + 1)[c], input.At(ix + 1, iy + 1)[c], fx);
+				op[c] = Lerp(top, bottom, fy);
+			}
+			const float corr = opY - Luma(op);
+			for (int c = 0; c < 3; ++c) {
+				// stored to a unorm texture
+				out[c] = Saturate(op[c] + corr);
+			}
+		}
+	};
+
+	Image CreateTestImage(int width, int height) {
+		Image image (width, height);
+		std::mt19937 rng (7);
+		std::uniform_real_distribution<float> noise (-0.05f, 0.05f);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				float u = float(x) / width, v = float(y) / height;
+				float *rgb = image.At(x, y);
+				if (u < 0.5f && v < 0.5f) {
+					// smooth gradients
+					rgb[0] = 2 * u;
+					rgb[1] = 2 * v;
+					rgb[2] = 1 - u - v;
+				}
+				else if (u >= 0.5f && v < 0.5f) {
+					// zone plate, detail at every frequency and orientation
+					float dx = u - 0.75f, dy = v - 0.25f;
+					float value = 0.5f + 0.5f * std::cos(2000.f * (dx * dx + dy * dy));
+					rgb[0] = rgb[1] = rgb[2] = value;
+				}
+				else if (u < 0.5f) {
+					// hard edges at many angles, like geometry edges in a game
+					float angle = std::atan2(v - 0.75f, u - 0.25f);
+					int sector = (int)std::floor(angle * 12 / 3.14159265f);
+					float value = (sector & 1) ? 0.9f : 0.1f;
+					rgb[0] = value;
+					rgb[1] = 0.5f * value + 0.2f;
+					rgb[2] = 1 - value;
+				}
+				else {
+					// textured surface with noise
+					float base = 0.5f + 0.3f * std::sin(40 * u) * std::sin(37 * v);
+					rgb[0] = Saturate(base + noise(rng));
+					rgb[1] = Saturate(base + noise(rng));
+					rgb[2] = Saturate(base + noise(rng));
+				}
+			}
+		}
+		return image;
+	}
+
+	struct Difference {
+		// in 8 bit steps
+		float maxError = 0;
+		float p999Error = 0;
+		double meanError = 0;
+		// share of values that differ by more than one 8 bit step
+		double flippedShare = 0;
+	};
+
+	Difference Measure(const Image &reference, const Image &image) {
+		Difference difference;
+		size_t flipped = 0;
+		std::vector<float> errors (reference.rgb.size());
+		for (size_t i = 0; i < reference.rgb.size(); ++i) {
+			float error = std::abs(reference.rgb[i] - image.rgb[i]) * 255.f;
+			difference.maxError = std::max(difference.maxError, error);
+			difference.meanError += error;
+			flipped += error > 1.f;
+			errors[i] = error;
+		}
+		auto p999 = errors.begin() + errors.size() * 999 / 1000;
+		std::nth_element(errors.begin(), p999, errors.end());
+		difference.p999Error = *p999;
+		difference.meanError /= reference.rgb.size();
+		difference.flippedShare = double(flipped) / reference.rgb.size();
+		return difference;
+	}
+
+	// returns false if the error exceeds the bounds
+	bool Compare(const Image &input, float renderScale, float sharpness) {
+		int outputWidth = (int)std::lround(input.width / renderScale);
+		int outputHeight = (int)std::lround(input.height / renderScale);
+		NISConfig config;
+		NVScalerUpdateConfig(config, sharpness, 0, 0, input.width, input.height, input.width, input.height,
+				0, 0, outputWidth, outputHeight, outputWidth, outputHeight);
+
+		Image full (outputWidth, outputHeight), halfFiltering (outputWidth, outputHeight), half (outputWidth, outputHeight);
+		NisReference(config, Precision::FULL).Upscale(input, full);
+		NisReference(config, Precision::HALF_FILTERING).Upscale(input, halfFiltering);
+		NisReference(config, Precision::HALF).Upscale(input, half);
+
+		Difference filtering = Measure(full, halfFiltering);
+		Difference total = Measure(full, half);
+		float maxTotalError = MAX_TOTAL_ERROR_BASE + MAX_TOTAL_ERROR_PER_SHARPNESS * sharpness;
+		bool passed = filtering.maxError <= MAX_FILTER_ERROR && total.maxError <= maxTotalError
+			&& total.p999Error <= MAX_TOTAL_P999_ERROR && total.flippedShare <= MAX_FLIPPED_SHARE;
+		std::printf("  scale %.3f, sharpness %.2f: filtering max %.3f mean %.4f | total max %6.3f p99.9 %.3f mean %.4f, %.3f%% > 1 step%s\n",
+			renderScale, sharpness, filtering.maxError, filtering.meanError, total.maxError, total.p999Error, total.meanError,
+			100.0 * total.flippedShare, passed ? "" : "  EXCEEDS BOUND");
+		return passed;
+	}
+}
+
+int main() {
+	Image input = CreateTestImage(384, 384);
+	std::printf("Half precision NIS upscaling compared to full precision, errors in 8 bit steps:\n");
+	bool passed = true;
+	for (float renderScale : { 0.5f, 0.667f, 0.77f, 0.83667f, 0.9f }) {
+		for (float sharpness : { 0.f, 0.3f, 1.f }) {
+			passed = Compare(input, renderScale, sharpness) && passed;
+		}
+	}
+	std::printf(passed ? "Within bounds\n" : "Half precision error exceeds the bounds\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+// Replays a synthetic stream of sampler binds, shaped like a game's (a few hot samplers, a long tail,
+// one to four samplers per call), through the MIP LOD bias sampler replacement. Compares the previous
+// unordered_set/unordered_map lookup, which was cleared on every bias change, with SamplerReplacementCache,
+// and checks the cache against a simple reference map, including under eviction.
+#include "sampler_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace vrperfkit;
+
+namespace {
+	struct MockSampler {
+		float mipLodBias = 0;
+		int maxAnisotropy = 16;
+	};
+
+	size_t g_created = 0;
+
+	std::shared_ptr<MockSampler> CreateSampler(const MockSampler &desc) {
+		++g_created;
+		return std::make_shared<MockSampler>(desc);
+	}
+
+	bool MustPassThrough(const MockSampler *sampler) {
+		return sampler->mipLodBias != 0 || sampler->maxAnisotropy == 1;
+	}
+
+	struct BindCall {
+		int count;
+		MockSampler *samplers[4];
+	};
+
+	struct Stream {
+		std::vector<std::unique_ptr<MockSampler>> samplers;
+		// the bias in effect during each frame
+		std::vector<float> frameBias;
+		std::vector<std::vector<BindCall>> frames;
+	};
+
+	Stream CreateStream(int samplerCount, int frameCount, int callsPerFrame, int biasChangeInterval) {
+		Stream stream;
+		std::mt19937 rng (1234);
+		for (int i = 0; i < samplerCount; ++i) {
+			auto sampler = std::make_unique<MockSampler>();
+			// some samplers aren't eligible for replacement
+			if (i % 5 == 0) sampler->maxAnisotropy = 1;
+			if (i % 17 == 0) sampler->mipLodBias = -0.5f;
+			stream.samplers.push_back(std::move(sampler));
+		}
+
+		// a handful of samplers are bound all the time, the rest only now and then
+		std::vector<double> weights;
+		for (int i = 0; i < samplerCount; ++i) {
+			weights.push_back(1.0 / (i + 1));
+		}
+		std::discrete_distribution<int> pick (weights.begin(), weights.end());
+		std::uniform_int_distribution<int> count (1, 4);
+		// a dynamic resolution controller moving back and forth between a few render scales
+		const float biases[] = { -0.38f, -0.45f, -0.52f, -0.45f };
+
+		for (int f = 0; f < frameCount; ++f) {
+			stream.frameBias.push_back(biases[(f / biasChangeInterval) % 4]);
+			std::vector<BindCall> calls (callsPerFrame);
+			for (BindCall &call : calls) {
+				call.count = count(rng);
+				for (int i = 0; i < call.count; ++i) {
+					call.samplers[i] = stream.samplers[pick(rng)].get();
+				}
+			}
+			stream.frames.push_back(std::move(calls));
+		}
+		return stream;
+	}
+
+	// the previous implementation in D3D12PostProcessor::PrePSSetSamplers
+	class MapReplacement {
+	public:
+		void SetBias(float bias) {
+			if (bias != mipLodBias) {
+				passThroughSamplers.clear();
+				mappedSamplers.clear();
+				mipLodBias = bias;
+			}
+		}
+
+		MockSampler *Bind(const BindCall &call) {
+			MockSampler *samplers[4];
+			memcpy(samplers, call.samplers, call.count * sizeof(MockSampler*));
+			for (int i = 0; i < call.count; ++i) {
+				MockSampler *orig = samplers[i];
+				if (passThroughSamplers.find(orig) != passThroughSamplers.end()) {
+					continue;
+				}
+				if (mappedSamplers.find(orig) == mappedSamplers.end()) {
+					if (MustPassThrough(orig)) {
+						passThroughSamplers.insert(orig);
+						continue;
+					}
+					MockSampler desc = *orig;
+					desc.mipLodBias = mipLodBias;
+					mappedSamplers[orig] = CreateSampler(desc);
+					passThroughSamplers.insert(mappedSamplers[orig].get());
+				}
+				samplers[i] = mappedSamplers[orig].get();
+			}
+			return samplers[0];
+		}
+
+	private:
+		float mipLodBias = 0;
+		std::unordered_set<MockSampler*> passThroughSamplers;
+		std::unordered_map<MockSampler*, std::shared_ptr<MockSampler>> mappedSamplers;
+	};
+
+	class CacheReplacement {
+	public:
+		explicit CacheReplacement(size_t maxEntries) : cache(maxEntries) {}
+
+		void SetBias(float bias) {
+			biasKey = cache.QuantizeBias(bias);
+		}
+
+		MockSampler *Bind(const BindCall &call) {
+			MockSampler *samplers[4];
+			bool replaced = false;
+			for (int i = 0; i < call.count; ++i) {
+				MockSampler *orig = call.samplers[i];
+				MockSampler *replacement = cache.Find(orig, biasKey);
+				if (replacement == nullptr) {
+					if (MustPassThrough(orig)) {
+						cache.Insert(orig, biasKey, orig);
+						continue;
+					}
+					MockSampler desc = *orig;
+					desc.mipLodBias = cache.BiasFromKey(biasKey);
+					auto sampler = CreateSampler(desc);
+					replacement = sampler.get();
+					cache.Insert(orig, biasKey, replacement, sampler);
+				}
+				if (replacement != orig) {
+					if (!replaced) {
+						memcpy(samplers, call.samplers, call.count * sizeof(MockSampler*));
+						replaced = true;
+					}
+					samplers[i] = replacement;
+				}
+			}
+			return replaced ? samplers[0] : call.samplers[0];
+		}
+
+		SamplerReplacementCache<MockSampler, std::shared_ptr<MockSampler>> cache;
+
+	private:
+		int biasKey = 0;
+	};
+
+	template<typename Replacement>
+	void Run(const char *name, Replacement &replacement, const Stream &stream) {
+		g_created = 0;
+		size_t binds = 0;
+		uintptr_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t f = 0; f < stream.frames.size(); ++f) {
+			replacement.SetBias(stream.frameBias[f]);
+			for (const BindCall &call : stream.frames[f]) {
+				sink += (uintptr_t)replacement.Bind(call);
+				++binds;
+			}
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		std::printf("  %-36s %6.1f ns per bind call, %6zu samplers created%s\n", name, ns / binds, g_created, sink == 0 ? " " : "");
+	}
+
+	// randomized comparison of the cache against std::map, with a capacity small enough to evict all the time
+	bool CheckCache() {
+		const size_t MAX_ENTRIES = 64;
+		SamplerReplacementCache<MockSampler, std::shared_ptr<MockSampler>> cache (MAX_ENTRIES);
+		std::map<std::pair<MockSampler*, int>, MockSampler*> reference;
+		std::vector<MockSampler> samplers (256);
+		std::mt19937 rng (42);
+
+		for (int i = 0; i < 200000; ++i) {
+			MockSampler *sampler = &samplers[rng() % samplers.size()];
+			int biasKey = (int)(rng() % 8) - 4;
+			MockSampler *found = cache.Find(sampler, biasKey);
+			auto it = reference.find({ sampler, biasKey });
+			if (found != nullptr && (it == reference.end() || it->second != found)) {
+				std::printf("cache returned a wrong entry\n");
+				return false;
+			}
+			if (found == nullptr) {
+				MockSampler *replacement = &samplers[rng() % samplers.size()];
+				cache.Insert(sampler, biasKey, replacement);
+				reference[{ sampler, biasKey }] = replacement;
+			}
+			if (cache.Size() > MAX_ENTRIES) {
+				std::printf("cache exceeded its size bound\n");
+				return false;
+			}
+		}
+		// eviction removes the oldest eighth, so the most recent seven eighths must all still be there
+		MockSampler *sampler = &samplers[0];
+		int recent = (int)(MAX_ENTRIES - MAX_ENTRIES / 8);
+		for (int biasKey = 100; biasKey < 100 + recent; ++biasKey) {
+			cache.Insert(sampler, biasKey, sampler);
+		}
+		for (int biasKey = 100; biasKey < 100 + recent; ++biasKey) {
+			if (cache.Find(sampler, biasKey) != sampler) {
+				std::printf("cache lost a recent entry\n");
+				return false;
+			}
+		}
+		std::printf("Cache check passed, %zu evictions\n", cache.Evictions());
+		return true;
+	}
+}
+
+int main() {
+	if (!CheckCache()) {
+		return 1;
+	}
+
+	const int FRAMES = 2000;
+	const int CALLS_PER_FRAME = 2000;
+	for (int interval : { 1000000, 30, 2 }) {
+		Stream stream = CreateStream(400, FRAMES, CALLS_PER_FRAME, interval);
+		if (interval >= FRAMES) {
+			std::printf("Constant bias:\n");
+		}
+		else {
+			std::printf("Bias changing every %d frames:\n", interval);
+		}
+		MapReplacement maps;
+		Run("unordered_set + unordered_map", maps, stream);
+		CacheReplacement cache (2048);
+		Run("SamplerReplacementCache", cache, stream);
+	}
+	return 0;
+}
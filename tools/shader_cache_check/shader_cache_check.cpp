@@ -0,0 +1,183 @@
+// Checks the shader manifest that D3D12ShaderCache keeps next to the config: that it round-trips through
+// serialization and the file system, that manifests of a different GPU or driver are ignored, and that
+// truncated or damaged files are rejected as a whole instead of prewarming garbage.
+#include "shader_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vrperfkit;
+
+namespace {
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		if (g_failures < 20) {
+			std::printf("FAILED: %s\n", message.c_str());
+		}
+		++g_failures;
+	}
+
+	ShaderCacheKey MakeKey(uint32_t vendor, uint32_t device, uint64_t driver) {
+		ShaderCacheKey key;
+		key.vendorId = vendor;
+		key.deviceId = device;
+		key.driverVersion = driver;
+		return key;
+	}
+
+	bool SameEntries(const ShaderCacheManifest &a, const ShaderCacheManifest &b) {
+		if (a.Entries().size() != b.Entries().size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.Entries().size(); ++i) {
+			if (a.Entries()[i].hash != b.Entries()[i].hash || a.Entries()[i].stage != b.Entries()[i].stage) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void CheckHash() {
+		// reference values of 64 bit FNV-1a
+		if (HashShaderBytecode("", 0) != 0xcbf29ce484222325ull || HashShaderBytecode("a", 1) != 0xaf63dc4c8601ec8cull) {
+			Fail("bytecode hash is not FNV-1a");
+		}
+	}
+
+	ShaderCacheManifest MakeManifest(const ShaderCacheKey &key, int count, std::mt19937_64 &rng) {
+		ShaderCacheManifest manifest (key);
+		for (int i = 0; i < count; ++i) {
+			manifest.Add(rng(), (ShaderStage)(i % (int)ShaderStage::COUNT));
+		}
+		return manifest;
+	}
+
+	void CheckAdd() {
+		ShaderCacheManifest manifest;
+		if (!manifest.Add(1, ShaderStage::COMPUTE) || manifest.Add(1, ShaderStage::PIXEL) || manifest.Entries().size() != 1) {
+			Fail("adding the same hash twice");
+		}
+		for (uint64_t i = 2; i < ShaderCacheManifest::MAX_ENTRIES + 10; ++i) {
+			manifest.Add(i, ShaderStage::COMPUTE);
+		}
+		if (manifest.Entries().size() != ShaderCacheManifest::MAX_ENTRIES) {
+			Fail("manifest grew beyond MAX_ENTRIES");
+		}
+	}
+
+	void CheckRoundTrip(std::mt19937_64 &rng) {
+		ShaderCacheKey key = MakeKey(0x10de, 0x2684, 0x001f000e000f1234ull);
+		for (int count : { 0, 1, 7, 100, (int)ShaderCacheManifest::MAX_ENTRIES }) {
+			ShaderCacheManifest written = MakeManifest(key, count, rng);
+			ShaderCacheManifest read (key);
+			if (!read.Deserialize(written.Serialize()) || !SameEntries(written, read)) {
+				Fail("round trip of " + std::to_string(count) + " entries");
+			}
+		}
+	}
+
+	void CheckKeyMismatch(std::mt19937_64 &rng) {
+		ShaderCacheKey key = MakeKey(0x1002, 0x73bf, 0x001f000e000f1234ull);
+		std::vector<uint8_t> data = MakeManifest(key, 20, rng).Serialize();
+		for (const ShaderCacheKey &other : { MakeKey(0x1003, 0x73bf, key.driverVersion), MakeKey(0x1002, 0x73c0, key.driverVersion), MakeKey(0x1002, 0x73bf, key.driverVersion + 1) }) {
+			ShaderCacheManifest read (other);
+			if (read.Deserialize(data) || !read.Entries().empty()) {
+				Fail("manifest of a different GPU or driver was accepted");
+			}
+		}
+	}
+
+	void CheckDamage(std::mt19937_64 &rng) {
+		ShaderCacheKey key = MakeKey(0x8086, 0x56a0, 42);
+		std::vector<uint8_t> data = MakeManifest(key, 30, rng).Serialize();
+
+		for (size_t length = 0; length < data.size(); ++length) {
+			ShaderCacheManifest read (key);
+			read.Add(1, ShaderStage::COMPUTE);
+			if (read.Deserialize(std::vector<uint8_t>(data.begin(), data.begin() + length)) || !read.Entries().empty()) {
+				Fail("manifest truncated to " + std::to_string(length) + " bytes was accepted");
+			}
+		}
+
+		std::vector<uint8_t> extended = data;
+		extended.push_back(0);
+		ShaderCacheManifest read (key);
+		if (read.Deserialize(extended)) {
+			Fail("manifest with trailing data was accepted");
+		}
+
+		for (size_t byte = 0; byte < data.size(); ++byte) {
+			for (int bit = 0; bit < 8; ++bit) {
+				std::vector<uint8_t> damaged = data;
+				damaged[byte] ^= 1 << bit;
+				ShaderCacheManifest read (key);
+				if (read.Deserialize(damaged)) {
+					Fail("manifest with bit " + std::to_string(bit) + " of byte " + std::to_string(byte) + " flipped was accepted");
+				}
+			}
+		}
+	}
+
+	void CheckFiles(std::mt19937_64 &rng) {
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "shader_cache_check.shaders";
+		std::filesystem::remove(path);
+
+		ShaderCacheKey key = MakeKey(0x10de, 0x2204, 7);
+		ShaderCacheManifest missing (key);
+		if (missing.Load(path)) {
+			Fail("loading a missing file succeeded");
+		}
+
+		ShaderCacheManifest written = MakeManifest(key, 50, rng);
+		if (!written.Save(path)) {
+			Fail("saving the manifest failed");
+		}
+		// saving again replaces the previous file
+		written.Add(12345, ShaderStage::PIXEL);
+		if (!written.Save(path)) {
+			Fail("saving over an existing manifest failed");
+		}
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		if (std::filesystem::exists(tempPath)) {
+			Fail("temporary file left behind");
+		}
+
+		ShaderCacheManifest read (key);
+		if (!read.Load(path) || !SameEntries(written, read)) {
+			Fail("manifest read back from the file differs");
+		}
+
+		{
+			std::ofstream file (path, std::ios::binary | std::ios::trunc);
+			file << "innerRadius: 0.6\n";
+		}
+		ShaderCacheManifest garbage (key);
+		if (garbage.Load(path) || !garbage.Entries().empty()) {
+			Fail("file that isn't a manifest was accepted");
+		}
+		std::filesystem::remove(path);
+	}
+}
+
+int main() {
+	std::mt19937_64 rng (20);
+	CheckHash();
+	CheckAdd();
+	CheckRoundTrip(rng);
+	CheckKeyMismatch(rng);
+	CheckDamage(rng);
+	CheckFiles(rng);
+
+	if (g_failures > 0) {
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,109 @@
+// Checks that the permutation tables generated by cmake/ShaderPermutations.cmake line up with
+// ShaderPermutationFlags, i.e. that the shader the upscalers pick for a set of flags was compiled
+// with exactly the defines those flags stand for, and checks the permutation selection itself.
+#include "shader_permutations.h"
+#include "shader_nis_copy.h"
+#include "shader_nis_copy_stereo.h"
+#include "shader_nis_sharpen.h"
+#include "shader_nis_upscale.h"
+#include "shader_nis_sharpen_stereo.h"
+#include "shader_nis_upscale_stereo.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace vrperfkit;
+
+namespace {
+	struct Define {
+		const char *name;
+		uint32_t flag;
+	};
+	const Define DEFINES[] = {
+		{ "RADIUS_CUTOFF", SHADER_RADIUS_CUTOFF },
+		{ "DEBUG_MODE", SHADER_DEBUG_MODE },
+		{ "HALF_PRECISION", SHADER_HALF_PRECISION },
+		{ "RDM_RECONSTRUCT", SHADER_RDM_RECONSTRUCT },
+	};
+
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		std::printf("FAILED: %s\n", message.c_str());
+		++g_failures;
+	}
+
+	bool Contains(const std::string &text, const std::string &part) {
+		return text.find(part) != std::string::npos;
+	}
+
+	void CheckTable(const char *name, const ShaderBytecode *table, size_t count) {
+		if (count != SHADER_PERMUTATION_COUNT) {
+			Fail(std::string(name) + " has " + std::to_string(count) + " permutations");
+			return;
+		}
+
+		for (uint32_t permutation = 0; permutation < count; ++permutation) {
+			const ShaderBytecode &entry = table[permutation];
+			std::string context = std::string(name) + " permutation " + std::to_string(permutation);
+			// the placeholder bytecode holds the index the generator gave it
+			if (entry.size != 1 || *(const unsigned char*)entry.data != permutation) {
+				Fail(context + " points at the wrong bytecode");
+			}
+
+			std::ifstream file (std::string(SHADER_WRAPPER_DIR) + "/" + name + "_" + std::to_string(permutation) + ".hlsl");
+			std::stringstream wrapper;
+			wrapper << file.rdbuf();
+			for (const Define &define : DEFINES) {
+				std::string value = (permutation & define.flag) ? "1" : "0";
+				if (!Contains(entry.defines, std::string(define.name) + "=" + value)) {
+					Fail(context + " is listed with defines " + entry.defines);
+				}
+				if (!Contains(wrapper.str(), std::string("#define ") + define.name + " " + value + "\n")) {
+					Fail(context + " is not compiled with " + define.name + " " + value);
+				}
+			}
+		}
+	}
+
+	void CheckSelection(const char *name, uint32_t actual, uint32_t expected) {
+		if (actual != expected) {
+			Fail(std::string(name) + ": selected " + std::to_string(actual) + ", expected " + std::to_string(expected));
+		}
+	}
+}
+
+#define CHECK_TABLE(table, name) CheckTable(name, table, sizeof(table) / sizeof(table[0]))
+
+int main() {
+	CHECK_TABLE(g_NISCopyShader, "shader_nis_copy");
+	CHECK_TABLE(g_NISCopyStereoShader, "shader_nis_copy_stereo");
+	CHECK_TABLE(g_NISSharpenShader, "shader_nis_sharpen");
+	CHECK_TABLE(g_NISUpscaleShader, "shader_nis_upscale");
+	CHECK_TABLE(g_NISSharpenStereoShader, "shader_nis_sharpen_stereo");
+	CHECK_TABLE(g_NISUpscaleStereoShader, "shader_nis_upscale_stereo");
+
+	// a 2016x2240 eye with the projection centre off to the side, as on an Index
+	const uint32_t W = 2016, H = 2240, CX = 1150, CY = 1120;
+	auto squared = [](float radius) { return (uint32_t)(radius * radius); };
+	// the default radius of 0.95 leaves the corners out
+	CheckSelection("default radius", SelectShaderPermutation(false, false, W, H, CX, CY, squared(0.5f * 0.95f * H)), SHADER_RADIUS_CUTOFF);
+	CheckSelection("default radius, debug", SelectShaderPermutation(true, false, W, H, CX, CY, squared(0.5f * 0.95f * H)), SHADER_RADIUS_CUTOFF | SHADER_DEBUG_MODE);
+	CheckSelection("default radius, fp16", SelectShaderPermutation(false, true, W, H, CX, CY, squared(0.5f * 0.95f * H)), SHADER_RADIUS_CUTOFF | SHADER_HALF_PRECISION);
+	// the farthest corner is sqrt(1150^2 + 1120^2) = 1605 pixels away
+	CheckSelection("radius just short of the far corner", SelectShaderPermutation(true, false, W, H, CX, CY, squared(1604)), SHADER_RADIUS_CUTOFF | SHADER_DEBUG_MODE);
+	CheckSelection("radius reaching the far corner", SelectShaderPermutation(true, false, W, H, CX, CY, squared(1606)), 0);
+	CheckSelection("radius covering everything, fp16", SelectShaderPermutation(true, true, W, H, CX, CY, squared(5000)), SHADER_HALF_PRECISION);
+	// mirrored for the other eye
+	CheckSelection("mirrored, reaching the far corner", SelectShaderPermutation(false, false, W, H, W - CX, CY, squared(1606)), 0);
+	CheckSelection("mirrored, short of the far corner", SelectShaderPermutation(false, false, W, H, W - CX, CY, squared(1604)), SHADER_RADIUS_CUTOFF);
+
+	if (g_failures > 0) {
+		std::printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	std::printf("All shader permutation checks passed\n");
+	return 0;
+}
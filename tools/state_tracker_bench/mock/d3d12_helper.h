@@ -0,0 +1,200 @@
+#pragma once
+// Just enough of the D3D12 device context for D3D12StateTracker, replacing src/d3d12/d3d12_helper.h
+// in the benchmark build. Every context call is counted, and the context keeps the bindings it was
+// given so that the benchmark can check what the tracker puts back.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+typedef unsigned int UINT;
+
+struct ID3D12ClassInstance {};
+struct ID3D12ComputeShader {};
+struct ID3D12VertexShader {};
+struct ID3D12PixelShader {};
+struct ID3D12ShaderResourceView {};
+struct ID3D12UnorderedAccessView {};
+struct ID3D12SamplerState {};
+struct ID3D12InputLayout {};
+struct ID3D12RenderTargetView {};
+struct ID3D12DepthStencilView {};
+struct ID3D12DepthStencilState {};
+struct ID3D12RasterizerState {};
+struct ID3D12Resource {};
+
+enum D3D12_PRIMITIVE_TOPOLOGY {
+	D3D12_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D12_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+	D3D12_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5,
+};
+
+struct D3D12_VIEWPORT {
+	float TopLeftX, TopLeftY, Width, Height, MinDepth, MaxDepth;
+};
+
+const UINT D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT = 8;
+const UINT D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE = 16;
+const UINT D3D12_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT = 14;
+const UINT D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT = 128;
+const UINT D3D12_COMMONSHADER_SAMPLER_SLOT_COUNT = 16;
+const UINT D3D12_1_UAV_SLOT_COUNT = 64;
+
+// the mock objects aren't reference counted, so this only needs to hold the pointer
+template<typename T>
+class ComPtr {
+public:
+	ComPtr() = default;
+	ComPtr(T *p) : p(p) {}
+	ComPtr &operator=(T *other) { p = other; return *this; }
+	T *Get() const { return p; }
+	T *operator->() const { return p; }
+	T **GetAddressOf() { return &p; }
+	T *const *GetAddressOf() const { return &p; }
+	T **ReleaseAndGetAddressOf() { p = nullptr; return &p; }
+	void Attach(T *other) { p = other; }
+	void Reset() { p = nullptr; }
+	explicit operator bool() const { return p != nullptr; }
+
+private:
+	T *p = nullptr;
+};
+
+struct MockPipelineState {
+	ID3D12ComputeShader *computeShader = nullptr;
+	ID3D12Resource *csConstantBuffers[D3D12_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {};
+	ID3D12ShaderResourceView *csShaderResources[D3D12_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+	ID3D12UnorderedAccessView *csUavs[D3D12_1_UAV_SLOT_COUNT] = {};
+	ID3D12SamplerState *csSamplers[D3D12_COMMONSHADER_SAMPLER_SLOT_COUNT] = {};
+	ID3D12VertexShader *vertexShader = nullptr;
+	ID3D12PixelShader *pixelShader = nullptr;
+	ID3D12Resource *vsConstantBuffer = nullptr;
+	ID3D12Resource *psConstantBuffer = nullptr;
+	ID3D12InputLayout *inputLayout = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY topology = D3D12_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	ID3D12RenderTargetView *renderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+	ID3D12DepthStencilView *depthStencil = nullptr;
+	ID3D12DepthStencilState *depthStencilState = nullptr;
+	UINT stencilRef = 0;
+	ID3D12RasterizerState *rasterizerState = nullptr;
+	D3D12_VIEWPORT viewports[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE] = {};
+	UINT numViewports = 0;
+
+	bool operator==(const MockPipelineState &o) const {
+		return computeShader == o.computeShader
+			&& std::equal(std::begin(csConstantBuffers), std::end(csConstantBuffers), std::begin(o.csConstantBuffers))
+			&& std::equal(std::begin(csShaderResources), std::end(csShaderResources), std::begin(o.csShaderResources))
+			&& std::equal(std::begin(csUavs), std::end(csUavs), std::begin(o.csUavs))
+			&& std::equal(std::begin(csSamplers), std::end(csSamplers), std::begin(o.csSamplers))
+			&& vertexShader == o.vertexShader && pixelShader == o.pixelShader
+			&& vsConstantBuffer == o.vsConstantBuffer && psConstantBuffer == o.psConstantBuffer
+			&& inputLayout == o.inputLayout && topology == o.topology
+			&& std::equal(std::begin(renderTargets), std::end(renderTargets), std::begin(o.renderTargets))
+			&& depthStencil == o.depthStencil && depthStencilState == o.depthStencilState && stencilRef == o.stencilRef
+			&& rasterizerState == o.rasterizerState && numViewports == o.numViewports
+			&& std::memcmp(viewports, o.viewports, sizeof(viewports)) == 0;
+	}
+};
+
+class ID3D12DeviceContext {
+public:
+	MockPipelineState state;
+	uint64_t calls = 0;
+
+	void CSSetShader(ID3D12ComputeShader *shader, ID3D12ClassInstance *const *, UINT) { ++calls; state.computeShader = shader; }
+	void CSGetShader(ID3D12ComputeShader **shader, ID3D12ClassInstance **, UINT *) { ++calls; *shader = state.computeShader; }
+	void CSSetConstantBuffers(UINT start, UINT num, ID3D12Resource *const *buffers) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) state.csConstantBuffers[start + i] = buffers[i];
+	}
+	void CSGetConstantBuffers(UINT start, UINT num, ID3D12Resource **buffers) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) buffers[i] = state.csConstantBuffers[start + i];
+	}
+	void CSSetShaderResources(UINT start, UINT num, ID3D12ShaderResourceView *const *views) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) state.csShaderResources[start + i] = views != nullptr ? views[i] : nullptr;
+	}
+	void CSGetShaderResources(UINT start, UINT num, ID3D12ShaderResourceView **views) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) views[i] = state.csShaderResources[start + i];
+	}
+	void CSSetUnorderedAccessViews(UINT start, UINT num, ID3D12UnorderedAccessView *const *uavs, const UINT *) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) state.csUavs[start + i] = uavs != nullptr ? uavs[i] : nullptr;
+	}
+	void CSGetUnorderedAccessViews(UINT start, UINT num, ID3D12UnorderedAccessView **uavs) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) uavs[i] = state.csUavs[start + i];
+	}
+	void CSSetSamplers(UINT start, UINT num, ID3D12SamplerState *const *samplers) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) state.csSamplers[start + i] = samplers != nullptr ? samplers[i] : nullptr;
+	}
+	void CSGetSamplers(UINT start, UINT num, ID3D12SamplerState **samplers) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) samplers[i] = state.csSamplers[start + i];
+	}
+
+	void VSSetShader(ID3D12VertexShader *shader, ID3D12ClassInstance *const *, UINT) { ++calls; state.vertexShader = shader; }
+	void VSGetShader(ID3D12VertexShader **shader, ID3D12ClassInstance **, UINT *) { ++calls; *shader = state.vertexShader; }
+	void PSSetShader(ID3D12PixelShader *shader, ID3D12ClassInstance *const *, UINT) { ++calls; state.pixelShader = shader; }
+	void PSGetShader(ID3D12PixelShader **shader, ID3D12ClassInstance **, UINT *) { ++calls; *shader = state.pixelShader; }
+	void VSSetConstantBuffers(UINT, UINT, ID3D12Resource *const *buffers) { ++calls; state.vsConstantBuffer = buffers[0]; }
+	void VSGetConstantBuffers(UINT, UINT, ID3D12Resource **buffers) { ++calls; buffers[0] = state.vsConstantBuffer; }
+	void PSSetConstantBuffers(UINT, UINT, ID3D12Resource *const *buffers) { ++calls; state.psConstantBuffer = buffers[0]; }
+	void PSGetConstantBuffers(UINT, UINT, ID3D12Resource **buffers) { ++calls; buffers[0] = state.psConstantBuffer; }
+
+	void IASetInputLayout(ID3D12InputLayout *layout) { ++calls; state.inputLayout = layout; }
+	void IAGetInputLayout(ID3D12InputLayout **layout) { ++calls; *layout = state.inputLayout; }
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) { ++calls; state.topology = topology; }
+	void IAGetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY *topology) { ++calls; *topology = state.topology; }
+
+	void OMSetRenderTargets(UINT num, ID3D12RenderTargetView *const *rtvs, ID3D12DepthStencilView *dsv) {
+		++calls;
+		for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) state.renderTargets[i] = i < num && rtvs != nullptr ? rtvs[i] : nullptr;
+		state.depthStencil = dsv;
+	}
+	void OMGetRenderTargets(UINT num, ID3D12RenderTargetView **rtvs, ID3D12DepthStencilView **dsv) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) rtvs[i] = state.renderTargets[i];
+		if (dsv != nullptr) *dsv = state.depthStencil;
+	}
+	void OMSetDepthStencilState(ID3D12DepthStencilState *dss, UINT ref) { ++calls; state.depthStencilState = dss; state.stencilRef = ref; }
+	void OMGetDepthStencilState(ID3D12DepthStencilState **dss, UINT *ref) { ++calls; *dss = state.depthStencilState; *ref = state.stencilRef; }
+
+	void RSSetState(ID3D12RasterizerState *rs) { ++calls; state.rasterizerState = rs; }
+	void RSGetState(ID3D12RasterizerState **rs) { ++calls; *rs = state.rasterizerState; }
+	void RSSetViewports(UINT num, const D3D12_VIEWPORT *viewports) {
+		++calls;
+		for (UINT i = 0; i < num; ++i) state.viewports[i] = viewports[i];
+		for (UINT i = num; i < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE; ++i) state.viewports[i] = D3D12_VIEWPORT();
+		state.numViewports = num;
+	}
+	void RSGetViewports(UINT *num, D3D12_VIEWPORT *viewports) {
+		++calls;
+		if (viewports == nullptr) {
+			*num = state.numViewports;
+			return;
+		}
+		for (UINT i = 0; i < *num && i < state.numViewports; ++i) viewports[i] = state.viewports[i];
+		*num = state.numViewports;
+	}
+};
+
+namespace vrperfkit {
+	// the full save and restore in src/d3d12/d3d12_helper.cpp, with the same number of context calls
+	struct D3D12State {
+		MockPipelineState state;
+	};
+
+	inline void StoreD3D12State(ID3D12DeviceContext *context, D3D12State &state) {
+		state.state = context->state;
+		context->calls += 17;
+	}
+
+	inline void RestoreD3D12State(ID3D12DeviceContext *context, const D3D12State &state) {
+		context->state = state.state;
+		context->calls += 16;
+	}
+}
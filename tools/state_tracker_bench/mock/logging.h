@@ -0,0 +1,5 @@
+#pragma once
+#include <iostream>
+
+// the tracker only logs its periodic statistics, which the benchmark reports itself
+#define LOG_DEBUG if (false) std::cout
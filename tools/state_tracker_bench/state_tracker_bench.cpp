@@ -0,0 +1,315 @@
+// Counts the device context calls our post-processing spends on saving and restoring the game's
+// pipeline state, with the full save/restore against the shadow copy kept by D3D12StateTracker.
+// The game's bindings go through the same notifications the setter hooks in d3d12_injector.cpp
+// send, and the passes override the same state groups as the upscaling and depth mask passes in
+// d3d12_post_processor.cpp. After every pass the context must hold exactly the game's bindings again.
+#include "d3d12_state_tracker.h"
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace vrperfkit;
+
+namespace {
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		if (g_failures < 20) {
+			std::printf("FAILED: %s\n", message.c_str());
+		}
+		++g_failures;
+	}
+
+	const uint32_t UPSCALE_GROUPS = STATE_COMPUTE | STATE_OUTPUT_MERGER;
+	const uint32_t DEPTH_MASK_GROUPS = STATE_GRAPHICS_SHADERS | STATE_INPUT_ASSEMBLER | STATE_OUTPUT_MERGER | STATE_RASTERIZER | STATE_DEPTH_STENCIL;
+	// as in D3D12Injector
+	const uint32_t TRACKED_GROUPS = UPSCALE_GROUPS | DEPTH_MASK_GROUPS;
+
+	// a few distinct objects of each kind for the game and for our own passes
+	template<typename T>
+	struct Pool {
+		T objects[8];
+		T *Pick(std::mt19937 &rng) {
+			int i = std::uniform_int_distribution<int>(-1, 7)(rng);
+			return i < 0 ? nullptr : &objects[i];
+		}
+	};
+
+	struct Objects {
+		Pool<ID3D12ComputeShader> computeShaders;
+		Pool<ID3D12VertexShader> vertexShaders;
+		Pool<ID3D12PixelShader> pixelShaders;
+		Pool<ID3D12Resource> buffers;
+		Pool<ID3D12ShaderResourceView> srvs;
+		Pool<ID3D12UnorderedAccessView> uavs;
+		Pool<ID3D12SamplerState> samplers;
+		Pool<ID3D12InputLayout> inputLayouts;
+		Pool<ID3D12RenderTargetView> rtvs;
+		Pool<ID3D12DepthStencilView> dsvs;
+		Pool<ID3D12DepthStencilState> depthStencilStates;
+		Pool<ID3D12RasterizerState> rasterizerStates;
+	};
+
+	// the game's side of the context: calls that reach the context through our hooks
+	class Game {
+	public:
+		Game(ID3D12DeviceContext *context, Objects &objects) : context(context), objects(objects) {}
+
+		void SetTracker(D3D12StateTracker *tracker) { this->tracker = tracker; }
+		uint64_t Notifications() const { return notifications; }
+
+		void RandomBinds(std::mt19937 &rng, int count) {
+			for (int i = 0; i < count; ++i) {
+				RandomBind(rng);
+			}
+		}
+
+	private:
+		ID3D12DeviceContext *context;
+		Objects &objects;
+		D3D12StateTracker *tracker = nullptr;
+		uint64_t notifications = 0;
+
+		bool Notify() {
+			if (tracker != nullptr && !tracker->IsOverriding()) {
+				++notifications;
+				return true;
+			}
+			return false;
+		}
+
+		void RandomBind(std::mt19937 &rng) {
+			switch (std::uniform_int_distribution<int>(0, 14)(rng)) {
+			case 0: {
+				ID3D12ComputeShader *shader = objects.computeShaders.Pick(rng);
+				context->CSSetShader(shader, nullptr, 0);
+				if (Notify()) tracker->OnCSSetShader(shader);
+				break;
+			}
+			case 1: {
+				UINT slot = std::uniform_int_distribution<UINT>(0, 2)(rng);
+				ID3D12Resource *buffer = objects.buffers.Pick(rng);
+				// constant buffers aren't hooked, the tracker reads them when an override begins
+				context->CSSetConstantBuffers(slot, 1, &buffer);
+				break;
+			}
+			case 2: {
+				UINT start = std::uniform_int_distribution<UINT>(0, 5)(rng);
+				ID3D12ShaderResourceView *views[4];
+				for (auto &view : views) view = objects.srvs.Pick(rng);
+				context->CSSetShaderResources(start, 4, views);
+				if (Notify()) tracker->OnCSSetShaderResources(start, 4, views);
+				break;
+			}
+			case 3: {
+				ID3D12UnorderedAccessView *uav = objects.uavs.Pick(rng);
+				context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+				if (Notify()) tracker->OnCSSetUnorderedAccessViews(0, 1, &uav);
+				break;
+			}
+			case 4: {
+				ID3D12SamplerState *sampler = objects.samplers.Pick(rng);
+				context->CSSetSamplers(0, 1, &sampler);
+				if (Notify()) tracker->OnCSSetSamplers(0, 1, &sampler);
+				break;
+			}
+			case 5: {
+				ID3D12VertexShader *shader = objects.vertexShaders.Pick(rng);
+				context->VSSetShader(shader, nullptr, 0);
+				if (Notify()) tracker->OnVSSetShader(shader);
+				break;
+			}
+			case 6: {
+				ID3D12PixelShader *shader = objects.pixelShaders.Pick(rng);
+				context->PSSetShader(shader, nullptr, 0);
+				if (Notify()) tracker->OnPSSetShader(shader);
+				break;
+			}
+			case 7: {
+				ID3D12Resource *vs = objects.buffers.Pick(rng);
+				ID3D12Resource *ps = objects.buffers.Pick(rng);
+				context->VSSetConstantBuffers(0, 1, &vs);
+				context->PSSetConstantBuffers(0, 1, &ps);
+				break;
+			}
+			case 8: {
+				ID3D12InputLayout *layout = objects.inputLayouts.Pick(rng);
+				context->IASetInputLayout(layout);
+				if (Notify()) tracker->OnIASetInputLayout(layout);
+				break;
+			}
+			case 9: {
+				D3D12_PRIMITIVE_TOPOLOGY topology = rng() & 1 ? D3D12_PRIMITIVE_TOPOLOGY_TRIANGLELIST : D3D12_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+				context->IASetPrimitiveTopology(topology);
+				if (Notify()) tracker->OnIASetPrimitiveTopology(topology);
+				break;
+			}
+			case 10: {
+				UINT num = std::uniform_int_distribution<UINT>(0, 4)(rng);
+				ID3D12RenderTargetView *rtvs[4];
+				for (auto &rtv : rtvs) rtv = objects.rtvs.Pick(rng);
+				ID3D12DepthStencilView *dsv = objects.dsvs.Pick(rng);
+				context->OMSetRenderTargets(num, rtvs, dsv);
+				if (Notify()) tracker->OnOMSetRenderTargets(num, rtvs, dsv);
+				break;
+			}
+			case 11: {
+				ID3D12DepthStencilState *dss = objects.depthStencilStates.Pick(rng);
+				UINT ref = rng() & 0xff;
+				context->OMSetDepthStencilState(dss, ref);
+				if (Notify()) tracker->OnOMSetDepthStencilState(dss, ref);
+				break;
+			}
+			case 12: {
+				ID3D12RasterizerState *rs = objects.rasterizerStates.Pick(rng);
+				context->RSSetState(rs);
+				if (Notify()) tracker->OnRSSetState(rs);
+				break;
+			}
+			default: {
+				UINT num = std::uniform_int_distribution<UINT>(1, 2)(rng);
+				D3D12_VIEWPORT viewports[2];
+				for (auto &vp : viewports) {
+					vp = { 0, 0, float(rng() % 2000 + 1), float(rng() % 2000 + 1), 0, 1 };
+				}
+				context->RSSetViewports(num, viewports);
+				if (Notify()) tracker->OnRSSetViewports(num, viewports);
+				break;
+			}
+			}
+		}
+	};
+
+	// what the upscaling pass binds on top of the game's state, up to the tile list of the foveated NIS passes
+	void UpscalePass(ID3D12DeviceContext *context, Objects &objects, std::mt19937 &rng) {
+		ID3D12ShaderResourceView *srvs[3] = { objects.srvs.Pick(rng), objects.srvs.Pick(rng), objects.srvs.Pick(rng) };
+		ID3D12ShaderResourceView *tileList = objects.srvs.Pick(rng);
+		ID3D12UnorderedAccessView *uav = objects.uavs.Pick(rng);
+		ID3D12SamplerState *sampler = objects.samplers.Pick(rng);
+		// the second one for the RDM constants of upscalers reconstructing a masked input
+		ID3D12Resource *buffers[2] = { objects.buffers.Pick(rng), objects.buffers.Pick(rng) };
+		context->OMSetRenderTargets(0, nullptr, nullptr);
+		context->CSSetShader(objects.computeShaders.Pick(rng), nullptr, 0);
+		context->CSSetConstantBuffers(0, 2, buffers);
+		context->CSSetShaderResources(0, 3, srvs);
+		context->CSSetShaderResources(3, 1, &tileList);
+		context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+		context->CSSetSamplers(0, 1, &sampler);
+	}
+
+	// and what the depth mask pass binds
+	void DepthMaskPass(ID3D12DeviceContext *context, Objects &objects, std::mt19937 &rng) {
+		ID3D12Resource *buffer = objects.buffers.Pick(rng);
+		D3D12_VIEWPORT viewport = { 0, 0, 1000, 1000, 0, 1 };
+		context->VSSetShader(objects.vertexShaders.Pick(rng), nullptr, 0);
+		context->PSSetShader(objects.pixelShaders.Pick(rng), nullptr, 0);
+		context->VSSetConstantBuffers(0, 1, &buffer);
+		context->PSSetConstantBuffers(0, 1, &buffer);
+		context->IASetInputLayout(nullptr);
+		context->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		context->OMSetRenderTargets(0, nullptr, objects.dsvs.Pick(rng));
+		context->OMSetDepthStencilState(objects.depthStencilStates.Pick(rng), 1);
+		context->RSSetState(objects.rasterizerStates.Pick(rng));
+		context->RSSetViewports(1, &viewport);
+	}
+
+	struct RunResult {
+		double saveRestoreCallsPerFrame = 0;
+		double notificationsPerFrame = 0;
+	};
+
+	RunResult Run(bool tracked, bool depthMask, int frames, int bindsPerFrame, const std::string &name) {
+		Objects objects;
+		ID3D12DeviceContext context;
+		Game game (&context, objects);
+		std::mt19937 rng (7);
+		game.RandomBinds(rng, 200);
+
+		std::unique_ptr<D3D12StateTracker> tracker;
+		if (tracked) {
+			tracker.reset(new D3D12StateTracker(&context, TRACKED_GROUPS));
+			game.SetTracker(tracker.get());
+		}
+
+		uint64_t saveRestoreCalls = 0;
+		auto runPass = [&](uint32_t groups, void (*pass)(ID3D12DeviceContext*, Objects&, std::mt19937&), int frame) {
+			MockPipelineState before = context.state;
+			uint64_t passCalls = 0;
+
+			uint64_t start = context.calls;
+			std::unique_ptr<D3D12StateOverride> override (new D3D12StateOverride(tracker.get(), &context, groups));
+			passCalls += context.calls - start;
+
+			pass(&context, objects, rng);
+
+			start = context.calls;
+			override.reset();
+			passCalls += context.calls - start;
+			saveRestoreCalls += passCalls;
+
+			if (!(context.state == before)) {
+				Fail(name + ": game state not restored after a pass in frame " + std::to_string(frame));
+			}
+		};
+
+		for (int frame = 0; frame < frames; ++frame) {
+			game.RandomBinds(rng, bindsPerFrame);
+			if (depthMask) {
+				runPass(DEPTH_MASK_GROUPS, &DepthMaskPass, frame);
+				game.RandomBinds(rng, bindsPerFrame / 4);
+				runPass(DEPTH_MASK_GROUPS, &DepthMaskPass, frame);
+			}
+			game.RandomBinds(rng, bindsPerFrame);
+			runPass(UPSCALE_GROUPS, &UpscalePass, frame);
+			game.RandomBinds(rng, bindsPerFrame / 4);
+			runPass(UPSCALE_GROUPS, &UpscalePass, frame);
+			if (tracker) {
+				tracker->EndFrame();
+			}
+		}
+
+		RunResult result;
+		result.saveRestoreCallsPerFrame = double(saveRestoreCalls) / frames;
+		result.notificationsPerFrame = double(game.Notifications()) / frames;
+		return result;
+	}
+
+	void Report(bool depthMask, int bindsPerFrame) {
+		const int FRAMES = 20000;
+		std::string name = std::string(depthMask ? "upscaling + depth mask" : "upscaling") + ", " + std::to_string(bindsPerFrame) + " binds";
+		RunResult full = Run(false, depthMask, FRAMES, bindsPerFrame, name + ", full");
+		RunResult tracked = Run(true, depthMask, FRAMES, bindsPerFrame, name + ", tracked");
+
+		double expectedFull = (depthMask ? 4 : 2) * 33.0;
+		double expectedTracked = 2 * 7.0 + (depthMask ? 2 * 12.0 : 0);
+		if (full.saveRestoreCallsPerFrame != expectedFull) {
+			Fail(name + ": full save/restore took " + std::to_string(full.saveRestoreCallsPerFrame) + " calls per frame");
+		}
+		if (tracked.saveRestoreCallsPerFrame != expectedTracked) {
+			Fail(name + ": tracked save/restore took " + std::to_string(tracked.saveRestoreCallsPerFrame) + " calls per frame");
+		}
+
+		std::printf("%s per frame:\n", name.c_str());
+		std::printf("  full save/restore   %6.1f context calls\n", full.saveRestoreCallsPerFrame);
+		std::printf("  tracked             %6.1f context calls, %6.1f hook notifications\n",
+			tracked.saveRestoreCallsPerFrame, tracked.notificationsPerFrame);
+	}
+}
+
+int main() {
+	// the mock context calls cost next to nothing, so only the call counts are meaningful here; every
+	// notification is a few pointer stores, while a context call goes through the runtime's locking
+	for (int binds : { 40, 400 }) {
+		Report(false, binds);
+		Report(true, binds);
+	}
+
+	if (g_failures > 0) {
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,218 @@
+// Checks the tile lists TileClassifier builds for the foveated upscaling passes: that the filter and copy
+// tiles together cover every pixel of every eye's viewport exactly once, with each tile carrying the index
+// of the eye whose constants the shaders must select for it, that the filter blocks are the ones the
+// shaders used to pick with their per-group radius check, and that the dispatch layout of tile_list.h
+// maps every thread group to a listed tile with no more padding than promised.
+#include "tile_classifier.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vrperfkit;
+
+namespace {
+	int g_failures = 0;
+
+	void Fail(const std::string &message) {
+		if (g_failures < 20) {
+			std::printf("FAILED: %s\n", message.c_str());
+		}
+		++g_failures;
+	}
+
+	// the check the shaders made per thread group before, with the same unsigned wraparound
+	bool ShaderBlockInRadius(uint32_t blockX, uint32_t blockY, uint32_t blockWidth, uint32_t blockHeight, const TileClassifierEye &eye) {
+		uint32_t dx = eye.projCentreX - (blockX * blockWidth + blockWidth / 2);
+		uint32_t dy = eye.projCentreY - (blockY * blockHeight + blockHeight / 2);
+		return dx * dx + dy * dy <= eye.squaredRadius;
+	}
+
+	// returns the tiles a list dispatches, one per thread group
+	std::vector<uint32_t> DispatchedTiles(const std::vector<uint32_t> &list, const std::string &context) {
+		std::vector<uint32_t> tiles;
+		uint32_t groupsX, groupsY;
+		if (!TileClassifier::DispatchSize(list, groupsX, groupsY)) {
+			if (list.size() != 1) {
+				Fail(context + ": nothing to dispatch, but the list has " + std::to_string(list.size()) + " elements");
+			}
+			return tiles;
+		}
+		if (groupsX == 0 || groupsX > TILE_LIST_MAX_ROW || groupsY == 0 || groupsY > TILE_LIST_MAX_ROW) {
+			Fail(context + ": dispatch of " + std::to_string(groupsX) + " x " + std::to_string(groupsY) + " groups");
+			return tiles;
+		}
+		if (1 + (size_t)groupsX * groupsY != list.size()) {
+			Fail(context + ": dispatch doesn't match the list length");
+			return tiles;
+		}
+		for (uint32_t y = 0; y < groupsY; ++y) {
+			for (uint32_t x = 0; x < groupsX; ++x) {
+				tiles.push_back(list[TileListIndex(x, y, list[0])]);
+			}
+		}
+		return tiles;
+	}
+
+	// drops the padding at the end, which must repeat the last tile and be shorter than a group per row
+	void RemovePadding(std::vector<uint32_t> &tiles, uint32_t rows, size_t expectedCount, const std::string &context) {
+		if (tiles.size() < expectedCount || tiles.size() - expectedCount >= rows + (expectedCount == 0 ? 1 : 0)) {
+			Fail(context + ": " + std::to_string(tiles.size()) + " groups dispatched for " + std::to_string(expectedCount) + " tiles");
+			return;
+		}
+		for (size_t i = expectedCount; i < tiles.size(); ++i) {
+			if (tiles[i] != tiles[expectedCount - 1]) {
+				Fail(context + ": padding doesn't repeat the last tile");
+			}
+		}
+		tiles.resize(expectedCount);
+	}
+
+	void Check(uint32_t blockWidth, uint32_t blockHeight, const std::vector<TileClassifierEye> &eyes, const std::string &context) {
+		TileClassifier classifier;
+		if (!classifier.Classify(blockWidth, blockHeight, eyes.data(), (int)eyes.size())) {
+			Fail(context + ": first classification reported no change");
+		}
+
+		// what the lists must contain, in the order the classifier goes through the blocks
+		size_t expectedFilter = 0, expectedCopy = 0;
+		for (const TileClassifierEye &eye : eyes) {
+			uint32_t blocksX = (eye.viewportWidth + blockWidth - 1) / blockWidth;
+			uint32_t blocksY = (eye.viewportHeight + blockHeight - 1) / blockHeight;
+			for (uint32_t by = 0; by < blocksY; ++by) {
+				for (uint32_t bx = 0; bx < blocksX; ++bx) {
+					if (ShaderBlockInRadius(bx, by, blockWidth, blockHeight, eye)) {
+						++expectedFilter;
+					}
+					else {
+						uint32_t w = std::min(blockWidth, eye.viewportWidth - bx * blockWidth);
+						uint32_t h = std::min(blockHeight, eye.viewportHeight - by * blockHeight);
+						expectedCopy += ((w + COPY_TILE_WIDTH - 1) / COPY_TILE_WIDTH) * ((h + COPY_TILE_HEIGHT - 1) / COPY_TILE_HEIGHT);
+					}
+				}
+			}
+		}
+
+		std::vector<uint32_t> filterTiles = DispatchedTiles(classifier.FilterList(), context + " filter");
+		std::vector<uint32_t> copyTiles = DispatchedTiles(classifier.CopyList(), context + " copy");
+		uint32_t x, y;
+		RemovePadding(filterTiles, TileClassifier::DispatchSize(classifier.FilterList(), x, y) ? y : 0, expectedFilter, context + " filter");
+		RemovePadding(copyTiles, TileClassifier::DispatchSize(classifier.CopyList(), x, y) ? y : 0, expectedCopy, context + " copy");
+
+		// count how often each pixel gets written, going by the eye the shaders select for the tile
+		std::vector<std::vector<uint8_t>> coverage (eyes.size());
+		for (size_t i = 0; i < eyes.size(); ++i) {
+			coverage[i].assign((size_t)eyes[i].viewportWidth * eyes[i].viewportHeight, 0);
+		}
+		auto cover = [&](uint32_t tile, uint32_t width, uint32_t height) {
+			if (TileEye(tile) >= eyes.size()) {
+				Fail(context + ": tile for an eye that wasn't classified");
+				return;
+			}
+			const TileClassifierEye &eye = eyes[TileEye(tile)];
+			for (uint32_t py = TileY(tile) * height; py < (TileY(tile) + 1) * height; ++py) {
+				for (uint32_t px = TileX(tile) * width; px < (TileX(tile) + 1) * width; ++px) {
+					// the shaders skip pixels outside the viewport, but a whole tile outside means the wrong eye
+					if (px < eye.viewportWidth && py < eye.viewportHeight) {
+						++coverage[TileEye(tile)][(size_t)py * eye.viewportWidth + px];
+					}
+					else if (px == TileX(tile) * width && py == TileY(tile) * height) {
+						Fail(context + ": tile entirely outside the viewport of eye " + std::to_string(TileEye(tile)));
+						return;
+					}
+				}
+			}
+		};
+		for (uint32_t tile : filterTiles) {
+			if (TileEye(tile) < eyes.size() && !ShaderBlockInRadius(TileX(tile), TileY(tile), blockWidth, blockHeight, eyes[TileEye(tile)])) {
+				Fail(context + ": filter block outside the radius");
+			}
+			cover(tile, blockWidth, blockHeight);
+		}
+		for (uint32_t tile : copyTiles) {
+			cover(tile, COPY_TILE_WIDTH, COPY_TILE_HEIGHT);
+		}
+		for (size_t i = 0; i < eyes.size(); ++i) {
+			for (uint8_t count : coverage[i]) {
+				if (count != 1) {
+					Fail(context + ": pixel of eye " + std::to_string(i) + " written " + std::to_string(count) + " times");
+					break;
+				}
+			}
+		}
+
+		if (classifier.Classify(blockWidth, blockHeight, eyes.data(), (int)eyes.size())) {
+			Fail(context + ": classifying the same eyes again reported a change");
+		}
+		std::vector<TileClassifierEye> moved = eyes;
+		moved[0].projCentreX += 1;
+		if (!classifier.Classify(blockWidth, blockHeight, moved.data(), (int)moved.size())) {
+			Fail(context + ": moving the projection centre reported no change");
+		}
+	}
+
+	TileClassifierEye MakeEye(uint32_t width, uint32_t height, float projX, float projY, float radius) {
+		TileClassifierEye result;
+		result.viewportWidth = width;
+		result.viewportHeight = height;
+		result.projCentreX = (uint32_t)(width * projX);
+		result.projCentreY = (uint32_t)(height * projY);
+		// as the upscalers compute it from the configured radius
+		float r = 0.5f * radius * height;
+		result.squaredRadius = (uint32_t)(r * r);
+		return result;
+	}
+}
+
+int main() {
+	const uint32_t BLOCK_SIZES[][2] = { { 32, 24 }, { 32, 32 } };
+	std::mt19937 rng (99);
+	std::uniform_int_distribution<uint32_t> size (1, 3000);
+	std::uniform_real_distribution<float> proj (0.3f, 0.7f);
+	std::uniform_real_distribution<float> radius (0.f, 1.6f);
+
+	int cases = 0;
+	for (const auto &block : BLOCK_SIZES) {
+		std::string blockName = std::to_string(block[0]) + "x" + std::to_string(block[1]);
+		// fixed cases: everything within the radius, nothing within it, tiny viewports
+		Check(block[0], block[1], { MakeEye(2016, 2240, 0.5f, 0.5f, 1.6f) }, blockName + " all filtered");
+		Check(block[0], block[1], { MakeEye(2016, 2240, 0.5f, 0.5f, 0.f) }, blockName + " radius 0");
+		Check(block[0], block[1], { MakeEye(1, 1, 0.5f, 0.5f, 0.5f) }, blockName + " single pixel");
+		// the game submitted the right eye first, so it comes first in the stereo constants; the eyes differ
+		// in size and projection centre so that tiles tagged with the wrong index don't cover the right pixels
+		Check(block[0], block[1], { MakeEye(1856, 2080, 0.56f, 0.5f, 0.6f), MakeEye(2016, 2240, 0.44f, 0.5f, 0.6f) }, blockName + " right eye first");
+		cases += 4;
+
+		for (int i = 0; i < 100; ++i) {
+			uint32_t width = size(rng), height = size(rng);
+			float r = radius(rng);
+			std::string context = blockName + " " + std::to_string(width) + "x" + std::to_string(height) + " radius " + std::to_string(r);
+			Check(block[0], block[1], { MakeEye(width, height, proj(rng), proj(rng), r) }, context + " mono");
+			Check(block[0], block[1], {
+				MakeEye(width, height, proj(rng), proj(rng), r),
+				MakeEye(width, height, proj(rng), proj(rng), r),
+			}, context + " stereo");
+			cases += 2;
+		}
+	}
+
+	// stereo at a resolution where the copy list needs more than one dispatch row
+	TileClassifierEye large[] = { MakeEye(4320, 4320, 0.45f, 0.5f, 0.3f), MakeEye(4320, 4320, 0.55f, 0.5f, 0.3f) };
+	Check(32, 24, { large[0], large[1] }, "32x24 large stereo");
+	TileClassifier classifier;
+	classifier.Classify(32, 24, large, 2);
+	uint32_t x, y;
+	if (!TileClassifier::DispatchSize(classifier.CopyList(), x, y) || y < 2) {
+		Fail("large stereo copy list fits a single dispatch row, the multi-row layout went unchecked");
+	}
+	++cases;
+
+	if (g_failures > 0) {
+		std::printf("%d failures in %d cases\n", g_failures, cases);
+		return 1;
+	}
+	std::printf("All %d cases passed\n", cases);
+	return 0;
+}
@@ -0,0 +1,223 @@
+// Replays an event trace recorded with traceEvents enabled through the same render target and
+// depth buffer heuristics the mod uses in game, so that settings like ignoreFirstTargetRenders or
+// renderOnlyTarget can be tried out without running the game.
+#include "config.h"
+#include "render_heuristics.h"
+#include "trace_format.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace vrperfkit {
+	Config g_config;
+	FrameState g_frameState;
+}
+
+using namespace vrperfkit;
+
+namespace {
+	// D3D12_CLEAR_DEPTH, so that we don't need any Windows headers
+	const uint8_t CLEAR_DEPTH = 1;
+
+	struct Options {
+		std::string tracePath;
+		TargetSelection hrmSelection;
+		bool hrmPrecise = true;
+		int maxFrames = -1;
+		bool quiet = false;
+	};
+
+	void PrintUsage() {
+		std::cerr << "Usage: trace_replay <trace file> [options]\n"
+			<< "  --game-mode auto|single|left|right\n"
+			<< "  --hrm-ignore-first N, --hrm-ignore-last N, --hrm-render-only N, --hrm-imprecise\n"
+			<< "  --vrs-ignore-first N, --vrs-ignore-last N, --vrs-render-only N, --vrs-imprecise\n"
+			<< "  --vrs-fast-mode, --vrs-fast-mode-hrm-count, --vrs-eye-order <order, e.g. LLRR>\n"
+			<< "  --frames N     only print the first N frames\n"
+			<< "  --quiet        only print the summary\n";
+	}
+
+	bool ParseGameMode(const std::string &s, GameMode &mode) {
+		if (s == "auto") mode = GameMode::AUTO;
+		else if (s == "single") mode = GameMode::GENERIC_SINGLE;
+		else if (s == "left") mode = GameMode::LEFT_EYE_FIRST;
+		else if (s == "right") mode = GameMode::RIGHT_EYE_FIRST;
+		else return false;
+		return true;
+	}
+
+	bool ParseOptions(int argc, char *argv[], Options &options) {
+		if (argc < 2) {
+			return false;
+		}
+		options.tracePath = argv[1];
+
+		g_config.ffr.enabled = true;
+		g_config.ffr.apply = true;
+		g_config.hiddenMask.enabled = true;
+
+		for (int i = 2; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--game-mode" && hasValue) {
+				if (!ParseGameMode(argv[++i], g_config.gameMode)) return false;
+			}
+			else if (arg == "--hrm-ignore-first" && hasValue) options.hrmSelection.ignoreFirst = std::atoi(argv[++i]);
+			else if (arg == "--hrm-ignore-last" && hasValue) options.hrmSelection.ignoreLast = std::atoi(argv[++i]);
+			else if (arg == "--hrm-render-only" && hasValue) options.hrmSelection.renderOnly = std::atoi(argv[++i]);
+			else if (arg == "--hrm-imprecise") options.hrmPrecise = false;
+			else if (arg == "--vrs-ignore-first" && hasValue) g_config.ffr.ignoreFirstTargetRenders = std::atoi(argv[++i]);
+			else if (arg == "--vrs-ignore-last" && hasValue) g_config.ffr.ignoreLastTargetRenders = std::atoi(argv[++i]);
+			else if (arg == "--vrs-render-only" && hasValue) g_config.ffr.renderOnlyTarget = std::atoi(argv[++i]);
+			else if (arg == "--vrs-imprecise") g_config.ffr.preciseResolution = false;
+			else if (arg == "--vrs-fast-mode") g_config.ffr.fastMode = true;
+			else if (arg == "--vrs-fast-mode-hrm-count") g_config.ffrFastModeUsesHRMCount = true;
+			else if (arg == "--vrs-eye-order" && hasValue) g_config.ffr.overrideSingleEyeOrder = argv[++i];
+			else if (arg == "--frames" && hasValue) options.maxFrames = std::atoi(argv[++i]);
+			else if (arg == "--quiet") options.quiet = true;
+			else return false;
+		}
+
+		// same as the config loader does
+		if (!g_config.ffr.fastMode) {
+			g_config.ffrFastModeUsesHRMCount = false;
+		}
+		return true;
+	}
+
+	bool LoadTrace(const std::string &path, std::vector<TraceRecord> &records) {
+		std::ifstream file (path, std::ios::binary);
+		TraceHeader header;
+		if (!file.read((char*)&header, sizeof(header))) {
+			std::cerr << "Could not read " << path << "\n";
+			return false;
+		}
+		if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION
+				|| header.recordSize != sizeof(TraceRecord) || header.capacity == 0) {
+			std::cerr << path << " is not a trace file of a supported version\n";
+			return false;
+		}
+
+		std::vector<TraceRecord> ring (header.capacity);
+		file.read((char*)ring.data(), ring.size() * sizeof(TraceRecord));
+
+		// oldest record first; records that were still being written when the game exited are dropped
+		uint64_t first = header.written > header.capacity ? header.written - header.capacity : 0;
+		for (uint64_t i = first; i < header.written; ++i) {
+			const TraceRecord &record = ring[i % header.capacity];
+			if (record.sequence == uint32_t(i + 1)) {
+				records.push_back(record);
+			}
+		}
+		return true;
+	}
+
+	const char *EyeName(int eye) {
+		return eye == RIGHT_EYE ? "R" : "L";
+	}
+
+	std::string Size(const TraceRecord &record) {
+		std::ostringstream s;
+		s << record.width << "x" << record.height;
+		if (record.arraySize > 1) {
+			s << "[" << record.arraySize << "]";
+		}
+		if (record.sampleCount > 1) {
+			s << " " << record.sampleCount << "xMSAA";
+		}
+		return s.str();
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<TraceRecord> records;
+	if (!LoadTrace(options.tracePath, records)) {
+		return 1;
+	}
+
+	VrsTargetClassifier vrs;
+	DepthClearCounter depthClears;
+	depthClears.Configure(options.hrmSelection);
+
+	uint32_t eyeWidth = 0;
+	uint32_t eyeHeight = 0;
+	int frame = 0;
+	int submittedEyes = 0;
+	std::ostringstream eyeLog;
+	std::map<int, int> eyeDepthClearCounts;
+	int maskedClears = 0;
+	std::map<VrsTarget, int> vrsTargets;
+
+	for (const TraceRecord &record : records) {
+		bool print = !options.quiet && (options.maxFrames < 0 || frame < options.maxFrames);
+
+		switch (record.type) {
+		case TraceEventType::RENDER_TARGETS: {
+			VrsTarget target = vrs.Classify(g_config, record.width, record.height, record.arraySize);
+			++vrsTargets[target];
+			if (target != VrsTarget::NONE) {
+				eyeLog << "  RT " << Size(record) << " -> VRS " << VrsTargetToString(target) << "\n";
+			}
+			break;
+		}
+
+		case TraceEventType::DEPTH_CLEAR:
+			if ((record.info & CLEAR_DEPTH) && IsEyeDepthBuffer(record.width, record.height, eyeWidth, eyeHeight, options.hrmPrecise)) {
+				bool masked = depthClears.OnDepthClear(true);
+				maskedClears += masked;
+				eyeLog << "  depth clear #" << depthClears.Count() << " " << Size(record) << (masked ? " -> masked" : "") << "\n";
+			}
+			break;
+
+		case TraceEventType::SUBMIT:
+			if (print) {
+				std::cout << "frame " << frame << ", eye " << EyeName(record.eye) << " submitted as " << Size(record)
+					<< " (heuristics assumed " << EyeName(GuessRenderingEye(false)) << ")\n" << eyeLog.str();
+			}
+			eyeLog.str("");
+			++eyeDepthClearCounts[depthClears.Count()];
+			++submittedEyes;
+
+			EndSubmittedEye();
+			depthClears.EndEye();
+			eyeWidth = record.width;
+			eyeHeight = record.height;
+			vrs.SetEyeTarget(record.width, record.height, (TextureMode)record.info);
+			break;
+
+		case TraceEventType::FRAME_END:
+			if (vrs.EndFrame(g_config) && print) {
+				std::cout << "found " << vrs.SingleEyeTargetCount() << " single eye render targets, using order " << vrs.SingleEyeOrder() << "\n";
+			}
+			++frame;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	std::cout << "\n" << records.size() << " events, " << frame << " frames, " << submittedEyes << " submitted eyes\n";
+	std::cout << "Eye sized depth clears per eye:\n";
+	for (auto &entry : eyeDepthClearCounts) {
+		std::cout << "  " << entry.first << ": " << entry.second << " eyes\n";
+	}
+	std::cout << "Masked depth clears: " << maskedClears << "\n";
+	std::cout << "VRS decisions for bound render targets:\n";
+	for (auto &entry : vrsTargets) {
+		std::cout << "  " << VrsTargetToString(entry.first) << ": " << entry.second << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Measures how long generating the fixed foveated VRS patterns takes for typical eye resolutions,
+// comparing the per-tile sqrt evaluation the mod used before with VrsPatternGenerator, and checks
+// that both produce the same patterns.
+#include "vrs_pattern.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using namespace vrperfkit;
+
+namespace {
+	const int TILE_SIZE = 16;
+	const VrsPatternRadii RADII;
+
+	// the original implementation from d3d12_variable_rate_shading.cpp
+	uint8_t DistanceToVRSLevel(float distance) {
+		if (distance < RADII.inner) {
+			return 0;
+		}
+		if (distance < RADII.mid) {
+			return 1;
+		}
+		if (distance < RADII.outer) {
+			return 2;
+		}
+		return 3;
+	}
+
+	std::vector<uint8_t> ReferenceCombined(int width, int height, float leftProjX, float leftProjY, float rightProjX, float rightProjY) {
+		std::vector<uint8_t> data (width * height);
+		int halfWidth = width / 2;
+
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < halfWidth; ++x) {
+				float fx = float(x) / halfWidth;
+				float fy = float(y) / height;
+				float distance = 2 * sqrtf((fx - leftProjX) * (fx - leftProjX) + (fy - leftProjY) * (fy - leftProjY));
+				data[y * width + x] = DistanceToVRSLevel(distance);
+			}
+			for (int x = halfWidth; x < width; ++x) {
+				float fx = float(x - halfWidth) / halfWidth;
+				float fy = float(y) / height;
+				float distance = 2 * sqrtf((fx - rightProjX) * (fx - rightProjX) + (fy - rightProjY) * (fy - rightProjY));
+				data[y * width + x] = DistanceToVRSLevel(distance);
+			}
+		}
+
+		return data;
+	}
+
+	double MeasureMicroseconds(const std::function<void()> &fn) {
+		using clock = std::chrono::steady_clock;
+		// repeat until the measurement is long enough to be meaningful
+		int iterations = 1;
+		while (true) {
+			auto start = clock::now();
+			for (int i = 0; i < iterations; ++i) {
+				fn();
+			}
+			double elapsed = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+			if (elapsed > 200000 || iterations >= (1 << 20)) {
+				return elapsed / iterations;
+			}
+			iterations *= 2;
+		}
+	}
+
+	size_t CountMismatches(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+		if (a.size() != b.size()) {
+			return a.size() + b.size();
+		}
+		size_t mismatches = 0;
+		for (size_t i = 0; i < a.size(); ++i) {
+			mismatches += a[i] != b[i];
+		}
+		return mismatches;
+	}
+
+	void Benchmark(const char *name, int eyeWidth, int eyeHeight) {
+		int width = 2 * eyeWidth / TILE_SIZE;
+		int height = eyeHeight / TILE_SIZE;
+		float leftProjX = 0.57f, leftProjY = 0.5f, rightProjX = 0.43f, rightProjY = 0.5f;
+
+		VrsPatternGenerator scalar;
+		scalar.SetForceScalar(true);
+		scalar.SetMultithreading(false);
+		VrsPatternGenerator simd;
+		simd.SetMultithreading(false);
+		VrsPatternGenerator threaded;
+		VrsPatternGenerator cached;
+		cached.EnableCache(0.005f, 32);
+
+		auto reference = ReferenceCombined(width, height, leftProjX, leftProjY, rightProjX, rightProjY);
+		size_t mismatches = CountMismatches(reference, scalar.Combined(width, height, leftProjX, leftProjY, rightProjX, rightProjY, RADII))
+			+ CountMismatches(reference, simd.Combined(width, height, leftProjX, leftProjY, rightProjX, rightProjY, RADII))
+			+ CountMismatches(reference, threaded.Combined(width, height, leftProjX, leftProjY, rightProjX, rightProjY, RADII))
+			+ CountMismatches(reference, cached.Combined(width, height, leftProjX, leftProjY, rightProjX, rightProjY, RADII));
+
+		// alternate between two radii so that every call has to regenerate the pattern, like dynamic FFR does
+		int flip = 0;
+		auto regenerate = [&](VrsPatternGenerator &generator) {
+			VrsPatternRadii radii = RADII;
+			radii.inner += 0.01f * (flip ^= 1);
+			generator.Combined(width, height, leftProjX, leftProjY, rightProjX, rightProjY, radii);
+		};
+		// moving projection centers force the distance tables to be rebuilt as well
+		auto rebuild = [&](VrsPatternGenerator &generator) {
+			float offset = 0.01f * (flip ^= 1);
+			generator.Combined(width, height, leftProjX + offset, leftProjY, rightProjX, rightProjY, RADII);
+		};
+
+		double referenceTime = MeasureMicroseconds([&]() { reference = ReferenceCombined(width, height, leftProjX, leftProjY, rightProjX, rightProjY); });
+		double scalarTime = MeasureMicroseconds([&]() { regenerate(scalar); });
+		double simdRebuildTime = MeasureMicroseconds([&]() { rebuild(simd); });
+		double simdTime = MeasureMicroseconds([&]() { regenerate(simd); });
+		double threadedTime = MeasureMicroseconds([&]() { regenerate(threaded); });
+		double cachedTime = MeasureMicroseconds([&]() { regenerate(cached); });
+
+		std::printf("%-10s %5dx%-5d tiles %7.1f us reference, %7.1f us scalar, %7.1f us %s (%7.1f us with new tables), %7.1f us threaded, %5.2f us cached, %zu mismatches\n",
+			name, width, height, referenceTime, scalarTime, simdTime, VrsPatternGenerator::KernelName(), simdRebuildTime, threadedTime, cachedTime, mismatches);
+	}
+}
+
+int main() {
+	std::printf("Combined patterns of two eyes, %dx%d pixel tiles\n", TILE_SIZE, TILE_SIZE);
+	Benchmark("Quest 2", 1832, 1920);
+	Benchmark("Index", 2016, 2240);
+	Benchmark("4K", 3840, 2160);
+	Benchmark("4K square", 3840, 3840);
+	Benchmark("8K", 7680, 4320);
+	Benchmark("16K", 15360, 8640);
+	return 0;
+}